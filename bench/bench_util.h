@@ -0,0 +1,261 @@
+#pragma once
+
+#include "esp_chip.h"
+#include "esp_endian.h"
+#include "esp_image.h"
+#include "esp_partition.h"
+#include "esp_prologue.h"
+#include "esp_sha256.h"
+#include "esp_verify.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace EspAppBench
+{
+    using namespace EspApp;
+
+    // Fill `code` with functions the way a compiler lays them out, so that the prologue scan has real starts
+    // to find. Xtensa: `entry a1, N` at 4-byte aligned addresses, 16/24-bit ALU instructions, `retw.n`, zero
+    // padding. RISC-V: `addi sp, sp, -N`, `c.addi16sp` or `c.addi sp`, 16/32-bit ALU instructions, then
+    // `c.jr ra` or `jalr x0, 0(ra)`. Returns the number of functions.
+    inline size_t FillSyntheticCode(uint8_t* code, size_t size, PrologueArch arch, uint64_t seed)
+    {
+        uint64_t state = seed | 1;
+        auto next = [&state]() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return static_cast<uint32_t>(state >> 32);
+        };
+        auto put16 = [&](size_t at, uint32_t value) { StoreLE16(code + at, static_cast<uint16_t>(value)); };
+        auto put32 = [&](size_t at, uint32_t value) { StoreLE32(code + at, value); };
+
+        std::memset(code, 0, size);
+        size_t functions = 0;
+        size_t at = 0;
+        while (at + 64 <= size)
+        {
+            size_t end = std::min(size - 8, at + 24 + next() % 480);
+            if (arch == PrologueArch::Xtensa)
+            {
+                uint32_t frameUnits = 4 + next() % 61;
+                code[at] = 0x36;
+                code[at + 1] = static_cast<uint8_t>(0x01 | (frameUnits & 0xF) << 4);
+                code[at + 2] = static_cast<uint8_t>(frameUnits >> 4);
+                at += 3;
+                while (at + 3 <= end)
+                {
+                    uint32_t r = next();
+                    if (r & 1)
+                    {
+                        // add ar, as, at
+                        code[at] = static_cast<uint8_t>((r >> 4 & 0xF) << 4);
+                        code[at + 1] = static_cast<uint8_t>(r >> 8);
+                        code[at + 2] = 0x80;
+                        at += 3;
+                    }
+                    else
+                    {
+                        // mov.n at, as
+                        put16(at, 0x000D | (r >> 4 & 0xFF) << 4);
+                        at += 2;
+                    }
+                }
+                put16(at, 0xF01D);  // retw.n
+                at = (at + 2 + 3) & ~size_t(3);
+            }
+            else if (arch == PrologueArch::RiscV)
+            {
+                uint32_t r = next();
+                if (r % 3 == 0)
+                {
+                    put32(at, 0x00010113 | (uint32_t(-int32_t(16 * (1 + r / 3 % 32))) & 0xFFF) << 20);
+                    at += 4;
+                }
+                else
+                {
+                    put16(at, r % 3 == 1 ? 0x7139 : 0x1141);  // c.addi16sp sp, -64 or c.addi sp, -16
+                    at += 2;
+                }
+                while (at + 4 <= end)
+                {
+                    uint32_t rd = 10 + next() % 6, rs1 = 10 + next() % 6, rs2 = 10 + next() % 6;
+                    if (next() & 1)
+                    {
+                        put32(at, 0x33 | rd << 7 | rs1 << 15 | rs2 << 20);  // add rd, rs1, rs2
+                        at += 4;
+                    }
+                    else
+                    {
+                        put16(at, 0x8002 | rd << 7 | rs2 << 2);  // c.mv rd, rs2
+                        at += 2;
+                    }
+                }
+                if (next() & 1)
+                {
+                    put16(at, 0x8082);  // c.jr ra
+                    at += 2;
+                }
+                else
+                {
+                    put32(at, 0x00008067);  // jalr x0, 0(ra)
+                    at += 4;
+                }
+            }
+            else
+            {
+                break;
+            }
+            functions++;
+        }
+        return functions;
+    }
+
+    // Build a well-formed app image for `attr` with `segmentCount` segments of `segmentSize` bytes. Segments
+    // are spread round-robin over the chip's regions, code regions first, so that region mapping succeeds and
+    // even a one-segment image has code. Segments in code regions hold synthetic functions (FillSyntheticCode),
+    // the others a byte pattern.
+    inline std::vector<uint8_t> BuildSyntheticImage(const ChipAttr& attr, size_t segmentCount, uint32_t segmentSize)
+    {
+        std::vector<uint8_t> image(sizeof(EspImageHeader));
+        image[0] = ESP_IMAGE_HEADER_MAGIC;
+        image[1] = static_cast<uint8_t>(segmentCount);
+        StoreLE16(image.data() + 12, static_cast<uint16_t>(attr.chip_id));
+
+        std::vector<size_t> order(attr.region_count);
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_partition(order.begin(), order.end(),
+            [&attr](size_t i) { return (attr.regions[i].flags & RegionContainsCode) != 0; });
+
+        for (size_t i = 0; i < segmentCount; i++)
+        {
+            const MemoryRegion& region = attr.regions[order[i % attr.region_count]];
+            uint64_t regionSize = region.end_addr - region.start_addr;
+            uint32_t len = static_cast<uint32_t>(std::min<uint64_t>(segmentSize, regionSize / 2));
+            uint64_t slot = i / attr.region_count;
+            uint32_t addr = static_cast<uint32_t>(region.start_addr + std::min<uint64_t>(slot * len, regionSize - len));
+            if (i == 0)
+                StoreLE32(image.data() + 4, addr);
+
+            size_t at = image.size();
+            image.resize(at + sizeof(EspSegmentHeader) + len);
+            StoreLE32(image.data() + at, addr);
+            StoreLE32(image.data() + at + 4, len);
+            uint8_t* data = image.data() + at + sizeof(EspSegmentHeader);
+            if ((region.flags & RegionContainsCode) &&
+                FillSyntheticCode(data, len, GetPrologueArch(attr), 0x9E3779B97F4A7C15ull + i))
+                continue;
+            for (uint32_t j = 0; j < len; j++)
+                data[j] = static_cast<uint8_t>(i * 31 + j);
+        }
+        return image;
+    }
+
+    // Append the checksum and SHA-256 trailer the way esptool does, and set hash_appended in the header
+    inline void AppendImageTrailer(std::vector<uint8_t>& image)
+    {
+        image[23] = 1;
+
+        ParsedImage parsed;
+        if (ParseImage(image, parsed) != ImageParseStatus::Ok)
+            return;
+
+        uint8_t checksum = ESP_CHECKSUM_MAGIC;
+        for (const auto& seg : parsed.Segments())
+            for (uint32_t i = 0; i < seg.data_len; i++)
+                checksum ^= image[seg.file_offset + i];
+
+        ImageTrailer trailer = LocateImageTrailer(parsed);
+        image.resize(trailer.checksum_offset + 1, 0);
+        image[trailer.checksum_offset] = checksum;
+
+        Sha256Digest digest = Sha256::Hash(image);
+        image.insert(image.end(), digest.begin(), digest.end());
+    }
+
+    // Build a raw flash dump of `flashSize` bytes: partition table at 0x8000 followed by factory, ota_0 and
+    // ota_1 app partitions, where ota_1 is a byte-identical copy of ota_0
+    inline std::vector<uint8_t> BuildSyntheticFlashDump(const ChipAttr& attr, size_t flashSize, uint32_t segmentSize)
+    {
+        std::vector<uint8_t> flash(flashSize, 0xFF);
+        uint32_t partitionSize = static_cast<uint32_t>((flashSize - 0x10000) / 3) & ~0xFFFFu;
+
+        const struct
+        {
+            const char* label;
+            uint8_t subtype;
+            size_t segments;
+        } apps[] = {{"factory", AppFactory, 4}, {"ota_0", AppOtaMin, 8}, {"ota_1", AppOtaMin + 1, 8}};
+
+        size_t entryOffset = ESP_PARTITION_TABLE_OFFSET;
+        for (size_t i = 0; i < 3; i++)
+        {
+            uint32_t offset = 0x10000 + static_cast<uint32_t>(i) * partitionSize;
+            uint8_t* entry = flash.data() + entryOffset;
+            std::memset(entry, 0, sizeof(EspPartitionEntry));
+            StoreLE16(entry, ESP_PARTITION_MAGIC);
+            entry[2] = static_cast<uint8_t>(EspPartitionType::App);
+            entry[3] = apps[i].subtype;
+            StoreLE32(entry + 4, offset);
+            StoreLE32(entry + 8, partitionSize);
+            std::memcpy(entry + 12, apps[i].label, std::strlen(apps[i].label));
+            entryOffset += sizeof(EspPartitionEntry);
+
+            std::vector<uint8_t> image = BuildSyntheticImage(attr, apps[i].segments, segmentSize);
+            AppendImageTrailer(image);
+            std::memcpy(flash.data() + offset, image.data(), std::min<size_t>(image.size(), partitionSize));
+        }
+        return flash;
+    }
+
+    // Run `fn` repeatedly for at least `minSeconds` and print ns/op and, when `bytesPerOp` is non-zero,
+    // throughput. Returns ns/op.
+    template <typename Fn>
+    double RunBenchmark(const char* name, uint64_t bytesPerOp, Fn&& fn, double minSeconds = 0.25)
+    {
+        using Clock = std::chrono::steady_clock;
+        uint64_t iterations = 0;
+        uint64_t batch = 1;
+        auto start = Clock::now();
+        double elapsed = 0;
+        while (elapsed < minSeconds)
+        {
+            for (uint64_t i = 0; i < batch; i++)
+                fn();
+            iterations += batch;
+            batch *= 2;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        double nsPerOp = elapsed * 1e9 / static_cast<double>(iterations);
+        if (bytesPerOp)
+        {
+            double mbPerSec = static_cast<double>(bytesPerOp) * static_cast<double>(iterations) / elapsed / 1e6;
+            printf("%-44s %12llu iters %12.1f ns/op %12.1f MB/s\n", name, static_cast<unsigned long long>(iterations),
+                nsPerOp, mbPerSec);
+        }
+        else
+        {
+            printf("%-44s %12llu iters %12.1f ns/op\n", name, static_cast<unsigned long long>(iterations), nsPerOp);
+        }
+        return nsPerOp;
+    }
+
+    // Keep the optimizer from discarding a computed value
+    template <typename T>
+    inline void DoNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+}  // namespace EspAppBench
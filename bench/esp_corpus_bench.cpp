@@ -0,0 +1,250 @@
+// Corpus replay benchmark for the image parser fuzz target.
+//
+// Usage: esp_corpus_bench [--write-corpus <dir>] [file|dir ...]
+// Every input is run through the same entry point as fuzz/esp_image_fuzzer.cpp and the replay rate is reported
+// in execs/s, along with the slowest single input and the parse status of each input. Without inputs a
+// synthetic corpus is replayed: valid images for every chip, each truncated at every header boundary, images
+// with mutated headers and random blobs. --write-corpus stores that corpus as seed files for libFuzzer.
+
+#include "bench_util.h"
+#include "esp_image_fuzz.h"
+#include "esp_mapped_file.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppBench;
+
+struct CorpusInput
+{
+    string name;
+    vector<uint8_t> data;
+};
+
+static uint64_t NextRandom(uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static void AddTruncations(vector<CorpusInput>& corpus, const string& name, const vector<uint8_t>& image)
+{
+    ParsedImage parsed;
+    if (ParseImage(image, parsed) != ImageParseStatus::Ok)
+        return;
+
+    // Cut right before, at and after each header and data boundary
+    vector<uint64_t> cuts = {0, 1, sizeof(EspImageHeader) - 1, sizeof(EspImageHeader)};
+    for (const SegmentInfo& seg : parsed.Segments())
+    {
+        uint64_t header = seg.file_offset - sizeof(EspSegmentHeader);
+        for (uint64_t cut : {header + 4, seg.file_offset - 1, seg.file_offset, seg.file_offset + seg.data_len - 1})
+            cuts.push_back(cut);
+    }
+    for (uint64_t cut : cuts)
+    {
+        if (cut < image.size())
+            corpus.push_back({name + "-cut" + to_string(cut), vector<uint8_t>(image.begin(), image.begin() + cut)});
+    }
+}
+
+static void AddMutations(vector<CorpusInput>& corpus, const string& name, const vector<uint8_t>& image,
+    uint64_t& state, size_t count)
+{
+    ParsedImage parsed;
+    if (ParseImage(image, parsed) != ImageParseStatus::Ok)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        vector<uint8_t> mutated = image;
+        const SegmentInfo& seg = parsed.segments[NextRandom(state) % parsed.segment_count];
+        switch (NextRandom(state) % 4)
+        {
+        case 0:  // Segment count
+            mutated[1] = static_cast<uint8_t>(NextRandom(state));
+            break;
+        case 1:  // Chip id
+            StoreLE16(mutated.data() + 12, static_cast<uint16_t>(NextRandom(state) % 0x20));
+            break;
+        case 2:  // data_len: huge, off by a few, or wrapping the 32-bit offset
+            StoreLE32(mutated.data() + seg.file_offset - 4, static_cast<uint32_t>(NextRandom(state)));
+            break;
+        case 3:  // load_addr
+            StoreLE32(mutated.data() + seg.file_offset - 8, static_cast<uint32_t>(NextRandom(state)));
+            break;
+        }
+        corpus.push_back({name + "-mut" + to_string(i), move(mutated)});
+    }
+}
+
+static vector<CorpusInput> BuildSyntheticCorpus()
+{
+    vector<CorpusInput> corpus;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (const ChipAttr* attr : GetChipAttrList())
+    {
+        for (size_t segments : {1, 4, 16})
+        {
+            string name = string(attr->chip_name) + "-" + to_string(segments) + "seg";
+            vector<uint8_t> image = BuildSyntheticImage(*attr, segments, 0x400);
+            AppendImageTrailer(image);
+            corpus.push_back({name, image});
+            AddTruncations(corpus, name, image);
+            AddMutations(corpus, name, image, state, 32);
+        }
+    }
+
+    // Random blobs, half of them with a plausible magic and segment count
+    for (size_t i = 0; i < 256; i++)
+    {
+        vector<uint8_t> blob(NextRandom(state) % 4096);
+        for (auto& byte : blob)
+            byte = static_cast<uint8_t>(NextRandom(state));
+        if (i % 2 && blob.size() >= 2)
+        {
+            blob[0] = ESP_IMAGE_HEADER_MAGIC;
+            blob[1] = static_cast<uint8_t>(1 + NextRandom(state) % ESP_IMAGE_MAX_SEGMENTS);
+        }
+        corpus.push_back({"random" + to_string(i), move(blob)});
+    }
+
+    vector<uint8_t> flash = BuildSyntheticFlashDump(*GetChipAttrList()[0], 1024 * 1024, 0x1000);
+    corpus.push_back({"flash-1MB", move(flash)});
+    return corpus;
+}
+
+static bool AddInput(vector<CorpusInput>& corpus, const string& path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+    span<const uint8_t> data = file.GetSpan();
+    corpus.push_back({path, vector<uint8_t>(data.begin(), data.end())});
+    return true;
+}
+
+static void AddPath(vector<CorpusInput>& corpus, const string& path)
+{
+    error_code ec;
+    if (!filesystem::is_directory(path, ec))
+    {
+        if (!AddInput(corpus, path))
+            fprintf(stderr, "Failed to map %s\n", path.c_str());
+        return;
+    }
+
+    for (auto it = filesystem::recursive_directory_iterator(path, ec);
+         !ec && it != filesystem::recursive_directory_iterator(); it.increment(ec))
+    {
+        // Empty files are valid corpus entries but cannot be mapped
+        error_code fileError;
+        if (!it->is_regular_file(fileError))
+            continue;
+        if (it->file_size(fileError) == 0)
+            corpus.push_back({it->path().string(), {}});
+        else if (!AddInput(corpus, it->path().string()))
+            fprintf(stderr, "Failed to map %s\n", it->path().string().c_str());
+    }
+    if (ec)
+        fprintf(stderr, "warning: %s: %s\n", path.c_str(), ec.message().c_str());
+}
+
+static bool WriteCorpus(const vector<CorpusInput>& corpus, const string& directory)
+{
+    error_code ec;
+    filesystem::create_directories(directory, ec);
+    for (const CorpusInput& input : corpus)
+    {
+        ofstream out(filesystem::path(directory) / input.name, ios::binary);
+        out.write(reinterpret_cast<const char*>(input.data.data()), static_cast<streamsize>(input.data.size()));
+        if (!out)
+            return false;
+    }
+    return true;
+}
+
+static void ReplayCorpus(const char* label, const vector<CorpusInput>& corpus)
+{
+    size_t statusCounts[static_cast<size_t>(ImageParseStatus::UnknownChip) + 1] = {};
+    uint64_t bytes = 0;
+    for (const CorpusInput& input : corpus)
+    {
+        ParsedImage parsed;
+        statusCounts[static_cast<size_t>(ParseImage(input.data, parsed))]++;
+        bytes += input.data.size();
+    }
+
+    double nsPerReplay = RunBenchmark((string("replay/") + label).c_str(), bytes, [&] {
+        for (const CorpusInput& input : corpus)
+            EspAppFuzz::FuzzImageInput(input.data);
+    });
+    printf("%-44s %zu inputs, %.0f execs/s\n", label, corpus.size(),
+        static_cast<double>(corpus.size()) * 1e9 / nsPerReplay);
+
+    // A pathological input stalls a batch far more than a slow average, so report the worst one
+    using Clock = chrono::steady_clock;
+    constexpr int repeats = 16;
+    double slowest = 0;
+    const CorpusInput* slowestInput = nullptr;
+    for (const CorpusInput& input : corpus)
+    {
+        auto start = Clock::now();
+        for (int i = 0; i < repeats; i++)
+            EspAppFuzz::FuzzImageInput(input.data);
+        double ns = chrono::duration<double, nano>(Clock::now() - start).count() / repeats;
+        if (ns > slowest)
+        {
+            slowest = ns;
+            slowestInput = &input;
+        }
+    }
+    if (slowestInput)
+        printf("%-44s slowest %.1f ns: %s (%zu bytes)\n", label, slowest, slowestInput->name.c_str(),
+            slowestInput->data.size());
+
+    for (size_t i = 0; i < size(statusCounts); i++)
+    {
+        if (statusCounts[i])
+            printf("%-44s %8zu %s\n", label, statusCounts[i], GetImageParseStatusString(ImageParseStatus(i)));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    string corpusDirectory;
+    vector<CorpusInput> corpus;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--write-corpus" && i + 1 < argc)
+            corpusDirectory = argv[++i];
+        else
+            AddPath(corpus, arg);
+    }
+
+    if (!corpusDirectory.empty())
+    {
+        if (!WriteCorpus(BuildSyntheticCorpus(), corpusDirectory))
+        {
+            fprintf(stderr, "Failed to write corpus to %s\n", corpusDirectory.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    if (corpus.empty())
+        ReplayCorpus("synthetic", BuildSyntheticCorpus());
+    else
+        ReplayCorpus("corpus", corpus);
+    return 0;
+}
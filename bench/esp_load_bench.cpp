@@ -0,0 +1,270 @@
+// Load-time regression suite for the ESP image core.
+//
+// Usage: esp_load_bench [--json <file>] [--baseline <file>] [--tolerance <percent>]
+// A synthetic image is generated for every chip with 1 to 16 segments, and the core side of a view load is
+// run on each: parse (header, segment chain and app description), plan (segment validation and region
+// fragmentation) and functions (the prologue scan over the code segments, which hold synthetic Xtensa or RISC-V
+// functions). The best of several rounds is reported per phase, together with the segments, sections and bytes
+// the layout creates and the function starts found. A case with code segments but no function starts fails
+// with status 3. --json appends one line per case, tagged with a timestamp, so results can be
+// tracked over time. --baseline compares against such a file (the last line of each case wins) and exits with
+// status 2 if a case got slower than the tolerance (default 25%) or now creates a different layout or finds a
+// different number of function starts.
+
+#include "bench_util.h"
+#include "esp_app_desc.h"
+#include "esp_chip.h"
+#include "esp_image.h"
+#include "esp_layout.h"
+#include "esp_load_profile.h"
+#include "esp_prologue.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppBench;
+
+static constexpr size_t g_iterations = 2000;
+static constexpr size_t g_scanIterations = 200;
+static constexpr size_t g_rounds = 15;
+
+struct LoadCase
+{
+    string name;
+    LoadProfile profile;
+    bool has_code = false;
+};
+
+// Per-iteration time of each phase, best of g_rounds; counters from a single load
+static LoadProfile ProfileLoad(span<const uint8_t> image, const ChipAttr& attr, bool& hasCode)
+{
+    RegionIndex index(attr);
+    PrologueArch arch = GetPrologueArch(attr);
+    LoadProfile best;
+
+    for (size_t round = 0; round < g_rounds; round++)
+    {
+        LoadProfile batch;
+        ParsedImage parsed;
+        AppDesc desc;
+        {
+            ScopedPhaseTimer timer(batch, LoadPhase::Parse);
+            for (size_t i = 0; i < g_iterations; i++)
+            {
+                ImageParseStatus status = ParseImage(image, parsed);
+                bool hasDesc = ParseAppDesc(image, parsed, desc);
+                DoNotOptimize(status);
+                DoNotOptimize(hasDesc);
+            }
+        }
+
+        SegmentRegionMap map;
+        LayoutPlan plan;
+        {
+            ScopedPhaseTimer timer(batch, LoadPhase::Plan);
+            for (size_t i = 0; i < g_iterations; i++)
+            {
+                SegmentMapStatus status = PlanMemoryLayout(index, parsed.Segments(), map, plan);
+                DoNotOptimize(status);
+                DoNotOptimize(plan);
+            }
+        }
+
+        // The same code ranges the view scans
+        vector<CodeRange> ranges;
+        for (const auto& segment : plan.segments)
+        {
+            if ((segment.flags & RegionContainsCode) && segment.data_length)
+                ranges.push_back({segment.data_offset, segment.data_length, static_cast<uint32_t>(segment.start)});
+        }
+        vector<uint32_t> starts;
+        {
+            ScopedPhaseTimer timer(batch, LoadPhase::Functions);
+            for (size_t i = 0; i < g_scanIterations; i++)
+            {
+                starts = ScanCodeRanges(image, ranges, arch);
+                DoNotOptimize(starts);
+            }
+        }
+
+        for (size_t i = 0; i < best.phase_ns.size(); i++)
+        {
+            size_t iterations = static_cast<LoadPhase>(i) == LoadPhase::Functions ? g_scanIterations : g_iterations;
+            uint64_t ns = batch.phase_ns[i] / iterations;
+            best.phase_ns[i] = round == 0 ? ns : min(best.phase_ns[i], ns);
+        }
+        if (round == 0)
+        {
+            best.image_bytes = image.size();
+            best.AddLayout(plan);
+            best.function_starts = starts.size();
+            hasCode = arch != PrologueArch::Unknown && !ranges.empty();
+        }
+    }
+    return best;
+}
+
+static string FindJsonString(const string& line, const string& key)
+{
+    string pattern = "\"" + key + "\":\"";
+    size_t at = line.find(pattern);
+    if (at == string::npos)
+        return {};
+    at += pattern.size();
+    return line.substr(at, line.find('"', at) - at);
+}
+
+static uint64_t FindJsonNumber(const string& line, const string& key)
+{
+    string pattern = "\"" + key + "\":";
+    size_t at = line.find(pattern);
+    return at == string::npos ? 0 : strtoull(line.c_str() + at + pattern.size(), nullptr, 10);
+}
+
+// Returns the number of regressions against the baseline file
+static size_t CompareBaseline(const string& path, const vector<LoadCase>& cases, double tolerance)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "Failed to read baseline %s\n", path.c_str());
+        return 1;
+    }
+
+    map<string, string> baseline;
+    string line;
+    while (getline(in, line))
+    {
+        string name = FindJsonString(line, "case");
+        if (!name.empty())
+            baseline[name] = line;
+    }
+
+    // Tiny phases are dominated by timer noise; ignore differences below this
+    const uint64_t noiseNs = 20;
+    size_t regressions = 0;
+    for (const auto& item : cases)
+    {
+        auto it = baseline.find(item.name);
+        if (it == baseline.end())
+            continue;
+
+        const string& base = it->second;
+        if (FindJsonNumber(base, "segments_created") != item.profile.segments_created ||
+            FindJsonNumber(base, "sections_created") != item.profile.sections_created ||
+            FindJsonNumber(base, "bytes_mapped") != item.profile.bytes_mapped)
+        {
+            printf("REGRESSION %-28s layout changed (%llu segments, %llu sections before)\n", item.name.c_str(),
+                static_cast<unsigned long long>(FindJsonNumber(base, "segments_created")),
+                static_cast<unsigned long long>(FindJsonNumber(base, "sections_created")));
+            regressions++;
+        }
+        if (FindJsonNumber(base, "function_starts") != item.profile.function_starts)
+        {
+            printf("REGRESSION %-28s %llu function starts -> %llu\n", item.name.c_str(),
+                static_cast<unsigned long long>(FindJsonNumber(base, "function_starts")),
+                static_cast<unsigned long long>(item.profile.function_starts));
+            regressions++;
+        }
+
+        for (size_t i = 0; i < item.profile.phase_ns.size(); i++)
+        {
+            const char* phase = GetLoadPhaseName(static_cast<LoadPhase>(i));
+            uint64_t before = FindJsonNumber(base, string(phase) + "_ns");
+            uint64_t now = item.profile.phase_ns[i];
+            if (before && now > before + noiseNs && now > before * (1.0 + tolerance / 100.0))
+            {
+                printf("REGRESSION %-28s %s %llu ns -> %llu ns\n", item.name.c_str(), phase,
+                    static_cast<unsigned long long>(before), static_cast<unsigned long long>(now));
+                regressions++;
+            }
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+    string jsonPath, baselinePath;
+    double tolerance = 25.0;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = strtod(argv[++i], nullptr);
+        else
+        {
+            fprintf(stderr, "Usage: esp_load_bench [--json <file>] [--baseline <file>] [--tolerance <percent>]\n");
+            return 1;
+        }
+    }
+
+    vector<LoadCase> cases;
+    printf("%-28s %10s %10s %10s %10s %9s %9s %10s %9s\n", "case", "parse ns", "plan ns", "scan ns", "total ns",
+        "segments", "sections", "mapped", "functions");
+    size_t missingStarts = 0;
+    for (const ChipAttr* attr : GetChipAttrList())
+    {
+        for (size_t segments = 1; segments <= ESP_IMAGE_MAX_SEGMENTS; segments++)
+        {
+            vector<uint8_t> image = BuildSyntheticImage(*attr, segments, 0x1000);
+            AppendImageTrailer(image);
+
+            LoadCase item {string(attr->chip_name) + "/" + to_string(segments) + "seg", LoadProfile {}, false};
+            item.profile = ProfileLoad(image, *attr, item.has_code);
+            const LoadProfile& profile = item.profile;
+            printf("%-28s %10llu %10llu %10llu %10llu %9llu %9llu %#10llx %9llu\n", item.name.c_str(),
+                static_cast<unsigned long long>(profile.GetPhaseNanoseconds(LoadPhase::Parse)),
+                static_cast<unsigned long long>(profile.GetPhaseNanoseconds(LoadPhase::Plan)),
+                static_cast<unsigned long long>(profile.GetPhaseNanoseconds(LoadPhase::Functions)),
+                static_cast<unsigned long long>(profile.GetTotalNanoseconds()),
+                static_cast<unsigned long long>(profile.segments_created),
+                static_cast<unsigned long long>(profile.sections_created),
+                static_cast<unsigned long long>(profile.bytes_mapped),
+                static_cast<unsigned long long>(profile.function_starts));
+            if (item.has_code && !profile.function_starts)
+            {
+                fprintf(stderr, "%s: no function starts found in the code segments\n", item.name.c_str());
+                missingStarts++;
+            }
+            cases.push_back(std::move(item));
+        }
+    }
+
+    if (!jsonPath.empty())
+    {
+        FILE* out = fopen(jsonPath.c_str(), "a");
+        if (!out)
+        {
+            fprintf(stderr, "Failed to open %s\n", jsonPath.c_str());
+            return 1;
+        }
+        long long now = static_cast<long long>(time(nullptr));
+        for (const auto& item : cases)
+        {
+            string fields = item.profile.ToJson();
+            fprintf(out, "{\"time\":%lld,\"case\":\"%s\",%s\n", now, item.name.c_str(), fields.c_str() + 1);
+        }
+        fclose(out);
+    }
+
+    if (!baselinePath.empty())
+    {
+        size_t regressions = CompareBaseline(baselinePath, cases, tolerance);
+        printf("%zu regressions against %s\n", regressions, baselinePath.c_str());
+        if (regressions)
+            return 2;
+    }
+    return missingStarts ? 3 : 0;
+}
@@ -0,0 +1,304 @@
+// Parse throughput benchmark for the ESP image core.
+//
+// Usage: esp_parse_bench [image ...]
+// Without arguments only synthetic images and a synthetic flash dump are measured. Each argument (an app
+// image or a raw flash dump) is memory-mapped and parsed in place, the same way the view does it.
+
+#include "bench_util.h"
+#include "esp_chip.h"
+#include "esp_chunk_diff.h"
+#include "esp_export.h"
+#include "esp_flash.h"
+#include "esp_flash_crypt.h"
+#include "esp_image.h"
+#include "esp_layout.h"
+#include "esp_log_tags.h"
+#include "esp_mapped_file.h"
+#include "esp_prologue.h"
+#include "esp_verify.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppBench;
+
+static void BenchImage(const string& label, span<const uint8_t> image)
+{
+    ParsedImage parsed;
+    ImageParseStatus status = ParseImage(image, parsed);
+    if (status != ImageParseStatus::Ok)
+    {
+        printf("%-44s parse failed: %s\n", label.c_str(), GetImageParseStatusString(status));
+        return;
+    }
+
+    // Throughput is reported against the whole image because that is what a triage pass has to get through
+    RunBenchmark(("parse/" + label).c_str(), image.size(), [&] {
+        ParsedImage out;
+        ImageParseStatus s = ParseImage(image, out);
+        DoNotOptimize(s);
+        DoNotOptimize(out);
+    });
+
+    // View type detection runs this for every file BN opens
+    RunBenchmark(("probe/" + label).c_str(), 0, [&] {
+        ImageParseStatus s = ProbeImage(image);
+        DoNotOptimize(s);
+    });
+
+    ImageVerifyResult verify = VerifyImage(image, parsed);
+    printf("%-44s checksum %s, sha256 %s\n", label.c_str(), verify.ChecksumValid() ? "valid" : "INVALID",
+        !verify.hash_appended ? "absent" : verify.HashValid() ? "valid" : "INVALID");
+    RunBenchmark(("verify/" + label).c_str(), image.size(), [&] {
+        ImageVerifyResult result = VerifyImage(image, parsed);
+        DoNotOptimize(result);
+    });
+
+    const ChipAttr* attr = GetChipAttrById(parsed.ChipId());
+    if (!attr)
+        return;
+
+    RegionIndex index(*attr);
+    RunBenchmark(("map/" + label).c_str(), 0, [&] {
+        SegmentRegionMap map;
+        SegmentMapStatus s = MapSegmentsToRegions(index, parsed.Segments(), map);
+        DoNotOptimize(s);
+        DoNotOptimize(map);
+    });
+
+    LayoutPlan plan;
+    RunBenchmark(("plan/" + label).c_str(), 0, [&] {
+        SegmentRegionMap map;
+        SegmentMapStatus s = PlanMemoryLayout(index, parsed.Segments(), map, plan);
+        DoNotOptimize(s);
+        DoNotOptimize(plan);
+    });
+    RunBenchmark(("plan-sparse/" + label).c_str(), 0, [&] {
+        SegmentRegionMap map;
+        SegmentMapStatus s = PlanMemoryLayout(index, parsed.Segments(), map, plan, LayoutMode::Sparse);
+        DoNotOptimize(s);
+        DoNotOptimize(plan);
+    });
+}
+
+static void BenchFlashDump(const string& label, span<const uint8_t> flash)
+{
+    FlashLayout layout;
+    if (!ScanFlashDump(flash, layout))
+    {
+        printf("%-44s no images found\n", label.c_str());
+        return;
+    }
+
+    size_t unique = 0;
+    for (const auto& app : layout.apps)
+        unique += app.IsValid() && !app.IsDuplicate();
+    printf("%-44s %zu partitions, %zu apps, %zu unique\n", label.c_str(), layout.partitions.size(),
+        layout.apps.size(), unique);
+
+    RunBenchmark(("flash/" + label).c_str(), flash.size(), [&] {
+        FlashLayout out;
+        bool found = ScanFlashDump(flash, out);
+        DoNotOptimize(found);
+    });
+}
+
+static void BenchRebuild(const char* label, const ChipAttr& attr, size_t segments, uint32_t segmentSize)
+{
+    vector<uint8_t> image = BuildSyntheticImage(attr, segments, segmentSize);
+    AppendImageTrailer(image);
+    ParsedImage parsed;
+    ImageRebuilder rebuilder;
+    if (ParseImage(image, parsed) != ImageParseStatus::Ok || !rebuilder.Load(image, parsed))
+        return;
+    rebuilder.Finish();
+
+    // A one-byte patch in the middle of the last segment, toggled so every export changes bytes
+    size_t last = parsed.segment_count - 1;
+    const SegmentInfo& seg = parsed.segments[last];
+    vector<uint8_t> contents(image.begin() + seg.file_offset, image.begin() + seg.file_offset + seg.data_len);
+    RunBenchmark((string("rebuild/") + label).c_str(), 0, [&] {
+        contents[contents.size() / 2] ^= 0xFF;
+        rebuilder.UpdateSegment(last, contents);
+        span<const uint8_t> out = rebuilder.Finish();
+        DoNotOptimize(out);
+    });
+    printf("%-44s %llu bytes rehashed per export of %zu\n", label,
+        static_cast<unsigned long long>(rebuilder.GetStats().bytes_rehashed), image.size());
+}
+
+static void BenchChunkDiff(const char* label, const ChipAttr& attr, size_t segments, uint32_t segmentSize)
+{
+    // Pseudo-random segment contents, so that chunk boundaries fall the way they do in real code
+    vector<uint8_t> base = BuildSyntheticImage(attr, segments, segmentSize);
+    ParsedImage parsed;
+    if (ParseImage(base, parsed) != ImageParseStatus::Ok)
+        return;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (const auto& seg : parsed.Segments())
+    {
+        for (uint32_t i = 0; i < seg.data_len; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            base[seg.file_offset + i] = static_cast<uint8_t>(state);
+        }
+    }
+
+    // The next "build" changes a few bytes in every segment
+    vector<uint8_t> target = base;
+    for (const auto& seg : parsed.Segments())
+        target[seg.file_offset + seg.data_len / 2] ^= 0xFF;
+
+    RegionIndex regions(attr);
+    ChunkIndex baseIndex, targetIndex;
+    BuildChunkIndex(base, parsed, baseIndex);
+    BuildChunkIndex(target, parsed, targetIndex);
+    ImageDiff diff;
+    DiffChunkIndexes(baseIndex, targetIndex, regions, diff);
+    printf("%-44s %zu chunks, %zu changed ranges, %llu bytes changed\n", label, targetIndex.chunks.size(),
+        diff.changed.size(), static_cast<unsigned long long>(diff.changed_bytes));
+
+    RunBenchmark((string("chunk-index/") + label).c_str(), base.size(), [&] {
+        ChunkIndex index;
+        BuildChunkIndex(target, parsed, index);
+        DoNotOptimize(index);
+    });
+    RunBenchmark((string("chunk-diff/") + label).c_str(), base.size(), [&] {
+        ImageDiff out;
+        DiffChunkIndexes(baseIndex, targetIndex, regions, out);
+        DoNotOptimize(out);
+    });
+}
+
+static bool BenchPrologueScan(const char* label, PrologueArch arch, size_t size)
+{
+    vector<uint8_t> code(size);
+    size_t planted = FillSyntheticCode(code.data(), code.size(), arch, 0x9E3779B97F4A7C15ull);
+
+    CodeRange range = {0, code.size(), 0x42000000};
+    size_t found = ScanCodeRanges(code, {&range, 1}, arch).size();
+    printf("%-44s %zu candidate starts, %zu planted\n", label, found, planted);
+    RunBenchmark((string("prologue/") + label).c_str(), code.size(), [&] {
+        vector<uint32_t> starts = ScanCodeRanges(code, {&range, 1}, arch);
+        DoNotOptimize(starts);
+    });
+    RunBenchmark((string("prologue/") + label + "/1thread").c_str(), code.size(), [&] {
+        vector<uint32_t> starts = ScanCodeRanges(code, {&range, 1}, arch, 1);
+        DoNotOptimize(starts);
+    });
+
+    // A fixture without real prologues only times the candidate filter
+    if (found == 0)
+    {
+        fprintf(stderr, "%s: no function starts found in %zu synthetic functions\n", label, planted);
+        return false;
+    }
+    return true;
+}
+
+static void BenchStringScan(const char* label, size_t size)
+{
+    // DROM-like contents: runs of text of varying length between NULs and binary tables
+    vector<uint8_t> drom(size);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < size;)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size_t run = min<size_t>(size - i, 4 + state % 60);
+        bool text = state & 0x100;
+        for (size_t j = 0; j < run; j++)
+        {
+            uint64_t bits = state >> (j % 48);
+            drom[i + j] = static_cast<uint8_t>(text ? 'a' + bits % 26 : bits);
+        }
+        i += run;
+        if (text && i < size)
+            drom[i++] = 0;
+    }
+
+    CodeRange range = {0, drom.size(), 0x3C000000};
+    printf("%-44s %zu strings\n", label, FindStrings(drom, {&range, 1}, 4).size());
+    RunBenchmark((string("strings/") + label).c_str(), drom.size(), [&] {
+        vector<FoundString> strings = FindStrings(drom, {&range, 1}, 4);
+        DoNotOptimize(strings);
+    });
+    RunBenchmark((string("strings/") + label + "/1thread").c_str(), drom.size(), [&] {
+        vector<FoundString> strings = FindStrings(drom, {&range, 1}, 4, 1);
+        DoNotOptimize(strings);
+    });
+}
+
+static void BenchDecrypt(const char* label, size_t keySize, size_t size)
+{
+    vector<uint8_t> key(keySize), ciphertext(size);
+    for (size_t i = 0; i < key.size(); i++)
+        key[i] = static_cast<uint8_t>(i * 7 + 1);
+    for (size_t i = 0; i < ciphertext.size(); i++)
+        ciphertext[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+
+    FlashDecryptor decryptor;
+    decryptor.SetKey(key);
+    printf("%-44s %s AES\n", label, decryptor.UsesHardwareAes() ? "hardware" : "software");
+
+    // Cold reads: every page is decrypted once
+    auto reader = [](void* context, uint64_t offset, void* dest, size_t length) {
+        auto bytes = static_cast<const vector<uint8_t>*>(context);
+        if (offset > bytes->size() || bytes->size() - offset < length)
+            return false;
+        memcpy(dest, bytes->data() + offset, length);
+        return true;
+    };
+    vector<uint8_t> plaintext(size);
+    RunBenchmark((string("decrypt/") + label).c_str(), size, [&] {
+        DecryptedFlash flash(decryptor, ciphertext.size(), 0x10000, reader, &ciphertext, size / ESP_FLASH_CRYPT_PAGE);
+        flash.Read(0, plaintext.data(), plaintext.size());
+        DoNotOptimize(plaintext);
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    for (const ChipAttr* attr : GetChipAttrList())
+    {
+        for (size_t segments : {1, 4, 16})
+        {
+            vector<uint8_t> image = BuildSyntheticImage(*attr, segments, 0x1000);
+            AppendImageTrailer(image);
+            BenchImage(string("synthetic/") + attr->chip_name + "/" + to_string(segments) + "seg", image);
+        }
+    }
+
+    vector<uint8_t> flash = BuildSyntheticFlashDump(*GetChipAttrList()[0], 4 * 1024 * 1024, 0x10000);
+    BenchFlashDump("synthetic/4MB", flash);
+
+    BenchChunkDiff("ota", *GetChipAttrList()[0], 4, 0x80000);
+    BenchRebuild("one-byte-patch", *GetChipAttrList()[0], 4, 0x80000);
+
+    bool ok = BenchPrologueScan("xtensa/4MB", PrologueArch::Xtensa, 4 * 1024 * 1024);
+    ok &= BenchPrologueScan("riscv/4MB", PrologueArch::RiscV, 4 * 1024 * 1024);
+    BenchStringScan("drom/2MB", 2 * 1024 * 1024);
+    BenchDecrypt("xts-aes-128/1MB", 32, 1024 * 1024);
+    BenchDecrypt("xts-aes-256/1MB", 64, 1024 * 1024);
+
+    for (int i = 1; i < argc; i++)
+    {
+        MappedFile file;
+        if (!file.Open(argv[i]))
+        {
+            fprintf(stderr, "Failed to map %s\n", argv[i]);
+            continue;
+        }
+        if (LooksLikeFlashDump(file.GetSpan()))
+            BenchFlashDump(argv[i], file.GetSpan());
+        else
+            BenchImage(argv[i], file.GetSpan());
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "esp_app_desc.h"
+#include "esp_chip.h"
+#include "esp_flash.h"
+#include "esp_image.h"
+#include "esp_layout.h"
+#include "esp_verify.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+
+namespace EspAppFuzz
+{
+    using namespace EspApp;
+
+    inline void Check(bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            fprintf(stderr, "invariant violated: %s\n", what);
+            abort();
+        }
+    }
+
+    inline bool ReadSpan(void* context, uint64_t offset, void* dest, size_t length)
+    {
+        auto bytes = static_cast<const std::span<const uint8_t>*>(context);
+        if (offset > bytes->size() || bytes->size() - offset < length)
+            return false;
+        memcpy(dest, bytes->data() + offset, length);
+        return true;
+    }
+
+    // Everything a triage pass or a view load does with an untrusted blob before touching a BinaryView: flash
+    // dump detection and scan, then the header and segment chain parse, checked against the reader-based
+    // parse and the probe, and for well-formed images the app description, verification and layout plan.
+    // Any crash, sanitizer report or violated invariant is a bug.
+    inline void FuzzImageInput(std::span<const uint8_t> data)
+    {
+        if (LooksLikeFlashDump(data))
+        {
+            FlashLayout layout;
+            ScanFlashDump(data, layout, 1);
+        }
+
+        ParsedImage image;
+        ImageParseStatus status = ParseImage(data, image);
+        Check(image.segment_count <= ESP_IMAGE_MAX_SEGMENTS, "segment count is bounded");
+
+        uint64_t offset = sizeof(EspImageHeader);
+        for (const SegmentInfo& seg : image.Segments())
+        {
+            Check(seg.file_offset == offset + sizeof(EspSegmentHeader), "segments are contiguous");
+            Check(seg.file_offset <= data.size() && data.size() - seg.file_offset >= seg.data_len,
+                "segment data lies within the input");
+            offset = seg.file_offset + seg.data_len;
+        }
+        if (status == ImageParseStatus::Ok)
+        {
+            Check(image.segment_count == image.header.segment_count, "every segment is parsed");
+            Check(image.end_offset == offset, "end offset follows the last segment");
+        }
+        else
+        {
+            Check(image.error_offset <= data.size(), "error offset lies within the input");
+        }
+
+        // Decrypted views parse through a reader; both paths must agree exactly
+        ParsedImage viaReader;
+        ImageParseStatus readerStatus = ParseImage(data.size(), ReadSpan, &data, viaReader);
+        Check(readerStatus == status && viaReader.segment_count == image.segment_count &&
+            viaReader.failed_segment == image.failed_segment && viaReader.error_offset == image.error_offset &&
+            viaReader.end_offset == image.end_offset, "reader parse matches in-place parse");
+        for (size_t i = 0; i < image.segment_count; i++)
+        {
+            Check(viaReader.segments[i].load_addr == image.segments[i].load_addr &&
+                viaReader.segments[i].data_len == image.segments[i].data_len &&
+                viaReader.segments[i].file_offset == image.segments[i].file_offset, "reader segments match");
+        }
+
+        const ChipAttr* attr = status == ImageParseStatus::Ok ? GetChipAttrById(image.ChipId()) : nullptr;
+        Check((ProbeImage(data) == ImageParseStatus::Ok) == (attr != nullptr), "probe accepts what the view loads");
+        if (status != ImageParseStatus::Ok)
+            return;
+
+        AppDesc desc;
+        ParseAppDesc(data, image, desc);
+        ImageVerifyResult verify = VerifyImage(data, image);
+        (void)verify;
+
+        if (attr)
+        {
+            RegionIndex index(*attr);
+            SegmentRegionMap map;
+            LayoutPlan plan;
+            PlanMemoryLayout(index, image.Segments(), map, plan);
+        }
+    }
+}  // namespace EspAppFuzz
@@ -0,0 +1,13 @@
+// libFuzzer target for the image header and segment chain parser and what runs on a parsed image.
+//
+// Build with clang and -D ESP_APP_BUILD_FUZZERS=ON, then seed the corpus from the replay benchmark:
+//   ./build/esp_corpus_bench --write-corpus corpus
+//   ./build/esp_image_fuzzer corpus
+
+#include "esp_image_fuzz.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    EspAppFuzz::FuzzImageInput({data, size});
+    return 0;
+}
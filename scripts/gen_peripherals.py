@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+"""Generate the embedded peripheral register maps from Espressif SVD files.
+
+Usage: gen_peripherals.py --svd-path <dir with esp32.svd, esp32c3.svd, ...> --output <file.cpp>
+
+Every peripheral becomes one fixed-size block record so the table can be searched in place; the
+register lists are the bulky part and are stored compressed:
+
+    u32 magic ('EPER'), u16 version, u16 chip id, u32 block count,
+    u32 register stream size, u32 string table size
+    count * { u32 base, u32 size, u32 name offset, u32 type name offset,
+              u32 register stream offset, u32 register count }       (ascending base)
+    register stream                                                  (see below)
+    string table                                                     (NUL terminated names)
+
+A register list is a run of (varint offset delta, varint size in bytes, varint name offset)
+triples in ascending offset order. Peripherals derived from another one (UART1 from UART0, ...)
+share its register list and type name, and every name is stored once. All fixed-width integers
+are little-endian. See src/core/esp_peripherals.h for the reader.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import xml.etree.ElementTree as ET
+
+CHIPS = [
+    ("esp32", 0x0000),
+    ("esp32s2", 0x0002),
+    ("esp32c3", 0x0005),
+    ("esp32s3", 0x0009),
+    ("esp32c2", 0x000C),
+    ("esp32c6", 0x000D),
+    ("esp32h2", 0x0010),
+    ("esp32p4", 0x0012),
+]
+
+MAGIC = 0x52455045  # 'EPER'
+VERSION = 1
+
+
+def parse_int(text, default=0):
+    if text is None:
+        return default
+    text = text.strip().lower().replace("_", "")
+    if text.startswith("#"):
+        return int(text[1:].replace("x", "0"), 2)
+    return int(text, 0)
+
+
+def child_int(node, tag, default):
+    child = node.find(tag)
+    return parse_int(child.text, default) if child is not None else default
+
+
+def expand_dim(node, name):
+    """Yield (name, offset delta) for a register or cluster with optional dim/dimIncrement."""
+    dim = child_int(node, "dim", 1)
+    if dim <= 1 or "%s" not in name:
+        yield name.replace("[%s]", "").replace("%s", ""), 0
+        return
+    increment = child_int(node, "dimIncrement", 0)
+    index_node = node.find("dimIndex")
+    if index_node is not None and "," in index_node.text:
+        indices = [i.strip() for i in index_node.text.split(",")]
+    elif index_node is not None and "-" in index_node.text:
+        first, last = index_node.text.split("-")
+        indices = [str(i) for i in range(int(first), int(last) + 1)]
+    else:
+        indices = [str(i) for i in range(dim)]
+    for i, index in enumerate(indices[:dim]):
+        yield name.replace("[%s]", index).replace("%s", index), i * increment
+
+
+def collect_registers(parent, base_offset, default_size, prefix, out):
+    for node in parent:
+        if node.tag == "register":
+            name = node.findtext("name")
+            size = child_int(node, "size", default_size) // 8
+            offset = child_int(node, "addressOffset", 0)
+            for reg_name, delta in expand_dim(node, name):
+                out.append((base_offset + offset + delta, max(size, 1), prefix + reg_name))
+        elif node.tag == "cluster":
+            name = node.findtext("name")
+            offset = child_int(node, "addressOffset", 0)
+            size = child_int(node, "size", default_size)
+            for cluster_name, delta in expand_dim(node, name):
+                collect_registers(node, base_offset + offset + delta, size, prefix + cluster_name + "_", out)
+
+
+def identifier(name):
+    return re.sub(r"\W", "_", name)
+
+
+def parse_svd(path):
+    root = ET.parse(path).getroot()
+    device_size = child_int(root, "size", 32)
+    peripherals = {}
+    for node in root.iter("peripheral"):
+        name = node.findtext("name")
+        peripherals[name] = node
+
+    blocks = []
+    register_lists = {}
+    for name, node in peripherals.items():
+        base = child_int(node, "baseAddress", 0)
+
+        # Derived peripherals reuse the register list of the peripheral they derive from
+        owner = name
+        while peripherals[owner].get("derivedFrom") in peripherals and \
+                peripherals[owner].find("registers") is None:
+            owner = peripherals[owner].get("derivedFrom")
+        if owner not in register_lists:
+            registers = []
+            owner_node = peripherals[owner]
+            registers_node = owner_node.find("registers")
+            if registers_node is not None:
+                collect_registers(registers_node, 0, child_int(owner_node, "size", device_size), "", registers)
+            registers = sorted({r[0]: r for r in reversed(registers)}.values())
+            register_lists[owner] = [(o, s, identifier(n)) for o, s, n in registers]
+
+        size = 0
+        for block in node.iter("addressBlock"):
+            size = max(size, child_int(block, "offset", 0) + child_int(block, "size", 0))
+        if owner != name and size == 0:
+            for block in peripherals[owner].iter("addressBlock"):
+                size = max(size, child_int(block, "offset", 0) + child_int(block, "size", 0))
+        for offset, reg_size, _ in register_lists[owner]:
+            size = max(size, offset + reg_size)
+        if size == 0 or base == 0:
+            continue
+        blocks.append((base, size, identifier(name), identifier(owner) + "_regs", owner))
+
+    # Overlapping blocks cannot be looked up by address; keep the first of each run
+    blocks.sort()
+    result = []
+    for block in blocks:
+        if result and block[0] < result[-1][0] + result[-1][1]:
+            continue
+        result.append(block)
+    return result, register_lists
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return out
+
+
+def build_blob(chip_id, blocks, register_lists):
+    strings = bytearray()
+    string_offsets = {}
+
+    def intern(name):
+        if name not in string_offsets:
+            string_offsets[name] = len(strings)
+            strings.extend(name.encode("ascii", "replace") + b"\0")
+        return string_offsets[name]
+
+    stream = bytearray()
+    stream_offsets = {}
+    records = bytearray()
+    for base, size, name, type_name, owner in blocks:
+        registers = register_lists[owner]
+        if owner not in stream_offsets:
+            stream_offsets[owner] = len(stream)
+            previous = 0
+            for offset, reg_size, reg_name in registers:
+                stream += varint(offset - previous) + varint(reg_size) + varint(intern(reg_name))
+                previous = offset
+        records += struct.pack("<IIIIII", base, size, intern(name), intern(type_name),
+                               stream_offsets[owner], len(registers))
+    header = struct.pack("<IHHIII", MAGIC, VERSION, chip_id, len(blocks), len(stream), len(strings))
+    return header + records + stream + strings
+
+
+def emit_array(out, name, blob):
+    out.write("    alignas(4) static const uint8_t %s[] = {\n" % name)
+    for i in range(0, len(blob), 16):
+        out.write("        " + ", ".join("0x%02x" % b for b in blob[i:i + 16]) + ",\n")
+    out.write("    };\n\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--svd-path", required=True, help="Directory with the Espressif SVD files")
+    parser.add_argument("--output", required=True, help="Generated C++ source")
+    args = parser.parse_args()
+
+    blobs = []
+    for chip, chip_id in CHIPS:
+        path = os.path.join(args.svd_path, chip + ".svd")
+        if not os.path.exists(path):
+            print("warning: no SVD file for %s at %s" % (chip, path), file=sys.stderr)
+            continue
+        blocks, register_lists = parse_svd(path)
+        blob = build_blob(chip_id, blocks, register_lists)
+        blobs.append((chip, chip_id, blob, len(blocks)))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "w", encoding="ascii") as out:
+        out.write("// Generated by scripts/gen_peripherals.py from %s. Do not edit.\n\n" % args.svd_path)
+        out.write('#include "esp_peripherals.h"\n\n')
+        out.write("namespace EspApp\n{\n")
+        for chip, _, blob, count in blobs:
+            out.write("    // %s: %d peripherals, %d bytes\n" % (chip, count, len(blob)))
+            emit_array(out, "g_%sPeripherals" % chip, blob)
+        out.write("    const PeripheralBlob g_peripheralBlobs[] = {\n")
+        for chip, chip_id, _, _ in blobs:
+            out.write("        {0x%04x, g_%sPeripherals, sizeof(g_%sPeripherals)},\n" % (chip_id, chip, chip))
+        if not blobs:
+            out.write("        {0xFFFF, nullptr, 0},\n")
+        out.write("    };\n\n")
+        out.write("    const size_t g_peripheralBlobCount = %d;\n" % len(blobs))
+        out.write("}  // namespace EspApp\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Generate the embedded ROM symbol tables from ESP-IDF's *.rom*.ld linker scripts.
+
+Usage: gen_rom_symbols.py --idf-path <esp-idf> --output <file.cpp>
+
+For every supported chip, components/esp_rom/<chip>/ld/*.rom*.ld is scanned for
+`PROVIDE ( name = 0x... );` and `name = 0x...;` assignments. The symbols are
+deduplicated by address, sorted, and written as one compact blob per chip:
+
+    u32 magic ('EROM'), u16 version, u16 chip id, u32 symbol count, u32 string table size
+    count * { u32 address, u32 name offset }   (ascending address)
+    string table                               (NUL terminated names)
+
+All integers are little-endian. See src/core/esp_rom_symbols.h for the reader.
+"""
+
+import argparse
+import glob
+import os
+import re
+import struct
+import sys
+
+CHIPS = [
+    ("esp32", 0x0000),
+    ("esp32s2", 0x0002),
+    ("esp32c3", 0x0005),
+    ("esp32s3", 0x0009),
+    ("esp32c2", 0x000C),
+    ("esp32c6", 0x000D),
+    ("esp32h2", 0x0010),
+    ("esp32p4", 0x0012),
+]
+
+MAGIC = 0x4D4F5245  # 'EROM'
+VERSION = 1
+
+ASSIGNMENT = re.compile(
+    r"^\s*(?:PROVIDE\s*\(\s*)?([A-Za-z_.$][\w.$]*)\s*=\s*(0x[0-9a-fA-F]+)\s*\)?\s*;", re.MULTILINE
+)
+COMMENT = re.compile(r"/\*.*?\*/", re.DOTALL)
+
+
+def collect_symbols(ld_dir):
+    by_address = {}
+    for path in sorted(glob.glob(os.path.join(ld_dir, "*.rom*.ld"))):
+        with open(path, encoding="utf-8", errors="replace") as f:
+            text = COMMENT.sub("", f.read())
+        for name, value in ASSIGNMENT.findall(text):
+            address = int(value, 16)
+            if address == 0 or address > 0xFFFFFFFF:
+                continue
+            # Several scripts may name the same address; the first definition wins
+            by_address.setdefault(address, name)
+    return sorted(by_address.items())
+
+
+def build_blob(chip_id, symbols):
+    strings = bytearray()
+    entries = bytearray()
+    for address, name in symbols:
+        entries += struct.pack("<II", address, len(strings))
+        strings += name.encode("ascii", "replace") + b"\0"
+    header = struct.pack("<IHHII", MAGIC, VERSION, chip_id, len(symbols), len(strings))
+    return header + entries + strings
+
+
+def emit_array(out, name, blob):
+    out.write("    alignas(4) static const uint8_t %s[] = {\n" % name)
+    for i in range(0, len(blob), 16):
+        out.write("        " + ", ".join("0x%02x" % b for b in blob[i:i + 16]) + ",\n")
+    out.write("    };\n\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--idf-path", required=True, help="ESP-IDF checkout")
+    parser.add_argument("--output", required=True, help="Generated C++ source")
+    args = parser.parse_args()
+
+    blobs = []
+    for chip, chip_id in CHIPS:
+        ld_dir = os.path.join(args.idf_path, "components", "esp_rom", chip, "ld")
+        symbols = collect_symbols(ld_dir)
+        if not symbols:
+            print("warning: no ROM symbols found for %s in %s" % (chip, ld_dir), file=sys.stderr)
+        blobs.append((chip, chip_id, build_blob(chip_id, symbols), len(symbols)))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "w", encoding="ascii") as out:
+        out.write("// Generated by scripts/gen_rom_symbols.py from %s. Do not edit.\n\n" % args.idf_path)
+        out.write('#include "esp_rom_symbols.h"\n\n')
+        out.write("namespace EspApp\n{\n")
+        for chip, _, blob, count in blobs:
+            out.write("    // %s: %d symbols\n" % (chip, count))
+            emit_array(out, "g_%sRomSymbols" % chip, blob)
+        out.write("    const RomSymbolBlob g_romSymbolBlobs[] = {\n")
+        for chip, chip_id, _, _ in blobs:
+            out.write("        {0x%04x, g_%sRomSymbols, sizeof(g_%sRomSymbols)},\n" % (chip_id, chip, chip))
+        out.write("    };\n\n")
+        out.write("    const size_t g_romSymbolBlobCount = sizeof(g_romSymbolBlobs) / sizeof(g_romSymbolBlobs[0]);\n")
+        out.write("}  // namespace EspApp\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,366 @@
+#!/usr/bin/env python3
+"""Build a function signature database for one chip and ESP-IDF version.
+
+Usage: gen_signatures.py --chip <chip> --idf-version <vX.Y.Z> --output <file.sig> <input> ...
+
+Inputs are ELF objects, static libraries (.a) or linked ELF files built for the chip,
+e.g. the libraries under build/esp-idf/ of an ESP-IDF project and its app .elf. Every
+global function is normalized exactly like NormalizeCode() in src/core/esp_signatures.cpp
+(linker-filled operand bits zeroed) and stored under a hash of its first 16 bytes:
+
+    u32 magic ('ESIG'), u16 version, u16 chip id, u32 bucket count (power of two),
+    u32 signature count, u32 string table size, u32 IDF version string offset,
+    u32 key size, u32 0
+    (bucket count + 1) * u32 first signature of each bucket
+    count * { u64 key, u64 body hash, u32 length, u32 name offset }   (grouped by bucket)
+    string table                                                      (NUL terminated)
+
+All integers are little-endian. In relocatable objects a function is skipped if one of
+its relocations patches bits the normalizer keeps, or if the linker may relax (resize)
+its code; linked ELF files reflect the final code and give the most signatures. Functions
+shorter than 16 bytes, and identical bodies exported under different names, are skipped.
+See src/core/esp_signatures.h for the reader.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+CHIPS = {
+    "esp32": (0x0000, "xtensa"),
+    "esp32s2": (0x0002, "xtensa"),
+    "esp32c3": (0x0005, "riscv"),
+    "esp32s3": (0x0009, "xtensa"),
+    "esp32c2": (0x000C, "riscv"),
+    "esp32c6": (0x000D, "riscv"),
+    "esp32h2": (0x0010, "riscv"),
+    "esp32p4": (0x0012, "riscv"),
+}
+
+MAGIC = 0x47495345  # 'ESIG'
+VERSION = 1
+KEY_SIZE = 16
+
+EM_XTENSA = 94
+EM_RISCV = 243
+ET_REL = 1
+SHT_SYMTAB = 2
+SHT_RELA = 4
+SHT_NOBITS = 8
+STT_FUNC = 2
+STB_GLOBAL = 1
+STB_WEAK = 2
+
+# Relocations that patch nothing in the function body
+R_XTENSA_IGNORED = {0, 17, 18, 19}  # NONE, DIFF8/16/32
+R_RISCV_IGNORED = {0, 33, 34, 35, 36, 37, 38, 39, 40, 52, 53, 54, 55}  # NONE, ADD*/SUB*, SUB6, SET*
+
+MASK64 = (1 << 64) - 1
+P1 = 0x9E3779B185EBCA87
+P2 = 0xC2B2AE3D27D4EB4F
+P3 = 0x165667B19E3779F9
+P4 = 0x85EBCA77C2B2AE63
+P5 = 0x27D4EB2F165667C5
+
+
+def rotl(x, r):
+    return ((x << r) | (x >> (64 - r))) & MASK64
+
+
+def xxh_round(acc, lane):
+    return (rotl((acc + lane * P2) & MASK64, 31) * P1) & MASK64
+
+
+def xxh64(data, seed=0):
+    n = len(data)
+    p = 0
+    if n >= 32:
+        v = [(seed + P1 + P2) & MASK64, (seed + P2) & MASK64, seed, (seed - P1) & MASK64]
+        while p <= n - 32:
+            for i in range(4):
+                v[i] = xxh_round(v[i], struct.unpack_from("<Q", data, p + i * 8)[0])
+            p += 32
+        h = (rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18)) & MASK64
+        for lane in v:
+            h = ((h ^ xxh_round(0, lane)) * P1 + P4) & MASK64
+    else:
+        h = (seed + P5) & MASK64
+    h = (h + n) & MASK64
+    while n - p >= 8:
+        h ^= xxh_round(0, struct.unpack_from("<Q", data, p)[0])
+        h = (rotl(h, 27) * P1 + P4) & MASK64
+        p += 8
+    if n - p >= 4:
+        h ^= (struct.unpack_from("<I", data, p)[0] * P1) & MASK64
+        h = (rotl(h, 23) * P2 + P3) & MASK64
+        p += 4
+    while p < n:
+        h ^= (data[p] * P5) & MASK64
+        h = (rotl(h, 11) * P1) & MASK64
+        p += 1
+    h ^= h >> 33
+    h = (h * P2) & MASK64
+    h ^= h >> 29
+    h = (h * P3) & MASK64
+    h ^= h >> 32
+    return h
+
+
+def xtensa_mask(code):
+    mask = bytearray(b"\xff" * len(code))
+    i = 0
+    while i < len(code):
+        op0 = code[i] & 0xF
+        size = 2 if op0 >= 8 else 3
+        if i + size > len(code):
+            break
+        if op0 == 1:
+            mask[i + 1] = mask[i + 2] = 0
+        elif op0 == 5 or (op0 == 6 and (code[i] >> 4) & 3 == 0):
+            mask[i] &= 0x3F
+            mask[i + 1] = mask[i + 2] = 0
+        i += size
+    return mask
+
+
+def riscv_mask(code):
+    mask = bytearray(b"\xff" * len(code))
+    after_upper = False
+    i = 0
+    while i < len(code):
+        size = 4 if code[i] & 3 == 3 else 2
+        if i + size > len(code):
+            break
+        upper = False
+        if size == 2:
+            funct3 = code[i + 1] >> 5
+            if code[i] & 3 == 1 and funct3 in (1, 5):
+                mask[i] &= 0x03
+                mask[i + 1] &= 0xE0
+        else:
+            opcode = code[i] & 0x7F
+            if opcode in (0x17, 0x37, 0x6F):
+                mask[i + 1] &= 0x0F
+                mask[i + 2] = mask[i + 3] = 0
+                upper = opcode != 0x6F
+            elif after_upper and opcode in (0x67, 0x03, 0x13):
+                mask[i + 2] &= 0x0F
+                mask[i + 3] = 0
+            elif after_upper and opcode == 0x23:
+                mask[i] &= 0x7F
+                mask[i + 1] &= 0xF0
+                mask[i + 3] &= 0x01
+        after_upper = upper
+        i += size
+    return mask
+
+
+def normalize(arch, code):
+    mask = xtensa_mask(code) if arch == "xtensa" else riscv_mask(code)
+    return bytes(b & m for b, m in zip(code, mask))
+
+
+# Bits each relocation type writes, as (byte offset, bits) pairs relative to r_offset
+RISCV_HI20 = ((1, 0xF0), (2, 0xFF), (3, 0xFF))
+RISCV_LO12_I = ((2, 0xF0), (3, 0xFF))
+RISCV_LO12_S = ((0, 0x80), (1, 0x0F), (3, 0xFE))
+RISCV_PATCHED = {
+    17: RISCV_HI20,  # JAL
+    18: RISCV_HI20 + tuple((o + 4, b) for o, b in RISCV_LO12_I),  # CALL
+    19: RISCV_HI20 + tuple((o + 4, b) for o, b in RISCV_LO12_I),  # CALL_PLT
+    23: RISCV_HI20,  # PCREL_HI20
+    24: RISCV_LO12_I,  # PCREL_LO12_I
+    25: RISCV_LO12_S,  # PCREL_LO12_S
+    26: RISCV_HI20,  # HI20
+    27: RISCV_LO12_I,  # LO12_I
+    28: RISCV_LO12_S,  # LO12_S
+    45: ((0, 0xFC), (1, 0x1F)),  # RVC_JUMP
+}
+R_XTENSA_SLOT0_OP = 20
+
+
+def relocation_masked(arch, rtype, code, mask, offset):
+    """True if everything relocation `rtype` at `offset` writes is zeroed by the normalizer."""
+    if arch == "xtensa":
+        if rtype in R_XTENSA_IGNORED:
+            return True
+        if rtype != R_XTENSA_SLOT0_OP or offset + 3 > len(code):
+            return False
+        op0 = code[offset] & 0xF
+        patched = ((0, 0xC0), (1, 0xFF), (2, 0xFF)) if op0 in (5, 6) else ((1, 0xFF), (2, 0xFF))
+    else:
+        if rtype in R_RISCV_IGNORED:
+            return True
+        patched = RISCV_PATCHED.get(rtype)
+        if patched is None:
+            return False
+    return all(offset + o < len(mask) and mask[offset + o] & bits == 0 for o, bits in patched)
+
+
+class ElfFile:
+    def __init__(self, data, name):
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("not a 32-bit little-endian ELF file")
+        self.data = data
+        self.name = name
+        (self.type, self.machine) = struct.unpack_from("<HH", data, 16)
+        shoff, = struct.unpack_from("<I", data, 32)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 46)
+        self.sections = []
+        for i in range(shnum):
+            fields = struct.unpack_from("<IIIIIIIIII", data, shoff + i * shentsize)
+            self.sections.append({
+                "name": fields[0], "type": fields[1], "addr": fields[3], "offset": fields[4],
+                "size": fields[5], "link": fields[6], "info": fields[7], "entsize": fields[9],
+            })
+        if shstrndx < len(self.sections):
+            for section in self.sections:
+                section["name"] = self.string(self.sections[shstrndx], section["name"])
+
+    def string(self, strtab, offset):
+        start = strtab["offset"] + offset
+        return self.data[start:self.data.index(b"\0", start)].decode("ascii", "replace")
+
+    def contents(self, section):
+        if section["type"] == SHT_NOBITS:
+            return b""
+        return self.data[section["offset"]:section["offset"] + section["size"]]
+
+    def symbols(self):
+        for section in self.sections:
+            if section["type"] != SHT_SYMTAB:
+                continue
+            strtab = self.sections[section["link"]]
+            for at in range(section["offset"], section["offset"] + section["size"], 16):
+                name, value, size, info, _, shndx = struct.unpack_from("<IIIBBH", self.data, at)
+                yield self.string(strtab, name), value, size, info, shndx
+
+    def relocations(self, target):
+        """(offset, type) of every relocation against section index `target`."""
+        for section in self.sections:
+            if section["type"] != SHT_RELA or section["info"] != target:
+                continue
+            for at in range(section["offset"], section["offset"] + section["size"], 12):
+                offset, info, _ = struct.unpack_from("<IIi", self.data, at)
+                yield offset, info & 0xFF
+
+
+def read_archive(data, path):
+    """Yield (name, bytes) of every member of an ar archive."""
+    long_names = b""
+    at = 8
+    while at + 60 <= len(data):
+        header = data[at:at + 60]
+        name = header[:16].decode("ascii", "replace").rstrip()
+        size = int(header[48:58])
+        body = data[at + 60:at + 60 + size]
+        at += 60 + size + (size & 1)
+        if name == "//":
+            long_names = body
+        elif name in ("/", "/SYM64/", "__.SYMDEF"):
+            continue
+        else:
+            if name.startswith("/") and name[1:].isdigit():
+                start = int(name[1:])
+                name = long_names[start:long_names.index(b"/\n", start)].decode("ascii", "replace")
+            yield "%s(%s)" % (path, name.rstrip("/")), body
+
+
+def collect_functions(elf, arch, stats):
+    """Yield (name, normalized code) of the global functions of one ELF file."""
+    relocatable = elf.type == ET_REL
+    for name, value, size, info, shndx in elf.symbols():
+        if info & 0xF != STT_FUNC or info >> 4 not in (STB_GLOBAL, STB_WEAK) or shndx == 0 or shndx >= 0xFF00:
+            continue
+        stats["functions"] += 1
+        if size < KEY_SIZE:
+            stats["short"] += 1
+            continue
+
+        section = elf.sections[shndx]
+        start = value - (0 if relocatable else section["addr"])
+        code = elf.contents(section)[start:start + size]
+        if len(code) != size:
+            stats["unreadable"] += 1
+            continue
+
+        if relocatable:
+            mask = xtensa_mask(code) if arch == "xtensa" else riscv_mask(code)
+            if not all(relocation_masked(arch, rtype, code, mask, offset - start)
+                       for offset, rtype in elf.relocations(shndx) if start <= offset < start + size):
+                stats["relocated"] += 1
+                continue
+
+        yield name, code
+
+
+def build_database(chip_id, idf_version, signatures):
+    bucket_count = 1
+    while bucket_count < len(signatures):
+        bucket_count *= 2
+
+    strings = bytearray(idf_version.encode("ascii") + b"\0")
+    records = []
+    for (key, body_hash, length), name in signatures.items():
+        records.append((key & (bucket_count - 1), key, body_hash, length, len(strings)))
+        strings += name.encode("ascii", "replace") + b"\0"
+    records.sort()
+
+    buckets = [0] * (bucket_count + 1)
+    for record in records:
+        buckets[record[0] + 1] += 1
+    for i in range(bucket_count):
+        buckets[i + 1] += buckets[i]
+
+    header = struct.pack("<IHHIIIIII", MAGIC, VERSION, chip_id, bucket_count, len(records), len(strings), 0,
+                         KEY_SIZE, 0)
+    body = struct.pack("<%dI" % len(buckets), *buckets)
+    body += b"".join(struct.pack("<QQII", key, body_hash, length, name) for _, key, body_hash, length, name in records)
+    return header + body + strings
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--chip", required=True, choices=sorted(CHIPS), help="Target chip")
+    parser.add_argument("--idf-version", required=True, help="ESP-IDF version, as in esp_app_desc_t (e.g. v5.1.2)")
+    parser.add_argument("--output", required=True, help="Signature database to write (.sig)")
+    parser.add_argument("inputs", nargs="+", help="ELF objects, static libraries or linked ELF files")
+    args = parser.parse_args()
+
+    chip_id, arch = CHIPS[args.chip]
+    machine = EM_XTENSA if arch == "xtensa" else EM_RISCV
+    stats = {"functions": 0, "short": 0, "unreadable": 0, "relocated": 0}
+    by_signature = {}
+    for path in args.inputs:
+        with open(path, "rb") as f:
+            data = f.read()
+        members = read_archive(data, path) if data.startswith(b"!<arch>\n") else [(path, data)]
+        for member, contents in members:
+            try:
+                elf = ElfFile(contents, member)
+            except (ValueError, struct.error, IndexError) as e:
+                print("warning: skipping %s: %s" % (member, e), file=sys.stderr)
+                continue
+            if elf.machine != machine:
+                print("warning: skipping %s: not built for %s" % (member, args.chip), file=sys.stderr)
+                continue
+            for name, code in collect_functions(elf, arch, stats):
+                body = normalize(arch, code)
+                signature = (xxh64(normalize(arch, code[:KEY_SIZE])), xxh64(body, len(body)), len(body))
+                by_signature.setdefault(signature, set()).add(name)
+
+    # The same code under several names cannot be named reliably
+    signatures = {sig: names.pop() for sig, names in by_signature.items() if len(names) == 1}
+    ambiguous = len(by_signature) - len(signatures)
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "wb") as out:
+        out.write(build_database(chip_id, args.idf_version, signatures))
+    print("%s: %d signatures (%d functions; skipped %d short, %d relocated, %d unreadable, %d ambiguous)" % (
+        args.output, len(signatures), stats["functions"], stats["short"], stats["relocated"], stats["unreadable"],
+        ambiguous))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,99 @@
+#include "esp_app_desc.h"
+#include "esp_endian.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    template <size_t N, size_t M>
+    static void CopyField(char (&dest)[N], const char (&src)[M])
+    {
+        static_assert(N == M + 1, "Field copy must leave room for the terminator");
+        size_t length = find(src, src + M, '\0') - src;
+        memcpy(dest, src, length);
+        dest[length] = '\0';
+    }
+
+    bool AppDesc::HasElfHash() const
+    {
+        return any_of(app_elf_sha256.begin(), app_elf_sha256.end(), [](uint8_t b) { return b != 0; });
+    }
+
+    static void DecodeAppDesc(const uint8_t* p, const ParsedImage& image, size_t segment, AppDesc& out)
+    {
+        // Packed, so the descriptor can be read in place; numeric fields go through the LE loaders
+        const auto* raw = reinterpret_cast<const EspAppDescriptor*>(p);
+        const SegmentInfo& seg = image.segments[segment];
+
+        out.secure_version = LoadLE32(p + offsetof(EspAppDescriptor, secure_version));
+        CopyField(out.version, raw->version);
+        CopyField(out.project_name, raw->project_name);
+        CopyField(out.time, raw->time);
+        CopyField(out.date, raw->date);
+        CopyField(out.idf_ver, raw->idf_ver);
+        memcpy(out.app_elf_sha256.data(), raw->app_elf_sha256, out.app_elf_sha256.size());
+        out.min_efuse_blk_rev_full = LoadLE16(p + offsetof(EspAppDescriptor, min_efuse_blk_rev_full));
+        out.max_efuse_blk_rev_full = LoadLE16(p + offsetof(EspAppDescriptor, max_efuse_blk_rev_full));
+        out.mmu_page_size = raw->mmu_page_size;
+        out.segment = segment;
+        out.file_offset = seg.file_offset;
+        out.load_addr = seg.load_addr;
+    }
+
+    bool ParseAppDesc(span<const uint8_t> data, const ParsedImage& image, AppDesc& out)
+    {
+        for (size_t i = 0; i < image.segment_count; i++)
+        {
+            const SegmentInfo& seg = image.segments[i];
+            if (seg.data_len < sizeof(EspAppDescriptor) || seg.file_offset > data.size() ||
+                data.size() - seg.file_offset < sizeof(EspAppDescriptor))
+                continue;
+            if (LoadLE32(data.data() + seg.file_offset) != ESP_APP_DESC_MAGIC)
+                continue;
+
+            DecodeAppDesc(data.data() + seg.file_offset, image, i, out);
+            return true;
+        }
+        return false;
+    }
+
+    bool ParseAppDesc(uint64_t length, ImageProbeReader reader, void* context, const ParsedImage& image,
+        AppDesc& out)
+    {
+        for (size_t i = 0; i < image.segment_count; i++)
+        {
+            const SegmentInfo& seg = image.segments[i];
+            if (seg.data_len < sizeof(EspAppDescriptor) || seg.file_offset > length ||
+                length - seg.file_offset < sizeof(EspAppDescriptor))
+                continue;
+
+            uint8_t buffer[sizeof(EspAppDescriptor)];
+            if (!reader(context, seg.file_offset, buffer, sizeof(buffer)) ||
+                LoadLE32(buffer) != ESP_APP_DESC_MAGIC)
+                continue;
+
+            DecodeAppDesc(buffer, image, i, out);
+            return true;
+        }
+        return false;
+    }
+
+    string GetAppIdentityKey(const AppDesc& desc)
+    {
+        if (desc.HasElfHash())
+            return DigestToHex(desc.app_elf_sha256);
+
+        // Without the ELF hash, identify the build by everything the descriptor records about it
+        Sha256 hash;
+        for (const char* field : {desc.project_name, desc.version, desc.idf_ver, desc.date, desc.time})
+            hash.Update({reinterpret_cast<const uint8_t*>(field), strlen(field) + 1});
+        uint8_t secureVersion[4];
+        StoreLE32(secureVersion, desc.secure_version);
+        hash.Update(secureVersion);
+        return DigestToHex(hash.Final());
+    }
+}  // namespace EspApp
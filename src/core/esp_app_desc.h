@@ -0,0 +1,73 @@
+#pragma once
+
+#include "esp_image.h"
+#include "esp_sha256.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace EspApp
+{
+    constexpr uint32_t ESP_APP_DESC_MAGIC = 0xABCD5432;
+    constexpr size_t ESP_APP_DESC_NOT_FOUND = SIZE_MAX;
+
+// esp_app_desc_t as placed by ESP-IDF at the start of the first DROM segment (256 bytes)
+#pragma pack(push, 1)
+    struct EspAppDescriptor
+    {
+        uint32_t magic_word;               // ESP_APP_DESC_MAGIC
+        uint32_t secure_version;           // Anti-rollback version
+        uint32_t reserv1[2];
+        char version[32];                  // Application version
+        char project_name[32];             // Project name
+        char time[16];                     // Compile time
+        char date[16];                     // Compile date
+        char idf_ver[32];                  // ESP-IDF version
+        uint8_t app_elf_sha256[32];        // SHA-256 of the application ELF
+        uint16_t min_efuse_blk_rev_full;   // Minimum eFuse block revision (IDF 5.2+)
+        uint16_t max_efuse_blk_rev_full;   // Maximum eFuse block revision (IDF 5.2+)
+        uint8_t mmu_page_size;             // log2 of the MMU page size (IDF 5.3+)
+        uint8_t reserv3[3];
+        uint32_t reserv2[18];
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(EspAppDescriptor) == 256, "EspAppDescriptor must be 256 bytes");
+
+    // Decoded app description. Strings are NUL terminated copies of the fixed-size fields.
+    struct AppDesc
+    {
+        uint32_t secure_version;
+        char version[33];
+        char project_name[33];
+        char time[17];
+        char date[17];
+        char idf_ver[33];
+        Sha256Digest app_elf_sha256;
+        uint16_t min_efuse_blk_rev_full;
+        uint16_t max_efuse_blk_rev_full;
+        uint8_t mmu_page_size;
+
+        // Where the descriptor was found
+        size_t segment;          // Index into ParsedImage::segments
+        uint64_t file_offset;
+        uint32_t load_addr;
+
+        bool HasElfHash() const;
+    };
+
+    // Decode the app description at the start of the first segment that carries one. Only the first
+    // bytes of each segment are read, at the offsets ParseImage already recorded. Returns false if no
+    // segment starts with ESP_APP_DESC_MAGIC.
+    bool ParseAppDesc(std::span<const uint8_t> data, const ParsedImage& image, AppDesc& out);
+
+    // Same, reading the 256-byte candidates through `reader` from data of `length` bytes
+    bool ParseAppDesc(uint64_t length, ImageProbeReader reader, void* context, const ParsedImage& image,
+        AppDesc& out);
+
+    // Stable identity of the application, the same for every image built from the same ELF: the hex
+    // app_elf_sha256, or a SHA-256 over the descriptor fields when the build did not record it.
+    std::string GetAppIdentityKey(const AppDesc& desc);
+}  // namespace EspApp
@@ -0,0 +1,245 @@
+#include "esp_chip.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace EspApp
+{
+#define RO  (RegionReadable)
+#define RW  (RegionReadable | RegionWritable)
+#define RX  (RegionReadable | RegionExecutable)
+#define RWX (RegionReadable | RegionWritable | RegionExecutable)
+
+    // Memory maps follow the SOC_*_LOW/HIGH ranges of ESP-IDF's soc.h and the chips' technical reference
+    // manuals. Tables must be sorted by address and must not overlap; this is checked at compile time.
+
+    static constexpr MemoryRegion g_esp32Regions[] = {
+        {"external.data.1",        0x3F400000, 0x3F800000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"external.data.2",        0x3F800000, 0x3FC00000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"peripheral",             0x3FF00000, 0x3FF80000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.rtc_fast", 0x3FF80000, 0x3FF82000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.rom.1",    0x3FF90000, 0x3FFA0000, RO | RegionContainsData, RegionExternalSemantics},
+        {"embedded.data.ram.2",    0x3FFAE000, 0x3FFE0000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.ram.1",    0x3FFE0000, 0x40000000, RW,                      RegionDefaultSemantics},
+        {"embedded.code.rom.0.1",  0x40000000, 0x40008000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.code.rom.0.2",  0x40008000, 0x40060000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.code.ram.0.1",  0x40070000, 0x40080000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.code.ram.0.2",  0x40080000, 0x400A0000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.code.ram.1.1",  0x400A0000, 0x400B0000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.code.ram.1.2",  0x400B0000, 0x400B8000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.code.ram.1.3",  0x400B8000, 0x400C0000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.code.rtc_fast", 0x400C0000, 0x400C2000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"external.code.0",        0x400C2000, 0x40C00000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.rtc_slow",      0x50000000, 0x50002000, RWX                    , RegionDefaultSemantics},
+    };
+
+    static constexpr MemoryRegion g_esp32s2Regions[] = {
+        {"external.data.0",        0x3F000000, 0x3F3F0000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"peripheral.0",           0x3F400000, 0x3F500000, RW,                      RegionDefaultSemantics},
+        {"external.data.1",        0x3F500000, 0x3FF80000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"embedded.data.rtc_fast", 0x3FF9E000, 0x3FFA0000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.rom.1",    0x3FFA0000, 0x3FFB0000, RO | RegionContainsData, RegionExternalSemantics},
+        {"embedded.data.ram.0",    0x3FFB0000, 0x40000000, RW,                      RegionDefaultSemantics},
+        {"embedded.code.rom.0",    0x40000000, 0x40020000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.code.ram.0",    0x40020000, 0x40070000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.code.rtc_fast", 0x40070000, 0x40072000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"external.code.0",        0x40080000, 0x40800000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.rtc_slow",      0x50000000, 0x50002000, RWX                    , RegionDefaultSemantics},
+        {"peripheral.1",           0x60000000, 0x600C0000, RW,                      RegionDefaultSemantics},
+    };
+
+    static constexpr MemoryRegion g_esp32s3Regions[] = {
+        {"external.data.0",        0x3C000000, 0x3E000000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"embedded.data.ram.0",    0x3FC88000, 0x3FD00000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.rom.0",    0x3FF00000, 0x3FF20000, RO | RegionContainsData, RegionExternalSemantics},
+        {"embedded.code.rom.0",    0x40000000, 0x40060000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.code.ram.0",    0x40370000, 0x403E0000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"external.code.0",        0x42000000, 0x44000000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.rtc_slow",      0x50000000, 0x50002000, RWX                    , RegionDefaultSemantics},
+        {"peripheral",             0x60000000, 0x600D1000, RW,                      RegionDefaultSemantics},
+        {"embedded.rtc_fast",      0x600FE000, 0x60100000, RWX                    , RegionDefaultSemantics},
+    };
+
+    static constexpr MemoryRegion g_esp32c2Regions[] = {
+        {"external.data.0",        0x3C000000, 0x3C400000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"embedded.data.ram.0",    0x3FCA0000, 0x3FCE0000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.rom.0",    0x3FF00000, 0x3FF50000, RO | RegionContainsData, RegionExternalSemantics},
+        {"embedded.code.rom.0",    0x40000000, 0x40090000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.code.ram.0",    0x4037C000, 0x403C0000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"external.code.0",        0x42000000, 0x42400000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"peripheral",             0x60000000, 0x600D1000, RW,                      RegionDefaultSemantics},
+    };
+
+    static constexpr MemoryRegion g_esp32c3Regions[] = {
+        {"external.data.0",        0x3C000000, 0x3C800000, RW | RegionContainsData, RegionDefaultSemantics},
+        {"embedded.data.ram.0",    0x3FC80000, 0x3FCE0000, RW,                      RegionDefaultSemantics},
+        {"embedded.data.rom.0",    0x3FF00000, 0x3FF20000, RO | RegionContainsData, RegionExternalSemantics},
+        {"embedded.code.rom.0",    0x40000000, 0x40060000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.code.ram.0",    0x4037C000, 0x403E0000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"external.code.0",        0x42000000, 0x42800000, RX | RegionContainsCode, RegionDefaultSemantics},
+        {"embedded.rtc_fast",      0x50000000, 0x50002000, RWX                    , RegionDefaultSemantics},
+        {"peripheral",             0x60000000, 0x600D1000, RW,                      RegionDefaultSemantics},
+    };
+
+    // C6/H2/P4 map flash and SRAM through unified instruction/data buses, so their regions hold both
+    static constexpr MemoryRegion g_esp32c6Regions[] = {
+        {"embedded.code.rom.0",    0x40000000, 0x40050000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.ram.0",         0x40800000, 0x40880000, RWX | RegionContainsCode | RegionContainsData,
+                                                                                    RegionDefaultSemantics},
+        {"external.flash.0",       0x42000000, 0x43000000, RX | RegionContainsCode | RegionContainsData,
+                                                                                    RegionDefaultSemantics},
+        {"embedded.rtc",           0x50000000, 0x50004000, RWX                    , RegionDefaultSemantics},
+        {"peripheral",             0x60000000, 0x600C0000, RW,                      RegionDefaultSemantics},
+    };
+
+    static constexpr MemoryRegion g_esp32h2Regions[] = {
+        {"embedded.code.rom.0",    0x40000000, 0x40020000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.ram.0",         0x40800000, 0x40850000, RWX | RegionContainsCode | RegionContainsData,
+                                                                                    RegionDefaultSemantics},
+        {"external.flash.0",       0x42000000, 0x43000000, RX | RegionContainsCode | RegionContainsData,
+                                                                                    RegionDefaultSemantics},
+        {"embedded.rtc",           0x50000000, 0x50001000, RWX                    , RegionDefaultSemantics},
+        {"peripheral",             0x60000000, 0x600C0000, RW,                      RegionDefaultSemantics},
+    };
+
+    static constexpr MemoryRegion g_esp32p4Regions[] = {
+        {"embedded.tcm",           0x30100000, 0x30102000, RWX                    , RegionDefaultSemantics},
+        {"external.flash.0",       0x40000000, 0x44000000, RX | RegionContainsCode | RegionContainsData,
+                                                                                    RegionDefaultSemantics},
+        {"external.psram.0",       0x48000000, 0x4C000000, RWX | RegionContainsData, RegionDefaultSemantics},
+        {"embedded.code.rom.0",    0x4FC00000, 0x4FC20000, RX | RegionContainsCode, RegionExternalSemantics},
+        {"embedded.ram.0",         0x4FF00000, 0x4FFC0000, RWX | RegionContainsCode | RegionContainsData,
+                                                                                    RegionDefaultSemantics},
+        {"peripheral.hp",          0x50000000, 0x50100000, RW,                      RegionDefaultSemantics},
+        {"embedded.rtc",           0x50108000, 0x50110000, RWX                    , RegionDefaultSemantics},
+        {"peripheral.lp",          0x50110000, 0x50130000, RW,                      RegionDefaultSemantics},
+    };
+
+#undef RO
+#undef RW
+#undef RX
+#undef RWX
+
+    template <size_t N>
+    static constexpr bool IsValidRegionTable(const MemoryRegion (&regions)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            if (!regions[i].name || regions[i].start_addr >= regions[i].end_addr)
+                return false;
+            if (i > 0 && regions[i - 1].end_addr > regions[i].start_addr)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(IsValidRegionTable(g_esp32Regions), "ESP32 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32s2Regions), "ESP32-S2 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32s3Regions), "ESP32-S3 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32c2Regions), "ESP32-C2 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32c3Regions), "ESP32-C3 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32c6Regions), "ESP32-C6 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32h2Regions), "ESP32-H2 regions must be sorted and non-overlapping");
+    static_assert(IsValidRegionTable(g_esp32p4Regions), "ESP32-P4 regions must be sorted and non-overlapping");
+
+    template <size_t N>
+    static constexpr ChipAttr MakeChipAttr(
+        EspChipId chipId, const char* chipName, const char* archName, const MemoryRegion (&regions)[N])
+    {
+        return {chipId, chipName, archName, regions, N};
+    }
+
+    // The Xtensa LX7 parts (S2/S3) use the same windowed-ABI decoder as the ESP32; the RISC-V parts use
+    // Binary Ninja's RV32 architecture.
+    static constexpr ChipAttr g_esp32Attr = MakeChipAttr(EspChipId::ESP32, "ESP32", "esp32", g_esp32Regions);
+    static constexpr ChipAttr g_esp32s2Attr =
+        MakeChipAttr(EspChipId::ESP32_S2, "ESP32-S2", "esp32", g_esp32s2Regions);
+    static constexpr ChipAttr g_esp32s3Attr =
+        MakeChipAttr(EspChipId::ESP32_S3, "ESP32-S3", "esp32", g_esp32s3Regions);
+    static constexpr ChipAttr g_esp32c2Attr =
+        MakeChipAttr(EspChipId::ESP32_C2, "ESP32-C2", "rv32gc", g_esp32c2Regions);
+    static constexpr ChipAttr g_esp32c3Attr =
+        MakeChipAttr(EspChipId::ESP32_C3, "ESP32-C3", "rv32gc", g_esp32c3Regions);
+    static constexpr ChipAttr g_esp32c6Attr =
+        MakeChipAttr(EspChipId::ESP32_C6, "ESP32-C6", "rv32gc", g_esp32c6Regions);
+    static constexpr ChipAttr g_esp32h2Attr =
+        MakeChipAttr(EspChipId::ESP32_H2, "ESP32-H2", "rv32gc", g_esp32h2Regions);
+    static constexpr ChipAttr g_esp32p4Attr =
+        MakeChipAttr(EspChipId::ESP32_P4, "ESP32-P4", "rv32gc", g_esp32p4Regions);
+
+    static constexpr const ChipAttr* g_chipAttrList[] = {
+        &g_esp32Attr,
+        &g_esp32s2Attr,
+        &g_esp32s3Attr,
+        &g_esp32c2Attr,
+        &g_esp32c3Attr,
+        &g_esp32c6Attr,
+        &g_esp32h2Attr,
+        &g_esp32p4Attr,
+    };
+
+    // Direct id -> attr table, sized by the largest chip id. Chip ids are small integers.
+    static constexpr size_t GetChipIdTableSize()
+    {
+        size_t tableSize = 0;
+        for (EspChipId id : ESP_CHIP_IDS)
+            tableSize = max(tableSize, static_cast<size_t>(id) + 1);
+        return tableSize;
+    }
+
+    static constexpr size_t CHIP_ID_TABLE_SIZE = GetChipIdTableSize();
+
+    static constexpr bool IsValidChipList()
+    {
+        for (size_t i = 0; i < size(g_chipAttrList); i++)
+        {
+            if (static_cast<size_t>(g_chipAttrList[i]->chip_id) >= CHIP_ID_TABLE_SIZE)
+                return false;
+            for (size_t j = 0; j < i; j++)
+            {
+                if (g_chipAttrList[i]->chip_id == g_chipAttrList[j]->chip_id)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool HasAttrForEveryChipId()
+    {
+        for (EspChipId id : ESP_CHIP_IDS)
+        {
+            bool found = false;
+            for (const ChipAttr* attr : g_chipAttrList)
+                found |= attr->chip_id == id;
+            if (!found)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(IsValidChipList(), "Chip ids must be unique and fit the id lookup table");
+    static_assert(HasAttrForEveryChipId(), "Every EspChipId must have a ChipAttr");
+
+    static constexpr array<const ChipAttr*, CHIP_ID_TABLE_SIZE> BuildChipIdTable()
+    {
+        array<const ChipAttr*, CHIP_ID_TABLE_SIZE> table {};
+        for (const ChipAttr* attr : g_chipAttrList)
+            table[static_cast<size_t>(attr->chip_id)] = attr;
+        return table;
+    }
+
+    static constexpr array<const ChipAttr*, CHIP_ID_TABLE_SIZE> g_chipAttrById = BuildChipIdTable();
+
+    span<const ChipAttr* const> GetChipAttrList()
+    {
+        return g_chipAttrList;
+    }
+
+    const ChipAttr* GetChipAttrById(EspChipId chipId)
+    {
+        size_t index = static_cast<size_t>(chipId);
+        return index < g_chipAttrById.size() ? g_chipAttrById[index] : nullptr;
+    }
+}  // namespace EspApp
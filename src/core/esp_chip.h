@@ -0,0 +1,52 @@
+#pragma once
+
+#include "esp_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace EspApp
+{
+    // Region permission/content flags. The values mirror BNSegmentFlag so that the view can pass them
+    // straight through to AddAutoSegment.
+    enum RegionFlag : uint32_t
+    {
+        RegionExecutable = 0x01,
+        RegionWritable = 0x02,
+        RegionReadable = 0x04,
+        RegionContainsData = 0x08,
+        RegionContainsCode = 0x10,
+    };
+
+    // Section semantics. The values mirror BNSectionSemantics.
+    enum RegionSemantics : uint32_t
+    {
+        RegionDefaultSemantics = 0,
+        RegionReadOnlyCodeSemantics = 1,
+        RegionReadOnlyDataSemantics = 2,
+        RegionReadWriteDataSemantics = 3,
+        RegionExternalSemantics = 4,
+    };
+
+    struct MemoryRegion
+    {
+        const char* name;
+        uint64_t start_addr;
+        uint64_t end_addr;
+        uint32_t flags;
+        uint32_t section_semantics;
+    };
+
+    struct ChipAttr
+    {
+        EspChipId chip_id;
+        const char* chip_name;
+        const char* arch_name;
+        const MemoryRegion* regions;
+        size_t region_count;
+    };
+
+    std::span<const ChipAttr* const> GetChipAttrList();
+    const ChipAttr* GetChipAttrById(EspChipId chipId);
+}  // namespace EspApp
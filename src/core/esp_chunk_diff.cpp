@@ -0,0 +1,170 @@
+#include "esp_chunk_diff.h"
+#include "esp_hash.h"
+#include "esp_parallel.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace EspApp
+{
+    // Gear table: one pseudo-random 64-bit value per byte value (splitmix64)
+    static constexpr array<uint64_t, 256> MakeGearTable()
+    {
+        array<uint64_t, 256> table {};
+        uint64_t state = 0x45535031u;  // "ESP1"
+        for (auto& value : table)
+        {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }
+
+    static constexpr array<uint64_t, 256> g_gear = MakeGearTable();
+
+    void ChunkContent(span<const uint8_t> data, uint32_t addr, vector<ContentChunk>& out)
+    {
+        size_t start = 0;
+        while (start < data.size())
+        {
+            size_t remaining = data.size() - start;
+            size_t length = remaining;
+            if (remaining > ESP_CHUNK_MIN_SIZE)
+            {
+                // Bytes before the minimum size never end a chunk, so they are not rolled in either
+                const uint8_t* p = data.data() + start;
+                size_t limit = min(remaining, ESP_CHUNK_MAX_SIZE);
+                uint64_t hash = 0;
+                length = limit;
+                for (size_t i = ESP_CHUNK_MIN_SIZE; i < limit; i++)
+                {
+                    hash = (hash << 1) + g_gear[p[i]];
+                    if ((hash & (ESP_CHUNK_BOUNDARY_MASK << 40)) == 0)
+                    {
+                        length = i + 1;
+                        break;
+                    }
+                }
+            }
+
+            // XXH64 already runs four independent lanes and hashes at several GB/s, a fifth of the time spent
+            // here; its 64-bit multiplies have no SSE2 or AVX2 counterpart, so a vector version would be slower
+            span<const uint8_t> chunk = data.subspan(start, length);
+            out.push_back(
+                {addr + static_cast<uint32_t>(start), static_cast<uint32_t>(length), XxHash64(chunk, length)});
+            start += length;
+        }
+    }
+
+    void BuildChunkIndex(span<const uint8_t> data, const ParsedImage& image, ChunkIndex& out, size_t maxThreads)
+    {
+        span<const SegmentInfo> segments = image.Segments();
+        vector<vector<ContentChunk>> perSegment(segments.size());
+        ParallelFor(segments.size(), [&](size_t i) {
+            const SegmentInfo& seg = segments[i];
+            if (seg.file_offset + seg.data_len <= data.size())
+                ChunkContent(data.subspan(seg.file_offset, seg.data_len), seg.load_addr, perSegment[i]);
+        }, maxThreads);
+
+        out.chunks.clear();
+        out.bytes = 0;
+        for (const auto& chunks : perSegment)
+        {
+            out.chunks.insert(out.chunks.end(), chunks.begin(), chunks.end());
+            for (const auto& chunk : chunks)
+                out.bytes += chunk.length;
+        }
+        sort(out.chunks.begin(), out.chunks.end(),
+            [](const ContentChunk& a, const ContentChunk& b) { return a.addr < b.addr; });
+    }
+
+    static void AddRange(vector<ChangedRange>& ranges, const ContentChunk& chunk, const RegionIndex& regions)
+    {
+        const MemoryRegion* region = regions.Find(chunk.addr);
+        if (!ranges.empty())
+        {
+            ChangedRange& last = ranges.back();
+            if (last.region == region && uint64_t(last.start) + last.length == chunk.addr)
+            {
+                last.length += chunk.length;
+                return;
+            }
+        }
+        ranges.push_back({chunk.addr, chunk.length, region});
+    }
+
+    void DiffChunkIndexes(const ChunkIndex& base, const ChunkIndex& target, const RegionIndex& regions,
+        ImageDiff& out)
+    {
+        // Base chunks by hash, each hash's chunks in address order
+        vector<pair<uint64_t, uint32_t>> known;
+        known.reserve(base.chunks.size());
+        for (size_t i = 0; i < base.chunks.size(); i++)
+            known.push_back({base.chunks[i].hash, static_cast<uint32_t>(i)});
+        sort(known.begin(), known.end());
+
+        // Candidate base chunk of each target chunk: the first copy past the previous candidate, so that
+        // repeated content pairs up in order, or else the first copy
+        constexpr uint32_t none = UINT32_MAX;
+        vector<uint32_t> candidate(target.chunks.size(), none);
+        uint32_t previous = 0;
+        for (size_t i = 0; i < target.chunks.size(); i++)
+        {
+            uint64_t hash = target.chunks[i].hash;
+            auto first = lower_bound(known.begin(), known.end(), make_pair(hash, uint32_t(0)));
+            if (first == known.end() || first->first != hash)
+                continue;
+            auto next = lower_bound(first, known.end(), make_pair(hash, previous));
+            candidate[i] = (next != known.end() && next->first == hash ? next : first)->second;
+            previous = candidate[i] + 1;
+        }
+
+        // Longest strictly ascending run of candidates (patience sorting); its chunks are in place
+        vector<uint32_t> tails;  // Target index ending the best run of each length
+        vector<uint32_t> parent(target.chunks.size(), none);
+        for (uint32_t i = 0; i < target.chunks.size(); i++)
+        {
+            if (candidate[i] == none)
+                continue;
+            auto it = lower_bound(tails.begin(), tails.end(), candidate[i],
+                [&](uint32_t index, uint32_t value) { return candidate[index] < value; });
+            parent[i] = it == tails.begin() ? none : *prev(it);
+            if (it == tails.end())
+                tails.push_back(i);
+            else
+                *it = i;
+        }
+        vector<uint8_t> inPlace(target.chunks.size(), 0);
+        for (uint32_t i = tails.empty() ? none : tails.back(); i != none; i = parent[i])
+            inPlace[i] = 1;
+
+        out.changed.clear();
+        out.moved.clear();
+        out.changed_bytes = 0;
+        out.moved_bytes = 0;
+        out.unchanged_bytes = 0;
+        for (size_t i = 0; i < target.chunks.size(); i++)
+        {
+            const ContentChunk& chunk = target.chunks[i];
+            if (inPlace[i])
+            {
+                out.unchanged_bytes += chunk.length;
+            }
+            else if (candidate[i] != none)
+            {
+                out.moved_bytes += chunk.length;
+                AddRange(out.moved, chunk, regions);
+            }
+            else
+            {
+                out.changed_bytes += chunk.length;
+                AddRange(out.changed, chunk, regions);
+            }
+        }
+    }
+}  // namespace EspApp
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "esp_image.h"
+#include "esp_layout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    // Content-defined chunking parameters. Boundaries depend only on the bytes around them, so an insertion
+    // or a changed function only changes the chunks it touches and later chunks line up again.
+    constexpr size_t ESP_CHUNK_MIN_SIZE = 128;
+    constexpr size_t ESP_CHUNK_MAX_SIZE = 4096;
+    constexpr uint64_t ESP_CHUNK_BOUNDARY_MASK = 0x1FF;  // ~512 byte average past the minimum
+
+    struct ContentChunk
+    {
+        uint32_t addr;
+        uint32_t length;
+        uint64_t hash;  // XxHash64 of the chunk, seeded with its length
+    };
+
+    // Chunks of every file-backed segment of an image, in ascending address order
+    struct ChunkIndex
+    {
+        std::vector<ContentChunk> chunks;
+        uint64_t bytes = 0;
+    };
+
+    // Split `data`, loaded at `addr`, into content-defined chunks using a gear rolling hash
+    void ChunkContent(std::span<const uint8_t> data, uint32_t addr, std::vector<ContentChunk>& out);
+
+    // Chunk the segments of `image` (parsed out of `data`) in parallel
+    void BuildChunkIndex(
+        std::span<const uint8_t> data, const ParsedImage& image, ChunkIndex& out, size_t maxThreads = 0);
+
+    // A run of target bytes that changed, or moved, relative to the base image
+    struct ChangedRange
+    {
+        uint32_t start;
+        uint32_t length;
+        const MemoryRegion* region;  // Region of `start`, or nullptr
+    };
+
+    struct ImageDiff
+    {
+        // Ascending, adjacent chunks in the same region merged
+        std::vector<ChangedRange> changed;  // Content that does not occur in the base
+        std::vector<ChangedRange> moved;    // Content of the base out of its order there, or a second copy of it
+        uint64_t changed_bytes = 0;
+        uint64_t moved_bytes = 0;
+        uint64_t unchanged_bytes = 0;
+    };
+
+    // Compare `target` against `base`. Target chunks are matched to base chunks with the same content in order:
+    // the longest run of matches that is ascending in both images is unchanged, other chunks whose content
+    // occurs in the base are moved, the rest changed. O(n log n) in the number of chunks.
+    void DiffChunkIndexes(const ChunkIndex& base, const ChunkIndex& target, const RegionIndex& regions,
+        ImageDiff& out);
+}  // namespace EspApp
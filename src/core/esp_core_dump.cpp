@@ -0,0 +1,454 @@
+#include "esp_core_dump.h"
+#include "esp_chip.h"
+#include "esp_endian.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr uint8_t ELF_MAGIC[4] = {0x7F, 'E', 'L', 'F'};
+    static constexpr uint16_t ELF_TYPE_CORE = 4;
+    static constexpr uint16_t ELF_MACHINE_XTENSA = 94;
+    static constexpr uint16_t ELF_MACHINE_RISCV = 243;
+    static constexpr uint32_t ELF_PT_LOAD = 1;
+    static constexpr uint32_t ELF_PT_NOTE = 4;
+    static constexpr uint32_t ELF_NT_PRSTATUS = 1;
+
+    // elf_prstatus up to pr_reg: pr_info, pr_cursig, signal masks, pids and four timevals. ESP-IDF stores the
+    // TCB address in pr_pid.
+    static constexpr size_t PRSTATUS_PID_OFFSET = 24;
+    static constexpr size_t PRSTATUS_REG_OFFSET = 72;
+    static constexpr size_t XTENSA_GREGSET_WORDS = 128;  // pc .. windowbase, 56 reserved, ar[64]
+    static constexpr size_t RISCV_GREGSET_WORDS = 32;    // pc, x1-x31
+
+    // Partition header words: data_len, version, tasks_num, tcb_sz, then mem_segs_num and chip_rev in
+    // later versions. data_len covers the header, the body and the trailing CRC32 or SHA-256.
+    static constexpr size_t PARTITION_HEADER_SIZES[] = {24, 20, 16};
+    static constexpr size_t PARTITION_CHECKSUM_SIZES[] = {4, 32};
+    static constexpr uint32_t PARTITION_VERSION_ELF = 1;
+
+    static constexpr uint32_t FREERTOS_TCB_NAME_OFFSET = 0x34;  // pcTaskName
+
+    // Xtensa interrupt/exception frame (XtExcFrame) and the frame of a task that yielded (XtSolFrame)
+    static constexpr size_t XT_STK_EXIT = 0;
+    static constexpr size_t XT_STK_FRAME_WORDS = 25;
+    static constexpr size_t XT_SOL_FRAME_WORDS = 8;
+
+    // RISC-V exception frame (RvExcFrame): mepc, x1-x31, mstatus, mtvec, mcause, mtval, mhartid
+    static constexpr size_t RV_STK_MSTATUS = 32;
+    static constexpr size_t RV_STK_MCAUSE = 34;
+    static constexpr size_t RV_STK_MTVAL = 35;
+
+    enum XtensaReg : size_t
+    {
+        XtPc, XtPs, XtSar, XtExcCause, XtExcVaddr, XtLbeg, XtLend, XtLcount, XtA0,
+    };
+
+    static const char* const g_xtensaRegNames[] = {"pc", "ps", "sar", "exccause", "excvaddr", "lbeg", "lend",
+        "lcount", "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "a8", "a9", "a10", "a11", "a12", "a13", "a14",
+        "a15"};
+    static const char* const g_riscvRegNames[] = {"pc", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0",
+        "a1", "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3",
+        "t4", "t5", "t6", "mstatus", "mcause", "mtval"};
+
+    static_assert(size(g_riscvRegNames) == ESP_CORE_DUMP_MAX_REGS, "RISC-V registers must fill CoreDumpTask::regs");
+
+    const char* GetCoreDumpParseStatusString(CoreDumpParseStatus status)
+    {
+        switch (status)
+        {
+        case CoreDumpParseStatus::Ok:
+            return "ok";
+        case CoreDumpParseStatus::TooShort:
+            return "data is shorter than a core dump header";
+        case CoreDumpParseStatus::BadHeader:
+            return "not an ELF core file or a coredump partition";
+        case CoreDumpParseStatus::BadElf:
+            return "malformed ELF core file";
+        case CoreDumpParseStatus::UnknownArch:
+            return "unknown architecture";
+        case CoreDumpParseStatus::Truncated:
+            return "core dump is truncated";
+        }
+        return "unknown";
+    }
+
+    span<const char* const> GetCoreDumpRegisterNames(CoreDumpArch arch)
+    {
+        if (arch == CoreDumpArch::Xtensa)
+            return g_xtensaRegNames;
+        return g_riscvRegNames;
+    }
+
+    size_t GetCoreDumpStackPointerIndex(CoreDumpArch arch)
+    {
+        return arch == CoreDumpArch::Xtensa ? XtA0 + 1 : 2;
+    }
+
+    span<const uint8_t> ParsedCoreDump::Find(span<const uint8_t> data, uint32_t addr, uint32_t length) const
+    {
+        auto it = upper_bound(segments.begin(), segments.end(), addr,
+            [](uint32_t value, const CoreDumpSegment& seg) { return value < seg.addr; });
+        while (it != segments.begin())
+        {
+            --it;
+            if (addr - it->addr <= it->size && it->size - (addr - it->addr) >= length)
+                return data.subspan(it->file_offset + (addr - it->addr), length);
+        }
+        return {};
+    }
+
+    size_t ParsedCoreDump::Read(span<const uint8_t> data, uint32_t addr, void* dest, size_t length) const
+    {
+        auto out = static_cast<uint8_t*>(dest);
+        memset(out, 0, length);
+        uint64_t end = uint64_t(addr) + length;
+        size_t copied = 0;
+        for (const CoreDumpSegment& seg : segments)
+        {
+            uint64_t segEnd = uint64_t(seg.addr) + seg.size;
+            if (seg.addr >= end)
+                break;
+            if (segEnd <= addr)
+                continue;
+            uint64_t start = max<uint64_t>(seg.addr, addr);
+            uint64_t stop = min(segEnd, end);
+            memcpy(out + (start - addr), data.data() + seg.file_offset + (start - seg.addr), stop - start);
+            copied += stop - start;
+        }
+        return copied;
+    }
+
+    static uint32_t AlignUp4(uint32_t value)
+    {
+        return (value + 3) & ~3u;
+    }
+
+    static uint32_t FixXtensaPc(uint32_t pc)
+    {
+        // Windowed calls keep the caller's window increment in the top two bits of the return address
+        return (pc & 0x80000000) ? (pc & 0x3FFFFFFF) | 0x40000000 : pc;
+    }
+
+    static void ReadTaskName(span<const uint8_t> data, const ParsedCoreDump& dump, CoreDumpTask& task)
+    {
+        task.name[0] = 0;
+        span<const uint8_t> name = dump.Find(data, task.tcb_addr + FREERTOS_TCB_NAME_OFFSET,
+            ESP_CORE_DUMP_TASK_NAME_LEN);
+        if (name.empty())
+            return;
+
+        size_t length = 0;
+        while (length < name.size() && name[length] != 0)
+        {
+            if (name[length] < 0x20 || name[length] > 0x7E)
+                return;
+            length++;
+        }
+        memcpy(task.name, name.data(), length);
+        task.name[length] = 0;
+    }
+
+    static void SortSegments(ParsedCoreDump& out)
+    {
+        stable_sort(out.segments.begin(), out.segments.end(),
+            [](const CoreDumpSegment& a, const CoreDumpSegment& b) { return a.addr < b.addr; });
+    }
+
+    // Registers of an ELF NT_PRSTATUS note
+    static void DecodeElfRegisters(CoreDumpArch arch, const uint8_t* gregs, CoreDumpTask& task)
+    {
+        if (arch == CoreDumpArch::RiscV)
+        {
+            for (size_t i = 0; i < RISCV_GREGSET_WORDS; i++)
+                task.regs[i] = LoadLE32(gregs + i * 4);
+            return;
+        }
+
+        task.regs[XtPc] = FixXtensaPc(LoadLE32(gregs));
+        task.regs[XtPs] = LoadLE32(gregs + 4);
+        task.regs[XtLbeg] = LoadLE32(gregs + 8);
+        task.regs[XtLend] = LoadLE32(gregs + 12);
+        task.regs[XtLcount] = LoadLE32(gregs + 16);
+        task.regs[XtSar] = LoadLE32(gregs + 20);
+        uint32_t windowBase = LoadLE32(gregs + 28);
+        const uint8_t* ar = gregs + 64 * 4;
+        for (size_t i = 0; i < 16; i++)
+            task.regs[XtA0 + i] = LoadLE32(ar + ((windowBase * 4 + i) & 63) * 4);
+    }
+
+    static CoreDumpParseStatus ParseElfCore(span<const uint8_t> data, uint64_t base, ParsedCoreDump& out)
+    {
+        span<const uint8_t> elf = data.subspan(base);
+        if (elf.size() < 52 || memcmp(elf.data(), ELF_MAGIC, 4) != 0)
+            return CoreDumpParseStatus::BadHeader;
+        if (elf[4] != 1 || elf[5] != 1 || LoadLE16(elf.data() + 16) != ELF_TYPE_CORE)
+            return CoreDumpParseStatus::BadElf;
+
+        uint16_t machine = LoadLE16(elf.data() + 18);
+        if (machine == ELF_MACHINE_XTENSA)
+            out.arch = CoreDumpArch::Xtensa;
+        else if (machine == ELF_MACHINE_RISCV)
+            out.arch = CoreDumpArch::RiscV;
+        else
+            return CoreDumpParseStatus::UnknownArch;
+
+        uint32_t phOffset = LoadLE32(elf.data() + 28);
+        uint16_t phSize = LoadLE16(elf.data() + 42);
+        uint16_t phCount = LoadLE16(elf.data() + 44);
+        if (phSize < 32 || phOffset > elf.size() || (elf.size() - phOffset) / phSize < phCount)
+            return CoreDumpParseStatus::BadElf;
+
+        out.format = CoreDumpFormat::Elf;
+        uint32_t crashedTcb = 0;
+        bool hasCrashedTcb = false;
+        uint32_t excCause = 0, excVaddr = 0;
+        for (size_t i = 0; i < phCount; i++)
+        {
+            const uint8_t* ph = elf.data() + phOffset + i * phSize;
+            uint32_t type = LoadLE32(ph);
+            uint32_t offset = LoadLE32(ph + 4);
+            uint32_t vaddr = LoadLE32(ph + 8);
+            uint32_t fileSize = LoadLE32(ph + 16);
+            if (type != ELF_PT_LOAD && type != ELF_PT_NOTE)
+                continue;
+            if (offset > elf.size() || elf.size() - offset < fileSize)
+                return CoreDumpParseStatus::Truncated;
+
+            if (type == ELF_PT_LOAD)
+            {
+                if (fileSize != 0)
+                    out.segments.push_back({vaddr, fileSize, base + offset});
+                continue;
+            }
+
+            span<const uint8_t> notes = elf.subspan(offset, fileSize);
+            size_t pos = 0;
+            while (notes.size() - pos >= 12)
+            {
+                uint32_t nameSize = LoadLE32(notes.data() + pos);
+                uint32_t descSize = LoadLE32(notes.data() + pos + 4);
+                uint32_t noteType = LoadLE32(notes.data() + pos + 8);
+                uint64_t descPos = pos + 12 + uint64_t(AlignUp4(nameSize));
+                if (nameSize > notes.size() || descSize > notes.size() || descPos + descSize > notes.size())
+                    return CoreDumpParseStatus::BadElf;
+
+                string name(reinterpret_cast<const char*>(notes.data() + pos + 12), nameSize);
+                name = name.substr(0, name.find('\0'));
+                const uint8_t* desc = notes.data() + descPos;
+                if (name == "CORE" && noteType == ELF_NT_PRSTATUS)
+                {
+                    size_t words = out.arch == CoreDumpArch::Xtensa ? XTENSA_GREGSET_WORDS : RISCV_GREGSET_WORDS;
+                    if (descSize < PRSTATUS_REG_OFFSET + words * 4)
+                        return CoreDumpParseStatus::BadElf;
+                    CoreDumpTask task {};
+                    task.tcb_addr = LoadLE32(desc + PRSTATUS_PID_OFFSET);
+                    DecodeElfRegisters(out.arch, desc + PRSTATUS_REG_OFFSET, task);
+                    out.tasks.push_back(task);
+                }
+                else if (name == "ESP_CORE_DUMP_INFO" && descSize > 4)
+                {
+                    // Version word, then the app ELF SHA-256 as a NUL terminated hex string
+                    string sha(reinterpret_cast<const char*>(desc + 4), descSize - 4);
+                    out.app_elf_sha256 = sha.substr(0, sha.find('\0'));
+                }
+                else if (name == "EXTRA_INFO" && descSize >= 4)
+                {
+                    // Crashed task TCB, then (register number, value) pairs on Xtensa
+                    crashedTcb = LoadLE32(desc);
+                    hasCrashedTcb = true;
+                    for (uint32_t p = 4; out.arch == CoreDumpArch::Xtensa && p + 8 <= descSize; p += 8)
+                    {
+                        uint32_t reg = LoadLE32(desc + p);
+                        if (reg == 232)
+                            excCause = LoadLE32(desc + p + 4);
+                        else if (reg == 238)
+                            excVaddr = LoadLE32(desc + p + 4);
+                    }
+                }
+                pos = descPos + AlignUp4(descSize);
+            }
+        }
+        SortSegments(out);
+
+        size_t sp = GetCoreDumpStackPointerIndex(out.arch);
+        for (size_t i = 0; i < out.tasks.size(); i++)
+        {
+            CoreDumpTask& task = out.tasks[i];
+            task.stack_top = task.regs[sp];
+            task.stack_end = task.stack_top;
+            for (const CoreDumpSegment& seg : out.segments)
+            {
+                if (task.stack_top - seg.addr < seg.size)
+                    task.stack_end = seg.addr + seg.size;
+            }
+            ReadTaskName(data, out, task);
+            if (hasCrashedTcb && task.tcb_addr == crashedTcb)
+                out.crashed_task = i;
+        }
+        if (out.crashed_task == ESP_CORE_DUMP_NO_TASK && !out.tasks.empty())
+            out.crashed_task = 0;
+        if (out.crashed_task != ESP_CORE_DUMP_NO_TASK && out.arch == CoreDumpArch::Xtensa)
+        {
+            out.tasks[out.crashed_task].regs[XtExcCause] = excCause;
+            out.tasks[out.crashed_task].regs[XtExcVaddr] = excVaddr;
+        }
+        return CoreDumpParseStatus::Ok;
+    }
+
+    // Registers of a binary format task, from the frame its stack pointer points at
+    static void DecodeStackFrame(span<const uint8_t> data, const ParsedCoreDump& dump, CoreDumpTask& task)
+    {
+        if (dump.arch == CoreDumpArch::RiscV)
+        {
+            // mtvec sits between mstatus and mcause and is not reported
+            span<const uint8_t> frame = dump.Find(data, task.stack_top, (RV_STK_MTVAL + 1) * 4);
+            if (frame.empty())
+                return;
+            for (size_t i = 0; i <= RV_STK_MSTATUS; i++)
+                task.regs[i] = LoadLE32(frame.data() + i * 4);
+            task.regs[RV_STK_MSTATUS + 1] = LoadLE32(frame.data() + RV_STK_MCAUSE * 4);
+            task.regs[RV_STK_MSTATUS + 2] = LoadLE32(frame.data() + RV_STK_MTVAL * 4);
+            return;
+        }
+
+        span<const uint8_t> frame = dump.Find(data, task.stack_top, XT_SOL_FRAME_WORDS * 4);
+        if (frame.empty())
+            return;
+        task.regs[XtPc] = FixXtensaPc(LoadLE32(frame.data() + 4));
+        task.regs[XtPs] = LoadLE32(frame.data() + 8);
+        if (LoadLE32(frame.data() + XT_STK_EXIT * 4) == 0)
+        {
+            for (size_t i = 0; i < 4; i++)
+                task.regs[XtA0 + i] = LoadLE32(frame.data() + (4 + i) * 4);
+            return;
+        }
+
+        frame = dump.Find(data, task.stack_top, XT_STK_FRAME_WORDS * 4);
+        if (frame.empty())
+            return;
+        auto word = [&](size_t index) { return LoadLE32(frame.data() + index * 4); };
+        for (size_t i = 0; i < 16; i++)
+            task.regs[XtA0 + i] = word(3 + i);
+        task.regs[XtSar] = word(19);
+        task.regs[XtExcCause] = word(20);
+        task.regs[XtExcVaddr] = word(21);
+        task.regs[XtLbeg] = word(22);
+        task.regs[XtLend] = word(23);
+        task.regs[XtLcount] = word(24);
+    }
+
+    // Walk a binary format body with one guess of the header and checksum sizes. The right guess is the one
+    // whose tasks and segments end exactly where the checksum starts.
+    static bool WalkBinaryCore(span<const uint8_t> data, size_t headerSize, size_t checksumSize, ParsedCoreDump& out)
+    {
+        uint32_t dataLength = LoadLE32(data.data());
+        if (dataLength < headerSize + checksumSize)
+            return false;
+        uint32_t taskCount = LoadLE32(data.data() + 8);
+        uint32_t tcbSize = AlignUp4(LoadLE32(data.data() + 12));
+        uint32_t segmentCount = headerSize >= 20 ? LoadLE32(data.data() + 16) : 0;
+
+        uint64_t end = dataLength - checksumSize;
+        uint64_t offset = headerSize;
+        out.segments.clear();
+        out.tasks.clear();
+        for (uint32_t i = 0; i < taskCount; i++)
+        {
+            if (end - offset < 12)
+                return false;
+            CoreDumpTask task {};
+            task.tcb_addr = LoadLE32(data.data() + offset);
+            task.stack_top = LoadLE32(data.data() + offset + 4);
+            task.stack_end = LoadLE32(data.data() + offset + 8);
+            offset += 12;
+
+            uint32_t stackStart = min(task.stack_top, task.stack_end);
+            uint32_t stackSize = AlignUp4(max(task.stack_top, task.stack_end) - stackStart);
+            if (end - offset < uint64_t(tcbSize) + stackSize)
+                return false;
+            out.segments.push_back({task.tcb_addr, tcbSize, offset});
+            out.segments.push_back({stackStart, stackSize, offset + tcbSize});
+            offset += uint64_t(tcbSize) + stackSize;
+            out.tasks.push_back(task);
+        }
+        for (uint32_t i = 0; i < segmentCount; i++)
+        {
+            if (end - offset < 8)
+                return false;
+            uint32_t addr = LoadLE32(data.data() + offset);
+            uint32_t size = LoadLE32(data.data() + offset + 4);
+            offset += 8;
+            if (end - offset < size)
+                return false;
+            out.segments.push_back({addr, size, offset});
+            offset += size;
+        }
+        return offset == end;
+    }
+
+    static CoreDumpParseStatus ParseBinaryCore(span<const uint8_t> data, ParsedCoreDump& out)
+    {
+        const ChipAttr* attr = GetChipAttrById(out.chip_id);
+        if (!attr)
+            return CoreDumpParseStatus::UnknownArch;
+        out.arch = string(attr->arch_name) == "esp32" ? CoreDumpArch::Xtensa : CoreDumpArch::RiscV;
+        out.format = CoreDumpFormat::Binary;
+
+        bool walked = false;
+        for (size_t headerSize : PARTITION_HEADER_SIZES)
+        {
+            for (size_t checksumSize : PARTITION_CHECKSUM_SIZES)
+            {
+                if (!walked && WalkBinaryCore(data, headerSize, checksumSize, out))
+                    walked = true;
+            }
+        }
+        if (!walked)
+            return CoreDumpParseStatus::Truncated;
+        SortSegments(out);
+
+        // The crashed task is always written first
+        for (CoreDumpTask& task : out.tasks)
+        {
+            DecodeStackFrame(data, out, task);
+            ReadTaskName(data, out, task);
+        }
+        if (!out.tasks.empty())
+            out.crashed_task = 0;
+        return CoreDumpParseStatus::Ok;
+    }
+
+    CoreDumpParseStatus ParseCoreDump(span<const uint8_t> data, ParsedCoreDump& out)
+    {
+        out = ParsedCoreDump {};
+        out.version = 0;
+        out.chip_id = EspChipId::Invalid;
+        if (data.size() < 16)
+            return CoreDumpParseStatus::TooShort;
+        if (memcmp(data.data(), ELF_MAGIC, 4) == 0)
+            return ParseElfCore(data, 0, out);
+
+        // Coredump partition: the header, the ELF file or binary body, the checksum, then erased flash
+        uint32_t dataLength = LoadLE32(data.data());
+        if (dataLength < 16 || dataLength > data.size())
+            return CoreDumpParseStatus::BadHeader;
+        out.version = LoadLE32(data.data() + 4);
+        out.chip_id = static_cast<EspChipId>(out.version >> 16);
+        span<const uint8_t> body = data.first(dataLength);
+
+        if (((out.version >> 8) & 0xFF) == PARTITION_VERSION_ELF)
+        {
+            for (size_t headerSize : PARTITION_HEADER_SIZES)
+            {
+                if (dataLength > headerSize + 4 && memcmp(body.data() + headerSize, ELF_MAGIC, 4) == 0)
+                    return ParseElfCore(body, headerSize, out);
+            }
+            return CoreDumpParseStatus::BadElf;
+        }
+        return ParseBinaryCore(body, out);
+    }
+}  // namespace EspApp
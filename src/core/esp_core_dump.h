@@ -0,0 +1,91 @@
+#pragma once
+
+#include "esp_image.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr size_t ESP_CORE_DUMP_MAX_REGS = 35;
+    constexpr size_t ESP_CORE_DUMP_TASK_NAME_LEN = 16;
+    constexpr size_t ESP_CORE_DUMP_NO_TASK = SIZE_MAX;
+
+    enum class CoreDumpFormat
+    {
+        Elf,     // ELF core file, as written by espcoredump.py or found after the partition header
+        Binary,  // Legacy binary layout of the coredump partition
+    };
+
+    enum class CoreDumpArch
+    {
+        Xtensa,
+        RiscV,
+    };
+
+    enum class CoreDumpParseStatus
+    {
+        Ok,
+        TooShort,
+        BadHeader,
+        BadElf,
+        UnknownArch,
+        Truncated,
+    };
+
+    const char* GetCoreDumpParseStatusString(CoreDumpParseStatus status);
+
+    // A RAM snapshot: `size` bytes at `addr`, stored at `file_offset` in the dump
+    struct CoreDumpSegment
+    {
+        uint32_t addr;
+        uint32_t size;
+        uint64_t file_offset;
+    };
+
+    struct CoreDumpTask
+    {
+        uint32_t tcb_addr;
+        uint32_t stack_top;  // Saved stack pointer; the stack snapshot runs from here to stack_end
+        uint32_t stack_end;
+        char name[ESP_CORE_DUMP_TASK_NAME_LEN + 1];  // pcTaskName from the TCB snapshot, empty if not printable
+
+        // Registers in GetCoreDumpRegisterNames() order; zero where the dump does not record them
+        std::array<uint32_t, ESP_CORE_DUMP_MAX_REGS> regs;
+
+        uint32_t GetPc() const { return regs[0]; }
+    };
+
+    struct ParsedCoreDump
+    {
+        CoreDumpFormat format;
+        CoreDumpArch arch;
+        uint32_t version;    // Partition header version, 0 for a bare ELF file
+        EspChipId chip_id;   // From the partition header version, Invalid for a bare ELF file
+        std::vector<CoreDumpSegment> segments;  // Sorted by address
+        std::vector<CoreDumpTask> tasks;
+        size_t crashed_task = ESP_CORE_DUMP_NO_TASK;
+        std::string app_elf_sha256;  // Hex, from the ESP_CORE_DUMP_INFO note of ELF dumps
+
+        // Snapshot bytes at `addr` if `length` bytes there lie in one segment, otherwise an empty span
+        std::span<const uint8_t> Find(std::span<const uint8_t> data, uint32_t addr, uint32_t length) const;
+
+        // Copy snapshot bytes at `addr`, zero filling addresses that no segment covers. Returns the number
+        // of bytes that came from the dump.
+        size_t Read(std::span<const uint8_t> data, uint32_t addr, void* dest, size_t length) const;
+    };
+
+    // Register names of a task's `regs` for `arch`. Xtensa: pc, ps, sar, exception state, loop registers and
+    // a0-a15; RISC-V: pc, x1-x31 by ABI name, mstatus, mcause and mtval.
+    std::span<const char* const> GetCoreDumpRegisterNames(CoreDumpArch arch);
+    size_t GetCoreDumpStackPointerIndex(CoreDumpArch arch);
+
+    // Parse an ESP-IDF core dump: a bare ELF core file, or the contents of the coredump partition in either
+    // the ELF or the binary format (trailing erased flash is ignored). Only headers, notes and register
+    // frames are read, so the snapshots can stay in a memory mapping until they are needed.
+    CoreDumpParseStatus ParseCoreDump(std::span<const uint8_t> data, ParsedCoreDump& out);
+}  // namespace EspApp
@@ -0,0 +1,932 @@
+#include "esp_dwarf.h"
+#include "esp_endian.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+namespace EspApp
+{
+    enum DwarfTag : uint16_t
+    {
+        DW_TAG_array_type = 0x01,
+        DW_TAG_class_type = 0x02,
+        DW_TAG_enumeration_type = 0x04,
+        DW_TAG_formal_parameter = 0x05,
+        DW_TAG_member = 0x0d,
+        DW_TAG_pointer_type = 0x0f,
+        DW_TAG_reference_type = 0x10,
+        DW_TAG_structure_type = 0x13,
+        DW_TAG_subroutine_type = 0x15,
+        DW_TAG_typedef = 0x16,
+        DW_TAG_union_type = 0x17,
+        DW_TAG_unspecified_parameters = 0x18,
+        DW_TAG_subrange_type = 0x21,
+        DW_TAG_base_type = 0x24,
+        DW_TAG_const_type = 0x26,
+        DW_TAG_enumerator = 0x28,
+        DW_TAG_subprogram = 0x2e,
+        DW_TAG_variable = 0x34,
+        DW_TAG_volatile_type = 0x35,
+        DW_TAG_restrict_type = 0x37,
+        DW_TAG_unspecified_type = 0x3b,
+        DW_TAG_rvalue_reference_type = 0x42,
+        DW_TAG_atomic_type = 0x47,
+    };
+
+    enum DwarfAttribute : uint16_t
+    {
+        DW_AT_location = 0x02,
+        DW_AT_name = 0x03,
+        DW_AT_byte_size = 0x0b,
+        DW_AT_bit_offset = 0x0c,
+        DW_AT_bit_size = 0x0d,
+        DW_AT_low_pc = 0x11,
+        DW_AT_const_value = 0x1c,
+        DW_AT_upper_bound = 0x2f,
+        DW_AT_abstract_origin = 0x31,
+        DW_AT_count = 0x37,
+        DW_AT_data_member_location = 0x38,
+        DW_AT_declaration = 0x3c,
+        DW_AT_encoding = 0x3e,
+        DW_AT_specification = 0x47,
+        DW_AT_type = 0x49,
+        DW_AT_data_bit_offset = 0x6b,
+        DW_AT_str_offsets_base = 0x72,
+        DW_AT_addr_base = 0x73,
+    };
+
+    enum DwarfForm : uint16_t
+    {
+        DW_FORM_addr = 0x01,
+        DW_FORM_block2 = 0x03,
+        DW_FORM_block4 = 0x04,
+        DW_FORM_data2 = 0x05,
+        DW_FORM_data4 = 0x06,
+        DW_FORM_data8 = 0x07,
+        DW_FORM_string = 0x08,
+        DW_FORM_block = 0x09,
+        DW_FORM_block1 = 0x0a,
+        DW_FORM_data1 = 0x0b,
+        DW_FORM_flag = 0x0c,
+        DW_FORM_sdata = 0x0d,
+        DW_FORM_strp = 0x0e,
+        DW_FORM_udata = 0x0f,
+        DW_FORM_ref_addr = 0x10,
+        DW_FORM_ref1 = 0x11,
+        DW_FORM_ref2 = 0x12,
+        DW_FORM_ref4 = 0x13,
+        DW_FORM_ref8 = 0x14,
+        DW_FORM_ref_udata = 0x15,
+        DW_FORM_indirect = 0x16,
+        DW_FORM_sec_offset = 0x17,
+        DW_FORM_exprloc = 0x18,
+        DW_FORM_flag_present = 0x19,
+        DW_FORM_strx = 0x1a,
+        DW_FORM_addrx = 0x1b,
+        DW_FORM_ref_sup4 = 0x1c,
+        DW_FORM_strp_sup = 0x1d,
+        DW_FORM_data16 = 0x1e,
+        DW_FORM_line_strp = 0x1f,
+        DW_FORM_ref_sig8 = 0x20,
+        DW_FORM_implicit_const = 0x21,
+        DW_FORM_loclistx = 0x22,
+        DW_FORM_rnglistx = 0x23,
+        DW_FORM_ref_sup8 = 0x24,
+        DW_FORM_strx1 = 0x25,
+        DW_FORM_strx2 = 0x26,
+        DW_FORM_strx3 = 0x27,
+        DW_FORM_strx4 = 0x28,
+        DW_FORM_addrx1 = 0x29,
+        DW_FORM_addrx2 = 0x2a,
+        DW_FORM_addrx3 = 0x2b,
+        DW_FORM_addrx4 = 0x2c,
+        DW_FORM_GNU_addr_index = 0x1f01,
+        DW_FORM_GNU_str_index = 0x1f02,
+        DW_FORM_GNU_ref_alt = 0x1f20,
+        DW_FORM_GNU_strp_alt = 0x1f21,
+    };
+
+    static constexpr uint8_t DW_OP_addr = 0x03;
+    static constexpr uint8_t DW_OP_plus_uconst = 0x23;
+    static constexpr uint8_t DW_OP_addrx = 0xa1;
+    static constexpr uint8_t DW_OP_GNU_addr_index = 0xfb;
+    static constexpr uint32_t NO_REF = UINT32_MAX;
+
+    // Bounds-checked reader over one section. A read past the end sets `ok` to false and returns zeros.
+    struct DwarfCursor
+    {
+        const uint8_t* p;
+        const uint8_t* end;
+        bool ok = true;
+
+        bool Has(size_t n)
+        {
+            if (static_cast<size_t>(end - p) >= n)
+                return true;
+            ok = false;
+            p = end;
+            return false;
+        }
+        void Skip(uint64_t n)
+        {
+            if (Has(n))
+                p += n;
+        }
+        uint64_t Fixed(size_t n)
+        {
+            if (!Has(n))
+                return 0;
+            uint64_t value = 0;
+            for (size_t i = 0; i < n; i++)
+                value |= uint64_t(p[i]) << (8 * i);
+            p += n;
+            return value;
+        }
+        uint64_t Uleb()
+        {
+            uint64_t value = 0;
+            for (unsigned shift = 0; Has(1); shift += 7)
+            {
+                uint8_t byte = *p++;
+                if (shift < 64)
+                    value |= uint64_t(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            return 0;
+        }
+        int64_t Sleb()
+        {
+            int64_t value = 0;
+            unsigned shift = 0;
+            while (Has(1))
+            {
+                uint8_t byte = *p++;
+                if (shift < 64)
+                    value |= int64_t(byte & 0x7F) << shift;
+                shift += 7;
+                if (!(byte & 0x80))
+                {
+                    if (shift < 64 && (byte & 0x40))
+                        value |= -(int64_t(1) << shift);
+                    return value;
+                }
+            }
+            return 0;
+        }
+        string_view CString()
+        {
+            const void* nul = memchr(p, 0, end - p);
+            if (!nul)
+            {
+                ok = false;
+                p = end;
+                return {};
+            }
+            string_view s(reinterpret_cast<const char*>(p), static_cast<const uint8_t*>(nul) - p);
+            p = static_cast<const uint8_t*>(nul) + 1;
+            return s;
+        }
+    };
+
+    struct AbbrevAttr
+    {
+        uint16_t name;
+        uint16_t form;
+        int64_t implicit_const;
+    };
+
+    struct Abbrev
+    {
+        uint16_t tag = 0;
+        bool children = false;
+        uint32_t first_attr = 0;
+        uint32_t attr_count = 0;
+    };
+
+    // Abbreviation codes are dense in practice (1..N), so they index a vector directly
+    struct AbbrevTable
+    {
+        vector<Abbrev> abbrevs;
+        vector<AbbrevAttr> attrs;
+    };
+
+    static constexpr uint64_t MAX_ABBREV_CODE = 1 << 20;
+
+    static bool ParseAbbrevTable(span<const uint8_t> section, uint64_t offset, AbbrevTable& out)
+    {
+        if (offset >= section.size())
+            return false;
+        DwarfCursor cur {section.data() + offset, section.data() + section.size()};
+        while (cur.ok)
+        {
+            uint64_t code = cur.Uleb();
+            if (code == 0)
+                return cur.ok;
+            if (code >= MAX_ABBREV_CODE)
+                return false;
+            if (out.abbrevs.size() <= code)
+                out.abbrevs.resize(code + 1);
+
+            Abbrev& abbrev = out.abbrevs[code];
+            abbrev.tag = static_cast<uint16_t>(cur.Uleb());
+            abbrev.children = cur.Fixed(1) != 0;
+            abbrev.first_attr = static_cast<uint32_t>(out.attrs.size());
+            while (cur.ok)
+            {
+                uint64_t name = cur.Uleb();
+                uint64_t form = cur.Uleb();
+                if (name == 0 && form == 0)
+                    break;
+                int64_t implicitConst = form == DW_FORM_implicit_const ? cur.Sleb() : 0;
+                out.attrs.push_back({static_cast<uint16_t>(name), static_cast<uint16_t>(form), implicitConst});
+            }
+            abbrev.attr_count = static_cast<uint32_t>(out.attrs.size()) - abbrev.first_attr;
+        }
+        return false;
+    }
+
+    struct DwarfSections
+    {
+        span<const uint8_t> info;
+        span<const uint8_t> abbrev;
+        span<const uint8_t> str;
+        span<const uint8_t> line_str;
+        span<const uint8_t> str_offsets;
+        span<const uint8_t> addr;
+    };
+
+    struct DwarfUnit
+    {
+        uint64_t offset;
+        uint16_t version;
+        uint8_t addr_size;
+        uint64_t str_offsets_base;
+        uint64_t addr_base;
+    };
+
+    // The attributes of one DIE that the model uses
+    struct DieAttrs
+    {
+        string_view name;
+        uint64_t name_index = UINT64_MAX;  // DW_FORM_strx*, resolved once the unit's base is known
+        uint32_t type = NO_REF;
+        uint32_t specification = NO_REF;
+        uint64_t byte_size = 0;
+        uint64_t encoding = 0;
+        uint64_t member_offset = 0;
+        uint64_t bit_offset = UINT64_MAX;
+        uint64_t bit_size = 0;
+        uint64_t count = UINT64_MAX;
+        int64_t upper_bound = -1;
+        int64_t const_value = 0;
+        uint64_t low_pc = UINT64_MAX;
+        uint64_t low_pc_index = UINT64_MAX;  // DW_FORM_addrx*
+        uint64_t location = UINT64_MAX;
+        uint64_t location_index = UINT64_MAX;
+        uint64_t str_offsets_base = UINT64_MAX;
+        uint64_t addr_base = UINT64_MAX;
+        bool declaration = false;
+    };
+
+    static string_view StringAt(span<const uint8_t> section, uint64_t offset)
+    {
+        if (offset >= section.size())
+            return {};
+        DwarfCursor cur {section.data() + offset, section.data() + section.size()};
+        return cur.CString();
+    }
+
+    static string_view IndexedString(const DwarfSections& sections, const DwarfUnit& unit, uint64_t index)
+    {
+        uint64_t entry = unit.str_offsets_base + index * 4;
+        if (entry + 4 > sections.str_offsets.size())
+            return {};
+        return StringAt(sections.str, LoadLE32(sections.str_offsets.data() + entry));
+    }
+
+    static uint64_t IndexedAddress(const DwarfSections& sections, const DwarfUnit& unit, uint64_t index)
+    {
+        uint64_t entry = unit.addr_base + index * unit.addr_size;
+        if (entry + unit.addr_size > sections.addr.size())
+            return UINT64_MAX;
+        return unit.addr_size == 8 ? LoadLE64(sections.addr.data() + entry) : LoadLE32(sections.addr.data() + entry);
+    }
+
+    // Static address of a location expression that is exactly one DW_OP_addr or DW_OP_addrx
+    static void DecodeLocation(span<const uint8_t> expr, const DwarfUnit& unit, DieAttrs& out)
+    {
+        if (expr.empty())
+            return;
+        if (expr[0] == DW_OP_addr && expr.size() == 1u + unit.addr_size)
+        {
+            out.location = unit.addr_size == 8 ? LoadLE64(expr.data() + 1) : LoadLE32(expr.data() + 1);
+        }
+        else if (expr[0] == DW_OP_addrx || expr[0] == DW_OP_GNU_addr_index)
+        {
+            DwarfCursor cur {expr.data() + 1, expr.data() + expr.size()};
+            uint64_t index = cur.Uleb();
+            if (cur.ok && cur.p == cur.end)
+                out.location_index = index;
+        }
+    }
+
+    // Read one attribute value and keep it if the model uses it. Returns false on an unknown form.
+    static bool ReadAttribute(DwarfCursor& cur, const DwarfSections& sections, const DwarfUnit& unit,
+        const AbbrevAttr& attr, DieAttrs& out)
+    {
+        uint64_t form = attr.form;
+        while (form == DW_FORM_indirect)
+            form = cur.Uleb();
+
+        uint64_t value = 0;
+        int64_t signedValue = 0;
+        bool isSigned = false;
+        string_view str;
+        bool isString = false;
+        uint64_t strIndex = UINT64_MAX;
+        uint64_t addrIndex = UINT64_MAX;
+        uint64_t ref = UINT64_MAX;
+        span<const uint8_t> block;
+        bool isBlock = false;
+        size_t offsetSize = 4;
+
+        switch (form)
+        {
+        case DW_FORM_addr:
+            value = cur.Fixed(unit.addr_size);
+            break;
+        case DW_FORM_data1:
+        case DW_FORM_flag:
+            value = cur.Fixed(1);
+            break;
+        case DW_FORM_data2:
+            value = cur.Fixed(2);
+            break;
+        case DW_FORM_data4:
+            value = cur.Fixed(4);
+            break;
+        case DW_FORM_data8:
+        case DW_FORM_ref_sig8:
+            value = cur.Fixed(8);
+            break;
+        case DW_FORM_data16:
+            cur.Skip(16);
+            break;
+        case DW_FORM_sdata:
+            signedValue = cur.Sleb();
+            value = static_cast<uint64_t>(signedValue);
+            isSigned = true;
+            break;
+        case DW_FORM_udata:
+        case DW_FORM_loclistx:
+        case DW_FORM_rnglistx:
+            value = cur.Uleb();
+            break;
+        case DW_FORM_implicit_const:
+            signedValue = attr.implicit_const;
+            value = static_cast<uint64_t>(signedValue);
+            isSigned = true;
+            break;
+        case DW_FORM_flag_present:
+            value = 1;
+            break;
+        case DW_FORM_string:
+            str = cur.CString();
+            isString = true;
+            break;
+        case DW_FORM_strp:
+            str = StringAt(sections.str, cur.Fixed(offsetSize));
+            isString = true;
+            break;
+        case DW_FORM_line_strp:
+            str = StringAt(sections.line_str, cur.Fixed(offsetSize));
+            isString = true;
+            break;
+        case DW_FORM_sec_offset:
+            value = cur.Fixed(offsetSize);
+            break;
+        case DW_FORM_strp_sup:
+        case DW_FORM_GNU_strp_alt:
+        case DW_FORM_ref_sup4:
+        case DW_FORM_GNU_ref_alt:
+            cur.Skip(offsetSize);
+            break;
+        case DW_FORM_ref_sup8:
+            cur.Skip(8);
+            break;
+        case DW_FORM_strx:
+        case DW_FORM_GNU_str_index:
+            strIndex = cur.Uleb();
+            break;
+        case DW_FORM_strx1:
+        case DW_FORM_strx2:
+        case DW_FORM_strx3:
+        case DW_FORM_strx4:
+            strIndex = cur.Fixed(form - DW_FORM_strx1 + 1);
+            break;
+        case DW_FORM_addrx:
+        case DW_FORM_GNU_addr_index:
+            addrIndex = cur.Uleb();
+            break;
+        case DW_FORM_addrx1:
+        case DW_FORM_addrx2:
+        case DW_FORM_addrx3:
+        case DW_FORM_addrx4:
+            addrIndex = cur.Fixed(form - DW_FORM_addrx1 + 1);
+            break;
+        case DW_FORM_ref1:
+            ref = unit.offset + cur.Fixed(1);
+            break;
+        case DW_FORM_ref2:
+            ref = unit.offset + cur.Fixed(2);
+            break;
+        case DW_FORM_ref4:
+            ref = unit.offset + cur.Fixed(4);
+            break;
+        case DW_FORM_ref8:
+            ref = unit.offset + cur.Fixed(8);
+            break;
+        case DW_FORM_ref_udata:
+            ref = unit.offset + cur.Uleb();
+            break;
+        case DW_FORM_ref_addr:
+            ref = cur.Fixed(unit.version == 2 ? unit.addr_size : offsetSize);
+            break;
+        case DW_FORM_block1:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+        case DW_FORM_block:
+        case DW_FORM_exprloc:
+        {
+            uint64_t length = form == DW_FORM_block1 ? cur.Fixed(1) : form == DW_FORM_block2 ? cur.Fixed(2) :
+                form == DW_FORM_block4 ? cur.Fixed(4) : cur.Uleb();
+            if (cur.Has(length))
+            {
+                block = {cur.p, static_cast<size_t>(length)};
+                cur.p += length;
+                isBlock = true;
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+
+        switch (attr.name)
+        {
+        case DW_AT_name:
+            if (isString)
+                out.name = str;
+            else
+                out.name_index = strIndex;
+            break;
+        case DW_AT_type:
+            out.type = ref <= UINT32_MAX ? static_cast<uint32_t>(ref) : NO_REF;
+            break;
+        case DW_AT_specification:
+        case DW_AT_abstract_origin:
+            out.specification = ref <= UINT32_MAX ? static_cast<uint32_t>(ref) : NO_REF;
+            break;
+        case DW_AT_byte_size:
+            out.byte_size = value;
+            break;
+        case DW_AT_encoding:
+            out.encoding = value;
+            break;
+        case DW_AT_data_member_location:
+            if (isBlock)
+            {
+                DwarfCursor expr {block.data(), block.data() + block.size()};
+                if (!block.empty() && block[0] == DW_OP_plus_uconst)
+                {
+                    expr.p++;
+                    out.member_offset = expr.Uleb();
+                }
+            }
+            else
+            {
+                out.member_offset = value;
+            }
+            break;
+        case DW_AT_data_bit_offset:
+            out.bit_offset = value;
+            break;
+        case DW_AT_bit_size:
+            out.bit_size = value;
+            break;
+        case DW_AT_count:
+            if (ref == UINT64_MAX && !isBlock)
+                out.count = value;
+            break;
+        case DW_AT_upper_bound:
+            if (ref == UINT64_MAX && !isBlock)
+                out.upper_bound = isSigned ? signedValue : static_cast<int64_t>(value);
+            break;
+        case DW_AT_const_value:
+            out.const_value = isSigned ? signedValue : static_cast<int64_t>(value);
+            break;
+        case DW_AT_low_pc:
+            if (addrIndex != UINT64_MAX)
+                out.low_pc_index = addrIndex;
+            else
+                out.low_pc = value;
+            break;
+        case DW_AT_location:
+            if (isBlock)
+                DecodeLocation(block, unit, out);
+            break;
+        case DW_AT_declaration:
+            out.declaration = value != 0;
+            break;
+        case DW_AT_str_offsets_base:
+            out.str_offsets_base = value;
+            break;
+        case DW_AT_addr_base:
+            out.addr_base = value;
+            break;
+        default:
+            break;
+        }
+        return cur.ok;
+    }
+
+    // Name and type of a subprogram or parameter DIE, for concrete instances that only refer to it through
+    // DW_AT_specification or DW_AT_abstract_origin
+    struct DieOrigin
+    {
+        string_view name;
+        uint32_t type;
+        uint32_t origin;
+    };
+
+    struct OriginFixup
+    {
+        uint32_t type;   // Function type the fixup applies to
+        uint32_t param;  // Parameter index, or NO_REF for the function itself
+        uint32_t origin;
+        size_t function;
+    };
+
+    // State shared by all units until references are resolved
+    struct DwarfParseState
+    {
+        vector<uint32_t> type_offsets;  // .debug_info offset of each type, NO_REF for subprogram prototypes
+        unordered_map<uint32_t, DieOrigin> origins;
+        vector<OriginFixup> fixups;
+    };
+
+    // Reads one unit's DIEs into the model. Type references are stored as .debug_info offsets and mapped to
+    // type indexes once every unit has been read.
+    class DwarfUnitParser
+    {
+        const DwarfSections& m_sections;
+        DwarfInfo& m_out;
+        DwarfParseState& m_state;
+
+        struct Parent
+        {
+            uint16_t tag;
+            uint32_t type;  // Type index the children belong to, or NO_REF
+        };
+
+        uint32_t AddType(uint32_t offset, DwarfTypeKind kind, const DieAttrs& attrs)
+        {
+            DwarfType type;
+            type.kind = kind;
+            type.name = attrs.name;
+            type.size = attrs.byte_size;
+            type.target = attrs.type;
+            type.declaration = attrs.declaration;
+            m_out.types.push_back(std::move(type));
+            m_state.type_offsets.push_back(offset);
+            return static_cast<uint32_t>(m_out.types.size() - 1);
+        }
+
+        uint32_t HandleDie(uint32_t offset, uint16_t tag, const DieAttrs& attrs, const Parent* parent,
+            const DwarfUnit& unit)
+        {
+            uint32_t parentType = parent ? parent->type : NO_REF;
+            switch (tag)
+            {
+            case DW_TAG_base_type:
+            case DW_TAG_unspecified_type:
+            {
+                uint32_t index = AddType(offset, DwarfTypeKind::Base, attrs);
+                m_out.types[index].encoding = static_cast<uint8_t>(attrs.encoding);
+                m_out.types[index].target = NO_REF;
+                return index;
+            }
+            case DW_TAG_pointer_type:
+            case DW_TAG_reference_type:
+            case DW_TAG_rvalue_reference_type:
+            {
+                uint32_t index = AddType(offset, DwarfTypeKind::Pointer, attrs);
+                if (!m_out.types[index].size)
+                    m_out.types[index].size = unit.addr_size;
+                return index;
+            }
+            case DW_TAG_const_type:
+                return AddType(offset, DwarfTypeKind::Const, attrs);
+            case DW_TAG_volatile_type:
+                return AddType(offset, DwarfTypeKind::Volatile, attrs);
+            case DW_TAG_typedef:
+                return AddType(offset, DwarfTypeKind::Typedef, attrs);
+            case DW_TAG_restrict_type:
+            case DW_TAG_atomic_type:
+            {
+                uint32_t index = AddType(offset, DwarfTypeKind::Typedef, attrs);
+                m_out.types[index].name = {};
+                return index;
+            }
+            case DW_TAG_structure_type:
+            case DW_TAG_class_type:
+                return AddType(offset, DwarfTypeKind::Struct, attrs);
+            case DW_TAG_union_type:
+                return AddType(offset, DwarfTypeKind::Union, attrs);
+            case DW_TAG_enumeration_type:
+                return AddType(offset, DwarfTypeKind::Enum, attrs);
+            case DW_TAG_array_type:
+                return AddType(offset, DwarfTypeKind::Array, attrs);
+            case DW_TAG_subroutine_type:
+                return AddType(offset, DwarfTypeKind::Function, attrs);
+
+            case DW_TAG_member:
+                if (parentType != NO_REF)
+                {
+                    uint64_t byteOffset = attrs.member_offset;
+                    if (attrs.bit_offset != UINT64_MAX)
+                        byteOffset = attrs.bit_offset / 8;
+                    m_out.types[parentType].members.push_back({attrs.name, attrs.type,
+                        static_cast<uint32_t>(byteOffset), static_cast<uint32_t>(attrs.bit_size)});
+                }
+                return NO_REF;
+            case DW_TAG_enumerator:
+                if (parentType != NO_REF)
+                    m_out.types[parentType].enumerators.push_back({attrs.name, attrs.const_value});
+                return NO_REF;
+            case DW_TAG_subrange_type:
+                if (parentType != NO_REF && m_out.types[parentType].kind == DwarfTypeKind::Array)
+                {
+                    uint64_t count = attrs.count != UINT64_MAX ? attrs.count :
+                        attrs.upper_bound >= 0 ? static_cast<uint64_t>(attrs.upper_bound) + 1 : 0;
+                    m_out.types[parentType].dimensions.push_back(count);
+                }
+                return NO_REF;
+            case DW_TAG_formal_parameter:
+                if (parentType == NO_REF || m_out.types[parentType].kind != DwarfTypeKind::Function)
+                {
+                    if (parent && parent->tag == DW_TAG_subprogram)
+                        m_state.origins.emplace(offset, DieOrigin {attrs.name, attrs.type, attrs.specification});
+                    return NO_REF;
+                }
+                if (attrs.type == NO_REF && attrs.specification != NO_REF)
+                {
+                    m_state.fixups.push_back({parentType,
+                        static_cast<uint32_t>(m_out.types[parentType].params.size()), attrs.specification, 0});
+                }
+                m_out.types[parentType].params.push_back(attrs.type);
+                return NO_REF;
+            case DW_TAG_unspecified_parameters:
+                if (parentType != NO_REF && m_out.types[parentType].kind == DwarfTypeKind::Function)
+                    m_out.types[parentType].var_args = true;
+                return NO_REF;
+
+            case DW_TAG_variable:
+                if (attrs.location != UINT64_MAX && !attrs.name.empty())
+                    m_out.variables.push_back({attrs.name, static_cast<uint32_t>(attrs.location), attrs.type});
+                return NO_REF;
+            case DW_TAG_subprogram:
+            {
+                if (attrs.low_pc == UINT64_MAX || attrs.declaration)
+                {
+                    m_state.origins.emplace(offset, DieOrigin {attrs.name, attrs.type, attrs.specification});
+                    return NO_REF;
+                }
+
+                // The prototype is a function type owned by the subprogram; its parameters are the children
+                DieAttrs prototype;
+                prototype.type = attrs.type;
+                uint32_t index = AddType(NO_REF, DwarfTypeKind::Function, prototype);
+                m_out.functions.push_back({attrs.name, static_cast<uint32_t>(attrs.low_pc), index});
+                if (attrs.specification != NO_REF)
+                    m_state.fixups.push_back({index, NO_REF, attrs.specification, m_out.functions.size() - 1});
+                return index;
+            }
+            default:
+                return NO_REF;
+            }
+        }
+
+    public:
+        DwarfUnitParser(const DwarfSections& sections, DwarfInfo& out, DwarfParseState& state) :
+            m_sections(sections), m_out(out), m_state(state)
+        {}
+
+        bool Parse(DwarfUnit& unit, const AbbrevTable& abbrevs, DwarfCursor cur)
+        {
+            vector<Parent> parents;
+            const uint8_t* base = m_sections.info.data();
+            while (cur.ok && cur.p < cur.end)
+            {
+                uint32_t offset = static_cast<uint32_t>(cur.p - base);
+                uint64_t code = cur.Uleb();
+                if (code == 0)
+                {
+                    if (!parents.empty())
+                        parents.pop_back();
+                    continue;
+                }
+                if (code >= abbrevs.abbrevs.size() || abbrevs.abbrevs[code].tag == 0)
+                    return false;
+
+                const Abbrev& abbrev = abbrevs.abbrevs[code];
+                DieAttrs attrs;
+                for (uint32_t i = 0; i < abbrev.attr_count; i++)
+                {
+                    if (!ReadAttribute(cur, m_sections, unit, abbrevs.attrs[abbrev.first_attr + i], attrs))
+                        return false;
+                }
+
+                // The unit DIE carries the bases for indexed strings and addresses
+                if (attrs.str_offsets_base != UINT64_MAX)
+                    unit.str_offsets_base = attrs.str_offsets_base;
+                if (attrs.addr_base != UINT64_MAX)
+                    unit.addr_base = attrs.addr_base;
+                if (attrs.name_index != UINT64_MAX)
+                    attrs.name = IndexedString(m_sections, unit, attrs.name_index);
+                if (attrs.low_pc_index != UINT64_MAX)
+                    attrs.low_pc = IndexedAddress(m_sections, unit, attrs.low_pc_index);
+                if (attrs.location_index != UINT64_MAX)
+                    attrs.location = IndexedAddress(m_sections, unit, attrs.location_index);
+
+                const Parent* parent = parents.empty() ? nullptr : &parents.back();
+                uint32_t index = HandleDie(offset, abbrev.tag, attrs, parent, unit);
+                if (abbrev.children)
+                    parents.push_back({abbrev.tag, index});
+            }
+            return cur.ok;
+        }
+    };
+
+    static const DieOrigin* FindOrigin(const DwarfParseState& state, uint32_t offset)
+    {
+        auto it = state.origins.find(offset);
+        return it == state.origins.end() ? nullptr : &it->second;
+    }
+
+    // Fills in the names and types concrete subprograms and parameters leave to their declaration or abstract
+    // instance, following at most a few levels of indirection
+    static void ApplyOriginFixups(DwarfInfo& out, const DwarfParseState& state)
+    {
+        for (const OriginFixup& fixup : state.fixups)
+        {
+            string_view name;
+            uint32_t type = NO_REF;
+            uint32_t origin = fixup.origin;
+            for (int depth = 0; depth < 4 && origin != NO_REF; depth++)
+            {
+                const DieOrigin* die = FindOrigin(state, origin);
+                if (!die)
+                    break;
+                if (name.empty())
+                    name = die->name;
+                if (type == NO_REF)
+                    type = die->type;
+                origin = die->origin;
+            }
+
+            DwarfType& function = out.types[fixup.type];
+            if (fixup.param != NO_REF)
+            {
+                function.params[fixup.param] = type;
+                continue;
+            }
+            if (function.target == NO_REF)
+                function.target = type;
+            if (out.functions[fixup.function].name.empty())
+                out.functions[fixup.function].name = name;
+        }
+    }
+
+    // Replaces the .debug_info offsets in type references with type indexes
+    static void ResolveTypeReferences(DwarfInfo& out, const DwarfParseState& state)
+    {
+        vector<pair<uint32_t, uint32_t>> byOffset;
+        byOffset.reserve(state.type_offsets.size());
+        for (uint32_t i = 0; i < state.type_offsets.size(); i++)
+        {
+            if (state.type_offsets[i] != NO_REF)
+                byOffset.emplace_back(state.type_offsets[i], i);
+        }
+        sort(byOffset.begin(), byOffset.end());
+
+        auto resolve = [&](uint32_t& ref) {
+            if (ref == NO_REF)
+                return;
+            auto it = lower_bound(byOffset.begin(), byOffset.end(), make_pair(ref, uint32_t(0)));
+            ref = it != byOffset.end() && it->first == ref ? it->second : DWARF_NO_TYPE;
+        };
+        for (DwarfType& type : out.types)
+        {
+            resolve(type.target);
+            for (DwarfMember& member : type.members)
+                resolve(member.type);
+            for (uint32_t& param : type.params)
+                resolve(param);
+        }
+        for (DwarfVariable& variable : out.variables)
+            resolve(variable.type);
+    }
+
+    bool ParseDwarf(const ElfFile& elf, DwarfInfo& out)
+    {
+        out = {};
+        DwarfSections sections;
+        sections.info = elf.GetSectionData(".debug_info");
+        sections.abbrev = elf.GetSectionData(".debug_abbrev");
+        sections.str = elf.GetSectionData(".debug_str");
+        sections.line_str = elf.GetSectionData(".debug_line_str");
+        sections.str_offsets = elf.GetSectionData(".debug_str_offsets");
+        sections.addr = elf.GetSectionData(".debug_addr");
+        if (sections.info.empty() || sections.info.size() > UINT32_MAX)
+            return false;
+
+        // Units of one link usually share a handful of abbreviation tables
+        unordered_map<uint64_t, AbbrevTable> abbrevTables;
+        DwarfParseState state;
+        DwarfUnitParser parser(sections, out, state);
+
+        DwarfCursor cur {sections.info.data(), sections.info.data() + sections.info.size()};
+        while (cur.ok && cur.p < cur.end)
+        {
+            const uint8_t* unitStart = cur.p;
+            uint64_t length = cur.Fixed(4);
+            if (length >= 0xFFFFFFF0)
+            {
+                // 64-bit DWARF is not produced for 32-bit targets; skip the unit
+                if (length == 0xFFFFFFFF)
+                    cur.Skip(cur.Fixed(8));
+                else
+                    cur.ok = false;
+                out.skipped_units++;
+                continue;
+            }
+            if (!cur.Has(length))
+                break;
+
+            DwarfCursor unitCur {cur.p, cur.p + length};
+            cur.p += length;
+
+            DwarfUnit unit {};
+            unit.offset = static_cast<uint64_t>(unitStart - sections.info.data());
+            unit.version = static_cast<uint16_t>(unitCur.Fixed(2));
+            uint64_t abbrevOffset = 0;
+            bool supported = true;
+            if (unit.version >= 2 && unit.version <= 4)
+            {
+                abbrevOffset = unitCur.Fixed(4);
+                unit.addr_size = static_cast<uint8_t>(unitCur.Fixed(1));
+            }
+            else if (unit.version == 5)
+            {
+                // Only full and partial units; type and split units carry nothing a single app ELF needs
+                uint8_t unitType = static_cast<uint8_t>(unitCur.Fixed(1));
+                unit.addr_size = static_cast<uint8_t>(unitCur.Fixed(1));
+                abbrevOffset = unitCur.Fixed(4);
+                supported = unitType == 1 || unitType == 3;
+            }
+            else
+            {
+                supported = false;
+            }
+            if (!supported || !unitCur.ok || (unit.addr_size != 4 && unit.addr_size != 8))
+            {
+                out.skipped_units++;
+                continue;
+            }
+
+            auto [it, inserted] = abbrevTables.try_emplace(abbrevOffset);
+            if (inserted && !ParseAbbrevTable(sections.abbrev, abbrevOffset, it->second))
+                it->second.abbrevs.clear();
+            if (it->second.abbrevs.empty())
+            {
+                out.skipped_units++;
+                continue;
+            }
+
+            // A unit that fails part way keeps the DIEs read before the failure
+            if (!parser.Parse(unit, it->second, unitCur))
+                out.skipped_units++;
+            else
+                out.compile_units++;
+        }
+
+        ApplyOriginFixups(out, state);
+        ResolveTypeReferences(out, state);
+        return true;
+    }
+}  // namespace EspApp
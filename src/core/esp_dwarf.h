@@ -0,0 +1,87 @@
+#pragma once
+
+#include "esp_elf.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr uint32_t DWARF_NO_TYPE = UINT32_MAX;  // void, or a type the parser does not model
+
+    enum class DwarfTypeKind : uint8_t
+    {
+        Base,
+        Pointer,
+        Const,
+        Volatile,
+        Typedef,
+        Struct,
+        Union,
+        Enum,
+        Array,
+        Function,
+    };
+
+    struct DwarfMember
+    {
+        std::string_view name;
+        uint32_t type;
+        uint32_t offset;    // Byte offset; for bit-fields, of the byte holding the first bit
+        uint32_t bit_size;  // 0 unless the member is a bit-field
+    };
+
+    struct DwarfEnumerator
+    {
+        std::string_view name;
+        int64_t value;
+    };
+
+    // One type DIE. References to other types are indexes into DwarfInfo::types. A Typedef without a name
+    // stands for a qualifier that does not change the type's layout (restrict, _Atomic).
+    struct DwarfType
+    {
+        DwarfTypeKind kind;
+        uint8_t encoding = 0;      // DW_ATE_* of base types
+        bool declaration = false;  // Incomplete struct, union or enum
+        bool var_args = false;     // Function types
+        std::string_view name;
+        uint64_t size = 0;
+        uint32_t target = DWARF_NO_TYPE;  // Pointee, qualified or aliased type, array element, return type
+        std::vector<uint64_t> dimensions;  // Arrays, outermost first; 0 for an unknown bound
+        std::vector<DwarfMember> members;  // Struct and union members
+        std::vector<DwarfEnumerator> enumerators;
+        std::vector<uint32_t> params;      // Function parameter types
+    };
+
+    struct DwarfVariable
+    {
+        std::string_view name;
+        uint32_t addr;
+        uint32_t type;
+    };
+
+    struct DwarfFunction
+    {
+        std::string_view name;
+        uint32_t addr;
+        uint32_t type;  // A DwarfTypeKind::Function type with the prototype
+    };
+
+    // Types, statically allocated variables and functions from .debug_info (DWARF 2-5, 32-bit format).
+    // Names point into the ELF data. Every compile unit contributes its own copy of shared types; consumers
+    // deduplicate by name.
+    struct DwarfInfo
+    {
+        std::vector<DwarfType> types;
+        std::vector<DwarfVariable> variables;
+        std::vector<DwarfFunction> functions;
+        size_t compile_units = 0;
+        size_t skipped_units = 0;  // Units with an unsupported version, format or abbreviation
+    };
+
+    // Returns false if the ELF has no .debug_info
+    bool ParseDwarf(const ElfFile& elf, DwarfInfo& out);
+}  // namespace EspApp
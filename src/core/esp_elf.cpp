@@ -0,0 +1,129 @@
+#include "esp_elf.h"
+#include "esp_endian.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr size_t ELF_HEADER_SIZE = 52;
+    static constexpr size_t ELF_SECTION_HEADER_SIZE = 40;
+    static constexpr size_t ELF_SYMBOL_SIZE = 16;
+    static constexpr uint32_t SHT_SYMTAB = 2;
+    static constexpr uint32_t SHT_NOBITS = 8;
+    static constexpr uint8_t STT_OBJECT = 1;
+    static constexpr uint8_t STT_FUNC = 2;
+    static constexpr uint8_t STB_LOCAL = 0;
+
+    bool LooksLikeElf32(span<const uint8_t> data)
+    {
+        return data.size() >= ELF_HEADER_SIZE && memcmp(data.data(), "\x7f" "ELF", 4) == 0 && data[4] == 1 &&
+            data[5] == 1;
+    }
+
+    static string_view GetStringAt(span<const uint8_t> table, uint32_t offset)
+    {
+        if (offset >= table.size())
+            return {};
+        const char* start = reinterpret_cast<const char*>(table.data() + offset);
+        const void* end = memchr(start, 0, table.size() - offset);
+        return end ? string_view(start, static_cast<const char*>(end) - start) : string_view();
+    }
+
+    bool ElfFile::Open(span<const uint8_t> data)
+    {
+        m_data = {};
+        m_sections.clear();
+        if (!LooksLikeElf32(data))
+            return false;
+
+        m_machine = LoadLE16(data.data() + 18);
+        uint32_t shOffset = LoadLE32(data.data() + 32);
+        uint16_t shSize = LoadLE16(data.data() + 46);
+        uint16_t shCount = LoadLE16(data.data() + 48);
+        uint16_t shStrIndex = LoadLE16(data.data() + 50);
+        if (shCount == 0)
+        {
+            m_data = data;
+            return true;
+        }
+        if (shSize < ELF_SECTION_HEADER_SIZE || shOffset > data.size() ||
+            (data.size() - shOffset) / shSize < shCount || shStrIndex >= shCount)
+            return false;
+
+        m_sections.resize(shCount);
+        vector<uint32_t> nameOffsets(shCount);
+        for (size_t i = 0; i < shCount; i++)
+        {
+            const uint8_t* sh = data.data() + shOffset + i * shSize;
+            ElfSection& section = m_sections[i];
+            nameOffsets[i] = LoadLE32(sh);
+            section.type = LoadLE32(sh + 4);
+            section.addr = LoadLE32(sh + 12);
+            section.offset = LoadLE32(sh + 16);
+            section.size = LoadLE32(sh + 20);
+            section.link = LoadLE32(sh + 24);
+            if (section.type != SHT_NOBITS &&
+                (section.offset > data.size() || data.size() - section.offset < section.size))
+                return false;
+        }
+
+        const ElfSection& names = m_sections[shStrIndex];
+        span<const uint8_t> nameTable = data.subspan(names.offset, names.type == SHT_NOBITS ? 0 : names.size);
+        for (size_t i = 0; i < shCount; i++)
+            m_sections[i].name = GetStringAt(nameTable, nameOffsets[i]);
+        m_data = data;
+        return true;
+    }
+
+    const ElfSection* ElfFile::FindSection(string_view name) const
+    {
+        for (const ElfSection& section : m_sections)
+        {
+            if (section.name == name)
+                return &section;
+        }
+        return nullptr;
+    }
+
+    span<const uint8_t> ElfFile::GetSectionData(const ElfSection* section) const
+    {
+        if (!section || section->type == SHT_NOBITS)
+            return {};
+        return m_data.subspan(section->offset, section->size);
+    }
+
+    void ElfFile::GetSymbols(vector<ElfSymbol>& out) const
+    {
+        out.clear();
+        for (const ElfSection& section : m_sections)
+        {
+            if (section.type != SHT_SYMTAB)
+                continue;
+
+            // sh_link of a symbol table is its string table
+            if (section.link >= m_sections.size())
+                continue;
+            span<const uint8_t> strings = GetSectionData(&m_sections[section.link]);
+            span<const uint8_t> symbols = GetSectionData(&section);
+
+            out.reserve(out.size() + symbols.size() / ELF_SYMBOL_SIZE);
+            for (size_t offset = 0; symbols.size() - offset >= ELF_SYMBOL_SIZE; offset += ELF_SYMBOL_SIZE)
+            {
+                const uint8_t* sym = symbols.data() + offset;
+                uint8_t info = sym[12];
+                uint8_t type = info & 0xF;
+                uint16_t sectionIndex = LoadLE16(sym + 14);
+                if ((type != STT_FUNC && type != STT_OBJECT) || sectionIndex == 0 || sectionIndex >= 0xFF00)
+                    continue;
+
+                string_view name = GetStringAt(strings, LoadLE32(sym));
+                if (name.empty())
+                    continue;
+                out.push_back({name, LoadLE32(sym + 4), LoadLE32(sym + 8),
+                    type == STT_FUNC ? ElfSymbolKind::Function : ElfSymbolKind::Object, (info >> 4) != STB_LOCAL});
+            }
+        }
+    }
+}  // namespace EspApp
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace EspApp
+{
+    enum class ElfSymbolKind : uint8_t
+    {
+        Function,
+        Object,
+    };
+
+    struct ElfSection
+    {
+        std::string_view name;
+        uint32_t type;
+        uint32_t addr;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t link;
+    };
+
+    struct ElfSymbol
+    {
+        std::string_view name;  // Points into the ELF data
+        uint32_t addr;
+        uint32_t size;
+        ElfSymbolKind kind;
+        bool global;
+    };
+
+    // Little-endian ELF32 file (the app ELF of an ESP-IDF build), read in place. Nothing is copied; names
+    // point into the data, which must outlive the object.
+    class ElfFile
+    {
+        std::span<const uint8_t> m_data;
+        std::vector<ElfSection> m_sections;
+        uint16_t m_machine = 0;
+
+    public:
+        // Returns false if `data` is not a well-formed little-endian ELF32 file
+        bool Open(std::span<const uint8_t> data);
+
+        uint16_t GetMachine() const { return m_machine; }
+        std::span<const ElfSection> GetSections() const { return m_sections; }
+        const ElfSection* FindSection(std::string_view name) const;
+
+        // Contents of a section, empty for SHT_NOBITS sections and sections that are not present
+        std::span<const uint8_t> GetSectionData(const ElfSection* section) const;
+        std::span<const uint8_t> GetSectionData(std::string_view name) const
+        {
+            return GetSectionData(FindSection(name));
+        }
+
+        // Named, defined function and object symbols of .symtab, in table order
+        void GetSymbols(std::vector<ElfSymbol>& out) const;
+    };
+
+    // True if `data` starts with the identification of a little-endian ELF32 file
+    bool LooksLikeElf32(std::span<const uint8_t> data);
+}  // namespace EspApp
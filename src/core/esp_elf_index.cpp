@@ -0,0 +1,385 @@
+#include "esp_elf_index.h"
+#include "esp_elf.h"
+#include "esp_endian.h"
+#include "esp_hash.h"
+#include "esp_parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+namespace EspApp
+{
+    // On-disk layout: header, then records sorted by hash, then the string table. All integers little-endian.
+    //   magic[8], u32 record count, u32 string table size, u64 directory stamp (GetElfDirectoryStamp)
+    //   record count * { sha256[32], u64 file size, i64 modification time, u32 path string offset, u32 0 }
+    // Paths are relative to the indexed directory, with '/' separators.
+    static constexpr char g_elfIndexMagic[8] = {'E', 'S', 'P', 'E', 'L', 'F', 'X', '1'};
+    static constexpr size_t ELF_INDEX_HEADER_SIZE = 24;
+    static constexpr size_t ELF_INDEX_RECORD_SIZE = 56;
+    static constexpr const char* ELF_INDEX_FILE_NAME = "esp_elf_index.bin";
+
+    struct ElfIndexEntry
+    {
+        Sha256Digest sha256;
+        uint64_t size;
+        int64_t mtime;
+        string path;
+    };
+
+    static int64_t GetModificationTime(const filesystem::path& path)
+    {
+        error_code ec;
+        auto time = filesystem::last_write_time(path, ec);
+        return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    string GetElfIndexPath(const string& directory)
+    {
+        return (filesystem::path(directory) / ELF_INDEX_FILE_NAME).string();
+    }
+
+    // Part of the directory stamp for one file. The parts are added up, so the walk order does not matter.
+    static uint64_t GetFileStamp(const string& path, uint64_t size, int64_t mtime)
+    {
+        vector<uint8_t> key(path.size() + 16);
+        memcpy(key.data(), path.data(), path.size());
+        uint8_t* p = key.data() + path.size();
+        StoreLE32(p, static_cast<uint32_t>(size));
+        StoreLE32(p + 4, static_cast<uint32_t>(size >> 32));
+        StoreLE32(p + 8, static_cast<uint32_t>(mtime));
+        StoreLE32(p + 12, static_cast<uint32_t>(static_cast<uint64_t>(mtime) >> 32));
+        return XxHash64(key);
+    }
+
+    // Call `visit` with every regular file below `root` except the index itself, by path relative to `root`
+    template <typename Visit>
+    static bool WalkElfDirectory(const filesystem::path& root, Visit&& visit)
+    {
+        error_code ec;
+        auto options = filesystem::directory_options::skip_permission_denied;
+        for (filesystem::recursive_directory_iterator it(root, options, ec), end; !ec && it != end; it.increment(ec))
+        {
+            error_code fileError;
+            if (!it->is_regular_file(fileError))
+                continue;
+            filesystem::path relative = it->path().lexically_relative(root);
+            if (relative.filename().string().starts_with(ELF_INDEX_FILE_NAME))
+                continue;
+            visit(it->path(), relative.generic_string(), it->file_size(fileError));
+        }
+        return !ec;
+    }
+
+    uint64_t GetElfDirectoryStamp(const string& directory)
+    {
+        uint64_t stamp = 0;
+        WalkElfDirectory(directory, [&](const filesystem::path& path, const string& relative, uint64_t size) {
+            stamp += GetFileStamp(relative, size, GetModificationTime(path));
+        });
+        return stamp;
+    }
+
+    static vector<uint8_t> SerializeIndex(vector<ElfIndexEntry>& entries, uint64_t stamp)
+    {
+        sort(entries.begin(), entries.end(), [](const ElfIndexEntry& a, const ElfIndexEntry& b) {
+            return a.sha256 < b.sha256;
+        });
+
+        string strings;
+        vector<uint8_t> file(ELF_INDEX_HEADER_SIZE + entries.size() * ELF_INDEX_RECORD_SIZE);
+        memcpy(file.data(), g_elfIndexMagic, sizeof(g_elfIndexMagic));
+        StoreLE32(file.data() + 8, static_cast<uint32_t>(entries.size()));
+        StoreLE32(file.data() + 16, static_cast<uint32_t>(stamp));
+        StoreLE32(file.data() + 20, static_cast<uint32_t>(stamp >> 32));
+
+        uint8_t* p = file.data() + ELF_INDEX_HEADER_SIZE;
+        for (const ElfIndexEntry& entry : entries)
+        {
+            memcpy(p, entry.sha256.data(), entry.sha256.size());
+            StoreLE32(p + 32, static_cast<uint32_t>(entry.size));
+            StoreLE32(p + 36, static_cast<uint32_t>(entry.size >> 32));
+            StoreLE32(p + 40, static_cast<uint32_t>(entry.mtime));
+            StoreLE32(p + 44, static_cast<uint32_t>(static_cast<uint64_t>(entry.mtime) >> 32));
+            StoreLE32(p + 48, static_cast<uint32_t>(strings.size()));
+            strings.append(entry.path);
+            strings.push_back('\0');
+            p += ELF_INDEX_RECORD_SIZE;
+        }
+        StoreLE32(file.data() + 12, static_cast<uint32_t>(strings.size()));
+        file.insert(file.end(), strings.begin(), strings.end());
+        return file;
+    }
+
+    static bool WriteIndex(const string& directory, const vector<uint8_t>& data)
+    {
+        // Write to a temporary name first so a concurrent reader never maps a partial file
+        error_code ec;
+        filesystem::path target(GetElfIndexPath(directory));
+        filesystem::path temp = target;
+        temp += ".tmp";
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out.write(reinterpret_cast<const char*>(data.data()), data.size()))
+                return false;
+        }
+        filesystem::rename(temp, target, ec);
+        if (ec)
+        {
+            filesystem::remove(temp, ec);
+            return false;
+        }
+        return true;
+    }
+
+    bool BuildElfIndex(const string& directory, ElfIndexStats* stats, size_t maxThreads, const ElfIndex* previous,
+        ElfIndex* out)
+    {
+        error_code ec;
+        filesystem::path root(directory);
+        if (!filesystem::is_directory(root, ec))
+            return false;
+
+        map<string, ElfIndex::Entry> known;
+        if (previous)
+        {
+            previous->GetEntries(known);
+        }
+        else
+        {
+            ElfIndex onDisk;
+            if (onDisk.Open(directory))
+                onDisk.GetEntries(known);
+        }
+
+        // Walk the tree first; the hashing below is what takes time and runs in parallel
+        vector<ElfIndexEntry> entries;
+        vector<size_t> pending;
+        size_t stillPresent = 0;
+        uint64_t stamp = 0;
+        bool walked = WalkElfDirectory(root, [&](const filesystem::path& path, const string& relative, uint64_t size) {
+            ElfIndexEntry entry {};
+            entry.path = relative;
+            entry.size = size;
+            entry.mtime = GetModificationTime(path);
+            stamp += GetFileStamp(entry.path, entry.size, entry.mtime);
+            auto old = known.find(entry.path);
+            bool isKnown = old != known.end();
+            stillPresent += isKnown;
+            if (isKnown && old->second.size == entry.size && old->second.mtime == entry.mtime)
+            {
+                entry.sha256 = old->second.sha256;
+            }
+            else
+            {
+                pending.push_back(entries.size());
+            }
+            entries.push_back(std::move(entry));
+        });
+        if (!walked)
+            return false;
+
+        // Files that are not ELF32 are dropped after the check; they are cheap to look at again
+        vector<uint8_t> isElf(entries.size(), 1);
+        ParallelFor(pending.size(), [&](size_t i) {
+            ElfIndexEntry& entry = entries[pending[i]];
+            MappedFile file;
+            if (!file.Open((root / entry.path).string()) || !LooksLikeElf32(file.GetSpan()))
+            {
+                isElf[pending[i]] = 0;
+                return;
+            }
+            entry.sha256 = Sha256::Hash(file.GetSpan());
+        }, maxThreads);
+
+        size_t kept = 0;
+        for (size_t i = 0; i < isElf.size(); i++)
+        {
+            if (!isElf[i])
+                continue;
+            if (kept != i)
+                entries[kept] = std::move(entries[i]);
+            kept++;
+        }
+        entries.resize(kept);
+
+        if (stats)
+        {
+            stats->files = kept;
+            stats->hashed = pending.size() - (isElf.size() - kept);
+            stats->removed = known.size() - stillPresent;
+        }
+
+        vector<uint8_t> data = SerializeIndex(entries, stamp);
+        bool written = WriteIndex(directory, data);
+        if (out)
+            out->Load(directory, std::move(data));
+        return written;
+    }
+
+    bool ElfIndex::Attach(span<const uint8_t> data)
+    {
+        m_records = nullptr;
+        m_count = 0;
+        if (data.size() < ELF_INDEX_HEADER_SIZE || memcmp(data.data(), g_elfIndexMagic, sizeof(g_elfIndexMagic)) != 0)
+            return false;
+
+        uint64_t count = LoadLE32(data.data() + 8);
+        uint64_t stringsSize = LoadLE32(data.data() + 12);
+        uint64_t stringsStart = ELF_INDEX_HEADER_SIZE + count * ELF_INDEX_RECORD_SIZE;
+        if (stringsStart + stringsSize != data.size() || (stringsSize != 0 && data.back() != 0))
+            return false;
+
+        m_records = data.data() + ELF_INDEX_HEADER_SIZE;
+        m_strings = reinterpret_cast<const char*>(data.data() + stringsStart);
+        m_count = static_cast<uint32_t>(count);
+        m_stringsSize = static_cast<uint32_t>(stringsSize);
+        m_stamp = LoadLE64(data.data() + 16);
+        return true;
+    }
+
+    bool ElfIndex::Open(const string& directory)
+    {
+        m_buffer.clear();
+        if (!m_file.Open(GetElfIndexPath(directory)))
+            return Attach({});
+        if (!Attach(m_file.GetSpan()))
+        {
+            m_file.Close();
+            return false;
+        }
+        m_directory = directory;
+        return true;
+    }
+
+    bool ElfIndex::Load(const string& directory, vector<uint8_t> data)
+    {
+        m_file.Close();
+        m_buffer = std::move(data);
+        if (!Attach(m_buffer))
+        {
+            m_buffer.clear();
+            return false;
+        }
+        m_directory = directory;
+        return true;
+    }
+
+    void ElfIndex::GetEntries(map<string, Entry>& out) const
+    {
+        out.clear();
+        for (uint32_t i = 0; i < m_count; i++)
+        {
+            const uint8_t* record = m_records + i * ELF_INDEX_RECORD_SIZE;
+            uint32_t pathOffset = LoadLE32(record + 48);
+            if (pathOffset >= m_stringsSize)
+                continue;
+            Entry entry;
+            memcpy(entry.sha256.data(), record, entry.sha256.size());
+            entry.size = LoadLE64(record + 32);
+            entry.mtime = static_cast<int64_t>(LoadLE64(record + 40));
+            out.emplace(m_strings + pathOffset, entry);
+        }
+    }
+
+    string ElfIndex::Find(const Sha256Digest& digest) const
+    {
+        size_t low = 0;
+        size_t high = m_count;
+        while (low < high)
+        {
+            size_t mid = low + (high - low) / 2;
+            if (memcmp(m_records + mid * ELF_INDEX_RECORD_SIZE, digest.data(), digest.size()) < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        // Several copies of the same build may be indexed; the first one that is still intact wins
+        for (; low < m_count; low++)
+        {
+            const uint8_t* record = m_records + low * ELF_INDEX_RECORD_SIZE;
+            if (memcmp(record, digest.data(), digest.size()) != 0)
+                break;
+            uint32_t pathOffset = LoadLE32(record + 48);
+            if (pathOffset >= m_stringsSize)
+                continue;
+
+            error_code ec;
+            filesystem::path path = filesystem::path(m_directory) / (m_strings + pathOffset);
+            uint64_t size = filesystem::file_size(path, ec);
+            if (!ec && size == LoadLE64(record + 32) &&
+                GetModificationTime(path) == static_cast<int64_t>(LoadLE64(record + 40)))
+                return path.string();
+        }
+        return {};
+    }
+
+    shared_ptr<const ElfIndex> ElfIndexCache::Get(const string& directory)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        auto it = m_indexes.find(directory);
+        if (it != m_indexes.end())
+            return it->second;
+
+        // Directories without an index are looked at again next time, the tool may have built one since
+        auto index = make_shared<ElfIndex>();
+        if (!index->Open(directory))
+            return nullptr;
+        m_indexes[directory] = index;
+        return index;
+    }
+
+    string ElfIndexCache::Find(const vector<string>& directories, const Sha256Digest& digest)
+    {
+        for (const string& directory : directories)
+        {
+            shared_ptr<const ElfIndex> index = Get(directory);
+            string path = index ? index->Find(digest) : string();
+            if (!path.empty())
+                return path;
+        }
+        return {};
+    }
+
+    bool ElfIndexCache::Update(const vector<string>& directories, size_t maxThreads)
+    {
+        // One update at a time, so that loads missing the same build do not hash the same files concurrently
+        lock_guard<mutex> updateLock(m_updateMutex);
+        bool changed = false;
+        for (const string& directory : directories)
+        {
+            error_code ec;
+            if (!filesystem::is_directory(directory, ec))
+                continue;
+
+            uint64_t stamp = GetElfDirectoryStamp(directory);
+            shared_ptr<const ElfIndex> current = Get(directory);
+            if (current && current->GetStamp() == stamp)
+                continue;
+
+            // The index on disk may be newer than the one in use
+            auto index = make_shared<ElfIndex>();
+            if (!index->Open(directory) || index->GetStamp() != stamp)
+            {
+                BuildElfIndex(directory, nullptr, maxThreads, current.get(), index.get());
+                if (!index->IsOpen())
+                    continue;
+            }
+
+            lock_guard<mutex> lock(m_mutex);
+            m_indexes[directory] = index;
+            changed = true;
+        }
+        return changed;
+    }
+
+    ElfIndexCache& GetElfIndexCache()
+    {
+        static ElfIndexCache cache;
+        return cache;
+    }
+}  // namespace EspApp
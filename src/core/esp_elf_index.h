@@ -0,0 +1,103 @@
+#pragma once
+
+#include "esp_mapped_file.h"
+#include "esp_sha256.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EspApp
+{
+    struct ElfIndexStats
+    {
+        size_t files = 0;    // ELF files in the index
+        size_t hashed = 0;   // Files hashed by this build, new or changed since the previous index
+        size_t removed = 0;  // Entries of the previous index whose file is gone
+    };
+
+    // Path of the index file kept at the top of an ELF directory
+    std::string GetElfIndexPath(const std::string& directory);
+
+    // Hash over the path, size and modification time of every file below `directory`, which changes whenever a
+    // file is added, removed, replaced or written in place anywhere in the tree. Files are only stat'ed, not
+    // read, so this is cheap next to rebuilding an index.
+    uint64_t GetElfDirectoryStamp(const std::string& directory);
+
+    // Index file, memory-mapped from disk or held in memory. Lookups are a binary search over records sorted
+    // by hash.
+    class ElfIndex
+    {
+        MappedFile m_file;
+        std::vector<uint8_t> m_buffer;
+        std::string m_directory;
+        const uint8_t* m_records = nullptr;
+        const char* m_strings = nullptr;
+        uint32_t m_count = 0;
+        uint32_t m_stringsSize = 0;
+        uint64_t m_stamp = 0;
+
+        bool Attach(std::span<const uint8_t> data);
+
+    public:
+        bool Open(const std::string& directory);
+
+        // Use an index built in memory, e.g. for a directory the index cannot be written to
+        bool Load(const std::string& directory, std::vector<uint8_t> data);
+
+        bool IsOpen() const { return m_records != nullptr; }
+        size_t GetCount() const { return m_count; }
+
+        // GetElfDirectoryStamp of the directory when the index was built
+        uint64_t GetStamp() const { return m_stamp; }
+
+        // Absolute path of the ELF with this SHA-256, or an empty string. An entry whose file changed or
+        // disappeared since the index was built does not match.
+        std::string Find(const Sha256Digest& digest) const;
+
+        // Relative path, size and modification time of every entry, keyed by path, for an incremental rebuild
+        struct Entry
+        {
+            Sha256Digest sha256;
+            uint64_t size;
+            int64_t mtime;
+        };
+        void GetEntries(std::map<std::string, Entry>& out) const;
+    };
+
+    // Index every ELF32 file below `directory` by its SHA-256, which is what ESP-IDF records as the app
+    // description's app_elf_sha256. Entries of `previous` (by default the index on disk) are reused for files
+    // whose size and modification time did not change, so only new builds are hashed. The index file is
+    // replaced atomically; `out` receives the new index even if it cannot be written. Returns false if the
+    // directory cannot be walked or the index cannot be written.
+    bool BuildElfIndex(const std::string& directory, ElfIndexStats* stats = nullptr, size_t maxThreads = 0,
+        const ElfIndex* previous = nullptr, ElfIndex* out = nullptr);
+
+    // The indexes of the ELF directories, opened once per process. Find only reads indexes that exist, so it
+    // is cheap enough for a view load; Update is what walks and hashes, and belongs on a worker.
+    class ElfIndexCache
+    {
+        std::mutex m_mutex;
+        std::mutex m_updateMutex;
+        std::map<std::string, std::shared_ptr<const ElfIndex>> m_indexes;
+
+        std::shared_ptr<const ElfIndex> Get(const std::string& directory);
+
+    public:
+        // Look the hash up in the index of each directory in turn. Directories without an index are skipped.
+        std::string Find(const std::vector<std::string>& directories, const Sha256Digest& digest);
+
+        // Rebuild the index of each directory that has none or whose tree changed since it was built, hashing
+        // only new or changed files. An index that cannot be written is kept in memory for the rest of the
+        // process. Returns true if any index changed.
+        bool Update(const std::vector<std::string>& directories, size_t maxThreads = 0);
+    };
+
+    ElfIndexCache& GetElfIndexCache();
+}  // namespace EspApp
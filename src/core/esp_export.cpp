@@ -0,0 +1,108 @@
+#include "esp_export.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    ImageRebuilder::ImageRebuilder() : m_parsed {}, m_trailer {}, m_cleanChunks(0), m_changed(0), m_stats {} {}
+
+    bool ImageRebuilder::Load(span<const uint8_t> data, const ParsedImage& image)
+    {
+        ImageTrailer trailer = LocateImageTrailer(image);
+        if (trailer.image_end > data.size())
+            return false;
+
+        // Rebase everything onto the copy
+        uint64_t base = image.base_offset;
+        m_image.assign(data.begin() + base, data.begin() + trailer.image_end);
+        m_parsed = image;
+        m_parsed.base_offset = 0;
+        m_parsed.end_offset -= base;
+        for (auto& seg : m_parsed.segments)
+            seg.file_offset -= min(seg.file_offset, base);
+        m_trailer = LocateImageTrailer(m_parsed);
+
+        m_segmentXor.clear();
+        for (const auto& seg : m_parsed.Segments())
+            m_segmentXor.push_back(XorBytes(m_image.data() + seg.file_offset, seg.data_len));
+
+        m_checkpoints.assign(1, Sha256());
+        m_cleanChunks = 0;
+        m_changed = 0;
+        m_stats = {};
+        return true;
+    }
+
+    void ImageRebuilder::MarkDirty(uint64_t offset)
+    {
+        m_cleanChunks = min<size_t>(m_cleanChunks, offset / ESP_REBUILD_CHUNK_SIZE);
+    }
+
+    bool ImageRebuilder::UpdateSegment(size_t segment, span<const uint8_t> contents)
+    {
+        if (segment >= m_parsed.segment_count || contents.size() != m_parsed.segments[segment].data_len)
+            return false;
+
+        // Chunks follow the image offsets, so a dirty chunk maps straight onto a SHA-256 checkpoint
+        uint64_t start = m_parsed.segments[segment].file_offset;
+        uint64_t end = start + contents.size();
+        for (uint64_t at = start; at < end;)
+        {
+            uint64_t next = min(end, (at / ESP_REBUILD_CHUNK_SIZE + 1) * ESP_REBUILD_CHUNK_SIZE);
+            uint8_t* current = m_image.data() + at;
+            const uint8_t* updated = contents.data() + (at - start);
+            size_t length = static_cast<size_t>(next - at);
+            if (memcmp(current, updated, length) != 0)
+            {
+                for (size_t i = 0; i < length; i++)
+                    m_changed += current[i] != updated[i];
+                m_segmentXor[segment] ^= XorBytes(current, length) ^ XorBytes(updated, length);
+                memcpy(current, updated, length);
+                MarkDirty(at);
+            }
+            at = next;
+        }
+        return true;
+    }
+
+    span<const uint8_t> ImageRebuilder::Finish()
+    {
+        uint8_t checksum = ESP_CHECKSUM_MAGIC;
+        for (uint8_t value : m_segmentXor)
+            checksum ^= value;
+        if (m_image[m_trailer.checksum_offset] != checksum)
+        {
+            m_image[m_trailer.checksum_offset] = checksum;
+            MarkDirty(m_trailer.checksum_offset);
+        }
+
+        m_stats.bytes_changed = m_changed;
+        m_stats.bytes_rehashed = 0;
+        m_changed = 0;
+        if (!m_parsed.header.hash_appended)
+            return m_image;
+
+        // The digest covers everything up to and including the checksum byte. Resume from the last clean
+        // checkpoint and record new checkpoints on the way.
+        uint64_t hashEnd = m_trailer.checksum_offset + 1;
+        size_t fullChunks = static_cast<size_t>(hashEnd / ESP_REBUILD_CHUNK_SIZE);
+        m_checkpoints.resize(fullChunks + 1);
+        Sha256 sha = m_checkpoints[m_cleanChunks];
+        for (size_t chunk = m_cleanChunks; chunk < fullChunks; chunk++)
+        {
+            sha.Update({m_image.data() + chunk * ESP_REBUILD_CHUNK_SIZE, ESP_REBUILD_CHUNK_SIZE});
+            m_checkpoints[chunk + 1] = sha;
+        }
+        uint64_t tail = static_cast<uint64_t>(fullChunks) * ESP_REBUILD_CHUNK_SIZE;
+        sha.Update({m_image.data() + tail, static_cast<size_t>(hashEnd - tail)});
+        m_stats.bytes_rehashed = hashEnd - static_cast<uint64_t>(m_cleanChunks) * ESP_REBUILD_CHUNK_SIZE;
+        m_cleanChunks = fullChunks;
+
+        Sha256Digest digest = sha.Final();
+        memcpy(m_image.data() + m_trailer.hash_offset, digest.data(), digest.size());
+        return m_image;
+    }
+}  // namespace EspApp
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "esp_image.h"
+#include "esp_sha256.h"
+#include "esp_verify.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    // Granularity of change detection and of the SHA-256 checkpoints
+    constexpr size_t ESP_REBUILD_CHUNK_SIZE = 0x10000;
+
+    struct RebuildStats
+    {
+        uint64_t bytes_changed;   // Segment bytes changed since the previous Finish
+        uint64_t bytes_rehashed;  // Bytes fed to SHA-256 by the last Finish
+    };
+
+    // Serialized copy of an app image that segment contents can be written back into. The XOR of every
+    // segment and the SHA-256 state at each chunk boundary are cached, so after a patch only the changed
+    // chunks are XORed again and the digest is recomputed from the first changed chunk onwards.
+    class ImageRebuilder
+    {
+        std::vector<uint8_t> m_image;           // Header through trailer
+        ParsedImage m_parsed;                   // Offsets relative to m_image
+        ImageTrailer m_trailer;
+        std::vector<uint8_t> m_segmentXor;
+        std::vector<Sha256> m_checkpoints;      // [i]: state after hashing the first i chunks
+        size_t m_cleanChunks;                   // Leading chunks whose checkpoints are still valid
+        uint64_t m_changed;
+        RebuildStats m_stats;
+
+        void MarkDirty(uint64_t offset);
+
+    public:
+        ImageRebuilder();
+
+        // Copy the image described by `image` out of `data`. Fails if the data ends before the trailer.
+        bool Load(std::span<const uint8_t> data, const ParsedImage& image);
+        bool IsLoaded() const { return !m_image.empty(); }
+
+        // Replace the data of one segment; `contents` must be exactly data_len bytes. Only chunks that differ
+        // are written. Returns false if the segment index or size does not match.
+        bool UpdateSegment(size_t segment, std::span<const uint8_t> contents);
+
+        // Store the checksum and, if the header asks for one, the SHA-256 digest and return the image
+        std::span<const uint8_t> Finish();
+
+        const ParsedImage& GetImage() const { return m_parsed; }
+        const RebuildStats& GetStats() const { return m_stats; }
+    };
+}  // namespace EspApp
@@ -0,0 +1,156 @@
+#include "esp_flash.h"
+#include "esp_hash.h"
+#include "esp_parallel.h"
+
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+namespace EspApp
+{
+    // Second stage bootloader locations: ESP32/S2, most RISC-V parts and S3, ESP32-P4
+    static const uint64_t g_bootloaderOffsets[] = {0x1000, 0x0, 0x2000};
+
+    size_t FlashLayout::GetDefaultAppIndex() const
+    {
+        size_t best = ESP_FLASH_NO_DUPLICATE;
+        for (size_t i = 0; i < apps.size(); i++)
+        {
+            const auto& app = apps[i];
+            if (!app.IsValid() || app.IsDuplicate())
+                continue;
+            if (best == ESP_FLASH_NO_DUPLICATE)
+                best = i;
+            if (app.partition.subtype == AppFactory)
+                return i;
+        }
+        return best;
+    }
+
+    bool LooksLikeFlashDump(span<const uint8_t> data)
+    {
+        return data.size() > ESP_PARTITION_TABLE_OFFSET + ESP_PARTITION_TABLE_MAX_LEN &&
+            IsValidPartitionTable(data.subspan(ESP_PARTITION_TABLE_OFFSET));
+    }
+
+    bool LooksLikeFlashDump(uint64_t length, ImageProbeReader reader, void* context)
+    {
+        // The magic alone decides most files before the whole table is read
+        uint8_t table[ESP_PARTITION_TABLE_MAX_LEN];
+        if (length <= ESP_PARTITION_TABLE_OFFSET + ESP_PARTITION_TABLE_MAX_LEN ||
+            !reader(context, ESP_PARTITION_TABLE_OFFSET, table, sizeof(EspPartitionEntry)) ||
+            !HasPartitionTableAt({table, sizeof(EspPartitionEntry)}, 0))
+            return false;
+        return reader(context, ESP_PARTITION_TABLE_OFFSET, table, sizeof(table)) && IsValidPartitionTable(table);
+    }
+
+    static bool ReadSpan(void* context, uint64_t offset, void* dest, size_t length)
+    {
+        auto bytes = static_cast<const span<const uint8_t>*>(context);
+        if (offset > bytes->size() || bytes->size() - offset < length)
+            return false;
+        memcpy(dest, bytes->data() + offset, length);
+        return true;
+    }
+
+    // Everything but the content hashes: bootloader, partition table and the headers and descriptions of
+    // the apps, each read through `reader`
+    static bool ScanFlashLayout(uint64_t length, ImageProbeReader reader, void* context, FlashLayout& out,
+        size_t maxThreads)
+    {
+        out.partition_table_offset = 0;
+        out.partitions.clear();
+        out.has_bootloader = false;
+        out.apps.clear();
+
+        for (uint64_t offset : g_bootloaderOffsets)
+        {
+            uint8_t magic;
+            if (reader(context, offset, &magic, 1) && magic == ESP_IMAGE_HEADER_MAGIC &&
+                ParseImage(length, reader, context, out.bootloader, offset) == ImageParseStatus::Ok)
+            {
+                out.has_bootloader = true;
+                break;
+            }
+        }
+
+        uint8_t table[ESP_PARTITION_TABLE_MAX_LEN];
+        size_t tableLength = length > ESP_PARTITION_TABLE_OFFSET ?
+            static_cast<size_t>(min<uint64_t>(sizeof(table), length - ESP_PARTITION_TABLE_OFFSET)) : 0;
+        if (tableLength && reader(context, ESP_PARTITION_TABLE_OFFSET, table, tableLength) &&
+            ParsePartitionTable({table, tableLength}, out.partitions, 0))
+        {
+            out.partition_table_offset = ESP_PARTITION_TABLE_OFFSET;
+            for (const auto& partition : out.partitions)
+            {
+                if (!partition.IsApp())
+                    continue;
+                FlashAppImage app {};
+                app.partition = partition;
+                out.apps.push_back(app);
+            }
+        }
+
+        // Parse each app independently
+        ParallelFor(out.apps.size(), [&](size_t i) {
+            auto& app = out.apps[i];
+            app.duplicate_of = ESP_FLASH_NO_DUPLICATE;
+            app.content_hash = 0;
+            app.has_app_desc = false;
+
+            uint64_t offset = app.partition.offset;
+            if (offset >= length)
+            {
+                app.status = ImageParseStatus::TooShort;
+                return;
+            }
+
+            // Bound the parse by the partition so a corrupt image cannot run into its neighbour
+            uint64_t end = min<uint64_t>(length, offset + app.partition.size);
+            app.status = ParseImage(end, reader, context, app.image, offset);
+            if (app.status == ImageParseStatus::Ok)
+                app.has_app_desc = ParseAppDesc(end, reader, context, app.image, app.app_desc);
+        }, maxThreads);
+
+        return out.has_bootloader || !out.apps.empty();
+    }
+
+    bool ScanFlashDump(uint64_t length, ImageProbeReader reader, void* context, FlashLayout& out, size_t maxThreads)
+    {
+        return ScanFlashLayout(length, reader, context, out, maxThreads);
+    }
+
+    bool ScanFlashDump(span<const uint8_t> data, FlashLayout& out, size_t maxThreads)
+    {
+        bool found = ScanFlashLayout(data.size(), ReadSpan, &data, out, maxThreads);
+
+        ParallelFor(out.apps.size(), [&](size_t i) {
+            auto& app = out.apps[i];
+            if (app.IsValid())
+                app.content_hash = XxHash64(data.subspan(app.image.base_offset, app.GetImageSize()));
+        }, maxThreads);
+
+        // Link identical images. Hash equality is confirmed with a compare, so a collision can never
+        // hide a distinct image.
+        unordered_map<uint64_t, size_t> firstByHash;
+        for (size_t i = 0; i < out.apps.size(); i++)
+        {
+            auto& app = out.apps[i];
+            if (!app.IsValid())
+                continue;
+
+            auto [it, inserted] = firstByHash.try_emplace(app.content_hash, i);
+            if (inserted)
+                continue;
+
+            const auto& first = out.apps[it->second];
+            if (first.GetImageSize() == app.GetImageSize() &&
+                memcmp(data.data() + first.image.base_offset, data.data() + app.image.base_offset,
+                    app.GetImageSize()) == 0)
+                app.duplicate_of = it->second;
+        }
+
+        return found;
+    }
+}  // namespace EspApp
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "esp_app_desc.h"
+#include "esp_image.h"
+#include "esp_partition.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr size_t ESP_FLASH_NO_DUPLICATE = SIZE_MAX;
+    constexpr uint64_t ESP_FLASH_APP_ALIGN = 0x10000;
+
+    // An app image found in a flash dump
+    struct FlashAppImage
+    {
+        PartitionInfo partition;
+        ImageParseStatus status;
+        ParsedImage image;            // File offsets are relative to the start of the dump
+        uint64_t content_hash;        // XxHash64 over the header and segment data
+        size_t duplicate_of;          // Index of the first byte-identical app, or ESP_FLASH_NO_DUPLICATE
+        bool has_app_desc;
+        AppDesc app_desc;
+
+        bool IsValid() const { return status == ImageParseStatus::Ok; }
+        bool IsDuplicate() const { return duplicate_of != ESP_FLASH_NO_DUPLICATE; }
+        uint64_t GetImageSize() const { return image.end_offset - image.base_offset; }
+    };
+
+    struct FlashLayout
+    {
+        uint64_t partition_table_offset;  // 0 if the dump has no partition table
+        std::vector<PartitionInfo> partitions;
+
+        bool has_bootloader;
+        ParsedImage bootloader;
+
+        std::vector<FlashAppImage> apps;
+
+        // Index of the app that should be loaded by default: factory, then the lowest OTA slot
+        size_t GetDefaultAppIndex() const;
+    };
+
+    // Check used by the view type probe: a raw SPI flash dump has a well-formed partition table with at least one
+    // app entry at 0x8000 (see IsValidPartitionTable)
+    bool LooksLikeFlashDump(std::span<const uint8_t> data);
+    bool LooksLikeFlashDump(uint64_t length, ImageProbeReader reader, void* context);
+
+    // Locate the bootloader, partition table and every app image in a raw flash dump. App images are
+    // parsed and hashed in parallel; byte-identical apps (e.g. ota_0 == ota_1 after an update) are linked
+    // through `duplicate_of`. Callers check LooksLikeFlashDump first; without a partition table only the
+    // bootloader is found.
+    bool ScanFlashDump(std::span<const uint8_t> data, FlashLayout& out, size_t maxThreads = 0);
+
+    // Same scan for a dump of `length` bytes that is only reachable through `reader`, such as an encrypted
+    // one. Only headers and app descriptions are read, so apps are not hashed and duplicates are not linked.
+    bool ScanFlashDump(uint64_t length, ImageProbeReader reader, void* context, FlashLayout& out,
+        size_t maxThreads = 0);
+}  // namespace EspApp
@@ -0,0 +1,554 @@
+#include "esp_flash_crypt.h"
+#include "esp_chip.h"
+#include "esp_endian.h"
+#include "esp_flash.h"
+#include "esp_partition.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define ESP_AES_X86
+#define ESP_AES_TARGET __attribute__((target("aes,ssse3")))
+#elif defined(_M_X64)
+#include <intrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define ESP_AES_X86
+#define ESP_AES_TARGET
+#elif defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+#include <arm_neon.h>
+#define ESP_AES_ARM
+#endif
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr uint8_t XTime(uint8_t x)
+    {
+        return static_cast<uint8_t>((x << 1) ^ ((x >> 7) * 0x1B));
+    }
+
+    static constexpr uint8_t GfMul(uint8_t a, uint8_t b)
+    {
+        uint8_t result = 0;
+        for (; b; b >>= 1, a = XTime(a))
+        {
+            if (b & 1)
+                result ^= a;
+        }
+        return result;
+    }
+
+    struct AesTables
+    {
+        uint8_t sbox[256];
+        uint8_t inv_sbox[256];
+        uint32_t te[256];  // Forward round table, big-endian column; rotated for the other rows
+        uint32_t td[256];  // Inverse round table
+    };
+
+    static constexpr AesTables BuildAesTables()
+    {
+        AesTables t {};
+        for (int i = 0; i < 256; i++)
+        {
+            // Multiplicative inverse in GF(2^8), then the affine transform
+            uint8_t inv = 0;
+            for (int j = 1; j < 256 && i; j++)
+            {
+                if (GfMul(static_cast<uint8_t>(i), static_cast<uint8_t>(j)) == 1)
+                {
+                    inv = static_cast<uint8_t>(j);
+                    break;
+                }
+            }
+            uint8_t s = inv;
+            for (int shift = 1; shift < 5; shift++)
+                s ^= static_cast<uint8_t>((inv << shift) | (inv >> (8 - shift)));
+            t.sbox[i] = static_cast<uint8_t>(s ^ 0x63);
+        }
+        for (int i = 0; i < 256; i++)
+            t.inv_sbox[t.sbox[i]] = static_cast<uint8_t>(i);
+        for (int i = 0; i < 256; i++)
+        {
+            uint8_t s = t.sbox[i];
+            t.te[i] = (uint32_t(GfMul(s, 2)) << 24) | (uint32_t(s) << 16) | (uint32_t(s) << 8) | GfMul(s, 3);
+            uint8_t v = t.inv_sbox[i];
+            t.td[i] = (uint32_t(GfMul(v, 14)) << 24) | (uint32_t(GfMul(v, 9)) << 16) |
+                (uint32_t(GfMul(v, 13)) << 8) | GfMul(v, 11);
+        }
+        return t;
+    }
+
+    static constexpr AesTables g_aes = BuildAesTables();
+
+    static uint32_t LoadBE32(const uint8_t* p)
+    {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    static void StoreBE32(uint8_t* p, uint32_t v)
+    {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    // FIPS-197 key expansion into (rounds + 1) 16-byte round keys. Returns the number of rounds.
+    static size_t ExpandAesKey(span<const uint8_t> key, uint8_t* roundKeys)
+    {
+        size_t nk = key.size() / 4;
+        size_t rounds = nk + 6;
+        memcpy(roundKeys, key.data(), key.size());
+        uint8_t rcon = 1;
+        for (size_t i = nk; i < 4 * (rounds + 1); i++)
+        {
+            uint8_t temp[4];
+            memcpy(temp, roundKeys + 4 * (i - 1), 4);
+            if (i % nk == 0)
+            {
+                uint8_t first = temp[0];
+                temp[0] = static_cast<uint8_t>(g_aes.sbox[temp[1]] ^ rcon);
+                temp[1] = g_aes.sbox[temp[2]];
+                temp[2] = g_aes.sbox[temp[3]];
+                temp[3] = g_aes.sbox[first];
+                rcon = XTime(rcon);
+            }
+            else if (nk > 6 && i % nk == 4)
+            {
+                for (uint8_t& b : temp)
+                    b = g_aes.sbox[b];
+            }
+            for (size_t j = 0; j < 4; j++)
+                roundKeys[4 * i + j] = roundKeys[4 * (i - nk) + j] ^ temp[j];
+        }
+        return rounds;
+    }
+
+    static void InvMixColumns(uint8_t* block)
+    {
+        for (size_t c = 0; c < 16; c += 4)
+        {
+            uint8_t a0 = block[c], a1 = block[c + 1], a2 = block[c + 2], a3 = block[c + 3];
+            block[c] = GfMul(a0, 14) ^ GfMul(a1, 11) ^ GfMul(a2, 13) ^ GfMul(a3, 9);
+            block[c + 1] = GfMul(a0, 9) ^ GfMul(a1, 14) ^ GfMul(a2, 11) ^ GfMul(a3, 13);
+            block[c + 2] = GfMul(a0, 13) ^ GfMul(a1, 9) ^ GfMul(a2, 14) ^ GfMul(a3, 11);
+            block[c + 3] = GfMul(a0, 11) ^ GfMul(a1, 13) ^ GfMul(a2, 9) ^ GfMul(a3, 14);
+        }
+    }
+
+    static void EncryptBlock(const uint8_t* rk, size_t rounds, const uint8_t* in, uint8_t* out)
+    {
+        uint32_t s0 = LoadBE32(in) ^ LoadBE32(rk), s1 = LoadBE32(in + 4) ^ LoadBE32(rk + 4);
+        uint32_t s2 = LoadBE32(in + 8) ^ LoadBE32(rk + 8), s3 = LoadBE32(in + 12) ^ LoadBE32(rk + 12);
+        auto te = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+            return g_aes.te[a >> 24] ^ rotr(g_aes.te[(b >> 16) & 0xFF], 8) ^ rotr(g_aes.te[(c >> 8) & 0xFF], 16) ^
+                rotr(g_aes.te[d & 0xFF], 24);
+        };
+        for (size_t r = 1; r < rounds; r++)
+        {
+            const uint8_t* k = rk + 16 * r;
+            uint32_t t0 = te(s0, s1, s2, s3) ^ LoadBE32(k);
+            uint32_t t1 = te(s1, s2, s3, s0) ^ LoadBE32(k + 4);
+            uint32_t t2 = te(s2, s3, s0, s1) ^ LoadBE32(k + 8);
+            uint32_t t3 = te(s3, s0, s1, s2) ^ LoadBE32(k + 12);
+            s0 = t0, s1 = t1, s2 = t2, s3 = t3;
+        }
+        auto last = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+            return (uint32_t(g_aes.sbox[a >> 24]) << 24) | (uint32_t(g_aes.sbox[(b >> 16) & 0xFF]) << 16) |
+                (uint32_t(g_aes.sbox[(c >> 8) & 0xFF]) << 8) | g_aes.sbox[d & 0xFF];
+        };
+        const uint8_t* k = rk + 16 * rounds;
+        StoreBE32(out, last(s0, s1, s2, s3) ^ LoadBE32(k));
+        StoreBE32(out + 4, last(s1, s2, s3, s0) ^ LoadBE32(k + 4));
+        StoreBE32(out + 8, last(s2, s3, s0, s1) ^ LoadBE32(k + 8));
+        StoreBE32(out + 12, last(s3, s0, s1, s2) ^ LoadBE32(k + 12));
+    }
+
+    // Equivalent inverse cipher; `dk` holds the round keys in decryption order with InvMixColumns applied
+    // to the inner ones
+    static void DecryptBlock(const uint8_t* dk, size_t rounds, const uint8_t* in, uint8_t* out)
+    {
+        uint32_t s0 = LoadBE32(in) ^ LoadBE32(dk), s1 = LoadBE32(in + 4) ^ LoadBE32(dk + 4);
+        uint32_t s2 = LoadBE32(in + 8) ^ LoadBE32(dk + 8), s3 = LoadBE32(in + 12) ^ LoadBE32(dk + 12);
+        auto td = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+            return g_aes.td[a >> 24] ^ rotr(g_aes.td[(b >> 16) & 0xFF], 8) ^ rotr(g_aes.td[(c >> 8) & 0xFF], 16) ^
+                rotr(g_aes.td[d & 0xFF], 24);
+        };
+        for (size_t r = 1; r < rounds; r++)
+        {
+            const uint8_t* k = dk + 16 * r;
+            uint32_t t0 = td(s0, s3, s2, s1) ^ LoadBE32(k);
+            uint32_t t1 = td(s1, s0, s3, s2) ^ LoadBE32(k + 4);
+            uint32_t t2 = td(s2, s1, s0, s3) ^ LoadBE32(k + 8);
+            uint32_t t3 = td(s3, s2, s1, s0) ^ LoadBE32(k + 12);
+            s0 = t0, s1 = t1, s2 = t2, s3 = t3;
+        }
+        auto last = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+            return (uint32_t(g_aes.inv_sbox[a >> 24]) << 24) | (uint32_t(g_aes.inv_sbox[(b >> 16) & 0xFF]) << 16) |
+                (uint32_t(g_aes.inv_sbox[(c >> 8) & 0xFF]) << 8) | g_aes.inv_sbox[d & 0xFF];
+        };
+        const uint8_t* k = dk + 16 * rounds;
+        StoreBE32(out, last(s0, s3, s2, s1) ^ LoadBE32(k));
+        StoreBE32(out + 4, last(s1, s0, s3, s2) ^ LoadBE32(k + 4));
+        StoreBE32(out + 8, last(s2, s1, s0, s3) ^ LoadBE32(k + 8));
+        StoreBE32(out + 12, last(s3, s2, s1, s0) ^ LoadBE32(k + 12));
+    }
+
+    // Multiply an XTS tweak by x in GF(2^128), little-endian
+    static void NextTweak(uint8_t* tweak)
+    {
+        uint8_t carry = tweak[15] >> 7;
+        for (size_t i = 15; i > 0; i--)
+            tweak[i] = static_cast<uint8_t>((tweak[i] << 1) | (tweak[i - 1] >> 7));
+        tweak[0] = static_cast<uint8_t>((tweak[0] << 1) ^ (carry ? 0x87 : 0));
+    }
+
+    static void GetUnitTweak(uint64_t flashAddr, uint8_t* tweak)
+    {
+        memset(tweak, 0, 16);
+        uint32_t addr = static_cast<uint32_t>(flashAddr) & ~uint32_t(ESP_FLASH_CRYPT_UNIT - 1);
+        for (size_t i = 0; i < 4; i++)
+            tweak[i] = static_cast<uint8_t>(addr >> (8 * i));
+    }
+
+    static void DecryptUnitSoftware(const uint8_t* dk, const uint8_t* tk, size_t rounds, uint64_t flashAddr,
+        uint8_t* unit)
+    {
+        uint8_t tweak[16];
+        GetUnitTweak(flashAddr, tweak);
+        EncryptBlock(tk, rounds, tweak, tweak);
+
+        uint8_t buffer[ESP_FLASH_CRYPT_UNIT];
+        reverse_copy(unit, unit + ESP_FLASH_CRYPT_UNIT, buffer);
+        for (size_t i = 0; i < ESP_FLASH_CRYPT_UNIT; i += 16)
+        {
+            uint8_t* block = buffer + i;
+            for (size_t j = 0; j < 16; j++)
+                block[j] ^= tweak[j];
+            DecryptBlock(dk, rounds, block, block);
+            for (size_t j = 0; j < 16; j++)
+                block[j] ^= tweak[j];
+            NextTweak(tweak);
+        }
+        reverse_copy(buffer, buffer + ESP_FLASH_CRYPT_UNIT, unit);
+    }
+
+#if defined(ESP_AES_X86)
+    // Tweak times x in GF(2^128): both 64-bit halves shift left, the carries go into the upper half and
+    // the reduction polynomial
+    ESP_AES_TARGET static __m128i NextTweak(__m128i tweak)
+    {
+        __m128i carry = _mm_srai_epi32(_mm_shuffle_epi32(tweak, 0x13), 31);
+        return _mm_xor_si128(_mm_add_epi64(tweak, tweak), _mm_and_si128(carry, _mm_set_epi32(0, 1, 0, 0x87)));
+    }
+
+    ESP_AES_TARGET static void DecryptUnitHardware(const uint8_t* dk, const uint8_t* tk, size_t rounds,
+        uint64_t flashAddr, uint8_t* unit)
+    {
+        constexpr size_t blocks = ESP_FLASH_CRYPT_UNIT / 16;
+        alignas(16) uint8_t first[16];
+        GetUnitTweak(flashAddr, first);
+        __m128i t = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(first)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(tk)));
+        for (size_t r = 1; r < rounds; r++)
+            t = _mm_aesenc_si128(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tk + 16 * r)));
+        t = _mm_aesenclast_si128(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tk + 16 * rounds)));
+
+        // Block i of the reversed unit is the byte-reversed block (blocks - 1 - i) of the unit. The eight
+        // blocks are independent, so their rounds are interleaved.
+        const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m128i tweaks[blocks], state[blocks];
+        __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dk));
+        for (size_t i = 0; i < blocks; i++)
+        {
+            tweaks[i] = t;
+            t = NextTweak(t);
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(unit + 16 * (blocks - 1 - i)));
+            state[i] = _mm_xor_si128(_mm_xor_si128(_mm_shuffle_epi8(block, reverse), tweaks[i]), key);
+        }
+        for (size_t r = 1; r < rounds; r++)
+        {
+            key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dk + 16 * r));
+            for (size_t i = 0; i < blocks; i++)
+                state[i] = _mm_aesdec_si128(state[i], key);
+        }
+        key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dk + 16 * rounds));
+        for (size_t i = 0; i < blocks; i++)
+        {
+            __m128i block = _mm_xor_si128(_mm_aesdeclast_si128(state[i], key), tweaks[i]);
+            block = _mm_shuffle_epi8(block, reverse);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(unit + 16 * (blocks - 1 - i)), block);
+        }
+    }
+#elif defined(ESP_AES_ARM)
+    static void DecryptUnitHardware(const uint8_t* dk, const uint8_t* tk, size_t rounds, uint64_t flashAddr,
+        uint8_t* unit)
+    {
+        constexpr size_t blocks = ESP_FLASH_CRYPT_UNIT / 16;
+        uint8_t tweaks[blocks][16];
+        GetUnitTweak(flashAddr, tweaks[0]);
+        uint8x16_t t = vld1q_u8(tweaks[0]);
+        for (size_t r = 0; r + 1 < rounds; r++)
+            t = vaesmcq_u8(vaeseq_u8(t, vld1q_u8(tk + 16 * r)));
+        t = veorq_u8(vaeseq_u8(t, vld1q_u8(tk + 16 * (rounds - 1))), vld1q_u8(tk + 16 * rounds));
+        vst1q_u8(tweaks[0], t);
+        for (size_t i = 1; i < blocks; i++)
+        {
+            memcpy(tweaks[i], tweaks[i - 1], 16);
+            NextTweak(tweaks[i]);
+        }
+
+        uint8_t buffer[ESP_FLASH_CRYPT_UNIT];
+        reverse_copy(unit, unit + ESP_FLASH_CRYPT_UNIT, buffer);
+        uint8x16_t state[blocks];
+        for (size_t i = 0; i < blocks; i++)
+            state[i] = veorq_u8(vld1q_u8(buffer + 16 * i), vld1q_u8(tweaks[i]));
+        for (size_t r = 0; r + 1 < rounds; r++)
+        {
+            uint8x16_t key = vld1q_u8(dk + 16 * r);
+            for (size_t i = 0; i < blocks; i++)
+                state[i] = vaesimcq_u8(vaesdq_u8(state[i], key));
+        }
+        uint8x16_t key = vld1q_u8(dk + 16 * (rounds - 1));
+        uint8x16_t lastKey = vld1q_u8(dk + 16 * rounds);
+        for (size_t i = 0; i < blocks; i++)
+        {
+            state[i] = veorq_u8(vaesdq_u8(state[i], key), lastKey);
+            vst1q_u8(buffer + 16 * i, veorq_u8(state[i], vld1q_u8(tweaks[i])));
+        }
+        reverse_copy(buffer, buffer + ESP_FLASH_CRYPT_UNIT, unit);
+    }
+#endif
+
+    bool FlashDecryptor::HasHardwareAes()
+    {
+#if defined(ESP_AES_X86) && defined(__GNUC__)
+        static const bool supported = [] {
+            unsigned int eax, ebx, ecx, edx;
+            return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) && (ecx & bit_SSSE3);
+        }();
+        return supported;
+#elif defined(ESP_AES_X86)
+        static const bool supported = [] {
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 25)) && (info[2] & (1 << 9));
+        }();
+        return supported;
+#elif defined(ESP_AES_ARM)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool FlashDecryptor::SetKey(span<const uint8_t> key, bool useHardware)
+    {
+        if (key.size() != 32 && key.size() != 64)
+            return false;
+
+        size_t half = key.size() / 2;
+        uint8_t roundKeys[15 * 16];
+        m_rounds = ExpandAesKey(key.first(half), roundKeys);
+        ExpandAesKey(key.subspan(half), m_tweakKeys.data());
+
+        memcpy(m_dataKeys.data(), roundKeys + 16 * m_rounds, 16);
+        for (size_t r = 1; r < m_rounds; r++)
+        {
+            uint8_t* k = m_dataKeys.data() + 16 * r;
+            memcpy(k, roundKeys + 16 * (m_rounds - r), 16);
+            InvMixColumns(k);
+        }
+        memcpy(m_dataKeys.data() + 16 * m_rounds, roundKeys, 16);
+        m_hardware = useHardware && HasHardwareAes();
+        return true;
+    }
+
+    void FlashDecryptor::Decrypt(uint64_t flashAddr, uint8_t* data, size_t length) const
+    {
+        for (size_t i = 0; i + ESP_FLASH_CRYPT_UNIT <= length; i += ESP_FLASH_CRYPT_UNIT)
+        {
+#if defined(ESP_AES_X86) || defined(ESP_AES_ARM)
+            if (m_hardware)
+            {
+                DecryptUnitHardware(m_dataKeys.data(), m_tweakKeys.data(), m_rounds, flashAddr + i, data + i);
+                continue;
+            }
+#endif
+            DecryptUnitSoftware(m_dataKeys.data(), m_tweakKeys.data(), m_rounds, flashAddr + i, data + i);
+        }
+    }
+
+    DecryptedFlash::DecryptedFlash(const FlashDecryptor& decryptor, uint64_t length, uint64_t flashAddr,
+        ImageProbeReader reader, void* context, size_t maxPages) :
+        m_decryptor(decryptor), m_length(length), m_flashAddr(flashAddr), m_reader(reader), m_context(context),
+        m_maxPages(max<size_t>(maxPages, 1))
+    {
+    }
+
+    const DecryptedFlash::Page* DecryptedFlash::GetPage(uint64_t index)
+    {
+        auto it = m_pageIndex.find(index);
+        if (it != m_pageIndex.end())
+        {
+            m_pages.splice(m_pages.begin(), m_pages, it->second);
+            return &*it->second;
+        }
+
+        // Pages are counted from the start of the data; with a unit-aligned flash address every page
+        // starts on a unit
+        uint64_t offset = index * ESP_FLASH_CRYPT_PAGE;
+        size_t available = static_cast<size_t>(min<uint64_t>(ESP_FLASH_CRYPT_PAGE, m_length - offset));
+
+        if (m_pages.size() >= m_maxPages)
+        {
+            m_pageIndex.erase(m_pages.back().index);
+            m_pages.splice(m_pages.begin(), m_pages, prev(m_pages.end()));
+        }
+        else
+        {
+            m_pages.emplace_front();
+        }
+
+        Page& page = m_pages.front();
+        page.index = index;
+        if (!m_reader(m_context, offset, page.data.data(), available))
+        {
+            m_pages.pop_front();
+            return nullptr;
+        }
+
+        // A partial unit at the end of the data is decrypted padded, its plaintext past the end is never read
+        size_t units = (available + ESP_FLASH_CRYPT_UNIT - 1) & ~(ESP_FLASH_CRYPT_UNIT - 1);
+        memset(page.data.data() + available, 0, units - available);
+        m_decryptor.Decrypt(m_flashAddr + offset, page.data.data(), units);
+        m_pageIndex[index] = m_pages.begin();
+        m_decryptedPages++;
+        return &page;
+    }
+
+    size_t DecryptedFlash::Read(uint64_t offset, void* dest, size_t length)
+    {
+        if (offset >= m_length)
+            return 0;
+        length = static_cast<size_t>(min<uint64_t>(length, m_length - offset));
+
+        lock_guard<mutex> lock(m_mutex);
+        size_t done = 0;
+        while (done < length)
+        {
+            uint64_t position = offset + done;
+            const Page* page = GetPage(position / ESP_FLASH_CRYPT_PAGE);
+            if (!page)
+                break;
+
+            size_t pageOffset = static_cast<size_t>(position % ESP_FLASH_CRYPT_PAGE);
+            size_t count = min(length - done, ESP_FLASH_CRYPT_PAGE - pageOffset);
+            memcpy(static_cast<uint8_t*>(dest) + done, page->data.data() + pageOffset, count);
+            done += count;
+        }
+        return done;
+    }
+
+    bool DecryptedFlash::ReadExact(void* context, uint64_t offset, void* dest, size_t length)
+    {
+        return static_cast<DecryptedFlash*>(context)->Read(offset, dest, length) == length;
+    }
+
+    uint64_t DecryptedFlash::GetDecryptedPages()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_decryptedPages;
+    }
+
+    // The probe at one flash address, given the ciphertext of the first unit and of the partition table unit
+    // (null if the data is too short for either)
+    static bool ProbeAt(const FlashDecryptor& decryptor, uint64_t flashAddr, uint64_t length, ImageProbeReader reader,
+        void* context, const uint8_t* firstUnit, const uint8_t* tableUnit)
+    {
+        // Whole flash dump: the partition table is encrypted along with the bootloader and the apps
+        uint8_t unit[ESP_FLASH_CRYPT_UNIT];
+        if (flashAddr == 0 && tableUnit)
+        {
+            memcpy(unit, tableUnit, sizeof(unit));
+            decryptor.Decrypt(ESP_PARTITION_TABLE_OFFSET, unit, sizeof(unit));
+            if (HasPartitionTableAt(unit, 0))
+                return true;
+        }
+
+        // A single image: the first unit has to hold a plausible header before the segment chain is walked
+        if (!firstUnit)
+            return false;
+        memcpy(unit, firstUnit, sizeof(unit));
+        decryptor.Decrypt(flashAddr, unit, sizeof(unit));
+        if (CheckImageHeader(unit) != ImageParseStatus::Ok ||
+            !GetChipAttrById(static_cast<EspChipId>(LoadLE16(unit + 12))))
+            return false;
+
+        DecryptedFlash image(decryptor, length, flashAddr, reader, context, 4);
+        return ProbeImage(length, DecryptedFlash::ReadExact, &image) == ImageParseStatus::Ok;
+    }
+
+    // Reads the units ProbeAt looks at; null where the data is too short
+    struct ProbeUnits
+    {
+        uint8_t first[ESP_FLASH_CRYPT_UNIT];
+        uint8_t table[ESP_FLASH_CRYPT_UNIT];
+        const uint8_t* first_unit = nullptr;
+        const uint8_t* table_unit = nullptr;
+
+        ProbeUnits(uint64_t length, ImageProbeReader reader, void* context)
+        {
+            if (length >= sizeof(first) && reader(context, 0, first, sizeof(first)))
+                first_unit = first;
+            if (length > ESP_PARTITION_TABLE_OFFSET + ESP_PARTITION_TABLE_MAX_LEN &&
+                reader(context, ESP_PARTITION_TABLE_OFFSET, table, sizeof(table)))
+                table_unit = table;
+        }
+    };
+
+    bool ProbeEncryptedFlash(const FlashDecryptor& decryptor, uint64_t flashAddr, uint64_t length,
+        ImageProbeReader reader, void* context)
+    {
+        if (flashAddr % ESP_FLASH_CRYPT_UNIT)
+            return false;
+        ProbeUnits units(length, reader, context);
+        return ProbeAt(decryptor, flashAddr, length, reader, context, units.first_unit, units.table_unit);
+    }
+
+    uint64_t FindEncryptedFlashAddress(const FlashDecryptor& decryptor, uint64_t length, ImageProbeReader reader,
+        void* context)
+    {
+        // The tweak is part of the cipher, so each address decrypts the unit anew, but from the one copy read here
+        ProbeUnits units(length, reader, context);
+        if (!units.first_unit && !units.table_unit)
+            return ESP_FLASH_CRYPT_NO_MATCH;
+        for (uint64_t flashAddr = 0; flashAddr < 0x1000000; flashAddr += ESP_FLASH_APP_ALIGN)
+        {
+            if (ProbeAt(decryptor, flashAddr, length, reader, context, units.first_unit, units.table_unit))
+                return flashAddr;
+        }
+        return ESP_FLASH_CRYPT_NO_MATCH;
+    }
+
+    bool LooksLikeCiphertext(span<const uint8_t> data)
+    {
+        // Headers, code and erased flash repeat bytes; 128 random bytes hit about 100 distinct values
+        bool seen[256] = {};
+        size_t distinct = 0;
+        for (uint8_t byte : data.first(min<size_t>(data.size(), ESP_FLASH_CRYPT_UNIT)))
+        {
+            distinct += !seen[byte];
+            seen[byte] = true;
+        }
+        return data.size() >= ESP_FLASH_CRYPT_UNIT && distinct >= 80;
+    }
+}  // namespace EspApp
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "esp_image.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+namespace EspApp
+{
+    constexpr size_t ESP_FLASH_CRYPT_UNIT = 0x80;      // XTS data unit, one tweak per 128 bytes of flash
+    constexpr size_t ESP_FLASH_CRYPT_PAGE = 0x1000;    // Granularity of lazy decryption
+    constexpr uint64_t ESP_FLASH_CRYPT_NO_MATCH = UINT64_MAX;
+
+    // XTS-AES flash encryption as used by the ESP32-S2 and later parts (espsecure.py encrypt_flash_data).
+    // The key is the eFuse key file: 32 bytes for XTS-AES-128 or 64 bytes for XTS-AES-256, key1 then key2.
+    // The tweak of each 128-byte unit is its flash address, and the hardware reverses the bytes of every
+    // unit around the standard XTS operation.
+    class FlashDecryptor
+    {
+        std::array<uint8_t, 15 * 16> m_dataKeys {};   // Decryption round keys of key1 (equivalent inverse cipher)
+        std::array<uint8_t, 15 * 16> m_tweakKeys {};  // Encryption round keys of key2
+        size_t m_rounds = 0;
+        bool m_hardware = false;
+
+    public:
+        // Returns false if `key` is not 32 or 64 bytes long. `useHardware` false keeps to the portable code even
+        // where the CPU has AES instructions, e.g. to check one against the other.
+        bool SetKey(std::span<const uint8_t> key, bool useHardware = true);
+        bool HasKey() const { return m_rounds != 0; }
+        size_t GetKeyBits() const { return m_rounds == 14 ? 256 : 128; }
+        bool UsesHardwareAes() const { return m_hardware; }
+
+        // Decrypt `length` bytes in place. `flashAddr` and `length` must be multiples of ESP_FLASH_CRYPT_UNIT.
+        void Decrypt(uint64_t flashAddr, uint8_t* data, size_t length) const;
+
+        // AES instructions of the CPU this runs on (AES-NI, or the ARMv8 crypto extension when compiled in)
+        static bool HasHardwareAes();
+    };
+
+    // Plaintext of an encrypted flash image whose first byte sits at flash address `flashAddr`. Ciphertext
+    // comes from `reader`; pages are decrypted the first time they are read and kept in a bounded LRU cache,
+    // so only what is actually read is ever decrypted. Safe to read from several threads.
+    class DecryptedFlash
+    {
+        struct Page
+        {
+            uint64_t index;
+            std::array<uint8_t, ESP_FLASH_CRYPT_PAGE> data;
+        };
+
+        FlashDecryptor m_decryptor;
+        uint64_t m_length;
+        uint64_t m_flashAddr;
+        ImageProbeReader m_reader;
+        void* m_context;
+        size_t m_maxPages;
+
+        std::mutex m_mutex;
+        std::list<Page> m_pages;  // Most recently used first
+        std::unordered_map<uint64_t, std::list<Page>::iterator> m_pageIndex;
+        uint64_t m_decryptedPages = 0;
+
+        const Page* GetPage(uint64_t index);
+
+    public:
+        // `flashAddr` must be a multiple of ESP_FLASH_CRYPT_UNIT
+        DecryptedFlash(const FlashDecryptor& decryptor, uint64_t length, uint64_t flashAddr, ImageProbeReader reader,
+            void* context, size_t maxPages = 1024);
+        DecryptedFlash(const DecryptedFlash&) = delete;
+        DecryptedFlash& operator=(const DecryptedFlash&) = delete;
+
+        uint64_t GetLength() const { return m_length; }
+        uint64_t GetFlashAddress() const { return m_flashAddr; }
+        const FlashDecryptor& GetDecryptor() const { return m_decryptor; }
+
+        // Copies plaintext and returns the number of bytes read: short at the end of the data, or where the
+        // ciphertext could not be read
+        size_t Read(uint64_t offset, void* dest, size_t length);
+
+        // ImageProbeReader over a DecryptedFlash `context`
+        static bool ReadExact(void* context, uint64_t offset, void* dest, size_t length);
+
+        // Pages decrypted so far, including ones that were evicted and decrypted again
+        uint64_t GetDecryptedPages();
+    };
+
+    // True if the data decrypts, with its first byte at flash address `flashAddr`, to a flash dump (only at
+    // address 0: the partition table at 0x8000) or to a complete app image
+    bool ProbeEncryptedFlash(const FlashDecryptor& decryptor, uint64_t flashAddr, uint64_t length,
+        ImageProbeReader reader, void* context);
+
+    // The flash address at which the data probes as above: 0, then every 64 KB aligned partition address up
+    // to 16 MB. The first unit and the partition table unit are read once; at addresses where no image starts
+    // only that copy of the first unit is decrypted. Returns ESP_FLASH_CRYPT_NO_MATCH if there is none.
+    uint64_t FindEncryptedFlashAddress(const FlashDecryptor& decryptor, uint64_t length, ImageProbeReader reader,
+        void* context);
+
+    // True if the first unit of `data` is as varied as ciphertext, which no image header or erased flash is
+    bool LooksLikeCiphertext(std::span<const uint8_t> data);
+}  // namespace EspApp
@@ -0,0 +1,91 @@
+#include "esp_hash.h"
+#include "esp_endian.h"
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+    static constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+    static constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+    static constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+    static constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+    static inline uint64_t Rotl64(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static inline uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * kPrime2;
+        acc = Rotl64(acc, 31);
+        return acc * kPrime1;
+    }
+
+    static inline uint64_t MergeRound(uint64_t acc, uint64_t val)
+    {
+        acc ^= Round(0, val);
+        return acc * kPrime1 + kPrime4;
+    }
+
+    uint64_t XxHash64(span<const uint8_t> data, uint64_t seed)
+    {
+        const uint8_t* p = data.data();
+        const uint8_t* end = p + data.size();
+        uint64_t h;
+
+        if (data.size() >= 32)
+        {
+            uint64_t v1 = seed + kPrime1 + kPrime2;
+            uint64_t v2 = seed + kPrime2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - kPrime1;
+            const uint8_t* limit = end - 32;
+            do
+            {
+                v1 = Round(v1, LoadLE64(p));
+                v2 = Round(v2, LoadLE64(p + 8));
+                v3 = Round(v3, LoadLE64(p + 16));
+                v4 = Round(v4, LoadLE64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+            h = MergeRound(h, v1);
+            h = MergeRound(h, v2);
+            h = MergeRound(h, v3);
+            h = MergeRound(h, v4);
+        }
+        else
+        {
+            h = seed + kPrime5;
+        }
+
+        h += static_cast<uint64_t>(data.size());
+
+        for (; end - p >= 8; p += 8)
+        {
+            h ^= Round(0, LoadLE64(p));
+            h = Rotl64(h, 27) * kPrime1 + kPrime4;
+        }
+        if (end - p >= 4)
+        {
+            h ^= static_cast<uint64_t>(LoadLE32(p)) * kPrime1;
+            h = Rotl64(h, 23) * kPrime2 + kPrime3;
+            p += 4;
+        }
+        for (; p < end; p++)
+        {
+            h ^= (*p) * kPrime5;
+            h = Rotl64(h, 11) * kPrime1;
+        }
+
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        h ^= h >> 32;
+        return h;
+    }
+}  // namespace EspApp
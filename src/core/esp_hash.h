@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace EspApp
+{
+    // XXH64 of `data`. Used for content identity (deduplicating identical images), not for integrity.
+    uint64_t XxHash64(std::span<const uint8_t> data, uint64_t seed = 0);
+}  // namespace EspApp
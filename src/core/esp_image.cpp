@@ -0,0 +1,204 @@
+#include "esp_image.h"
+#include "esp_chip.h"
+#include "esp_endian.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    const char* GetImageParseStatusString(ImageParseStatus status)
+    {
+        switch (status)
+        {
+        case ImageParseStatus::Ok:
+            return "ok";
+        case ImageParseStatus::TooShort:
+            return "data is shorter than the image header";
+        case ImageParseStatus::BadMagic:
+            return "bad image magic";
+        case ImageParseStatus::BadSegmentCount:
+            return "invalid segment count";
+        case ImageParseStatus::TruncatedSegmentHeader:
+            return "segment header is truncated";
+        case ImageParseStatus::TruncatedSegmentData:
+            return "segment data is truncated";
+        case ImageParseStatus::UnknownChip:
+            return "unknown chip id";
+        }
+        return "unknown";
+    }
+
+    void DecodeImageHeader(const uint8_t* data, EspImageHeader& out)
+    {
+        out.magic = data[0];
+        out.segment_count = data[1];
+        out.spi_mode = data[2];
+        out.spi_speed_size = data[3];
+        out.entry_addr = LoadLE32(data + 4);
+        out.wp_pin = data[8];
+        memcpy(out.spi_pin_drv, data + 9, sizeof(out.spi_pin_drv));
+        out.chip_id = LoadLE16(data + 12);
+        out.min_chip_rev = data[14];
+        out.min_chip_rev_full = LoadLE16(data + 15);
+        out.max_chip_rev_full = LoadLE16(data + 17);
+        memcpy(out.reserved, data + 19, sizeof(out.reserved));
+        out.hash_appended = data[23];
+    }
+
+    ImageParseStatus CheckImageHeader(span<const uint8_t> data)
+    {
+        if (data.size() < sizeof(EspImageHeader))
+            return ImageParseStatus::TooShort;
+        if (data[0] != ESP_IMAGE_HEADER_MAGIC)
+            return ImageParseStatus::BadMagic;
+        if (data[1] == 0 || data[1] > ESP_IMAGE_MAX_SEGMENTS)
+            return ImageParseStatus::BadSegmentCount;
+        return ImageParseStatus::Ok;
+    }
+
+    ImageParseStatus ProbeImage(uint64_t length, ImageProbeReader reader, void* context)
+    {
+        if (length < sizeof(EspImageHeader))
+            return ImageParseStatus::TooShort;
+
+        // Header and first segment header in one read
+        uint8_t head[sizeof(EspImageHeader) + sizeof(EspSegmentHeader)];
+        size_t headLength = length < sizeof(head) ? sizeof(EspImageHeader) : sizeof(head);
+        if (!reader(context, 0, head, headLength))
+            return ImageParseStatus::TooShort;
+
+        ImageParseStatus status = CheckImageHeader({head, headLength});
+        if (status != ImageParseStatus::Ok)
+            return status;
+        if (!GetChipAttrById(static_cast<EspChipId>(LoadLE16(head + 12))))
+            return ImageParseStatus::UnknownChip;
+
+        uint64_t offset = sizeof(EspImageHeader);
+        const uint8_t* segHeader = head + sizeof(EspImageHeader);
+        uint8_t next[sizeof(EspSegmentHeader)];
+        for (size_t i = 0; i < head[1]; i++)
+        {
+            if (length - offset < sizeof(EspSegmentHeader))
+                return ImageParseStatus::TruncatedSegmentHeader;
+            if (i > 0)
+            {
+                if (!reader(context, offset, next, sizeof(next)))
+                    return ImageParseStatus::TruncatedSegmentHeader;
+                segHeader = next;
+            }
+
+            uint32_t dataLen = LoadLE32(segHeader + 4);
+            offset += sizeof(EspSegmentHeader);
+            if (length - offset < dataLen)
+                return ImageParseStatus::TruncatedSegmentData;
+            offset += dataLen;
+        }
+        return ImageParseStatus::Ok;
+    }
+
+    ImageParseStatus ProbeImage(span<const uint8_t> data)
+    {
+        return ProbeImage(data.size(), [](void* context, uint64_t offset, void* dest, size_t length) {
+            auto bytes = static_cast<const span<const uint8_t>*>(context);
+            if (offset > bytes->size() || bytes->size() - offset < length)
+                return false;
+            memcpy(dest, bytes->data() + offset, length);
+            return true;
+        }, &data);
+    }
+
+    ImageParseStatus ParseImage(span<const uint8_t> data, ParsedImage& out, uint64_t baseOffset)
+    {
+        out.segment_count = 0;
+        out.base_offset = baseOffset;
+        out.end_offset = 0;
+        out.failed_segment = 0;
+        out.error_offset = baseOffset;
+
+        if (baseOffset > data.size())
+            return ImageParseStatus::TooShort;
+
+        ImageParseStatus status = CheckImageHeader(data.subspan(baseOffset));
+        if (status != ImageParseStatus::Ok)
+            return status;
+        DecodeImageHeader(data.data() + baseOffset, out.header);
+
+        const uint64_t size = data.size();
+        uint64_t offset = baseOffset + sizeof(EspImageHeader);
+        for (size_t i = 0; i < out.header.segment_count; i++)
+        {
+            out.failed_segment = i;
+            out.error_offset = offset;
+            if (size - offset < sizeof(EspSegmentHeader))
+                return ImageParseStatus::TruncatedSegmentHeader;
+
+            SegmentInfo& seg = out.segments[i];
+            seg.load_addr = LoadLE32(data.data() + offset);
+            seg.data_len = LoadLE32(data.data() + offset + 4);
+            seg.file_offset = offset + sizeof(EspSegmentHeader);
+            if (size - seg.file_offset < seg.data_len)
+            {
+                out.error_offset = seg.file_offset;
+                return ImageParseStatus::TruncatedSegmentData;
+            }
+
+            offset = seg.file_offset + seg.data_len;
+            out.segment_count = i + 1;
+        }
+
+        out.failed_segment = 0;
+        out.error_offset = 0;
+        out.end_offset = offset;
+        return ImageParseStatus::Ok;
+    }
+
+    ImageParseStatus ParseImage(uint64_t length, ImageProbeReader reader, void* context, ParsedImage& out,
+        uint64_t baseOffset)
+    {
+        out.segment_count = 0;
+        out.base_offset = baseOffset;
+        out.end_offset = 0;
+        out.failed_segment = 0;
+        out.error_offset = baseOffset;
+
+        uint8_t head[sizeof(EspImageHeader)];
+        if (baseOffset > length || length - baseOffset < sizeof(head) ||
+            !reader(context, baseOffset, head, sizeof(head)))
+            return ImageParseStatus::TooShort;
+
+        ImageParseStatus status = CheckImageHeader(head);
+        if (status != ImageParseStatus::Ok)
+            return status;
+        DecodeImageHeader(head, out.header);
+
+        uint64_t offset = baseOffset + sizeof(EspImageHeader);
+        for (size_t i = 0; i < out.header.segment_count; i++)
+        {
+            out.failed_segment = i;
+            out.error_offset = offset;
+            uint8_t segHeader[sizeof(EspSegmentHeader)];
+            if (length - offset < sizeof(segHeader) || !reader(context, offset, segHeader, sizeof(segHeader)))
+                return ImageParseStatus::TruncatedSegmentHeader;
+
+            SegmentInfo& seg = out.segments[i];
+            seg.load_addr = LoadLE32(segHeader);
+            seg.data_len = LoadLE32(segHeader + 4);
+            seg.file_offset = offset + sizeof(EspSegmentHeader);
+            if (length - seg.file_offset < seg.data_len)
+            {
+                out.error_offset = seg.file_offset;
+                return ImageParseStatus::TruncatedSegmentData;
+            }
+
+            offset = seg.file_offset + seg.data_len;
+            out.segment_count = i + 1;
+        }
+
+        out.failed_segment = 0;
+        out.error_offset = 0;
+        out.end_offset = offset;
+        return ImageParseStatus::Ok;
+    }
+}  // namespace EspApp
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace EspApp
+{
+    constexpr uint8_t ESP_IMAGE_HEADER_MAGIC = 0xE9;
+    constexpr uint8_t ESP_IMAGE_MAX_SEGMENTS = 16;
+
+    enum class EspChipId : uint16_t
+    {
+        ESP32 = 0x0000,
+        ESP32_S2 = 0x0002,
+        ESP32_C3 = 0x0005,
+        ESP32_S3 = 0x0009,
+        ESP32_C2 = 0x000C,
+        ESP32_C6 = 0x000D,
+        ESP32_H2 = 0x0010,
+        ESP32_P4 = 0x0012,
+        Invalid = 0xFFFF
+    };
+
+    // Every chip id above except Invalid; extend it together with the enum
+    constexpr EspChipId ESP_CHIP_IDS[] = {
+        EspChipId::ESP32,
+        EspChipId::ESP32_S2,
+        EspChipId::ESP32_C3,
+        EspChipId::ESP32_S3,
+        EspChipId::ESP32_C2,
+        EspChipId::ESP32_C6,
+        EspChipId::ESP32_H2,
+        EspChipId::ESP32_P4,
+    };
+
+// ESP32 Image Header (24 bytes)
+#pragma pack(push, 1)
+    struct EspImageHeader
+    {
+        uint8_t magic;               // 0xE9
+        uint8_t segment_count;       // Number of segments (max 16)
+        uint8_t spi_mode;            // Flash read mode
+        uint8_t spi_speed_size;      // spi_speed: 4, spi_size: 4
+        uint32_t entry_addr;         // Entry point address
+        uint8_t wp_pin;              // Write protect pin
+        uint8_t spi_pin_drv[3];      // SPI pin drive settings
+        uint16_t chip_id;            // Chip ID
+        uint8_t min_chip_rev;        // Minimum chip revision
+        uint16_t min_chip_rev_full;  // Minimum chip revision (full)
+        uint16_t max_chip_rev_full;  // Maximum chip revision (full)
+        uint8_t reserved[4];         // Reserved
+        uint8_t hash_appended;       // SHA256 hash appended flag
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(EspImageHeader) == 24, "EspImageHeader must be 24 bytes");
+
+// ESP32 Segment Header (8 bytes)
+#pragma pack(push, 1)
+    struct EspSegmentHeader
+    {
+        uint32_t load_addr;  // Memory address to load segment
+        uint32_t data_len;   // Length of segment data
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(EspSegmentHeader) == 8, "EspSegmentHeader must be 8 bytes");
+
+    // Internal segment info with file offset
+    struct SegmentInfo
+    {
+        uint32_t load_addr;
+        uint32_t data_len;
+        uint64_t file_offset;  // Offset in raw file where data starts
+    };
+
+    enum class ImageParseStatus
+    {
+        Ok,
+        TooShort,                // Fewer bytes than an EspImageHeader
+        BadMagic,                // Byte 0 is not ESP_IMAGE_HEADER_MAGIC
+        BadSegmentCount,         // Segment count is 0 or above ESP_IMAGE_MAX_SEGMENTS
+        TruncatedSegmentHeader,  // An EspSegmentHeader runs past the end of the data
+        TruncatedSegmentData,    // A segment's data_len runs past the end of the data
+        UnknownChip,             // Header chip id is not a supported chip (probe only)
+    };
+
+    const char* GetImageParseStatusString(ImageParseStatus status);
+
+    // Result of parsing an app image. Fixed-size so that parsing never allocates; segments beyond
+    // segment_count are left untouched.
+    struct ParsedImage
+    {
+        EspImageHeader header;
+        std::array<SegmentInfo, ESP_IMAGE_MAX_SEGMENTS> segments;
+        size_t segment_count;
+        uint64_t base_offset;     // Offset of the image header within the parsed data
+        uint64_t end_offset;      // Offset just past the data of the last segment
+        size_t failed_segment;    // Segment index that failed to parse, if any
+        uint64_t error_offset;    // Offset of the header or segment data that failed to parse, if any
+
+        std::span<const SegmentInfo> Segments() const { return {segments.data(), segment_count}; }
+        EspChipId ChipId() const { return static_cast<EspChipId>(header.chip_id); }
+    };
+
+    // Decode the 24-byte image header. `data` must hold at least sizeof(EspImageHeader) bytes.
+    void DecodeImageHeader(const uint8_t* data, EspImageHeader& out);
+
+    // Check only the fixed header fields (magic and segment count) of `data`
+    ImageParseStatus CheckImageHeader(std::span<const uint8_t> data);
+
+    // Reads exactly `length` bytes at `offset` into `dest`; returns false if they are not all available
+    using ImageProbeReader = bool (*)(void* context, uint64_t offset, void* dest, size_t length);
+
+    // Cheap but complete validity check for view type detection: validates the header and the chip id, then
+    // walks the whole segment chain checking the bounds of every segment header and its data against
+    // `length`. The header and first segment header come from a single bounded read; each later segment
+    // header is one 8-byte read. No allocation.
+    ImageParseStatus ProbeImage(uint64_t length, ImageProbeReader reader, void* context);
+    ImageParseStatus ProbeImage(std::span<const uint8_t> data);
+
+    // Parse the image header at `baseOffset` and walk the segment chain directly out of `data`. Segment
+    // file offsets are relative to the start of `data`, so images embedded in a flash dump keep their
+    // offsets within the dump. Nothing is copied besides the header fields. Total over any input: every
+    // read is bounds checked before it happens, at most ESP_IMAGE_MAX_SEGMENTS headers are read, and a
+    // failure leaves the segments parsed so far in `out` along with failed_segment and error_offset.
+    ImageParseStatus ParseImage(std::span<const uint8_t> data, ParsedImage& out, uint64_t baseOffset = 0);
+
+    // Same, for data of `length` bytes that is only reachable through `reader` (e.g. decrypted on demand):
+    // one read for the header and one per segment header
+    ImageParseStatus ParseImage(uint64_t length, ImageProbeReader reader, void* context, ParsedImage& out,
+        uint64_t baseOffset = 0);
+}  // namespace EspApp
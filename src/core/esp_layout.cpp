@@ -0,0 +1,179 @@
+#include "esp_layout.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace EspApp
+{
+    const char* GetSegmentMapStatusString(SegmentMapStatus status)
+    {
+        switch (status)
+        {
+        case SegmentMapStatus::Ok:
+            return "ok";
+        case SegmentMapStatus::NoRegion:
+            return "segment is not in any known memory region";
+        case SegmentMapStatus::SpansRegions:
+            return "segment spans multiple regions";
+        case SegmentMapStatus::ExceedsRegion:
+            return "segment exceeds its region boundary";
+        }
+        return "unknown";
+    }
+
+    RegionIndex::RegionIndex(const ChipAttr& attr)
+    {
+        m_regions.reserve(attr.region_count);
+        for (size_t i = 0; i < attr.region_count; i++)
+            m_regions.push_back(&attr.regions[i]);
+        sort(m_regions.begin(), m_regions.end(),
+            [](const MemoryRegion* a, const MemoryRegion* b) { return a->start_addr < b->start_addr; });
+    }
+
+    const MemoryRegion* RegionIndex::Find(uint64_t addr) const
+    {
+        // Last region starting at or below addr
+        auto it = upper_bound(m_regions.begin(), m_regions.end(), addr,
+            [](uint64_t value, const MemoryRegion* region) { return value < region->start_addr; });
+        if (it == m_regions.begin())
+            return nullptr;
+        const MemoryRegion* region = *(it - 1);
+        return addr < region->end_addr ? region : nullptr;
+    }
+
+    SegmentMapStatus MapSegmentsToRegions(
+        const RegionIndex& index, span<const SegmentInfo> segments, SegmentRegionMap& out)
+    {
+        out.segment_count = 0;
+        out.failed_segment = 0;
+        out.end_region = nullptr;
+
+        for (size_t i = 0; i < segments.size() && i < ESP_IMAGE_MAX_SEGMENTS; i++)
+        {
+            const auto& seg = segments[i];
+            uint64_t seg_start = seg.load_addr;
+            uint64_t seg_end = seg_start + seg.data_len;
+
+            const MemoryRegion* region = index.Find(seg_start);
+            if (!region)
+            {
+                out.failed_segment = i;
+                return SegmentMapStatus::NoRegion;
+            }
+
+            // Check if segment end is within the same region
+            if (seg_end > region->end_addr)
+            {
+                out.failed_segment = i;
+                out.regions[i] = region;
+                out.end_region = index.Find(seg_end - 1);
+                if (out.end_region && out.end_region != region)
+                    return SegmentMapStatus::SpansRegions;
+                return SegmentMapStatus::ExceedsRegion;
+            }
+
+            out.regions[i] = region;
+            out.segment_count = i + 1;
+        }
+        return SegmentMapStatus::Ok;
+    }
+
+    void LayoutPlan::Clear()
+    {
+        segments.clear();
+        sections.clear();
+        deferred_regions.clear();
+        file_backed_bytes = 0;
+        mapped_bytes = 0;
+    }
+
+    uint32_t GetRegionSectionSemantics(const MemoryRegion& region)
+    {
+        bool codeOnly = (region.flags & RegionContainsCode) && !(region.flags & RegionContainsData);
+        return codeOnly ? RegionReadOnlyCodeSemantics : RegionDefaultSemantics;
+    }
+
+    SegmentMapStatus PlanMemoryLayout(const RegionIndex& index, span<const SegmentInfo> segments,
+        SegmentRegionMap& map, LayoutPlan& plan, LayoutMode mode)
+    {
+        plan.Clear();
+
+        SegmentMapStatus status = MapSegmentsToRegions(index, segments, map);
+        if (status != SegmentMapStatus::Ok)
+            return status;
+
+        // App segments in address order; at most ESP_IMAGE_MAX_SEGMENTS so this stays on the stack
+        array<size_t, ESP_IMAGE_MAX_SEGMENTS> order;
+        size_t count = map.segment_count;
+        for (size_t i = 0; i < count; i++)
+            order[i] = i;
+        stable_sort(order.begin(), order.begin() + count,
+            [&](size_t a, size_t b) { return segments[a].load_addr < segments[b].load_addr; });
+
+        auto regions = index.GetRegions();
+        plan.segments.reserve(regions.size() + 2 * count);
+        plan.sections.reserve(regions.size() + 2 * count);
+
+        auto addRange = [&](string name, uint64_t start, uint64_t length, uint64_t dataOffset, uint64_t dataLength,
+                            const MemoryRegion& region, uint32_t semantics) {
+            plan.segments.push_back({start, length, dataOffset, dataLength, region.flags});
+            plan.sections.push_back({std::move(name), start, length, semantics});
+            plan.mapped_bytes += length;
+            plan.file_backed_bytes += dataLength;
+        };
+
+        // Merge sweep: regions and segments are both in address order, so each segment is visited once
+        size_t cursor = 0;
+        for (const MemoryRegion* region : regions)
+        {
+            uint32_t semantics = GetRegionSectionSemantics(*region);
+
+            if (cursor == count || map.regions[order[cursor]] != region)
+            {
+                if (mode == LayoutMode::Sparse)
+                {
+                    plan.deferred_regions.push_back(region);
+                    continue;
+                }
+
+                // No app segments in this region - add entire region as non-file-backed
+                addRange(region->name, region->start_addr, region->end_addr - region->start_addr, 0, 0, *region,
+                    semantics);
+                continue;
+            }
+
+            // Region has app segments - fragment the region
+            uint64_t currentAddr = region->start_addr;
+            size_t fragmentIndex = 0;
+            for (; cursor < count && map.regions[order[cursor]] == region; cursor++)
+            {
+                size_t segIndex = order[cursor];
+                const auto& seg = segments[segIndex];
+                uint64_t seg_start = seg.load_addr;
+                uint64_t seg_end = seg_start + seg.data_len;
+
+                // Add non-file-backed fragment before this app segment (if any gap)
+                if (currentAddr < seg_start)
+                {
+                    addRange(string(region->name) + ".frag." + to_string(fragmentIndex++), currentAddr,
+                        seg_start - currentAddr, 0, 0, *region, semantics);
+                }
+
+                // Add the file-backed app segment
+                addRange(string(region->name) + ".app." + to_string(segIndex), seg_start, seg.data_len,
+                    seg.file_offset, seg.data_len, *region, semantics);
+
+                currentAddr = max(currentAddr, seg_end);
+            }
+
+            // Add non-file-backed fragment after the last app segment (if any remainder)
+            if (currentAddr < region->end_addr)
+            {
+                addRange(string(region->name) + ".frag." + to_string(fragmentIndex), currentAddr,
+                    region->end_addr - currentAddr, 0, 0, *region, semantics);
+            }
+        }
+        return SegmentMapStatus::Ok;
+    }
+}  // namespace EspApp
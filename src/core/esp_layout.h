@@ -0,0 +1,98 @@
+#pragma once
+
+#include "esp_chip.h"
+#include "esp_image.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace EspApp
+{
+    // Regions of a chip ordered by start address, for O(log n) address lookup
+    class RegionIndex
+    {
+        std::vector<const MemoryRegion*> m_regions;
+
+    public:
+        RegionIndex() = default;
+        explicit RegionIndex(const ChipAttr& attr);
+
+        const MemoryRegion* Find(uint64_t addr) const;
+        std::span<const MemoryRegion* const> GetRegions() const { return m_regions; }
+    };
+
+    enum class SegmentMapStatus
+    {
+        Ok,
+        NoRegion,         // Segment start is not inside any region
+        SpansRegions,     // Segment starts in one region and ends in another
+        ExceedsRegion,    // Segment runs past the end of its region into unmapped space
+    };
+
+    const char* GetSegmentMapStatusString(SegmentMapStatus status);
+
+    // Result of assigning every app segment to the region that contains it
+    struct SegmentRegionMap
+    {
+        std::array<const MemoryRegion*, ESP_IMAGE_MAX_SEGMENTS> regions;
+        size_t segment_count;
+
+        // Details of the first segment that could not be mapped
+        size_t failed_segment;
+        const MemoryRegion* end_region;
+    };
+
+    // Each app segment must be fully contained within exactly one region of the chip
+    SegmentMapStatus MapSegmentsToRegions(
+        const RegionIndex& index, std::span<const SegmentInfo> segments, SegmentRegionMap& out);
+
+    // Section semantics of a region, the same whether it is mapped by the layout plan or later as a deferred
+    // region. Unified code/data regions (C6/H2/P4) keep default semantics so their rodata is not swept as code.
+    uint32_t GetRegionSectionSemantics(const MemoryRegion& region);
+
+    struct PlannedSegment
+    {
+        uint64_t start;
+        uint64_t length;
+        uint64_t data_offset;
+        uint64_t data_length;  // 0 for fragments that are not backed by the file
+        uint32_t flags;
+    };
+
+    struct PlannedSection
+    {
+        std::string name;
+        uint64_t start;
+        uint64_t length;
+        uint32_t semantics;
+    };
+
+    enum class LayoutMode
+    {
+        Full,    // Map every region of the chip
+        Sparse,  // Map only the regions that contain app segments; the rest are deferred
+    };
+
+    // Pure-data description of the view's memory map: every region of the chip, split around the app
+    // segments it contains. Segments and sections are in ascending address order.
+    struct LayoutPlan
+    {
+        std::vector<PlannedSegment> segments;
+        std::vector<PlannedSection> sections;
+        std::vector<const MemoryRegion*> deferred_regions;  // Sparse mode: regions left unmapped
+        uint64_t file_backed_bytes = 0;
+        uint64_t mapped_bytes = 0;
+
+        void Clear();
+    };
+
+    // Validate the app segments against the chip's regions and build the layout in one sweep over the
+    // regions and the address-sorted segments. On failure `map` describes the offending segment and the
+    // plan is left empty.
+    SegmentMapStatus PlanMemoryLayout(const RegionIndex& index, std::span<const SegmentInfo> segments,
+        SegmentRegionMap& map, LayoutPlan& plan, LayoutMode mode = LayoutMode::Full);
+}  // namespace EspApp
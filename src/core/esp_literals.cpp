@@ -0,0 +1,125 @@
+#include "esp_literals.h"
+#include "esp_endian.h"
+#include "esp_parallel.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace EspApp
+{
+    // Functions are handed to workers in batches to keep the per-item overhead negligible
+    static constexpr size_t FUNCTIONS_PER_BATCH = 256;
+
+    // A function body longer than this is a missing start, not a real function; stop decoding there
+    static constexpr uint32_t MAX_FUNCTION_SIZE = 64 * 1024;
+
+    static const CodeRange* FindRange(span<const CodeRange> ranges, uint32_t addr)
+    {
+        // Ranges are sorted by load address
+        auto it = upper_bound(ranges.begin(), ranges.end(), addr,
+            [](uint32_t a, const CodeRange& range) { return a < range.load_addr; });
+        if (it == ranges.begin())
+            return nullptr;
+        --it;
+        return addr - it->load_addr < it->length ? &*it : nullptr;
+    }
+
+    LiteralScanResult ResolveXtensaLiterals(span<const uint8_t> data, span<const CodeRange> ranges,
+        span<const uint32_t> functionStarts, size_t maxThreads)
+    {
+        vector<CodeRange> sortedRanges;
+        for (const CodeRange& range : ranges)
+        {
+            if (range.file_offset >= data.size())
+                continue;
+            CodeRange clamped = range;
+            clamped.length = min<uint64_t>(range.length, data.size() - range.file_offset);
+            sortedRanges.push_back(clamped);
+        }
+        sort(sortedRanges.begin(), sortedRanges.end(),
+            [](const CodeRange& a, const CodeRange& b) { return a.load_addr < b.load_addr; });
+
+        size_t batches = (functionStarts.size() + FUNCTIONS_PER_BATCH - 1) / FUNCTIONS_PER_BATCH;
+        vector<vector<LiteralLoad>> results(batches);
+        ParallelFor(batches, [&](size_t batch) {
+            size_t first = batch * FUNCTIONS_PER_BATCH;
+            size_t last = min(functionStarts.size(), first + FUNCTIONS_PER_BATCH);
+            for (size_t f = first; f < last; f++)
+            {
+                uint32_t start = functionStarts[f];
+                const CodeRange* range = FindRange(sortedRanges, start);
+                if (!range)
+                    continue;
+
+                uint64_t rangeEnd = uint64_t(range->load_addr) + range->length;
+                uint64_t end = min<uint64_t>(rangeEnd, uint64_t(start) + MAX_FUNCTION_SIZE);
+                if (f + 1 < functionStarts.size())
+                    end = min<uint64_t>(end, functionStarts[f + 1]);
+
+                const uint8_t* code = data.data() + range->file_offset;
+                for (uint64_t pc = start; pc + 2 <= end;)
+                {
+                    const uint8_t* insn = code + (pc - range->load_addr);
+                    uint8_t op0 = insn[0] & 0x0F;
+                    if (op0 >= 8)
+                    {
+                        pc += 2;
+                        continue;
+                    }
+                    if (pc + 3 > rangeEnd)
+                        break;
+
+                    // L32R at, label: op0 = 1, imm16 in bits 23:8, always a backwards, word aligned reference
+                    if (op0 == 1)
+                    {
+                        uint32_t imm16 = insn[1] | (uint32_t(insn[2]) << 8);
+                        uint32_t literal = static_cast<uint32_t>(((pc + 3) & ~uint64_t(3)) +
+                            (int64_t(int32_t(imm16 | 0xFFFF0000u)) << 2));
+                        const CodeRange* literalRange = FindRange(sortedRanges, literal);
+                        if (literalRange && literal - literalRange->load_addr + 4 <= literalRange->length)
+                        {
+                            uint32_t value = LoadLE32(data.data() + literalRange->file_offset +
+                                (literal - literalRange->load_addr));
+                            results[batch].push_back({static_cast<uint32_t>(pc), literal, value});
+                        }
+                    }
+                    pc += 3;
+                }
+            }
+        }, maxThreads);
+
+        LiteralScanResult out;
+        for (const auto& batch : results)
+            out.loads.insert(out.loads.end(), batch.begin(), batch.end());
+
+        auto collectLiterals = [&]() {
+            out.literals.clear();
+            for (const LiteralLoad& load : out.loads)
+                out.literals.push_back(load.literal_addr);
+            sort(out.literals.begin(), out.literals.end());
+            out.literals.erase(unique(out.literals.begin(), out.literals.end()), out.literals.end());
+        };
+        collectLiterals();
+
+        // The walk up to the next start also decodes the next function's literal pool. Loads decoded out of
+        // a word that real loads use as a literal are artifacts of that, not code.
+        auto isLiteral = [&](uint32_t addr) { return binary_search(out.literals.begin(), out.literals.end(), addr); };
+        erase_if(out.loads, [&](const LiteralLoad& load) {
+            return isLiteral(load.insn_addr & ~3u) || isLiteral((load.insn_addr + 2) & ~3u);
+        });
+        collectLiterals();
+
+        // Literal values that land on an entry instruction are functions reached through callx
+        for (const LiteralLoad& load : out.loads)
+        {
+            const CodeRange* target = FindRange(sortedRanges, load.value);
+            if (target && load.value - target->load_addr + 3 <= target->length && (load.value & 3) == 0 &&
+                IsXtensaEntry(data.data() + target->file_offset + (load.value - target->load_addr)))
+                out.code_pointers.push_back(load.value);
+        }
+        sort(out.code_pointers.begin(), out.code_pointers.end());
+        out.code_pointers.erase(unique(out.code_pointers.begin(), out.code_pointers.end()), out.code_pointers.end());
+        return out;
+    }
+}  // namespace EspApp
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "esp_prologue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    // One L32R instruction and the literal it loads
+    struct LiteralLoad
+    {
+        uint32_t insn_addr;
+        uint32_t literal_addr;
+        uint32_t value;
+    };
+
+    // Literals found by a resolver pass, deduplicated by literal address where noted
+    struct LiteralScanResult
+    {
+        std::vector<LiteralLoad> loads;        // Every resolved L32R, ascending instruction address
+        std::vector<uint32_t> literals;        // Distinct literal addresses, ascending
+        std::vector<uint32_t> code_pointers;   // Distinct literal values that point at an `entry` in code
+    };
+
+    // Decode the Xtensa instruction stream of every function in `functionStarts` (ascending), up to the next
+    // start or the end of its range, and resolve each L32R whose literal lies in one of `ranges`. Functions
+    // are decoded in parallel. Instruction lengths follow the density option: op0 >= 8 is a 16-bit
+    // instruction, everything else 24-bit.
+    LiteralScanResult ResolveXtensaLiterals(std::span<const uint8_t> data, std::span<const CodeRange> ranges,
+        std::span<const uint32_t> functionStarts, size_t maxThreads = 0);
+}  // namespace EspApp
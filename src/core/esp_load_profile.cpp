@@ -0,0 +1,70 @@
+#include "esp_load_profile.h"
+
+using namespace std;
+
+namespace EspApp
+{
+    const char* GetLoadPhaseName(LoadPhase phase)
+    {
+        switch (phase)
+        {
+        case LoadPhase::Parse:
+            return "parse";
+        case LoadPhase::Plan:
+            return "plan";
+        case LoadPhase::Map:
+            return "map";
+        case LoadPhase::Platform:
+            return "platform";
+        case LoadPhase::Functions:
+            return "functions";
+        case LoadPhase::Symbols:
+            return "symbols";
+        case LoadPhase::PostInit:
+            return "post_init";
+        case LoadPhase::Seeds:
+            return "seeds";
+        default:
+            break;
+        }
+        return "unknown";
+    }
+
+    uint64_t LoadProfile::GetTotalNanoseconds() const
+    {
+        uint64_t total = 0;
+        for (uint64_t ns : phase_ns)
+            total += ns;
+        return total;
+    }
+
+    void LoadProfile::AddLayout(const LayoutPlan& plan)
+    {
+        segments_created += plan.segments.size();
+        sections_created += plan.sections.size();
+        bytes_mapped += plan.mapped_bytes;
+        file_backed_bytes += plan.file_backed_bytes;
+    }
+
+    string LoadProfile::ToJson() const
+    {
+        string out = "{";
+        auto append = [&](const string& key, uint64_t value) {
+            if (out.size() > 1)
+                out += ',';
+            out += '"' + key + "\":" + to_string(value);
+        };
+
+        for (size_t i = 0; i < phase_ns.size(); i++)
+            append(string(GetLoadPhaseName(static_cast<LoadPhase>(i))) + "_ns", phase_ns[i]);
+        append("total_ns", GetTotalNanoseconds());
+        append("image_bytes", image_bytes);
+        append("segments_created", segments_created);
+        append("sections_created", sections_created);
+        append("bytes_mapped", bytes_mapped);
+        append("file_backed_bytes", file_backed_bytes);
+        append("function_starts", function_starts);
+        out += '}';
+        return out;
+    }
+}  // namespace EspApp
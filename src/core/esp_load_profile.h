@@ -0,0 +1,71 @@
+#pragma once
+
+#include "esp_layout.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace EspApp
+{
+    // Phases of loading an image into a view, in the order they run
+    enum class LoadPhase
+    {
+        Parse,      // Header, segment chain (or flash dump scan) and app description
+        Plan,       // Step 1 and 2: segment validation and region fragmentation
+        Map,        // Adding the planned segments and sections to the view
+        Platform,   // Step 3: architecture and platform setup
+        Functions,  // Entry point and prologue scan
+        Symbols,    // App description type, ROM symbols and peripherals
+        PostInit,   // Chip specific post_init hook
+        Seeds,      // Step 4: analysis seed cache
+        Count
+    };
+
+    const char* GetLoadPhaseName(LoadPhase phase);
+
+    // Wall time per load phase and what the load created. Cheap enough to fill in on every load.
+    struct LoadProfile
+    {
+        std::array<uint64_t, static_cast<size_t>(LoadPhase::Count)> phase_ns {};
+        uint64_t image_bytes = 0;
+        uint64_t segments_created = 0;
+        uint64_t sections_created = 0;
+        uint64_t bytes_mapped = 0;
+        uint64_t file_backed_bytes = 0;
+        uint64_t function_starts = 0;  // Found by the prologue scan
+
+        uint64_t GetPhaseNanoseconds(LoadPhase phase) const { return phase_ns[static_cast<size_t>(phase)]; }
+        uint64_t GetTotalNanoseconds() const;
+
+        // Count the segments, sections and bytes a layout plan adds
+        void AddLayout(const LayoutPlan& plan);
+
+        // Single-line JSON object, e.g. {"parse_ns":1200,...,"total_ns":5400,"segments_created":9,...}
+        std::string ToJson() const;
+    };
+
+    // Adds the lifetime of the timer to one phase of `profile`
+    class ScopedPhaseTimer
+    {
+        LoadProfile& m_profile;
+        LoadPhase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+
+    public:
+        ScopedPhaseTimer(LoadProfile& profile, LoadPhase phase) :
+            m_profile(profile), m_phase(phase), m_start(std::chrono::steady_clock::now())
+        {}
+        ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+        ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+        ~ScopedPhaseTimer()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_profile.phase_ns[static_cast<size_t>(m_phase)] +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        }
+    };
+}  // namespace EspApp
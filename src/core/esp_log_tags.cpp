@@ -0,0 +1,459 @@
+#include "esp_log_tags.h"
+#include "esp_endian.h"
+#include "esp_literals.h"
+#include "esp_parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ESP_LOG_TAGS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ESP_LOG_TAGS_NEON 1
+#endif
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr uint64_t STRING_CHUNK_SIZE = 256 * 1024;
+    static constexpr size_t FUNCTIONS_PER_BATCH = 256;
+    static constexpr uint32_t MAX_FUNCTION_SIZE = 64 * 1024;
+    static constexpr size_t MAX_TAG_LENGTH = 32;
+
+    static bool IsTextByte(uint8_t c)
+    {
+        return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n' || c == '\r' || c == 0x1B;
+    }
+
+    // Bitmask of the positions in p[0, 16) holding text bytes
+    static uint32_t MatchText16(const uint8_t* p)
+    {
+#if defined(ESP_LOG_TAGS_SSE2)
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Signed compares: bytes >= 0x80 are negative and fail the lower bound
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1F)),
+            _mm_cmplt_epi8(v, _mm_set1_epi8(0x7F)));
+        __m128i control = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))), _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(0x1B))));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(printable, control)));
+#elif defined(ESP_LOG_TAGS_NEON)
+        uint8x16_t v = vld1q_u8(p);
+        uint8x16_t printable = vandq_u8(vcgtq_u8(v, vdupq_n_u8(0x1F)), vcltq_u8(v, vdupq_n_u8(0x7F)));
+        uint8x16_t control = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('\t')), vceqq_u8(v, vdupq_n_u8('\n'))),
+            vorrq_u8(vceqq_u8(v, vdupq_n_u8('\r')), vceqq_u8(v, vdupq_n_u8(0x1B))));
+        static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t masked = vandq_u8(vorrq_u8(printable, control), vld1q_u8(bits));
+        return vaddv_u8(vget_low_u8(masked)) | (uint32_t(vaddv_u8(vget_high_u8(masked))) << 8);
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < 16; i++)
+            mask |= uint32_t(IsTextByte(p[i])) << i;
+        return mask;
+#endif
+    }
+
+    // Strings starting in [begin, end) of one range; the last one may run past `end`
+    static void ScanStringChunk(span<const uint8_t> data, const CodeRange& range, uint64_t begin, uint64_t end,
+        size_t minLength, vector<FoundString>& out)
+    {
+        const uint8_t* p = data.data() + range.file_offset;
+        uint64_t length = range.length;
+
+        // The text the chunk opens with belongs to a string of the previous chunk
+        uint64_t pos = begin;
+        if (pos > 0 && IsTextByte(p[pos - 1]))
+        {
+            while (pos < length && IsTextByte(p[pos]))
+                pos++;
+            pos++;
+        }
+
+        uint64_t runStart = pos;
+        while (pos < length && runStart < end)
+        {
+            uint32_t other = 0;
+            uint64_t n = 16;
+            if (pos + 16 <= length)
+            {
+                other = ~MatchText16(p + pos) & 0xFFFF;
+            }
+            else
+            {
+                n = length - pos;
+                for (uint64_t i = 0; i < n; i++)
+                    other |= uint32_t(!IsTextByte(p[pos + i])) << i;
+            }
+
+            // Every non-text byte ends the current run; only a NUL makes it a string
+            while (other && runStart < end)
+            {
+                uint64_t at = pos + countr_zero(other);
+                other &= other - 1;
+                if (p[at] == 0 && at - runStart >= minLength)
+                {
+                    out.push_back({range.load_addr + static_cast<uint32_t>(runStart),
+                        static_cast<uint32_t>(at - runStart), range.file_offset + runStart});
+                }
+                runStart = at + 1;
+            }
+            pos += n;
+        }
+    }
+
+    vector<FoundString> FindStrings(span<const uint8_t> data, span<const CodeRange> ranges, size_t minLength,
+        size_t maxThreads)
+    {
+        struct Chunk
+        {
+            CodeRange range;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        vector<Chunk> chunks;
+        for (const CodeRange& range : ranges)
+        {
+            if (range.file_offset >= data.size())
+                continue;
+            CodeRange clamped = range;
+            clamped.length = min<uint64_t>(range.length, data.size() - range.file_offset);
+            for (uint64_t at = 0; at < clamped.length; at += STRING_CHUNK_SIZE)
+                chunks.push_back({clamped, at, min(clamped.length, at + STRING_CHUNK_SIZE)});
+        }
+
+        vector<vector<FoundString>> results(chunks.size());
+        ParallelFor(chunks.size(), [&](size_t i) {
+            ScanStringChunk(data, chunks[i].range, chunks[i].begin, chunks[i].end, max<size_t>(minLength, 1),
+                results[i]);
+        }, maxThreads);
+
+        vector<FoundString> out;
+        for (const auto& found : results)
+            out.insert(out.end(), found.begin(), found.end());
+        sort(out.begin(), out.end(), [](const FoundString& a, const FoundString& b) { return a.addr < b.addr; });
+        return out;
+    }
+
+    char ParseLogFormat(string_view text, string_view* body)
+    {
+        // LOG_COLOR_x: "\033[0;31m" and the like
+        size_t i = 0;
+        if (text.starts_with("\x1b["))
+        {
+            i = text.find('m');
+            if (i == string_view::npos || i > 8)
+                return 0;
+            i++;
+        }
+
+        if (i + 4 > text.size() || !strchr("EWIDV", text[i]) || text.substr(i + 1, 3) != " (%")
+            return 0;
+
+        // The timestamp conversion is %lu, %u or %d depending on the ESP-IDF version
+        size_t close = text.find(") %s: ", i + 4);
+        if (close == string_view::npos || close > i + 8)
+            return 0;
+
+        if (body)
+            *body = text.substr(close + 6);
+        return text[i];
+    }
+
+    static const CodeRange* FindRange(span<const CodeRange> ranges, uint32_t addr)
+    {
+        // Ranges are sorted by load address
+        auto it = upper_bound(ranges.begin(), ranges.end(), addr,
+            [](uint32_t a, const CodeRange& range) { return a < range.load_addr; });
+        if (it == ranges.begin())
+            return nullptr;
+        --it;
+        return addr - it->load_addr < it->length ? &*it : nullptr;
+    }
+
+    // Track LUI/AUIPC results per register through one function and report each ADDI that completes an
+    // address. Calls and any other write to a register forget what it held.
+    static void FindRiscVReferences(const uint8_t* code, uint32_t loadAddr, uint64_t start, uint64_t end,
+        vector<CodeReference>& out)
+    {
+        uint32_t regs[32] = {};
+        uint32_t known = 0;
+        auto set = [&](uint32_t reg, uint32_t value) {
+            if (reg == 0)
+                return;
+            regs[reg] = value;
+            known |= 1u << reg;
+        };
+        auto clear = [&](uint32_t reg) { known &= ~(1u << reg); };
+        auto isKnown = [&](uint32_t reg) { return reg != 0 && (known >> reg) & 1; };
+
+        for (uint64_t pc = start; pc + 2 <= end;)
+        {
+            const uint8_t* insn = code + (pc - loadAddr);
+            uint16_t h = LoadLE16(insn);
+            if ((h & 3) == 3)
+            {
+                if (pc + 4 > end)
+                    break;
+                uint32_t w = LoadLE32(insn);
+                uint32_t rd = (w >> 7) & 0x1F;
+                uint32_t rs1 = (w >> 15) & 0x1F;
+                switch (w & 0x7F)
+                {
+                case 0x37:  // lui
+                    set(rd, w & 0xFFFFF000);
+                    break;
+                case 0x17:  // auipc
+                    set(rd, static_cast<uint32_t>(pc) + (w & 0xFFFFF000));
+                    break;
+                case 0x13:  // addi
+                    if (((w >> 12) & 7) == 0 && isKnown(rs1))
+                    {
+                        uint32_t value = regs[rs1] + static_cast<uint32_t>(int32_t(w) >> 20);
+                        out.push_back({static_cast<uint32_t>(pc), value});
+                        set(rd, value);
+                    }
+                    else
+                    {
+                        clear(rd);
+                    }
+                    break;
+                case 0x23:  // stores and branches write no register
+                case 0x63:
+                    break;
+                case 0x6F:  // jal, jalr
+                case 0x67:
+                    known = 0;
+                    break;
+                default:
+                    clear(rd);
+                    break;
+                }
+                pc += 4;
+                continue;
+            }
+
+            uint32_t quadrant = h & 3;
+            uint32_t funct3 = h >> 13;
+            uint32_t rd = (h >> 7) & 0x1F;
+            uint32_t imm6 = ((h >> 12) & 1) << 5 | ((h >> 2) & 0x1F);
+            if (quadrant == 1 && funct3 == 3 && rd != 0 && rd != 2)
+            {
+                // c.lui: nzimm[17:12]
+                set(rd, static_cast<uint32_t>(int32_t(imm6 << 26) >> 14));
+            }
+            else if (quadrant == 1 && funct3 == 0 && isKnown(rd))
+            {
+                // c.addi
+                uint32_t value = regs[rd] + static_cast<uint32_t>(int32_t(imm6 << 26) >> 26);
+                out.push_back({static_cast<uint32_t>(pc), value});
+                set(rd, value);
+            }
+            else if ((quadrant == 1 && (funct3 == 1 || funct3 == 5)) ||
+                (quadrant == 2 && funct3 == 4 && (h & 0x107C) == 0x1000 && rd != 0))
+            {
+                // c.jal, c.j, c.jalr
+                known = 0;
+            }
+            else
+            {
+                // Whichever register field this format writes
+                clear(rd);
+                clear(8 + ((h >> 7) & 7));
+                clear(8 + ((h >> 2) & 7));
+            }
+            pc += 2;
+        }
+    }
+
+    vector<CodeReference> FindCodeReferences(span<const uint8_t> data, span<const CodeRange> codeRanges,
+        PrologueArch arch, span<const uint32_t> functionStarts, size_t maxThreads)
+    {
+        vector<CodeReference> out;
+        if (arch == PrologueArch::Xtensa)
+        {
+            LiteralScanResult literals = ResolveXtensaLiterals(data, codeRanges, functionStarts, maxThreads);
+            out.reserve(literals.loads.size());
+            for (const LiteralLoad& load : literals.loads)
+                out.push_back({load.insn_addr, load.value});
+            return out;
+        }
+        if (arch != PrologueArch::RiscV)
+            return out;
+
+        vector<CodeRange> sortedRanges;
+        for (const CodeRange& range : codeRanges)
+        {
+            if (range.file_offset >= data.size())
+                continue;
+            CodeRange clamped = range;
+            clamped.length = min<uint64_t>(range.length, data.size() - range.file_offset);
+            sortedRanges.push_back(clamped);
+        }
+        sort(sortedRanges.begin(), sortedRanges.end(),
+            [](const CodeRange& a, const CodeRange& b) { return a.load_addr < b.load_addr; });
+
+        size_t batches = (functionStarts.size() + FUNCTIONS_PER_BATCH - 1) / FUNCTIONS_PER_BATCH;
+        vector<vector<CodeReference>> results(batches);
+        ParallelFor(batches, [&](size_t batch) {
+            size_t first = batch * FUNCTIONS_PER_BATCH;
+            size_t last = min(functionStarts.size(), first + FUNCTIONS_PER_BATCH);
+            for (size_t f = first; f < last; f++)
+            {
+                uint32_t start = functionStarts[f];
+                const CodeRange* range = FindRange(sortedRanges, start);
+                if (!range)
+                    continue;
+
+                uint64_t end = min<uint64_t>(uint64_t(range->load_addr) + range->length,
+                    uint64_t(start) + MAX_FUNCTION_SIZE);
+                if (f + 1 < functionStarts.size())
+                    end = min<uint64_t>(end, functionStarts[f + 1]);
+                FindRiscVReferences(data.data() + range->file_offset, range->load_addr, start, end, results[batch]);
+            }
+        }, maxThreads);
+
+        for (const auto& batch : results)
+            out.insert(out.end(), batch.begin(), batch.end());
+        return out;
+    }
+
+    // Short and identifier-like, without spaces or conversions: "wifi", "BT_HCI", "esp-tls", "nvs.flash"
+    static bool IsTagLike(string_view text)
+    {
+        if (text.empty() || text.size() > MAX_TAG_LENGTH)
+            return false;
+        bool letter = false;
+        for (char c : text)
+        {
+            if (isalpha(static_cast<unsigned char>(c)))
+                letter = true;
+            else if (!isdigit(static_cast<unsigned char>(c)) && !strchr("_-./:", c))
+                return false;
+        }
+        return letter;
+    }
+
+    static bool IsIdentifier(string_view text)
+    {
+        if (text.empty() || isdigit(static_cast<unsigned char>(text[0])))
+            return false;
+        return all_of(text.begin(), text.end(),
+            [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+    }
+
+    vector<LogTagProposal> MineLogTags(span<const uint8_t> data, span<const CodeRange> codeRanges,
+        span<const CodeRange> dataRanges, PrologueArch arch, span<const uint32_t> functionStarts, size_t maxThreads)
+    {
+        vector<FoundString> strings = FindStrings(data, dataRanges, 1, maxThreads);
+        vector<CodeReference> refs = FindCodeReferences(data, codeRanges, arch, functionStarts, maxThreads);
+
+        // The text a reference points at; the linker merges string tails, so it may start inside a string
+        auto getText = [&](uint32_t addr) -> string_view {
+            auto it = upper_bound(strings.begin(), strings.end(), addr,
+                [](uint32_t a, const FoundString& s) { return a < s.addr; });
+            if (it == strings.begin())
+                return {};
+            --it;
+            uint32_t skip = addr - it->addr;
+            if (skip >= it->length)
+                return {};
+            return string_view(reinterpret_cast<const char*>(data.data() + it->file_offset + skip), it->length - skip);
+        };
+
+        struct LoggingFunction
+        {
+            uint32_t start;
+            uint32_t log_calls = 0;
+            bool names_itself = false;  // A format starts with "%s", usually __func__
+            vector<uint32_t> candidates;
+        };
+
+        // References come in ascending instruction order, so each function's references are contiguous
+        vector<LoggingFunction> functions;
+        for (size_t i = 0; i < refs.size();)
+        {
+            auto owner = upper_bound(functionStarts.begin(), functionStarts.end(), refs[i].insn_addr);
+            if (owner == functionStarts.begin())
+            {
+                i++;
+                continue;
+            }
+            uint32_t start = *(owner - 1);
+            uint64_t next = owner == functionStarts.end() ? UINT64_MAX : *owner;
+
+            LoggingFunction func {};
+            func.start = start;
+            for (; i < refs.size() && refs[i].insn_addr < next; i++)
+            {
+                string_view text = getText(refs[i].target);
+                string_view body;
+                if (ParseLogFormat(text, &body))
+                {
+                    func.log_calls++;
+                    func.names_itself |= body.starts_with("%s");
+                }
+                else if (IsTagLike(text))
+                {
+                    func.candidates.push_back(refs[i].target);
+                }
+            }
+            if (!func.log_calls)
+                continue;
+            sort(func.candidates.begin(), func.candidates.end());
+            func.candidates.erase(unique(func.candidates.begin(), func.candidates.end()), func.candidates.end());
+            functions.push_back(std::move(func));
+        }
+
+        // How many logging functions reference each candidate
+        map<uint32_t, uint32_t> shared;
+        for (const auto& func : functions)
+        {
+            for (uint32_t addr : func.candidates)
+                shared[addr]++;
+        }
+
+        vector<LogTagProposal> out;
+        for (const auto& func : functions)
+        {
+            uint32_t tag = 0;
+            uint32_t best = 0;
+            for (uint32_t addr : func.candidates)
+            {
+                if (shared[addr] > best)
+                {
+                    tag = addr;
+                    best = shared[addr];
+                }
+            }
+            if (!best)
+                continue;
+
+            LogTagProposal proposal {func.start, string(getText(tag)), {}, func.log_calls};
+            if (func.names_itself)
+            {
+                // __func__ is referenced by this function alone; with several such strings it is a guess
+                size_t names = 0;
+                for (uint32_t addr : func.candidates)
+                {
+                    string_view text = getText(addr);
+                    if (addr != tag && shared[addr] == 1 && IsIdentifier(text))
+                    {
+                        proposal.name = text;
+                        names++;
+                    }
+                }
+                if (names != 1)
+                    proposal.name.clear();
+            }
+            out.push_back(std::move(proposal));
+        }
+        return out;
+    }
+}  // namespace EspApp
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "esp_prologue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EspApp
+{
+    // NUL-terminated run of text (printable ASCII, tab, CR, LF and ESC) in a data segment
+    struct FoundString
+    {
+        uint32_t addr;
+        uint32_t length;  // Without the NUL
+        uint64_t file_offset;
+    };
+
+    // Every string of at least `minLength` characters in the ranges, ascending. Ranges are split into chunks
+    // that are scanned in parallel, 16 bytes at a time with SIMD compares where available.
+    std::vector<FoundString> FindStrings(std::span<const uint8_t> data, std::span<const CodeRange> ranges,
+        size_t minLength, size_t maxThreads = 0);
+
+    // ESP_LOGx format strings as expanded by LOG_FORMAT(): an optional color escape, the level letter and
+    // the timestamp, then "%s: " for the tag. Returns the level letter (E, W, I, D or V) and sets `body` to
+    // the caller's part of the format, or returns 0 if `text` is not a log format.
+    char ParseLogFormat(std::string_view text, std::string_view* body = nullptr);
+
+    // An instruction that materializes an address: Xtensa L32R, or a RISC-V LUI/AUIPC + ADDI pair
+    struct CodeReference
+    {
+        uint32_t insn_addr;
+        uint32_t target;
+    };
+
+    // Address references made by the functions in `functionStarts` (ascending), in ascending instruction
+    // address order. Functions are decoded in parallel up to the next start or the end of their range.
+    std::vector<CodeReference> FindCodeReferences(std::span<const uint8_t> data, std::span<const CodeRange> codeRanges,
+        PrologueArch arch, std::span<const uint32_t> functionStarts, size_t maxThreads = 0);
+
+    // Names for one function that logs
+    struct LogTagProposal
+    {
+        uint32_t function;
+        std::string tag;     // The TAG it passes to esp_log_write, i.e. its component
+        std::string name;    // Its __func__ when a "%s..." format names it, otherwise empty
+        uint32_t log_calls;  // Log format strings it references
+    };
+
+    // Find the log format strings in `dataRanges`, the functions that reference them and the tag string each
+    // of those functions passes along. A function's tag is the short identifier-like string it references
+    // that the most logging functions share, which is what a per-file `static const char* TAG` looks like.
+    std::vector<LogTagProposal> MineLogTags(std::span<const uint8_t> data, std::span<const CodeRange> codeRanges,
+        std::span<const CodeRange> dataRanges, PrologueArch arch, std::span<const uint32_t> functionStarts,
+        size_t maxThreads = 0);
+}  // namespace EspApp
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace EspApp
+{
+    // Read-only memory mapping of a whole file. Move-only; the mapping is released on destruction.
+    class MappedFile
+    {
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_open = false;
+#ifdef _WIN32
+        void* m_fileHandle = nullptr;
+        void* m_mappingHandle = nullptr;
+#endif
+
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        // Map `path` read-only. Returns false (leaving the object closed) if the file cannot be opened
+        // or mapped. Empty files open successfully with an empty span.
+        bool Open(const std::string& path);
+        void Close();
+
+        bool IsOpen() const { return m_open; }
+        const uint8_t* GetData() const { return m_data; }
+        size_t GetSize() const { return m_size; }
+        std::span<const uint8_t> GetSpan() const { return {m_data, m_size}; }
+    };
+}  // namespace EspApp
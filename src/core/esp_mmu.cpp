@@ -0,0 +1,226 @@
+#include "esp_mmu.h"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+namespace EspApp
+{
+    // Flash windows follow the SOC_IROM/DROM_LOW/HIGH ranges of ESP-IDF's soc.h, limited to the regions the
+    // chip tables map
+    static constexpr MmuWindow g_esp32MmuWindows[] = {
+        {0x3F400000, 0x3F800000, MmuBus::Data},
+        {0x400D0000, 0x40400000, MmuBus::Instruction},
+    };
+
+    static constexpr MmuWindow g_esp32s2MmuWindows[] = {
+        {0x3F000000, 0x3F3F0000, MmuBus::Data},
+        {0x40080000, 0x40800000, MmuBus::Instruction},
+    };
+
+    static constexpr MmuWindow g_esp32s3MmuWindows[] = {
+        {0x3C000000, 0x3E000000, MmuBus::Data},
+        {0x42000000, 0x44000000, MmuBus::Instruction},
+    };
+
+    static constexpr MmuWindow g_esp32c2MmuWindows[] = {
+        {0x3C000000, 0x3C400000, MmuBus::Data},
+        {0x42000000, 0x42400000, MmuBus::Instruction},
+    };
+
+    static constexpr MmuWindow g_esp32c3MmuWindows[] = {
+        {0x3C000000, 0x3C800000, MmuBus::Data},
+        {0x42000000, 0x42800000, MmuBus::Instruction},
+    };
+
+    static constexpr MmuWindow g_esp32c6MmuWindows[] = {
+        {0x42000000, 0x43000000, MmuBus::Both},
+    };
+
+    static constexpr MmuWindow g_esp32p4MmuWindows[] = {
+        {0x40000000, 0x44000000, MmuBus::Both},
+    };
+
+    span<const MmuWindow> GetFlashMmuWindows(EspChipId chipId)
+    {
+        switch (chipId)
+        {
+        case EspChipId::ESP32:
+            return g_esp32MmuWindows;
+        case EspChipId::ESP32_S2:
+            return g_esp32s2MmuWindows;
+        case EspChipId::ESP32_S3:
+            return g_esp32s3MmuWindows;
+        case EspChipId::ESP32_C2:
+            return g_esp32c2MmuWindows;
+        case EspChipId::ESP32_C3:
+            return g_esp32c3MmuWindows;
+        case EspChipId::ESP32_C6:
+        case EspChipId::ESP32_H2:
+            return g_esp32c6MmuWindows;
+        case EspChipId::ESP32_P4:
+            return g_esp32p4MmuWindows;
+        default:
+            return {};
+        }
+    }
+
+    bool FlashMmu::Init(EspChipId chipId, uint32_t pageSize)
+    {
+        Clear();
+        if (!has_single_bit(pageSize))
+            return false;
+        m_windows = GetFlashMmuWindows(chipId);
+        m_pageSize = pageSize;
+        for (const MmuWindow& window : m_windows)
+        {
+            m_windowSlots.push_back(m_slotCount);
+            m_slotCount += (window.end_addr - window.start_addr) / pageSize;
+        }
+        return !m_windows.empty();
+    }
+
+    void FlashMmu::Clear()
+    {
+        m_windows = {};
+        m_windowSlots.clear();
+        m_slotCount = 0;
+        m_apps.clear();
+        m_flashPages.clear();
+    }
+
+    bool FlashMmu::FindSlot(uint32_t addr, uint32_t& slot, size_t* window) const
+    {
+        for (size_t i = 0; i < m_windows.size(); i++)
+        {
+            if (addr < m_windows[i].start_addr || addr >= m_windows[i].end_addr)
+                continue;
+            slot = m_windowSlots[i] + (addr - m_windows[i].start_addr) / m_pageSize;
+            if (window)
+                *window = i;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t FlashMmu::GetSlotAddress(uint32_t slot) const
+    {
+        size_t i = m_windows.size() - 1;
+        while (i > 0 && m_windowSlots[i] > slot)
+            i--;
+        return m_windows[i].start_addr + (slot - m_windowSlots[i]) * m_pageSize;
+    }
+
+    size_t FlashMmu::AddApp()
+    {
+        m_apps.emplace_back(m_slotCount, NO_PAGE);
+        return m_apps.size() - 1;
+    }
+
+    bool FlashMmu::Map(size_t app, uint32_t addr, uint64_t flashOffset, uint64_t size)
+    {
+        uint32_t pageOffset = addr & (m_pageSize - 1);
+        uint32_t firstSlot;
+        size_t window;
+        if (app >= m_apps.size() || size == 0 || flashOffset < pageOffset || !FindSlot(addr, firstSlot, &window))
+            return false;
+
+        // The bootloader maps whole pages: the one holding the first byte and every page up to the last,
+        // here limited to the end of the window
+        uint64_t firstPage = (flashOffset - pageOffset) / m_pageSize;
+        uint64_t pageCount = (size + pageOffset + m_pageSize - 1) / m_pageSize;
+        uint32_t windowEndSlot = window + 1 < m_windowSlots.size() ? m_windowSlots[window + 1] : m_slotCount;
+        pageCount = min<uint64_t>(pageCount, windowEndSlot - firstSlot);
+        if (firstPage + pageCount >= NO_PAGE)
+            return false;
+        if (m_flashPages.size() < firstPage + pageCount)
+            m_flashPages.resize(firstPage + pageCount);
+
+        uint8_t bus = static_cast<uint8_t>(m_windows[window].bus);
+        for (uint32_t i = 0; i < pageCount; i++)
+        {
+            uint32_t slot = firstSlot + i;
+            uint32_t flashPage = static_cast<uint32_t>(firstPage + i);
+            m_apps[app][slot] = flashPage;
+
+            // A flash page keeps the first mapping on each bus; IROM and DROM may share the page between them
+            FlashPage& page = m_flashPages[flashPage];
+            if ((bus & static_cast<uint8_t>(MmuBus::Data)) && page.data_slot == NO_PAGE)
+                page.data_slot = slot;
+            if ((bus & static_cast<uint8_t>(MmuBus::Instruction)) && page.instruction_slot == NO_PAGE)
+                page.instruction_slot = slot;
+            if (page.app == NO_PAGE)
+                page.app = static_cast<uint32_t>(app);
+        }
+        return true;
+    }
+
+    size_t FlashMmu::AddImage(const ParsedImage& image, uint64_t flashBase)
+    {
+        size_t app = AddApp();
+        for (const SegmentInfo& segment : image.Segments())
+        {
+            if (IsFlashWindow(segment.load_addr))
+                Map(app, segment.load_addr, flashBase + segment.file_offset, segment.data_len);
+        }
+        return app;
+    }
+
+    bool FlashMmu::IsFlashWindow(uint32_t addr) const
+    {
+        uint32_t slot;
+        return FindSlot(addr, slot);
+    }
+
+    bool FlashMmu::VirtualToFlash(uint32_t addr, uint64_t& flashOffset, size_t app) const
+    {
+        uint32_t slot;
+        if (app >= m_apps.size() || !FindSlot(addr, slot) || m_apps[app][slot] == NO_PAGE)
+            return false;
+        flashOffset = static_cast<uint64_t>(m_apps[app][slot]) * m_pageSize + (addr & (m_pageSize - 1));
+        return true;
+    }
+
+    bool FlashMmu::FlashToVirtual(uint64_t flashOffset, uint32_t& addr, MmuBus bus, size_t* app) const
+    {
+        uint64_t flashPage = flashOffset / m_pageSize;
+        if (flashPage >= m_flashPages.size())
+            return false;
+
+        const FlashPage& page = m_flashPages[flashPage];
+        uint32_t slot = NO_PAGE;
+        if (bus != MmuBus::Data)
+            slot = page.instruction_slot;
+        if (slot == NO_PAGE && bus != MmuBus::Instruction)
+            slot = page.data_slot;
+        if (slot == NO_PAGE)
+            return false;
+
+        addr = GetSlotAddress(slot) + static_cast<uint32_t>(flashOffset & (m_pageSize - 1));
+        if (app)
+            *app = page.app;
+        return true;
+    }
+
+    void FlashMmu::GetRuns(size_t app, vector<MmuRun>& out) const
+    {
+        out.clear();
+        if (app >= m_apps.size())
+            return;
+
+        const vector<uint32_t>& slots = m_apps[app];
+        for (uint32_t slot = 0; slot < m_slotCount; slot++)
+        {
+            if (slots[slot] == NO_PAGE)
+                continue;
+            uint32_t addr = GetSlotAddress(slot);
+            uint64_t flashOffset = static_cast<uint64_t>(slots[slot]) * m_pageSize;
+            if (!out.empty() && out.back().addr + out.back().size == addr &&
+                out.back().flash_offset + out.back().size == flashOffset)
+                out.back().size += m_pageSize;
+            else
+                out.push_back({addr, flashOffset, m_pageSize});
+        }
+    }
+}  // namespace EspApp
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "esp_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr uint32_t FLASH_MMU_PAGE_SIZE = 0x10000;
+    constexpr size_t FLASH_MMU_NO_APP = SIZE_MAX;
+
+    // Bus a virtual window is reached through. C6, H2 and P4 map flash through one window on both buses.
+    enum class MmuBus : uint8_t
+    {
+        Data = 1,
+        Instruction = 2,
+        Both = 3,
+    };
+
+    // Virtual address range that the flash cache MMU maps in pages (the IROM and DROM windows)
+    struct MmuWindow
+    {
+        uint32_t start_addr;
+        uint32_t end_addr;
+        MmuBus bus;
+    };
+
+    std::span<const MmuWindow> GetFlashMmuWindows(EspChipId chipId);
+
+    // Contiguous virtual pages mapping contiguous flash pages
+    struct MmuRun
+    {
+        uint32_t addr;
+        uint64_t flash_offset;
+        uint32_t size;
+    };
+
+    // Page table of the flash cache MMU, as the second stage bootloader programs it for the IROM and DROM
+    // segments of an app: the flash page holding a segment's first byte is mapped at the virtual page holding
+    // its load address, followed by as many pages as the segment covers. Every window page has one slot per
+    // app, and every flash page records the slot it is mapped to on each bus, so translation either way is
+    // an array lookup. The apps of a flash dump share the virtual windows but not their flash pages.
+    class FlashMmu
+    {
+        static constexpr uint32_t NO_PAGE = UINT32_MAX;
+
+        struct FlashPage
+        {
+            uint32_t data_slot = NO_PAGE;
+            uint32_t instruction_slot = NO_PAGE;
+            uint32_t app = NO_PAGE;
+        };
+
+        std::span<const MmuWindow> m_windows;
+        std::vector<uint32_t> m_windowSlots;  // First slot of each window
+        uint32_t m_slotCount = 0;
+        uint32_t m_pageSize = FLASH_MMU_PAGE_SIZE;
+        std::vector<std::vector<uint32_t>> m_apps;  // Per app: slot -> flash page
+        std::vector<FlashPage> m_flashPages;
+
+        bool FindSlot(uint32_t addr, uint32_t& slot, size_t* window = nullptr) const;
+        uint32_t GetSlotAddress(uint32_t slot) const;
+
+    public:
+        // Returns false for chips without a flash MMU model. `pageSize` must be a power of two; ESP-IDF
+        // uses 64 KB pages except on C2/C6/H2 builds for flash chips smaller than 4 MB.
+        bool Init(EspChipId chipId, uint32_t pageSize = FLASH_MMU_PAGE_SIZE);
+        void Clear();
+
+        uint32_t GetPageSize() const { return m_pageSize; }
+        size_t GetAppCount() const { return m_apps.size(); }
+
+        // Add an app with no mappings and return its index
+        size_t AddApp();
+
+        // Map `size` bytes at virtual `addr` to `flashOffset` with the page granularity of the hardware. Pages
+        // outside the windows are ignored. Returns false if nothing could be mapped.
+        bool Map(size_t app, uint32_t addr, uint64_t flashOffset, uint64_t size);
+
+        // Add an app and map its flash segments. Segment file offsets plus `flashBase` are flash offsets: 0
+        // for images parsed out of a flash dump, the partition offset for an image file.
+        size_t AddImage(const ParsedImage& image, uint64_t flashBase = 0);
+
+        // True if `addr` lies in one of the flash windows
+        bool IsFlashWindow(uint32_t addr) const;
+
+        bool VirtualToFlash(uint32_t addr, uint64_t& flashOffset, size_t app = 0) const;
+
+        // Virtual address a flash offset appears at, through the given bus (Both: the instruction bus first).
+        // `app` receives the app that maps the page.
+        bool FlashToVirtual(uint64_t flashOffset, uint32_t& addr, MmuBus bus = MmuBus::Both,
+            size_t* app = nullptr) const;
+
+        // Mappings of one app in address order
+        void GetRuns(size_t app, std::vector<MmuRun>& out) const;
+    };
+}  // namespace EspApp
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace EspApp
+{
+    // Number of worker threads to use for `count` independent items
+    inline size_t GetParallelWorkerCount(size_t count, size_t maxThreads = 0)
+    {
+        size_t workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+        if (maxThreads)
+            workers = std::min(workers, maxThreads);
+        return std::min(workers, count);
+    }
+
+    // Call fn(i) for every i in [0, count) across a set of short-lived worker threads. Items are handed
+    // out dynamically, so uneven item costs (a 4 MB app next to a 64 KB bootloader) still balance. The
+    // calling thread participates; fn must not throw.
+    template <typename Fn>
+    void ParallelFor(size_t count, Fn&& fn, size_t maxThreads = 0)
+    {
+        size_t workers = GetParallelWorkerCount(count, maxThreads);
+        if (workers <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        std::atomic<size_t> next {0};
+        auto worker = [&]() {
+            for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < count;
+                 i = next.fetch_add(1, std::memory_order_relaxed))
+                fn(i);
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (size_t i = 1; i < workers; i++)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+    }
+}  // namespace EspApp
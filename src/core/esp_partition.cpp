@@ -0,0 +1,142 @@
+#include "esp_partition.h"
+#include "esp_endian.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    bool HasPartitionTableAt(span<const uint8_t> data, uint64_t offset)
+    {
+        if (offset > data.size() || data.size() - offset < sizeof(EspPartitionEntry))
+            return false;
+        return LoadLE16(data.data() + offset) == ESP_PARTITION_MAGIC;
+    }
+
+    static bool IsValidPartitionEntry(const uint8_t* entry, uint64_t tableOffset)
+    {
+        uint8_t type = entry[2];
+        uint8_t subtype = entry[3];
+        uint32_t offset = LoadLE32(entry + 4);
+        uint32_t size = LoadLE32(entry + 8);
+        if (size == 0 || offset < tableOffset + ESP_PARTITION_TABLE_SECTOR)
+            return false;
+
+        // Custom partition types are 0x40-0xFE
+        if (type == static_cast<uint8_t>(EspPartitionType::App))
+        {
+            bool knownSubtype = subtype == AppFactory || (subtype >= AppOtaMin && subtype <= AppTest);
+            return knownSubtype && offset % ESP_PARTITION_APP_ALIGN == 0;
+        }
+        if (type != static_cast<uint8_t>(EspPartitionType::Data) && (type < 0x40 || type == 0xFF))
+            return false;
+        return offset % ESP_PARTITION_TABLE_SECTOR == 0;
+    }
+
+    bool IsValidPartitionTable(span<const uint8_t> table, uint64_t tableOffset)
+    {
+        if (table.size() > ESP_PARTITION_TABLE_MAX_LEN)
+            table = table.first(ESP_PARTITION_TABLE_MAX_LEN);
+
+        bool hasApp = false;
+        for (size_t at = 0; table.size() - at >= sizeof(EspPartitionEntry); at += sizeof(EspPartitionEntry))
+        {
+            const uint8_t* entry = table.data() + at;
+            uint16_t magic = LoadLE16(entry);
+            if (magic == ESP_PARTITION_MAGIC_MD5)
+                return hasApp;
+            if (magic != ESP_PARTITION_MAGIC)
+            {
+                // Only an erased entry ends a table without an MD5 row
+                static const uint8_t erased[sizeof(EspPartitionEntry)] = {
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+                return hasApp && memcmp(entry, erased, sizeof(erased)) == 0;
+            }
+            if (!IsValidPartitionEntry(entry, tableOffset))
+                return false;
+            hasApp |= entry[2] == static_cast<uint8_t>(EspPartitionType::App);
+        }
+        return false;
+    }
+
+    bool ParsePartitionTable(span<const uint8_t> data, vector<PartitionInfo>& out, uint64_t offset)
+    {
+        out.clear();
+        if (offset > data.size())
+            return false;
+
+        span<const uint8_t> table = data.subspan(offset);
+        if (table.size() > ESP_PARTITION_TABLE_MAX_LEN)
+            table = table.first(ESP_PARTITION_TABLE_MAX_LEN);
+
+        for (size_t at = 0; table.size() - at >= sizeof(EspPartitionEntry); at += sizeof(EspPartitionEntry))
+        {
+            const uint8_t* entry = table.data() + at;
+            uint16_t magic = LoadLE16(entry);
+            if (magic != ESP_PARTITION_MAGIC)
+                break;  // 0xFFFF (erased), ESP_PARTITION_MAGIC_MD5 or garbage all end the table
+
+            PartitionInfo info;
+            info.type = entry[2];
+            info.subtype = entry[3];
+            info.offset = LoadLE32(entry + 4);
+            info.size = LoadLE32(entry + 8);
+            memcpy(info.label, entry + 12, 16);
+            info.label[16] = '\0';
+            info.flags = LoadLE32(entry + 28);
+            out.push_back(info);
+        }
+        return !out.empty();
+    }
+
+    const char* GetPartitionTypeName(uint8_t type)
+    {
+        switch (static_cast<EspPartitionType>(type))
+        {
+        case EspPartitionType::App:
+            return "app";
+        case EspPartitionType::Data:
+            return "data";
+        }
+        return "custom";
+    }
+
+    const char* GetPartitionSubtypeName(uint8_t type, uint8_t subtype)
+    {
+        static const char* const otaNames[] = {"ota_0", "ota_1", "ota_2", "ota_3", "ota_4", "ota_5", "ota_6",
+            "ota_7", "ota_8", "ota_9", "ota_10", "ota_11", "ota_12", "ota_13", "ota_14", "ota_15"};
+
+        if (type == static_cast<uint8_t>(EspPartitionType::App))
+        {
+            if (subtype == AppFactory)
+                return "factory";
+            if (subtype >= AppOtaMin && subtype <= AppOtaMax)
+                return otaNames[subtype - AppOtaMin];
+            if (subtype == AppTest)
+                return "test";
+        }
+        else if (type == static_cast<uint8_t>(EspPartitionType::Data))
+        {
+            switch (subtype)
+            {
+            case DataOta:
+                return "ota";
+            case DataPhy:
+                return "phy";
+            case DataNvs:
+                return "nvs";
+            case DataCoreDump:
+                return "coredump";
+            case DataNvsKeys:
+                return "nvs_keys";
+            case DataEfuse:
+                return "efuse";
+            default:
+                break;
+            }
+        }
+        return "unknown";
+    }
+}  // namespace EspApp
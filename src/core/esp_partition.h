@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr uint64_t ESP_PARTITION_TABLE_OFFSET = 0x8000;
+    constexpr size_t ESP_PARTITION_TABLE_MAX_LEN = 0xC00;
+    constexpr uint32_t ESP_PARTITION_TABLE_SECTOR = 0x1000;  // The table sector; data partitions are aligned to it
+    constexpr uint32_t ESP_PARTITION_APP_ALIGN = 0x10000;
+    constexpr uint16_t ESP_PARTITION_MAGIC = 0x50AA;
+    constexpr uint16_t ESP_PARTITION_MAGIC_MD5 = 0xEBEB;
+
+    enum class EspPartitionType : uint8_t
+    {
+        App = 0x00,
+        Data = 0x01,
+    };
+
+    enum EspAppPartitionSubtype : uint8_t
+    {
+        AppFactory = 0x00,
+        AppOtaMin = 0x10,
+        AppOtaMax = 0x1F,
+        AppTest = 0x20,
+    };
+
+    enum EspDataPartitionSubtype : uint8_t
+    {
+        DataOta = 0x00,
+        DataPhy = 0x01,
+        DataNvs = 0x02,
+        DataCoreDump = 0x03,
+        DataNvsKeys = 0x04,
+        DataEfuse = 0x05,
+    };
+
+// Partition table entry (32 bytes)
+#pragma pack(push, 1)
+    struct EspPartitionEntry
+    {
+        uint16_t magic;     // ESP_PARTITION_MAGIC
+        uint8_t type;       // EspPartitionType
+        uint8_t subtype;    // Type specific subtype
+        uint32_t offset;    // Flash offset of the partition
+        uint32_t size;      // Size of the partition in bytes
+        char label[16];     // NUL padded, not necessarily NUL terminated
+        uint32_t flags;     // Bit 0: encrypted
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(EspPartitionEntry) == 32, "EspPartitionEntry must be 32 bytes");
+
+    struct PartitionInfo
+    {
+        uint8_t type;
+        uint8_t subtype;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t flags;
+        char label[17];  // NUL terminated copy of EspPartitionEntry::label
+
+        bool IsApp() const { return type == static_cast<uint8_t>(EspPartitionType::App); }
+        bool IsEncrypted() const { return flags & 1; }
+    };
+
+    // Returns true if a partition table entry starts at `offset` in `data`
+    bool HasPartitionTableAt(std::span<const uint8_t> data, uint64_t offset = ESP_PARTITION_TABLE_OFFSET);
+
+    // Stricter check for format detection: `table`, read from flash at `tableOffset`, has only well-formed
+    // entries (app, data or custom type, a known subtype for apps, aligned offset past the table, non-zero
+    // size), at least one of them an app, and ends in an MD5 row or an erased entry within
+    // ESP_PARTITION_TABLE_MAX_LEN. Data subtypes are not checked; gen_esp32part accepts custom ones.
+    bool IsValidPartitionTable(std::span<const uint8_t> table, uint64_t tableOffset = ESP_PARTITION_TABLE_OFFSET);
+
+    // Parse the partition table at `offset`, stopping at the first erased or MD5 entry. Entries that
+    // extend past the end of `data` are kept (a dump may be shorter than the configured flash size);
+    // callers must bound their reads. Returns false if no valid entry is found.
+    bool ParsePartitionTable(
+        std::span<const uint8_t> data, std::vector<PartitionInfo>& out, uint64_t offset = ESP_PARTITION_TABLE_OFFSET);
+
+    // Human readable names for partition types, e.g. "app/ota_1", "data/nvs"
+    const char* GetPartitionTypeName(uint8_t type);
+    const char* GetPartitionSubtypeName(uint8_t type, uint8_t subtype);
+}  // namespace EspApp
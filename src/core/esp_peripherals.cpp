@@ -0,0 +1,131 @@
+#include "esp_peripherals.h"
+#include "esp_endian.h"
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr size_t PERIPHERALS_HEADER_SIZE = 20;
+    static constexpr size_t PERIPHERALS_BLOCK_SIZE = 24;
+
+    static bool ReadVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value)
+    {
+        uint64_t result = 0;
+        for (int shift = 0; shift < 35 && cursor < end; shift += 7)
+        {
+            uint8_t byte = *cursor++;
+            result |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                if (result > UINT32_MAX)
+                    return false;
+                value = static_cast<uint32_t>(result);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    PeripheralTable::PeripheralTable(span<const uint8_t> blob)
+    {
+        if (blob.size() < PERIPHERALS_HEADER_SIZE || LoadLE32(blob.data()) != ESP_PERIPHERALS_MAGIC ||
+            LoadLE16(blob.data() + 4) != ESP_PERIPHERALS_VERSION)
+            return;
+
+        uint64_t count = LoadLE32(blob.data() + 8);
+        uint64_t streamSize = LoadLE32(blob.data() + 12);
+        uint64_t stringsSize = LoadLE32(blob.data() + 16);
+        uint64_t stringsStart = PERIPHERALS_HEADER_SIZE + count * PERIPHERALS_BLOCK_SIZE + streamSize;
+        if (stringsStart + stringsSize > blob.size())
+            return;
+        if (stringsSize == 0 ? count != 0 : blob[stringsStart + stringsSize - 1] != 0)
+            return;
+
+        m_blocks = blob.data() + PERIPHERALS_HEADER_SIZE;
+        m_stream = m_blocks + count * PERIPHERALS_BLOCK_SIZE;
+        m_strings = reinterpret_cast<const char*>(blob.data() + stringsStart);
+        m_count = static_cast<uint32_t>(count);
+        m_streamSize = static_cast<uint32_t>(streamSize);
+        m_stringsSize = static_cast<uint32_t>(stringsSize);
+    }
+
+    string_view PeripheralTable::GetString(uint32_t offset) const
+    {
+        if (offset >= m_stringsSize)
+            return {};
+        return string_view(m_strings + offset);
+    }
+
+    PeripheralBlock PeripheralTable::GetBlock(size_t index) const
+    {
+        const uint8_t* record = m_blocks + index * PERIPHERALS_BLOCK_SIZE;
+        PeripheralBlock block;
+        block.base = LoadLE32(record);
+        block.size = LoadLE32(record + 4);
+        block.name = GetString(LoadLE32(record + 8));
+        block.type_name = GetString(LoadLE32(record + 12));
+        block.register_offset = LoadLE32(record + 16);
+        block.register_count = LoadLE32(record + 20);
+        return block;
+    }
+
+    size_t PeripheralTable::FindBlock(uint64_t addr) const
+    {
+        // Last block whose base is at or below addr
+        size_t lo = 0, hi = m_count;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (LoadLE32(m_blocks + mid * PERIPHERALS_BLOCK_SIZE) <= addr)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == 0)
+            return ESP_PERIPHERAL_NOT_FOUND;
+
+        const uint8_t* record = m_blocks + (lo - 1) * PERIPHERALS_BLOCK_SIZE;
+        if (addr - LoadLE32(record) >= LoadLE32(record + 4))
+            return ESP_PERIPHERAL_NOT_FOUND;
+        return lo - 1;
+    }
+
+    bool PeripheralTable::DecodeRegisters(const PeripheralBlock& block, vector<PeripheralRegister>& out) const
+    {
+        out.clear();
+        if (block.register_offset > m_streamSize)
+            return false;
+
+        // Every register takes at least three bytes of stream
+        const uint8_t* cursor = m_stream + block.register_offset;
+        const uint8_t* end = m_stream + m_streamSize;
+        if (block.register_count > size_t(end - cursor) / 3)
+            return false;
+
+        out.reserve(block.register_count);
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < block.register_count; i++)
+        {
+            uint32_t delta, size, nameOffset;
+            if (!ReadVarint(cursor, end, delta) || !ReadVarint(cursor, end, size) ||
+                !ReadVarint(cursor, end, nameOffset))
+                return false;
+
+            offset += delta;
+            if (offset + size > block.size || nameOffset >= m_stringsSize)
+                return false;
+            out.push_back({static_cast<uint32_t>(offset), size, GetString(nameOffset)});
+        }
+        return true;
+    }
+
+    PeripheralTable GetPeripheralTable(EspChipId chipId)
+    {
+        for (size_t i = 0; i < g_peripheralBlobCount; i++)
+        {
+            if (g_peripheralBlobs[i].chip_id == static_cast<uint16_t>(chipId))
+                return PeripheralTable({g_peripheralBlobs[i].data, g_peripheralBlobs[i].size});
+        }
+        return {};
+    }
+}  // namespace EspApp
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "esp_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr uint32_t ESP_PERIPHERALS_MAGIC = 0x52455045;  // 'EPER'
+    constexpr uint16_t ESP_PERIPHERALS_VERSION = 1;
+    constexpr size_t ESP_PERIPHERAL_NOT_FOUND = SIZE_MAX;
+
+    // Embedded per-chip register map generated by scripts/gen_peripherals.py
+    struct PeripheralBlob
+    {
+        uint16_t chip_id;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    extern const PeripheralBlob g_peripheralBlobs[];
+    extern const size_t g_peripheralBlobCount;
+
+    struct PeripheralBlock
+    {
+        uint32_t base;
+        uint32_t size;
+        std::string_view name;
+        std::string_view type_name;  // Shared by peripherals with the same register layout
+        uint32_t register_offset;
+        uint32_t register_count;
+    };
+
+    struct PeripheralRegister
+    {
+        uint32_t offset;
+        uint32_t size;
+        std::string_view name;
+    };
+
+    // Read-only view over a peripheral blob. Blocks are fixed-size records sorted by base address and
+    // searched in place; a block's register list is only decoded on request. An invalid blob behaves as
+    // an empty table.
+    class PeripheralTable
+    {
+        const uint8_t* m_blocks = nullptr;
+        const uint8_t* m_stream = nullptr;
+        const char* m_strings = nullptr;
+        uint32_t m_count = 0;
+        uint32_t m_streamSize = 0;
+        uint32_t m_stringsSize = 0;
+
+        std::string_view GetString(uint32_t offset) const;
+
+    public:
+        PeripheralTable() = default;
+        explicit PeripheralTable(std::span<const uint8_t> blob);
+
+        size_t GetCount() const { return m_count; }
+        PeripheralBlock GetBlock(size_t index) const;
+
+        // Index of the block containing addr, or ESP_PERIPHERAL_NOT_FOUND
+        size_t FindBlock(uint64_t addr) const;
+
+        // Decode a block's registers in ascending offset order. Fails on a corrupt register stream.
+        bool DecodeRegisters(const PeripheralBlock& block, std::vector<PeripheralRegister>& out) const;
+    };
+
+    PeripheralTable GetPeripheralTable(EspChipId chipId);
+}  // namespace EspApp
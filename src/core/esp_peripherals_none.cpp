@@ -0,0 +1,12 @@
+// Used when the build is not configured with ESP_SVD_PATH: no peripheral register maps are embedded.
+
+#include "esp_peripherals.h"
+
+namespace EspApp
+{
+    const PeripheralBlob g_peripheralBlobs[] = {
+        {0xFFFF, nullptr, 0},
+    };
+
+    const size_t g_peripheralBlobCount = 0;
+}  // namespace EspApp
@@ -0,0 +1,228 @@
+#include "esp_prologue.h"
+#include "esp_endian.h"
+#include "esp_parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ESP_PROLOGUE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ESP_PROLOGUE_NEON 1
+#endif
+
+using namespace std;
+
+namespace EspApp
+{
+    // Large segments are split so that a single 4 MB IROM segment still spreads across cores
+    static constexpr uint64_t SCAN_CHUNK_SIZE = 256 * 1024;
+
+    // Windowed-ABI stack frames are 8-byte units; anything beyond 16 KB is almost certainly not code
+    static constexpr uint32_t XTENSA_MAX_FRAME_UNITS = 0x200;
+    static constexpr int32_t RISCV_MAX_FRAME = 0x800;
+
+    PrologueArch GetPrologueArch(const ChipAttr& attr)
+    {
+        if (strcmp(attr.arch_name, "esp32") == 0)
+            return PrologueArch::Xtensa;
+        if (strncmp(attr.arch_name, "rv32", 4) == 0)
+            return PrologueArch::RiscV;
+        return PrologueArch::Unknown;
+    }
+
+    // Bitmask of the positions in p[0, 16) holding any of the given bytes
+    static uint32_t MatchBytes16(const uint8_t* p, uint8_t a, uint8_t b, uint8_t c)
+    {
+#if defined(ESP_PROLOGUE_SSE2)
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(a))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(b))),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(c)))));
+        return static_cast<uint32_t>(_mm_movemask_epi8(m));
+#elif defined(ESP_PROLOGUE_NEON)
+        uint8x16_t v = vld1q_u8(p);
+        uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8(a)), vorrq_u8(vceqq_u8(v, vdupq_n_u8(b)),
+            vceqq_u8(v, vdupq_n_u8(c))));
+        static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t masked = vandq_u8(m, vld1q_u8(bits));
+        return vaddv_u8(vget_low_u8(masked)) | (uint32_t(vaddv_u8(vget_high_u8(masked))) << 8);
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < 16; i++)
+            mask |= uint32_t(p[i] == a || p[i] == b || p[i] == c) << i;
+        return mask;
+#endif
+    }
+
+    // entry a1, N: BRI12 encoding 0x36 | as << 8 | imm12 << 12, with as = a1 and imm12 = N / 8
+    bool IsXtensaEntry(const uint8_t* p)
+    {
+        if (p[0] != 0x36 || (p[1] & 0x0F) != 0x01)
+            return false;
+        uint32_t frame = (p[1] >> 4) | (uint32_t(p[2]) << 4);
+        return frame >= 2 && frame <= XTENSA_MAX_FRAME_UNITS;
+    }
+
+    // Negative stack adjustment of a 16-byte aligned frame, returning the instruction length (0 if none)
+    static size_t GetRiscVStackAdjust(const uint8_t* p, size_t avail)
+    {
+        uint16_t h = LoadLE16(p);
+
+        // c.addi16sp -N: 011 nzimm[9] 00010 nzimm[4|6|8:7|5] 01. With nzimm[9] set the adjustment is
+        // always negative and a multiple of 16.
+        if ((h & 0xFF83) == 0x7101)
+            return 2;
+
+        // c.addi sp, -N: 000 imm[5] 00010 imm[4:0] 01, imm[5] set
+        if ((h & 0xFF83) == 0x1101)
+        {
+            int32_t imm = int32_t((h >> 2) & 0x1F) - 0x20;
+            return imm < 0 && imm % 16 == 0 ? 2 : 0;
+        }
+
+        // addi sp, sp, -N
+        if (avail >= 4)
+        {
+            uint32_t w = LoadLE32(p);
+            if ((w & 0x000FFFFF) == 0x00010113 && (w & 0x80000000))
+            {
+                int32_t imm = int32_t(w) >> 20;
+                return imm >= -RISCV_MAX_FRAME && imm % 16 == 0 ? 4 : 0;
+            }
+        }
+        return 0;
+    }
+
+    // A RISC-V stack adjustment only starts a function right after the end of the previous one: a return,
+    // alignment padding, or the start of the range. Without this, every alloca-style adjustment would count.
+    static bool FollowsFunctionEnd(const uint8_t* code, size_t offset)
+    {
+        if (offset == 0)
+            return true;
+        if (offset >= 2)
+        {
+            uint16_t prev = LoadLE16(code + offset - 2);
+            if (prev == 0x8082 || prev == 0x0000)  // c.jr ra, padding
+                return true;
+        }
+        if (offset >= 4 && LoadLE32(code + offset - 4) == 0x00008067)  // jalr x0, 0(ra)
+            return true;
+        return false;
+    }
+
+    void ScanPrologues(span<const uint8_t> code, uint32_t loadAddr, PrologueArch arch, vector<uint32_t>& out)
+    {
+        const uint8_t* p = code.data();
+        size_t size = code.size();
+
+        if (arch == PrologueArch::Xtensa)
+        {
+            // Call targets are 4-byte aligned, so only lanes 0, 4, 8 and 12 of each block can hold an entry
+            size_t base = (4 - (loadAddr & 3)) & 3;
+            size_t i = base;
+            for (; i + 16 <= size; i += 16)
+            {
+                uint32_t mask = MatchBytes16(p + i, 0x36, 0x36, 0x36) & 0x1111;
+                while (mask)
+                {
+                    size_t at = i + countr_zero(mask);
+                    mask &= mask - 1;
+                    if (at + 3 <= size && IsXtensaEntry(p + at))
+                        out.push_back(loadAddr + static_cast<uint32_t>(at));
+                }
+            }
+            for (; i + 3 <= size; i += 4)
+            {
+                if (IsXtensaEntry(p + i))
+                    out.push_back(loadAddr + static_cast<uint32_t>(i));
+            }
+        }
+        else if (arch == PrologueArch::RiscV)
+        {
+            // Instructions are 2-byte aligned. Every pattern above is identified by its second byte (0x71 or
+            // 0x11 for the compressed forms) or its first byte (0x13), so those are located first.
+            size_t base = loadAddr & 1;
+            size_t i = base;
+            auto check = [&](size_t at) {
+                if (at + 2 > size)
+                    return;
+                if (GetRiscVStackAdjust(p + at, size - at) && FollowsFunctionEnd(p, at))
+                    out.push_back(loadAddr + static_cast<uint32_t>(at));
+            };
+            for (; i + 16 <= size; i += 16)
+            {
+                uint32_t mask = MatchBytes16(p + i, 0x13, 0x11, 0x71);
+
+                // Fold matches on odd lanes (second byte) onto the even lane that starts the halfword
+                uint32_t starts = (mask | (mask >> 1)) & 0x5555;
+                while (starts)
+                {
+                    size_t at = i + countr_zero(starts);
+                    starts &= starts - 1;
+                    check(at);
+                }
+            }
+            for (; i + 2 <= size; i += 2)
+                check(i);
+        }
+    }
+
+    vector<uint32_t> ScanCodeRanges(span<const uint8_t> data, span<const CodeRange> ranges, PrologueArch arch,
+        size_t maxThreads)
+    {
+        // Chunks start at fixed multiples of SCAN_CHUNK_SIZE into their range, keeping instruction alignment
+        struct Chunk
+        {
+            uint64_t offset;
+            uint64_t length;
+            uint64_t range_start;
+            uint64_t range_end;
+            uint32_t load_addr;
+        };
+        vector<Chunk> chunks;
+        for (const CodeRange& range : ranges)
+        {
+            if (range.file_offset >= data.size())
+                continue;
+            uint64_t end = min<uint64_t>(data.size(), range.file_offset + range.length);
+            for (uint64_t offset = range.file_offset; offset < end; offset += SCAN_CHUNK_SIZE)
+            {
+                uint64_t length = min<uint64_t>(SCAN_CHUNK_SIZE, end - offset);
+                chunks.push_back({offset, length, range.file_offset, end,
+                    static_cast<uint32_t>(range.load_addr + (offset - range.file_offset))});
+            }
+        }
+
+        vector<vector<uint32_t>> results(chunks.size());
+        ParallelFor(chunks.size(), [&](size_t i) {
+            const Chunk& chunk = chunks[i];
+
+            // Chunks overlap their neighbours by one instruction on each side, so patterns that look at the
+            // previous instruction or run past the chunk end see the same bytes as an unsplit scan. Only
+            // starts inside the chunk itself are kept.
+            uint64_t lead = min<uint64_t>(4, chunk.offset - chunk.range_start);
+            uint64_t readEnd = min<uint64_t>(chunk.range_end, chunk.offset + chunk.length + 3);
+            vector<uint32_t> found;
+            ScanPrologues(data.subspan(chunk.offset - lead, readEnd - (chunk.offset - lead)),
+                chunk.load_addr - static_cast<uint32_t>(lead), arch, found);
+
+            uint32_t limit = chunk.load_addr + static_cast<uint32_t>(chunk.length);
+            for (uint32_t addr : found)
+            {
+                if (addr >= chunk.load_addr && addr < limit)
+                    results[i].push_back(addr);
+            }
+        }, maxThreads);
+
+        vector<uint32_t> starts;
+        for (const auto& result : results)
+            starts.insert(starts.end(), result.begin(), result.end());
+        sort(starts.begin(), starts.end());
+        starts.erase(unique(starts.begin(), starts.end()), starts.end());
+        return starts;
+    }
+}  // namespace EspApp
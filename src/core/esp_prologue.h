@@ -0,0 +1,42 @@
+#pragma once
+
+#include "esp_chip.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    enum class PrologueArch
+    {
+        Unknown,
+        Xtensa,  // Windowed ABI: functions open with `entry a1, N`
+        RiscV,   // Functions open with a negative `addi sp, sp, -N` (or its compressed forms)
+    };
+
+    PrologueArch GetPrologueArch(const ChipAttr& attr);
+
+    // `entry a1, N` with a plausible frame size at p[0, 3)
+    bool IsXtensaEntry(const uint8_t* p);
+
+    // A file-backed stretch of code to scan
+    struct CodeRange
+    {
+        uint64_t file_offset;
+        uint64_t length;
+        uint32_t load_addr;
+    };
+
+    // Append the load address of every function prologue found in `code` (loaded at loadAddr) to `out`,
+    // in ascending order. Candidate bytes are located 16 at a time with SIMD compares where available and
+    // then checked with the full instruction pattern.
+    void ScanPrologues(std::span<const uint8_t> code, uint32_t loadAddr, PrologueArch arch,
+        std::vector<uint32_t>& out);
+
+    // Scan every range of `data`, split into chunks spread across worker threads. Returns the function
+    // starts of all ranges in ascending address order.
+    std::vector<uint32_t> ScanCodeRanges(std::span<const uint8_t> data, std::span<const CodeRange> ranges,
+        PrologueArch arch, size_t maxThreads = 0);
+}  // namespace EspApp
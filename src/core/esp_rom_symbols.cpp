@@ -0,0 +1,65 @@
+#include "esp_rom_symbols.h"
+#include "esp_endian.h"
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr size_t ROM_SYMBOLS_HEADER_SIZE = 16;
+    static constexpr size_t ROM_SYMBOLS_ENTRY_SIZE = 8;
+
+    RomSymbolTable::RomSymbolTable(span<const uint8_t> blob)
+    {
+        if (blob.size() < ROM_SYMBOLS_HEADER_SIZE || LoadLE32(blob.data()) != ESP_ROM_SYMBOLS_MAGIC ||
+            LoadLE16(blob.data() + 4) != ESP_ROM_SYMBOLS_VERSION)
+            return;
+
+        uint64_t count = LoadLE32(blob.data() + 8);
+        uint64_t stringsSize = LoadLE32(blob.data() + 12);
+        if (ROM_SYMBOLS_HEADER_SIZE + count * ROM_SYMBOLS_ENTRY_SIZE + stringsSize > blob.size())
+            return;
+
+        // Every name must be NUL terminated within the string table
+        if (stringsSize == 0 ? count != 0 : blob[ROM_SYMBOLS_HEADER_SIZE + count * ROM_SYMBOLS_ENTRY_SIZE +
+                                                   stringsSize - 1] != 0)
+            return;
+
+        m_entries = blob.data() + ROM_SYMBOLS_HEADER_SIZE;
+        m_strings = reinterpret_cast<const char*>(m_entries + count * ROM_SYMBOLS_ENTRY_SIZE);
+        m_count = static_cast<uint32_t>(count);
+        m_stringsSize = static_cast<uint32_t>(stringsSize);
+    }
+
+    RomSymbol RomSymbolTable::Get(size_t index) const
+    {
+        const uint8_t* entry = m_entries + index * ROM_SYMBOLS_ENTRY_SIZE;
+        uint32_t nameOffset = LoadLE32(entry + 4);
+        if (nameOffset >= m_stringsSize)
+            return {LoadLE32(entry), {}};
+        return {LoadLE32(entry), string_view(m_strings + nameOffset)};
+    }
+
+    size_t RomSymbolTable::LowerBound(uint64_t addr) const
+    {
+        size_t lo = 0, hi = m_count;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (LoadLE32(m_entries + mid * ROM_SYMBOLS_ENTRY_SIZE) < addr)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    RomSymbolTable GetRomSymbolTable(EspChipId chipId)
+    {
+        for (size_t i = 0; i < g_romSymbolBlobCount; i++)
+        {
+            if (g_romSymbolBlobs[i].chip_id == static_cast<uint16_t>(chipId))
+                return RomSymbolTable({g_romSymbolBlobs[i].data, g_romSymbolBlobs[i].size});
+        }
+        return {};
+    }
+}  // namespace EspApp
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "esp_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace EspApp
+{
+    constexpr uint32_t ESP_ROM_SYMBOLS_MAGIC = 0x4D4F5245;  // 'EROM'
+    constexpr uint16_t ESP_ROM_SYMBOLS_VERSION = 1;
+
+    // Embedded per-chip symbol blob generated by scripts/gen_rom_symbols.py
+    struct RomSymbolBlob
+    {
+        uint16_t chip_id;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    extern const RomSymbolBlob g_romSymbolBlobs[];
+    extern const size_t g_romSymbolBlobCount;
+
+    struct RomSymbol
+    {
+        uint32_t addr;
+        std::string_view name;
+    };
+
+    // Read-only view over a ROM symbol blob. Symbols are sorted by address and read in place; an invalid
+    // blob behaves as an empty table.
+    class RomSymbolTable
+    {
+        const uint8_t* m_entries = nullptr;
+        const char* m_strings = nullptr;
+        uint32_t m_count = 0;
+        uint32_t m_stringsSize = 0;
+
+    public:
+        RomSymbolTable() = default;
+        explicit RomSymbolTable(std::span<const uint8_t> blob);
+
+        size_t GetCount() const { return m_count; }
+        RomSymbol Get(size_t index) const;
+
+        // Index of the first symbol at or above addr
+        size_t LowerBound(uint64_t addr) const;
+    };
+
+    RomSymbolTable GetRomSymbolTable(EspChipId chipId);
+}  // namespace EspApp
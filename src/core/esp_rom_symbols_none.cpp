@@ -0,0 +1,12 @@
+// Used when the build is not configured with ESP_IDF_PATH: no ROM symbols are embedded.
+
+#include "esp_rom_symbols.h"
+
+namespace EspApp
+{
+    const RomSymbolBlob g_romSymbolBlobs[] = {
+        {0xFFFF, nullptr, 0},
+    };
+
+    const size_t g_romSymbolBlobCount = 0;
+}  // namespace EspApp
@@ -0,0 +1,179 @@
+#include "esp_seed_cache.h"
+#include "esp_endian.h"
+#include "esp_sha256.h"
+#include "esp_verify.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace std;
+
+namespace EspApp
+{
+    // On-disk layout: header, then fixed-size records, then the string table. All integers little-endian.
+    //   magic[8], u32 function count, u32 data variable count, u32 name count, u32 string table size, u64 0
+    //   function count * u32 address
+    //   data variable count * { u32 address, u32 type string offset }
+    //   name count * { u32 address, u32 kind, u32 name string offset }
+    static constexpr char g_seedCacheMagic[8] = {'E', 'S', 'P', 'S', 'E', 'E', 'D', '1'};
+    static constexpr size_t SEED_HEADER_SIZE = 32;
+    static constexpr size_t SEED_DATA_VAR_SIZE = 8;
+    static constexpr size_t SEED_NAME_SIZE = 12;
+
+    static atomic<uint32_t> g_tempCounter;
+
+    string GetSeedCacheKey(span<const uint8_t> data, const ParsedImage& image, const AppDesc* desc)
+    {
+        if (desc && desc->HasElfHash())
+            return "elf-" + DigestToHex(desc->app_elf_sha256);
+
+        ImageTrailer trailer = LocateImageTrailer(image);
+        if (image.header.hash_appended && trailer.image_end <= data.size())
+            return "img-" + DigestToHex(data.subspan(trailer.hash_offset, sizeof(Sha256Digest)));
+
+        uint64_t end = min<uint64_t>(trailer.image_end, data.size());
+        return "img-" + DigestToHex(Sha256::Hash(data.subspan(image.base_offset, end - image.base_offset)));
+    }
+
+    string GetSeedCachePath(const string& directory, const string& key)
+    {
+        return (filesystem::path(directory) / (key + ".seeds")).string();
+    }
+
+    bool StoreSeedCache(const string& path, const AnalysisSeeds& seeds)
+    {
+        string strings;
+        auto addString = [&](const string& s) {
+            uint32_t offset = static_cast<uint32_t>(strings.size());
+            strings.append(s);
+            strings.push_back('\0');
+            return offset;
+        };
+
+        vector<uint8_t> file(SEED_HEADER_SIZE + seeds.function_starts.size() * 4 +
+            seeds.data_vars.size() * SEED_DATA_VAR_SIZE + seeds.names.size() * SEED_NAME_SIZE);
+        memcpy(file.data(), g_seedCacheMagic, sizeof(g_seedCacheMagic));
+        StoreLE32(file.data() + 8, static_cast<uint32_t>(seeds.function_starts.size()));
+        StoreLE32(file.data() + 12, static_cast<uint32_t>(seeds.data_vars.size()));
+        StoreLE32(file.data() + 16, static_cast<uint32_t>(seeds.names.size()));
+
+        uint8_t* p = file.data() + SEED_HEADER_SIZE;
+        for (uint32_t addr : seeds.function_starts)
+        {
+            StoreLE32(p, addr);
+            p += 4;
+        }
+        for (const auto& var : seeds.data_vars)
+        {
+            StoreLE32(p, var.addr);
+            StoreLE32(p + 4, addString(var.type));
+            p += SEED_DATA_VAR_SIZE;
+        }
+        for (const auto& name : seeds.names)
+        {
+            StoreLE32(p, name.addr);
+            StoreLE32(p + 4, static_cast<uint32_t>(name.kind));
+            StoreLE32(p + 8, addString(name.name));
+            p += SEED_NAME_SIZE;
+        }
+        StoreLE32(file.data() + 20, static_cast<uint32_t>(strings.size()));
+
+        error_code ec;
+        filesystem::path target(path);
+        filesystem::create_directories(target.parent_path(), ec);
+
+        // Write to a temporary name first so a concurrent reader never maps a partial file. The name is unique
+        // to this call, so two views storing the same build do not write into one file.
+        filesystem::path temp = target;
+        temp += "." + to_string(random_device()()) + "-" + to_string(g_tempCounter++) + ".tmp";
+        bool written;
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            written = out.write(reinterpret_cast<const char*>(file.data()), file.size()) &&
+                out.write(strings.data(), strings.size());
+        }
+        if (written)
+            filesystem::rename(temp, target, ec);
+        if (!written || ec)
+        {
+            filesystem::remove(temp, ec);
+            return false;
+        }
+        return true;
+    }
+
+    bool SeedCache::Open(const string& path)
+    {
+        if (!m_file.Open(path))
+            return false;
+
+        span<const uint8_t> data = m_file.GetSpan();
+        if (data.size() < SEED_HEADER_SIZE || memcmp(data.data(), g_seedCacheMagic, sizeof(g_seedCacheMagic)) != 0)
+        {
+            m_file.Close();
+            return false;
+        }
+
+        uint64_t functionCount = LoadLE32(data.data() + 8);
+        uint64_t dataVarCount = LoadLE32(data.data() + 12);
+        uint64_t nameCount = LoadLE32(data.data() + 16);
+        uint64_t stringsSize = LoadLE32(data.data() + 20);
+        uint64_t stringsStart = SEED_HEADER_SIZE + functionCount * 4 + dataVarCount * SEED_DATA_VAR_SIZE +
+            nameCount * SEED_NAME_SIZE;
+        if (stringsStart + stringsSize != data.size() || (stringsSize != 0 && data.back() != 0))
+        {
+            m_file.Close();
+            return false;
+        }
+
+        m_functions = data.data() + SEED_HEADER_SIZE;
+        m_dataVars = m_functions + functionCount * 4;
+        m_names = m_dataVars + dataVarCount * SEED_DATA_VAR_SIZE;
+        m_strings = reinterpret_cast<const char*>(data.data() + stringsStart);
+        m_functionCount = static_cast<uint32_t>(functionCount);
+        m_dataVarCount = static_cast<uint32_t>(dataVarCount);
+        m_nameCount = static_cast<uint32_t>(nameCount);
+        m_stringsSize = static_cast<uint32_t>(stringsSize);
+        return true;
+    }
+
+    string_view SeedCache::GetString(uint32_t offset) const
+    {
+        if (offset >= m_stringsSize)
+            return {};
+        return string_view(m_strings + offset);
+    }
+
+    uint32_t SeedCache::GetFunctionStart(size_t index) const
+    {
+        return LoadLE32(m_functions + index * 4);
+    }
+
+    uint32_t SeedCache::GetDataVarAddress(size_t index) const
+    {
+        return LoadLE32(m_dataVars + index * SEED_DATA_VAR_SIZE);
+    }
+
+    string_view SeedCache::GetDataVarType(size_t index) const
+    {
+        return GetString(LoadLE32(m_dataVars + index * SEED_DATA_VAR_SIZE + 4));
+    }
+
+    uint32_t SeedCache::GetNameAddress(size_t index) const
+    {
+        return LoadLE32(m_names + index * SEED_NAME_SIZE);
+    }
+
+    SeedSymbolKind SeedCache::GetNameKind(size_t index) const
+    {
+        return static_cast<SeedSymbolKind>(LoadLE32(m_names + index * SEED_NAME_SIZE + 4));
+    }
+
+    string_view SeedCache::GetName(size_t index) const
+    {
+        return GetString(LoadLE32(m_names + index * SEED_NAME_SIZE + 8));
+    }
+}  // namespace EspApp
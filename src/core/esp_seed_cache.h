@@ -0,0 +1,83 @@
+#pragma once
+
+#include "esp_app_desc.h"
+#include "esp_image.h"
+#include "esp_mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EspApp
+{
+    enum class SeedSymbolKind : uint32_t
+    {
+        Function = 0,
+        Data = 1,
+    };
+
+    struct SeedDataVar
+    {
+        uint32_t addr;
+        std::string type;  // Type in C syntax, as printed by the analysis
+    };
+
+    struct SeedName
+    {
+        uint32_t addr;
+        SeedSymbolKind kind;
+        std::string name;
+    };
+
+    // Analysis results worth carrying over to the next load of the same build
+    struct AnalysisSeeds
+    {
+        std::vector<uint32_t> function_starts;
+        std::vector<SeedDataVar> data_vars;
+        std::vector<SeedName> names;  // User-confirmed names only
+    };
+
+    // Key that identifies a build independently of the file it was loaded from: the app ELF SHA-256 when
+    // the app description records it, else the SHA-256 appended to the image, else a SHA-256 of the image.
+    // `data` is not read when the ELF hash is there, so callers can pass an empty span for that case.
+    std::string GetSeedCacheKey(std::span<const uint8_t> data, const ParsedImage& image, const AppDesc* desc);
+
+    std::string GetSeedCachePath(const std::string& directory, const std::string& key);
+
+    // Write the seeds as one flat file; the previous file is replaced atomically
+    bool StoreSeedCache(const std::string& path, const AnalysisSeeds& seeds);
+
+    // Memory-mapped seed cache file. Records are read in place; a corrupt file fails to open.
+    class SeedCache
+    {
+        MappedFile m_file;
+        const uint8_t* m_functions = nullptr;
+        const uint8_t* m_dataVars = nullptr;
+        const uint8_t* m_names = nullptr;
+        const char* m_strings = nullptr;
+        uint32_t m_functionCount = 0;
+        uint32_t m_dataVarCount = 0;
+        uint32_t m_nameCount = 0;
+        uint32_t m_stringsSize = 0;
+
+        std::string_view GetString(uint32_t offset) const;
+
+    public:
+        bool Open(const std::string& path);
+
+        size_t GetFunctionCount() const { return m_functionCount; }
+        uint32_t GetFunctionStart(size_t index) const;
+
+        size_t GetDataVarCount() const { return m_dataVarCount; }
+        uint32_t GetDataVarAddress(size_t index) const;
+        std::string_view GetDataVarType(size_t index) const;
+
+        size_t GetNameCount() const { return m_nameCount; }
+        uint32_t GetNameAddress(size_t index) const;
+        SeedSymbolKind GetNameKind(size_t index) const;
+        std::string_view GetName(size_t index) const;
+    };
+}  // namespace EspApp
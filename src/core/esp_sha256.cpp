@@ -0,0 +1,154 @@
+#include "esp_sha256.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace EspApp
+{
+    static const uint32_t g_roundConstants[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    static inline uint32_t Rotr32(uint32_t x, int r)
+    {
+        return (x >> r) | (x << (32 - r));
+    }
+
+    static inline uint32_t LoadBE32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    Sha256::Sha256()
+    {
+        Reset();
+    }
+
+    void Sha256::Reset()
+    {
+        m_state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        m_blockLength = 0;
+        m_totalLength = 0;
+    }
+
+    void Sha256::Compress(const uint8_t* block)
+    {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+            w[i] = LoadBE32(block + i * 4);
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = Rotr32(w[i - 15], 7) ^ Rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = Rotr32(w[i - 2], 17) ^ Rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t s1 = Rotr32(e, 6) ^ Rotr32(e, 11) ^ Rotr32(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + g_roundConstants[i] + w[i];
+            uint32_t s0 = Rotr32(a, 2) ^ Rotr32(a, 13) ^ Rotr32(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+        m_state[5] += f;
+        m_state[6] += g;
+        m_state[7] += h;
+    }
+
+    void Sha256::Update(span<const uint8_t> data)
+    {
+        const uint8_t* p = data.data();
+        size_t remaining = data.size();
+        m_totalLength += remaining;
+
+        if (m_blockLength)
+        {
+            size_t take = min(remaining, m_block.size() - m_blockLength);
+            memcpy(m_block.data() + m_blockLength, p, take);
+            m_blockLength += take;
+            p += take;
+            remaining -= take;
+            if (m_blockLength < m_block.size())
+                return;
+            Compress(m_block.data());
+            m_blockLength = 0;
+        }
+
+        for (; remaining >= 64; p += 64, remaining -= 64)
+            Compress(p);
+
+        if (remaining)
+        {
+            memcpy(m_block.data(), p, remaining);
+            m_blockLength = remaining;
+        }
+    }
+
+    Sha256Digest Sha256::Final()
+    {
+        uint64_t bitLength = m_totalLength * 8;
+        uint8_t padding[72] = {0x80};
+        size_t padLength = (m_blockLength < 56) ? (56 - m_blockLength) : (120 - m_blockLength);
+        for (int i = 0; i < 8; i++)
+            padding[padLength + i] = static_cast<uint8_t>(bitLength >> (56 - i * 8));
+        Update(span<const uint8_t>(padding, padLength + 8));
+
+        Sha256Digest digest;
+        for (int i = 0; i < 8; i++)
+        {
+            digest[i * 4] = static_cast<uint8_t>(m_state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+        }
+        Reset();
+        return digest;
+    }
+
+    Sha256Digest Sha256::Hash(span<const uint8_t> data)
+    {
+        Sha256 sha;
+        sha.Update(data);
+        return sha.Final();
+    }
+
+    string DigestToHex(span<const uint8_t> digest)
+    {
+        static const char hex[] = "0123456789abcdef";
+        string out;
+        out.reserve(digest.size() * 2);
+        for (uint8_t b : digest)
+        {
+            out += hex[b >> 4];
+            out += hex[b & 0xF];
+        }
+        return out;
+    }
+}  // namespace EspApp
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace EspApp
+{
+    using Sha256Digest = std::array<uint8_t, 32>;
+
+    // Streaming SHA-256 (FIPS 180-4). Update may be called with chunks of any size.
+    class Sha256
+    {
+        std::array<uint32_t, 8> m_state;
+        std::array<uint8_t, 64> m_block;
+        size_t m_blockLength;
+        uint64_t m_totalLength;
+
+        void Compress(const uint8_t* block);
+
+    public:
+        Sha256();
+
+        void Reset();
+        void Update(std::span<const uint8_t> data);
+        Sha256Digest Final();
+
+        static Sha256Digest Hash(std::span<const uint8_t> data);
+    };
+
+    std::string DigestToHex(std::span<const uint8_t> digest);
+}  // namespace EspApp
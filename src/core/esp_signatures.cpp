@@ -0,0 +1,312 @@
+#include "esp_signatures.h"
+#include "esp_endian.h"
+#include "esp_hash.h"
+#include "esp_parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+using namespace std;
+
+namespace EspApp
+{
+    static constexpr size_t SIGNATURE_HEADER_SIZE = 32;
+    static constexpr size_t SIGNATURE_ENTRY_SIZE = 24;
+    static constexpr size_t SIGNATURE_CHUNK_SIZE = 0x40000;
+
+    static void NormalizeXtensa(span<const uint8_t> code, uint8_t* out)
+    {
+        for (size_t i = 0; i < code.size();)
+        {
+            uint8_t op0 = code[i] & 0xF;
+            size_t size = op0 >= 8 ? 2 : 3;
+            if (i + size > code.size())
+                break;
+            if (op0 == 1)
+            {
+                // L32R literal offset
+                out[i + 1] = 0;
+                out[i + 2] = 0;
+            }
+            else if (op0 == 5 || (op0 == 6 && ((code[i] >> 4) & 3) == 0))
+            {
+                // CALLn and J: 18-bit offset in bits 6..23
+                out[i] &= 0x3F;
+                out[i + 1] = 0;
+                out[i + 2] = 0;
+            }
+            i += size;
+        }
+    }
+
+    static void NormalizeRiscV(span<const uint8_t> code, uint8_t* out)
+    {
+        bool afterUpper = false;
+        for (size_t i = 0; i < code.size();)
+        {
+            size_t size = (code[i] & 3) == 3 ? 4 : 2;
+            if (i + size > code.size())
+                break;
+
+            bool upper = false;
+            if (size == 2)
+            {
+                // c.jal (RV32) and c.j: everything but the opcode and funct3 is the target
+                uint8_t funct3 = code[i + 1] >> 5;
+                if ((code[i] & 3) == 1 && (funct3 == 1 || funct3 == 5))
+                {
+                    out[i] &= 0x03;
+                    out[i + 1] &= 0xE0;
+                }
+            }
+            else
+            {
+                uint8_t opcode = code[i] & 0x7F;
+                if (opcode == 0x17 || opcode == 0x37 || opcode == 0x6F)
+                {
+                    // AUIPC, LUI, JAL: imm in bits 12..31
+                    out[i + 1] &= 0x0F;
+                    out[i + 2] = 0;
+                    out[i + 3] = 0;
+                    upper = opcode != 0x6F;
+                }
+                else if (afterUpper && (opcode == 0x67 || opcode == 0x03 || opcode == 0x13))
+                {
+                    // JALR, loads and ADDI completing a %pcrel_hi/%hi pair: imm in bits 20..31
+                    out[i + 2] &= 0x0F;
+                    out[i + 3] = 0;
+                }
+                else if (afterUpper && opcode == 0x23)
+                {
+                    // Stores: imm in bits 7..11 and 25..31
+                    out[i] &= 0x7F;
+                    out[i + 1] &= 0xF0;
+                    out[i + 3] &= 0x01;
+                }
+            }
+            afterUpper = upper;
+            i += size;
+        }
+    }
+
+    void NormalizeCode(PrologueArch arch, span<const uint8_t> code, uint8_t* out)
+    {
+        memcpy(out, code.data(), code.size());
+        if (arch == PrologueArch::Xtensa)
+            NormalizeXtensa(code, out);
+        else if (arch == PrologueArch::RiscV)
+            NormalizeRiscV(code, out);
+    }
+
+    uint64_t GetSignatureKey(PrologueArch arch, const uint8_t* p)
+    {
+        uint8_t normalized[ESP_SIGNATURE_KEY_SIZE];
+        NormalizeCode(arch, {p, ESP_SIGNATURE_KEY_SIZE}, normalized);
+        return XxHash64(normalized);
+    }
+
+    bool SignatureIndex::Open(const string& path)
+    {
+        if (!m_file.Open(path))
+            return false;
+
+        span<const uint8_t> data = m_file.GetSpan();
+        if (data.size() < SIGNATURE_HEADER_SIZE || LoadLE32(data.data()) != ESP_SIGNATURE_MAGIC ||
+            LoadLE16(data.data() + 4) != ESP_SIGNATURE_VERSION ||
+            LoadLE32(data.data() + 24) != ESP_SIGNATURE_KEY_SIZE)
+        {
+            m_file.Close();
+            return false;
+        }
+
+        uint64_t bucketCount = LoadLE32(data.data() + 8);
+        uint64_t count = LoadLE32(data.data() + 12);
+        uint64_t stringsSize = LoadLE32(data.data() + 16);
+        uint64_t stringsStart = SIGNATURE_HEADER_SIZE + (bucketCount + 1) * 4 + count * SIGNATURE_ENTRY_SIZE;
+        bool powerOfTwo = bucketCount && (bucketCount & (bucketCount - 1)) == 0;
+        if (!powerOfTwo || stringsStart + stringsSize != data.size() || stringsSize == 0 || data.back() != 0)
+        {
+            m_file.Close();
+            return false;
+        }
+
+        // Bucket starts must be ascending and end at the signature count, so lookups never leave the table
+        const uint8_t* buckets = data.data() + SIGNATURE_HEADER_SIZE;
+        uint32_t previous = 0;
+        for (uint64_t i = 0; i <= bucketCount; i++)
+        {
+            uint32_t first = LoadLE32(buckets + i * 4);
+            if (first < previous || first > count)
+            {
+                m_file.Close();
+                return false;
+            }
+            previous = first;
+        }
+        if (previous != count)
+        {
+            m_file.Close();
+            return false;
+        }
+
+        m_buckets = buckets;
+        m_entries = buckets + (bucketCount + 1) * 4;
+        m_strings = reinterpret_cast<const char*>(data.data() + stringsStart);
+        m_bucketCount = static_cast<uint32_t>(bucketCount);
+        m_count = static_cast<uint32_t>(count);
+        m_stringsSize = static_cast<uint32_t>(stringsSize);
+        m_chipId = static_cast<EspChipId>(LoadLE16(data.data() + 6));
+        m_idfVersion = GetString(LoadLE32(data.data() + 20));
+        return true;
+    }
+
+    string_view SignatureIndex::GetString(uint32_t offset) const
+    {
+        if (offset >= m_stringsSize)
+            return {};
+        return string_view(m_strings + offset);
+    }
+
+    SignatureEntry SignatureIndex::Get(size_t index) const
+    {
+        const uint8_t* p = m_entries + index * SIGNATURE_ENTRY_SIZE;
+        return {LoadLE64(p), LoadLE64(p + 8), LoadLE32(p + 16), GetString(LoadLE32(p + 20))};
+    }
+
+    pair<size_t, size_t> SignatureIndex::GetBucket(uint64_t key) const
+    {
+        if (!m_bucketCount)
+            return {0, 0};
+        size_t bucket = static_cast<size_t>(key & (m_bucketCount - 1));
+        return {LoadLE32(m_buckets + bucket * 4), LoadLE32(m_buckets + (bucket + 1) * 4)};
+    }
+
+    struct SignatureChunk
+    {
+        uint64_t begin;  // File offsets of the candidate starts [begin, end)
+        uint64_t end;
+        uint64_t range_end;
+        uint32_t load_addr;  // Address of `begin`
+    };
+
+    static void MatchChunk(span<const uint8_t> data, const SignatureChunk& chunk, PrologueArch arch,
+        const SignatureIndex& index, vector<SignatureMatch>& out)
+    {
+        size_t step = arch == PrologueArch::Xtensa ? 4 : 2;
+        vector<uint8_t> body;
+        for (uint64_t at = chunk.begin; at < chunk.end && at + ESP_SIGNATURE_KEY_SIZE <= chunk.range_end; at += step)
+        {
+            uint64_t key = GetSignatureKey(arch, data.data() + at);
+            auto [first, last] = index.GetBucket(key);
+            for (size_t i = first; i < last; i++)
+            {
+                SignatureEntry entry = index.Get(i);
+                if (entry.key != key || entry.length > chunk.range_end - at)
+                    continue;
+
+                body.resize(entry.length);
+                NormalizeCode(arch, data.subspan(at, entry.length), body.data());
+                if (XxHash64(body, entry.length) != entry.body_hash)
+                    continue;
+
+                uint32_t addr = chunk.load_addr + static_cast<uint32_t>(at - chunk.begin);
+                out.push_back({addr, entry.length, static_cast<uint32_t>(i)});
+                break;
+            }
+        }
+    }
+
+    vector<SignatureMatch> MatchSignatures(span<const uint8_t> data, span<const CodeRange> ranges, PrologueArch arch,
+        const SignatureIndex& index, size_t maxThreads)
+    {
+        vector<SignatureChunk> chunks;
+        for (const CodeRange& range : ranges)
+        {
+            if (range.file_offset >= data.size())
+                continue;
+            uint64_t end = min<uint64_t>(range.file_offset + range.length, data.size());
+            for (uint64_t at = range.file_offset; at < end; at += SIGNATURE_CHUNK_SIZE)
+            {
+                chunks.push_back({at, min(end, at + SIGNATURE_CHUNK_SIZE), end,
+                    range.load_addr + static_cast<uint32_t>(at - range.file_offset)});
+            }
+        }
+
+        vector<vector<SignatureMatch>> perChunk(chunks.size());
+        ParallelFor(chunks.size(), [&](size_t i) {
+            MatchChunk(data, chunks[i], arch, index, perChunk[i]);
+        }, maxThreads);
+
+        vector<SignatureMatch> matches;
+        for (const auto& found : perChunk)
+            matches.insert(matches.end(), found.begin(), found.end());
+        sort(matches.begin(), matches.end(),
+            [](const SignatureMatch& a, const SignatureMatch& b) { return a.addr < b.addr; });
+
+        // A name found at several places does not identify any of them
+        vector<uint32_t> entries;
+        for (const auto& match : matches)
+            entries.push_back(match.entry);
+        sort(entries.begin(), entries.end());
+
+        vector<SignatureMatch> result;
+        uint64_t covered = 0;
+        for (const auto& match : matches)
+        {
+            auto [lo, hi] = equal_range(entries.begin(), entries.end(), match.entry);
+            if (hi - lo > 1 || match.addr < covered)
+                continue;
+            result.push_back(match);
+            covered = uint64_t(match.addr) + match.length;
+        }
+        return result;
+    }
+
+    // "v5.1.2" -> "v5.1", "v5.1-dirty" -> "v5.1"
+    static string_view GetIdfRelease(string_view version)
+    {
+        size_t dot = version.find('.');
+        if (dot == string_view::npos)
+            return version;
+        size_t end = version.find_first_not_of("0123456789", dot + 1);
+        return version.substr(0, end);
+    }
+
+    bool IsSameIdfRelease(string_view a, string_view b)
+    {
+        return !a.empty() && !b.empty() && GetIdfRelease(a) == GetIdfRelease(b);
+    }
+
+    vector<string> FindSignatureDatabases(const string& directory, EspChipId chipId, string_view idfVersion,
+        bool otherReleases)
+    {
+        vector<pair<int, string>> found;
+        error_code ec;
+        for (auto it = filesystem::directory_iterator(directory, ec);
+             !ec && it != filesystem::directory_iterator(); it.increment(ec))
+        {
+            if (it->path().extension() != ".sig")
+                continue;
+
+            SignatureIndex index;
+            if (!index.Open(it->path().string()) || index.GetChipId() != chipId)
+                continue;
+
+            int rank = 2;
+            if (!idfVersion.empty() && index.GetIdfVersion() == idfVersion)
+                rank = 0;
+            else if (IsSameIdfRelease(index.GetIdfVersion(), idfVersion))
+                rank = 1;
+            else if (!otherReleases)
+                continue;
+            found.push_back({rank, it->path().string()});
+        }
+        sort(found.begin(), found.end());
+
+        vector<string> paths;
+        for (auto& [rank, path] : found)
+            paths.push_back(std::move(path));
+        return paths;
+    }
+}  // namespace EspApp
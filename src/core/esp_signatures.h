@@ -0,0 +1,92 @@
+#pragma once
+
+#include "esp_chip.h"
+#include "esp_mapped_file.h"
+#include "esp_prologue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace EspApp
+{
+    constexpr uint32_t ESP_SIGNATURE_MAGIC = 0x47495345;  // 'ESIG'
+    constexpr uint16_t ESP_SIGNATURE_VERSION = 1;
+
+    // Functions are looked up by a hash of their first bytes and confirmed by a hash of their whole body
+    constexpr size_t ESP_SIGNATURE_KEY_SIZE = 16;
+
+    // Copy `code` to `out` with the operand bits that the linker fills in zeroed: L32R and CALL/J targets on
+    // Xtensa; AUIPC/LUI/JAL immediates, the low 12 bits used right after AUIPC/LUI and c.j/c.jal targets on
+    // RISC-V. Instructions are walked from the start of `code`. scripts/gen_signatures.py mirrors this.
+    void NormalizeCode(PrologueArch arch, std::span<const uint8_t> code, uint8_t* out);
+
+    // Lookup key of a function starting at p[0, ESP_SIGNATURE_KEY_SIZE)
+    uint64_t GetSignatureKey(PrologueArch arch, const uint8_t* p);
+
+    struct SignatureEntry
+    {
+        uint64_t key;
+        uint64_t body_hash;  // XxHash64 of the normalized function, seeded with its length
+        uint32_t length;
+        std::string_view name;
+    };
+
+    // Memory-mapped signature database for one chip and ESP-IDF version, written by scripts/gen_signatures.py:
+    //   u32 magic, u16 version, u16 chip id, u32 bucket count (power of two), u32 signature count,
+    //   u32 string table size, u32 IDF version string offset, u32 key size, u32 0
+    //   (bucket count + 1) * u32 first signature of each bucket
+    //   signature count * { u64 key, u64 body hash, u32 length, u32 name offset }   (grouped by bucket)
+    //   string table (NUL terminated)
+    // Records are read in place; a corrupt file fails to open.
+    class SignatureIndex
+    {
+        MappedFile m_file;
+        const uint8_t* m_buckets = nullptr;
+        const uint8_t* m_entries = nullptr;
+        const char* m_strings = nullptr;
+        uint32_t m_bucketCount = 0;
+        uint32_t m_count = 0;
+        uint32_t m_stringsSize = 0;
+        EspChipId m_chipId = EspChipId::Invalid;
+        std::string_view m_idfVersion;
+
+        std::string_view GetString(uint32_t offset) const;
+
+    public:
+        bool Open(const std::string& path);
+
+        EspChipId GetChipId() const { return m_chipId; }
+        std::string_view GetIdfVersion() const { return m_idfVersion; }
+        size_t GetCount() const { return m_count; }
+        SignatureEntry Get(size_t index) const;
+
+        // Entries [first, last) that share the bucket of `key`; callers compare the keys
+        std::pair<size_t, size_t> GetBucket(uint64_t key) const;
+    };
+
+    struct SignatureMatch
+    {
+        uint32_t addr;
+        uint32_t length;
+        uint32_t entry;  // Index into the SignatureIndex
+    };
+
+    // Try every instruction-aligned offset of the code ranges against `index`, in chunks spread across worker
+    // threads. Returns non-overlapping matches in ascending address order; names that match more than one
+    // place are dropped.
+    std::vector<SignatureMatch> MatchSignatures(std::span<const uint8_t> data, std::span<const CodeRange> ranges,
+        PrologueArch arch, const SignatureIndex& index, size_t maxThreads = 0);
+
+    // True if both versions name the same major.minor ESP-IDF release ("v5.1.2" and "v5.1-dirty")
+    bool IsSameIdfRelease(std::string_view a, std::string_view b);
+
+    // Databases in `directory` for `chipId`, best first: the exact IDF version, then the same major.minor
+    // release, then, with `otherReleases`, the remaining ones
+    std::vector<std::string> FindSignatureDatabases(
+        const std::string& directory, EspChipId chipId, std::string_view idfVersion, bool otherReleases);
+}  // namespace EspApp
@@ -0,0 +1,201 @@
+#include "esp_verify.h"
+#include "esp_hash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+namespace EspApp
+{
+    ImageTrailer LocateImageTrailer(const ParsedImage& image)
+    {
+        // esptool pads the image so that the checksum is the last byte of a 16-byte block
+        uint64_t length = image.end_offset - image.base_offset;
+        uint64_t padding = 15 - (length % 16);
+
+        ImageTrailer trailer;
+        trailer.checksum_offset = image.end_offset + padding;
+        trailer.hash_offset = trailer.checksum_offset + 1;
+        trailer.image_end = trailer.hash_offset + (image.header.hash_appended ? sizeof(Sha256Digest) : 0);
+        return trailer;
+    }
+
+    uint8_t XorBytes(const uint8_t* p, size_t length)
+    {
+        uint64_t wide = 0;
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, p + i, sizeof(word));
+            wide ^= word;
+        }
+
+        uint8_t result = 0;
+        for (int shift = 0; shift < 64; shift += 8)
+            result ^= static_cast<uint8_t>(wide >> shift);
+        for (; i < length; i++)
+            result ^= p[i];
+        return result;
+    }
+
+    ImageVerifier::ImageVerifier(span<const uint8_t> data, const ParsedImage& image) :
+        m_data(data), m_image(image), m_trailer(LocateImageTrailer(image)), m_position(image.base_offset),
+        m_segmentCursor(0), m_checksum(ESP_CHECKSUM_MAGIC), m_result {}, m_done(false)
+    {
+        // The digest covers everything from the header up to and including the checksum byte
+        m_hashEnd = min<uint64_t>(m_trailer.checksum_offset + 1, data.size());
+        m_result.hash_appended = image.header.hash_appended != 0;
+    }
+
+    bool ImageVerifier::Step(size_t maxBytes)
+    {
+        if (m_done)
+            return true;
+
+        uint64_t end = min<uint64_t>(m_hashEnd, m_position + max<size_t>(maxBytes, 1));
+        m_sha.Update(m_data.subspan(m_position, end - m_position));
+
+        // XOR the parts of segment data that fall into this chunk. Segments are in file order.
+        auto segments = m_image.Segments();
+        while (m_segmentCursor < segments.size())
+        {
+            const auto& seg = segments[m_segmentCursor];
+            uint64_t segEnd = seg.file_offset + seg.data_len;
+            uint64_t from = max(m_position, seg.file_offset);
+            uint64_t to = min(end, segEnd);
+            if (from < to)
+                m_checksum ^= XorBytes(m_data.data() + from, to - from);
+            if (segEnd > end)
+                break;
+            m_segmentCursor++;
+        }
+
+        m_position = end;
+        if (m_position >= m_hashEnd)
+            Finish();
+        return m_done;
+    }
+
+    void ImageVerifier::Finish()
+    {
+        m_done = true;
+        m_result.checksum_computed = m_checksum;
+        m_result.checksum_present = m_trailer.checksum_offset < m_data.size();
+        if (m_result.checksum_present)
+            m_result.checksum_expected = m_data[m_trailer.checksum_offset];
+
+        m_result.hash_computed = m_sha.Final();
+        if (m_result.hash_appended && m_trailer.image_end <= m_data.size())
+        {
+            m_result.hash_present = true;
+            memcpy(m_result.hash_expected.data(), m_data.data() + m_trailer.hash_offset, sizeof(Sha256Digest));
+        }
+    }
+
+    double ImageVerifier::GetProgress() const
+    {
+        uint64_t total = m_hashEnd - m_image.base_offset;
+        if (m_done || total == 0)
+            return 1.0;
+        return static_cast<double>(m_position - m_image.base_offset) / static_cast<double>(total);
+    }
+
+    ImageVerifyResult VerifyImage(span<const uint8_t> data, const ParsedImage& image)
+    {
+        ImageVerifier verifier(data, image);
+        verifier.Step(SIZE_MAX);
+        return verifier.GetResult();
+    }
+
+    optional<FileIdentity> GetFileIdentity(const string& path)
+    {
+        error_code ec;
+        filesystem::path p(path);
+        uint64_t size = filesystem::file_size(p, ec);
+        if (ec)
+            return nullopt;
+        auto mtime = filesystem::last_write_time(p, ec);
+        if (ec)
+            return nullopt;
+
+        FileIdentity identity;
+        identity.path = filesystem::absolute(p, ec).string();
+        if (ec)
+            identity.path = path;
+        identity.size = size;
+        identity.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+        return identity;
+    }
+
+    uint64_t GetFileIdentityKey(const FileIdentity& identity, uint64_t imageOffset)
+    {
+        uint64_t fields[3] = {identity.size, static_cast<uint64_t>(identity.mtime), imageOffset};
+        uint64_t seed = XxHash64(span<const uint8_t>(reinterpret_cast<const uint8_t*>(fields), sizeof(fields)));
+        return XxHash64(span<const uint8_t>(reinterpret_cast<const uint8_t*>(identity.path.data()),
+            identity.path.size()), seed);
+    }
+
+    // On-disk record: magic, then the result fields in a fixed layout
+    static constexpr char g_verifyCacheMagic[8] = {'E', 'S', 'P', 'V', 'R', 'F', 'Y', '1'};
+
+    static filesystem::path GetVerifyCachePath(const string& directory, uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.verify", static_cast<unsigned long long>(key));
+        return filesystem::path(directory) / name;
+    }
+
+    bool LoadCachedVerifyResult(const string& directory, uint64_t key, ImageVerifyResult& out)
+    {
+        ifstream in(GetVerifyCachePath(directory, key), ios::binary);
+        uint8_t record[sizeof(g_verifyCacheMagic) + 6 + 2 * sizeof(Sha256Digest)];
+        if (!in.read(reinterpret_cast<char*>(record), sizeof(record)))
+            return false;
+        if (memcmp(record, g_verifyCacheMagic, sizeof(g_verifyCacheMagic)) != 0)
+            return false;
+
+        const uint8_t* p = record + sizeof(g_verifyCacheMagic);
+        out.checksum_present = p[0] != 0;
+        out.checksum_expected = p[1];
+        out.checksum_computed = p[2];
+        out.hash_appended = p[3] != 0;
+        out.hash_present = p[4] != 0;
+        memcpy(out.hash_expected.data(), p + 6, sizeof(Sha256Digest));
+        memcpy(out.hash_computed.data(), p + 6 + sizeof(Sha256Digest), sizeof(Sha256Digest));
+        return true;
+    }
+
+    bool StoreCachedVerifyResult(const string& directory, uint64_t key, const ImageVerifyResult& result)
+    {
+        error_code ec;
+        filesystem::create_directories(directory, ec);
+
+        uint8_t record[sizeof(g_verifyCacheMagic) + 6 + 2 * sizeof(Sha256Digest)] = {};
+        memcpy(record, g_verifyCacheMagic, sizeof(g_verifyCacheMagic));
+        uint8_t* p = record + sizeof(g_verifyCacheMagic);
+        p[0] = result.checksum_present;
+        p[1] = result.checksum_expected;
+        p[2] = result.checksum_computed;
+        p[3] = result.hash_appended;
+        p[4] = result.hash_present;
+        memcpy(p + 6, result.hash_expected.data(), sizeof(Sha256Digest));
+        memcpy(p + 6 + sizeof(Sha256Digest), result.hash_computed.data(), sizeof(Sha256Digest));
+
+        // Write to a temporary name first so a concurrent reader never sees a partial record
+        filesystem::path path = GetVerifyCachePath(directory, key);
+        filesystem::path temp = path;
+        temp += ".tmp";
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out.write(reinterpret_cast<const char*>(record), sizeof(record)))
+                return false;
+        }
+        filesystem::rename(temp, path, ec);
+        return !ec;
+    }
+}  // namespace EspApp
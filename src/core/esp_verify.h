@@ -0,0 +1,89 @@
+#pragma once
+
+#include "esp_image.h"
+#include "esp_sha256.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace EspApp
+{
+    constexpr uint8_t ESP_CHECKSUM_MAGIC = 0xEF;
+
+    // Location of the checksum byte and optional SHA-256 digest that esptool appends after the last
+    // segment. Offsets are relative to the data the image was parsed from.
+    struct ImageTrailer
+    {
+        uint64_t checksum_offset;  // Last byte of the 16-byte aligned padding after the segments
+        uint64_t hash_offset;      // checksum_offset + 1, only meaningful if the header sets hash_appended
+        uint64_t image_end;        // Offset just past the trailer
+    };
+
+    ImageTrailer LocateImageTrailer(const ParsedImage& image);
+
+    // XOR of `length` bytes; the image checksum is ESP_CHECKSUM_MAGIC XORed with every segment's data
+    uint8_t XorBytes(const uint8_t* p, size_t length);
+
+    struct ImageVerifyResult
+    {
+        bool checksum_present;      // False if the image is truncated before the checksum byte
+        uint8_t checksum_expected;
+        uint8_t checksum_computed;
+
+        bool hash_appended;         // Header flag
+        bool hash_present;          // False if the image is truncated inside the digest
+        Sha256Digest hash_expected;
+        Sha256Digest hash_computed;
+
+        bool ChecksumValid() const { return checksum_present && checksum_expected == checksum_computed; }
+        bool HashValid() const { return !hash_appended || (hash_present && hash_expected == hash_computed); }
+        bool IsValid() const { return ChecksumValid() && HashValid(); }
+    };
+
+    // Incremental checksum and SHA-256 verification. The image is walked once, front to back, in
+    // caller-sized steps so the work can be spread over time, reported as progress and cancelled.
+    class ImageVerifier
+    {
+        std::span<const uint8_t> m_data;
+        ParsedImage m_image;
+        ImageTrailer m_trailer;
+        uint64_t m_position;
+        uint64_t m_hashEnd;
+        size_t m_segmentCursor;
+        uint8_t m_checksum;
+        Sha256 m_sha;
+        ImageVerifyResult m_result;
+        bool m_done;
+
+        void Finish();
+
+    public:
+        ImageVerifier(std::span<const uint8_t> data, const ParsedImage& image);
+
+        // Process up to `maxBytes`; returns true once verification is complete
+        bool Step(size_t maxBytes);
+        bool IsDone() const { return m_done; }
+        double GetProgress() const;
+        const ImageVerifyResult& GetResult() const { return m_result; }
+    };
+
+    ImageVerifyResult VerifyImage(std::span<const uint8_t> data, const ParsedImage& image);
+
+    // Identity of a file on disk for caching derived results. Changes whenever the file is rewritten.
+    struct FileIdentity
+    {
+        std::string path;
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    std::optional<FileIdentity> GetFileIdentity(const std::string& path);
+    uint64_t GetFileIdentityKey(const FileIdentity& identity, uint64_t imageOffset);
+
+    // Verification results cached on disk, one small record per (file identity, image offset)
+    bool LoadCachedVerifyResult(const std::string& directory, uint64_t key, ImageVerifyResult& out);
+    bool StoreCachedVerifyResult(const std::string& directory, uint64_t key, const ImageVerifyResult& result);
+}  // namespace EspApp
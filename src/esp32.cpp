@@ -1,40 +1,59 @@
 #include "esp32.h"
 #include "binaryninjacore.h"
+#include "core/esp_literals.h"
 
+#include <algorithm>
+
+using namespace std;
 using namespace BinaryNinja;
 
 namespace EspApp
 {
-#define RO  (SegmentReadable)
-#define RW  (SegmentReadable | SegmentWritable)
-#define RX  (SegmentReadable | SegmentExecutable)
-#define RWX (SegmentReadable | SegmentWritable | SegmentExecutable)
-
-    const MemoryRegion g_esp32Regions[] = {
-        {"external.data.1",        0x3F400000, 0x3F800000, RW | SegmentContainsData, DefaultSectionSemantics},
-        {"external.data.2",        0x3F800000, 0x3FC00000, RW | SegmentContainsData, DefaultSectionSemantics},
-        {"peripheral",             0x3FF00000, 0x3FF80000, RW,                       DefaultSectionSemantics},
-        {"embedded.data.rtc_fast", 0x3FF80000, 0x3FF82000, RW,                       DefaultSectionSemantics},
-        {"embedded.data.rom.1",    0x3FF90000, 0x3FFA0000, RO | SegmentContainsData, ExternalSectionSemantics},
-        {"embedded.data.ram.2",    0x3FFAE000, 0x3FFE0000, RW,                       DefaultSectionSemantics},
-        {"embedded.data.ram.1",    0x3FFE0000, 0x40000000, RW,                       DefaultSectionSemantics},
-        {"embedded.code.rom.0.1",  0x40000000, 0x40008000, RX | SegmentContainsCode, ExternalSectionSemantics},
-        {"embedded.code.rom.0.2",  0x40008000, 0x40060000, RX | SegmentContainsCode, ExternalSectionSemantics},
-        {"embedded.code.ram.0.1",  0x40070000, 0x40080000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"embedded.code.ram.0.2",  0x40080000, 0x400A0000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"embedded.code.ram.1.1",  0x400A0000, 0x400B0000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"embedded.code.ram.1.2",  0x400B0000, 0x400B8000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"embedded.code.ram.1.3",  0x400B8000, 0x400C0000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"embedded.code.rtc_fast", 0x400C0000, 0x400C2000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"external.code.0",        0x400C2000, 0x40C00000, RX | SegmentContainsCode, DefaultSectionSemantics},
-        {"embedded.rtc_slow",      0x50000000, 0x50002000, RWX                     , DefaultSectionSemantics},
-    };
+    // Define the literal pools the prologue sweep resolved: each pool word becomes a data variable (pointer
+    // typed when it points into the address space, which yields the string and function xrefs immediately)
+    // with an auto data reference from every L32R that loads it, and literals that point at an `entry` become
+    // function starts. Only the symbol updates are batched; variables and references are added one by one.
+    static void ApplyLiteralPools(EspAppView* view)
+    {
+        Ref<Architecture> arch = view->GetDefaultArchitecture();
+        Ref<Platform> plat = view->GetDefaultPlatform();
+        LiteralScanResult result = view->TakeLiteralScan();
+        if (!arch || !plat || result.loads.empty())
+            return;
+
+        // Many loads share a literal; define each pool word once
+        vector<LiteralLoad> byLiteral = result.loads;
+        sort(byLiteral.begin(), byLiteral.end(),
+            [](const LiteralLoad& a, const LiteralLoad& b) { return a.literal_addr < b.literal_addr; });
+        byLiteral.erase(unique(byLiteral.begin(), byLiteral.end(),
+            [](const LiteralLoad& a, const LiteralLoad& b) { return a.literal_addr == b.literal_addr; }),
+            byLiteral.end());
+
+        Ref<Type> pointerType = Type::PointerType(arch, Type::VoidType());
+        Ref<Type> wordType = Type::IntegerType(4, false);
+        size_t pointers = 0;
+        view->BeginBulkModifySymbols();
+        for (const LiteralLoad& load : byLiteral)
+        {
+            bool isPointer = view->IsValidOffset(load.value);
+            view->DefineDataVariable(load.literal_addr, isPointer ? pointerType : wordType);
+            pointers += isPointer;
+        }
+        for (const LiteralLoad& load : result.loads)
+            view->AddDataReference(load.insn_addr, load.literal_addr);
+        view->EndBulkModifySymbols();
 
-    const size_t g_esp32RegionCount = sizeof(g_esp32Regions) / sizeof(g_esp32Regions[0]);
+        for (uint32_t target : result.code_pointers)
+            view->AddFunctionForAnalysis(plat, target, true);
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        logger->LogInfo("Resolved %zu L32R loads: %zu literals (%zu pointers), %zu functions reached via literals",
+            result.loads.size(), byLiteral.size(), pointers, result.code_pointers.size());
+    }
 
     void Esp32PostInit(EspAppView* view)
     {
-		return;
+        ApplyLiteralPools(view);
     }
 
     void Esp32OnPluginInit()
@@ -42,19 +61,23 @@ namespace EspApp
         return;
     }
 
-    const ChipAttr g_esp32Attr = {
+    const ChipHooks g_esp32Hooks = {
         EspChipId::ESP32,
-		"ESP32",
-		"esp32",
-		g_esp32Regions,
-		g_esp32RegionCount,
 		Esp32PostInit,
 		Esp32OnPluginInit
 	};
 
-#undef RO
-#undef RW
-#undef RX
-#undef RWX
+    // The S2 and S3 share the Xtensa windowed ABI and literal pools with the original ESP32
+    const ChipHooks g_esp32s2Hooks = {
+        EspChipId::ESP32_S2,
+        Esp32PostInit,
+        nullptr
+    };
+
+    const ChipHooks g_esp32s3Hooks = {
+        EspChipId::ESP32_S3,
+        Esp32PostInit,
+        nullptr
+    };
 
 }  // namespace EspApp
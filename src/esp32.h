@@ -4,9 +4,9 @@
 
 namespace EspApp
 {
-    extern const MemoryRegion g_esp32Regions[];
-    extern const size_t g_esp32RegionCount;
-    extern const ChipAttr g_esp32Attr;
+    extern const ChipHooks g_esp32Hooks;
+    extern const ChipHooks g_esp32s2Hooks;
+    extern const ChipHooks g_esp32s3Hooks;
     void Esp32PostInit(EspAppView* view);
     void Esp32OnPluginInit();
 }  // namespace EspApp
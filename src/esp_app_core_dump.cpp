@@ -0,0 +1,370 @@
+#include "esp_app_core_dump.h"
+#include "esp_app_view.h"
+#include "core/esp_core_dump.h"
+#include "core/esp_endian.h"
+#include "core/esp_mapped_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static const char* g_coreDumpTagType = "ESP Core Dump";
+    static constexpr size_t TASK_RECORD_HEADER = 32;  // tcb, name[16], stack_top, stack_end, crashed
+
+    struct AttachedCoreDump;
+
+    // One overlaid address range, read out of the dump's mapping when analysis or the UI asks for it
+    class CoreDumpMemory : public FileAccessor
+    {
+        const AttachedCoreDump& m_dump;
+        uint64_t m_start;
+        uint64_t m_length;
+
+    public:
+        CoreDumpMemory(const AttachedCoreDump& dump, uint64_t start, uint64_t length) :
+            m_dump(dump), m_start(start), m_length(length)
+        {}
+
+        virtual bool IsValid() const override { return true; }
+        virtual uint64_t GetLength() const override { return m_length; }
+        virtual size_t Read(void* dest, uint64_t offset, size_t len) override;
+        virtual size_t Write(uint64_t, const void*, size_t) override { return 0; }
+    };
+
+    struct AttachedCoreDump
+    {
+        MappedFile file;
+        ParsedCoreDump dump;
+        vector<unique_ptr<CoreDumpMemory>> windows;
+        vector<string> region_names;
+    };
+
+    // Dumps per file session; the memory map reads through their accessors for as long as the view lives
+    static mutex g_coreDumpMutex;
+    static map<size_t, unique_ptr<AttachedCoreDump>> g_coreDumps;
+
+    size_t CoreDumpMemory::Read(void* dest, uint64_t offset, size_t len)
+    {
+        if (offset >= m_length)
+            return 0;
+        len = static_cast<size_t>(min<uint64_t>(len, m_length - offset));
+        m_dump.dump.Read(m_dump.file.GetSpan(), static_cast<uint32_t>(m_start + offset), dest, len);
+        return len;
+    }
+
+    struct AddressRange
+    {
+        uint64_t start;
+        uint64_t end;
+    };
+
+    static bool IsRamRegion(const MemoryRegion& region)
+    {
+        string_view name(region.name);
+        return name.starts_with("embedded.data.ram") || name.starts_with("embedded.ram");
+    }
+
+    // Snapshot ranges inside the chip's RAM regions that no image segment backs. Deferred RAM regions the
+    // dump touches are mapped first.
+    static vector<AddressRange> GetOverlayRanges(BinaryView* view, const ChipAttr& attr, const ParsedCoreDump& dump)
+    {
+        vector<AddressRange> ranges;
+        vector<const MemoryRegion*> deferred;
+        for (size_t i = 0; i < attr.region_count; i++)
+        {
+            const MemoryRegion& region = attr.regions[i];
+            if (!IsRamRegion(region))
+                continue;
+            size_t before = ranges.size();
+            for (const CoreDumpSegment& seg : dump.segments)
+            {
+                uint64_t start = max<uint64_t>(seg.addr, region.start_addr);
+                uint64_t end = min<uint64_t>(uint64_t(seg.addr) + seg.size, region.end_addr);
+                if (start < end)
+                    ranges.push_back({start, end});
+            }
+            if (ranges.size() != before && !view->GetSegmentAt(region.start_addr))
+                deferred.push_back(&region);
+        }
+        MapDeferredRegions(view, deferred);
+
+        auto byStart = [](const AddressRange& a, const AddressRange& b) { return a.start < b.start; };
+        sort(ranges.begin(), ranges.end(), byStart);
+        vector<AddressRange> merged;
+        for (const AddressRange& range : ranges)
+        {
+            if (!merged.empty() && range.start <= merged.back().end)
+                merged.back().end = max(merged.back().end, range.end);
+            else
+                merged.push_back(range);
+        }
+
+        vector<AddressRange> backed;
+        for (const auto& segment : view->GetSegments())
+        {
+            if (segment->GetDataLength())
+                backed.push_back({segment->GetStart(), segment->GetStart() + segment->GetDataLength()});
+        }
+        sort(backed.begin(), backed.end(), byStart);
+
+        vector<AddressRange> unbacked;
+        for (const AddressRange& range : merged)
+        {
+            uint64_t cursor = range.start;
+            for (const AddressRange& data : backed)
+            {
+                if (data.end <= cursor)
+                    continue;
+                if (data.start >= range.end)
+                    break;
+                if (data.start > cursor)
+                    unbacked.push_back({cursor, data.start});
+                cursor = max(cursor, data.end);
+            }
+            if (cursor < range.end)
+                unbacked.push_back({cursor, range.end});
+        }
+        return unbacked;
+    }
+
+    static string GetTaskLabel(const CoreDumpTask& task)
+    {
+        if (!task.name[0])
+        {
+            char label[16];
+            snprintf(label, sizeof(label), "tcb_%08x", task.tcb_addr);
+            return label;
+        }
+        string label;
+        for (const char* c = task.name; *c; c++)
+            label += isalnum(static_cast<unsigned char>(*c)) ? *c : '_';
+        return label;
+    }
+
+    static void DefineTaskTable(BinaryView* view, const ParsedCoreDump& dump)
+    {
+        span<const char* const> regNames = GetCoreDumpRegisterNames(dump.arch);
+        Ref<Type> u32 = Type::IntegerType(4, false);
+
+        StructureBuilder regs;
+        for (const char* name : regNames)
+            regs.AddMember(u32, name);
+        QualifiedName regsName(dump.arch == CoreDumpArch::Xtensa ? "esp_core_dump_xtensa_regs_t" :
+            "esp_core_dump_riscv_regs_t");
+        view->DefineType(Type::GenerateAutoTypeId("esp", regsName), regsName, Type::StructureType(regs.Finalize()));
+
+        StructureBuilder task;
+        task.AddMember(Type::PointerType(4, Type::VoidType()), "tcb");
+        task.AddMember(Type::ArrayType(Type::IntegerType(1, true), ESP_CORE_DUMP_TASK_NAME_LEN), "name");
+        task.AddMember(u32, "stack_top");
+        task.AddMember(u32, "stack_end");
+        task.AddMember(u32, "crashed");
+        task.AddMember(Type::NamedType(view, regsName), "regs");
+        QualifiedName taskName("esp_core_dump_task_t");
+        view->DefineType(Type::GenerateAutoTypeId("esp", taskName), taskName, Type::StructureType(task.Finalize()));
+
+        size_t recordSize = TASK_RECORD_HEADER + regNames.size() * 4;
+        DataBuffer table(dump.tasks.size() * recordSize);
+        auto out = static_cast<uint8_t*>(table.GetData());
+        memset(out, 0, table.GetLength());
+        for (size_t i = 0; i < dump.tasks.size(); i++)
+        {
+            const CoreDumpTask& t = dump.tasks[i];
+            uint8_t* record = out + i * recordSize;
+            StoreLE32(record, t.tcb_addr);
+            memcpy(record + 4, t.name, strlen(t.name));
+            StoreLE32(record + 20, t.stack_top);
+            StoreLE32(record + 24, t.stack_end);
+            StoreLE32(record + 28, i == dump.crashed_task);
+            for (size_t r = 0; r < regNames.size(); r++)
+                StoreLE32(record + TASK_RECORD_HEADER + r * 4, t.regs[r]);
+        }
+
+        view->GetMemoryMap()->AddDataMemoryRegion("esp.core_dump.tasks", ESP_CORE_DUMP_TASK_TABLE_ADDR, table,
+            SegmentReadable | SegmentContainsData);
+        view->AddAutoSection("esp.core_dump.tasks", ESP_CORE_DUMP_TASK_TABLE_ADDR, table.GetLength(),
+            ReadOnlyDataSectionSemantics);
+        view->DefineDataVariable(ESP_CORE_DUMP_TASK_TABLE_ADDR,
+            Type::ArrayType(Type::NamedType(view, taskName), dump.tasks.size()));
+        view->DefineAutoSymbol(new Symbol(DataSymbol, "core_dump_tasks", ESP_CORE_DUMP_TASK_TABLE_ADDR, GlobalBinding));
+    }
+
+    static string AnnotateTasks(BinaryView* view, const ParsedCoreDump& dump)
+    {
+        if (!view->GetTagType(g_coreDumpTagType))
+            view->AddTagType(new TagType(view, g_coreDumpTagType, "\xf0\x9f\x92\xa5"));
+
+        string markdown = "| Task | TCB | PC | Function | Stack |\n|---|---|---|---|---|\n";
+        for (size_t i = 0; i < dump.tasks.size(); i++)
+        {
+            const CoreDumpTask& task = dump.tasks[i];
+            string label = GetTaskLabel(task);
+            bool crashed = i == dump.crashed_task;
+
+            view->DefineAutoSymbol(new Symbol(DataSymbol, "core_dump_tcb_" + label, task.tcb_addr, GlobalBinding));
+            if (task.stack_end > task.stack_top)
+            {
+                view->DefineDataVariable(task.stack_top,
+                    Type::ArrayType(Type::IntegerType(4, false), (task.stack_end - task.stack_top) / 4));
+                view->DefineAutoSymbol(
+                    new Symbol(DataSymbol, "core_dump_stack_" + label, task.stack_top, GlobalBinding));
+            }
+
+            char text[96];
+            snprintf(text, sizeof(text), "Task %s%s: pc 0x%08x, sp 0x%08x", label.c_str(), crashed ? " (crashed)" : "",
+                task.GetPc(), task.regs[GetCoreDumpStackPointerIndex(dump.arch)]);
+            view->CreateAutoDataTag(task.GetPc(), g_coreDumpTagType, text, true);
+
+            string function;
+            vector<Ref<Function>> functions = view->GetAnalysisFunctionsContainingAddress(task.GetPc());
+            if (!functions.empty())
+                function = functions[0]->GetSymbol()->GetShortName();
+
+            char row[160];
+            snprintf(row, sizeof(row), "| %s%s | 0x%08x | 0x%08x | %s | 0x%08x-0x%08x |\n", label.c_str(),
+                crashed ? " (crashed)" : "", task.tcb_addr, task.GetPc(), function.c_str(), task.stack_top,
+                task.stack_end);
+            markdown += row;
+        }
+        return markdown;
+    }
+
+    static bool CheckDumpMatchesView(BinaryView* view, const ParsedCoreDump& dump, const ChipAttr& attr, Logger* logger)
+    {
+        bool xtensa = string(attr.arch_name) == "esp32";
+        if ((dump.chip_id != EspChipId::Invalid && dump.chip_id != attr.chip_id) ||
+            xtensa != (dump.arch == CoreDumpArch::Xtensa))
+        {
+            logger->LogError("Cannot attach core dump: it was not taken on an %s", attr.chip_name);
+            return false;
+        }
+
+        // The dump records a prefix of the app ELF SHA-256 (CONFIG_APP_RETRIEVE_LEN_ELF_SHA characters)
+        Ref<Metadata> desc = view->QueryMetadata("esp.app_desc");
+        if (!dump.app_elf_sha256.empty() && desc && desc->IsKeyValueStore())
+        {
+            auto store = desc->GetKeyValueStore();
+            string appSha = store.count("app_elf_sha256") ? store["app_elf_sha256"]->GetString() : "";
+            if (appSha.compare(0, dump.app_elf_sha256.size(), dump.app_elf_sha256) != 0)
+                logger->LogWarn("Core dump was taken from a different build (app ELF SHA-256 %s, image %s)",
+                    dump.app_elf_sha256.c_str(), appSha.c_str());
+        }
+        return true;
+    }
+
+    bool AttachCoreDump(BinaryView* view, const string& path, bool report)
+    {
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        auto attached = make_unique<AttachedCoreDump>();
+        if (!attached->file.Open(path))
+        {
+            logger->LogError("Cannot attach core dump: failed to open %s", path.c_str());
+            return false;
+        }
+        CoreDumpParseStatus status = ParseCoreDump(attached->file.GetSpan(), attached->dump);
+        if (status != CoreDumpParseStatus::Ok)
+        {
+            logger->LogError("Cannot attach core dump %s: %s", path.c_str(), GetCoreDumpParseStatusString(status));
+            return false;
+        }
+        const ParsedCoreDump& dump = attached->dump;
+
+        RawViewBytes raw(view->GetParentView());
+        ParsedImage image;
+        const ChipAttr* attr = ParseViewImage(view, raw.GetSpan(), image) ? GetChipAttrById(image.ChipId()) : nullptr;
+        if (!attr || !CheckDumpMatchesView(view, dump, *attr, logger))
+            return false;
+
+        lock_guard<mutex> lock(g_coreDumpMutex);
+        MemoryMap* memoryMap = view->GetMemoryMap();
+        unique_ptr<AttachedCoreDump>& slot = g_coreDumps[view->GetFile()->GetSessionId()];
+        if (slot)
+        {
+            for (const string& name : slot->region_names)
+                memoryMap->RemoveMemoryRegion(name);
+            memoryMap->RemoveMemoryRegion("esp.core_dump.tasks");
+        }
+
+        // Later memory regions take precedence, so each overlay shows through the unbacked RAM segment below it
+        uint64_t overlaid = 0;
+        for (const AddressRange& range : GetOverlayRanges(view, *attr, dump))
+        {
+            attached->windows.push_back(make_unique<CoreDumpMemory>(*attached, range.start, range.end - range.start));
+            string name = "esp.core_dump." + to_string(attached->region_names.size());
+            if (memoryMap->AddRemoteMemoryRegion(name, range.start, attached->windows.back().get(),
+                    SegmentReadable | SegmentWritable | SegmentContainsData))
+            {
+                attached->region_names.push_back(name);
+                overlaid += range.end - range.start;
+            }
+        }
+
+        if (!dump.tasks.empty())
+            DefineTaskTable(view, dump);
+        string markdown = AnnotateTasks(view, dump);
+        slot = std::move(attached);
+
+        map<string, Ref<Metadata>> stored;
+        stored["path"] = new Metadata(path);
+        stored["format"] = new Metadata(string(dump.format == CoreDumpFormat::Elf ? "elf" : "binary"));
+        stored["tasks"] = new Metadata(uint64_t(dump.tasks.size()));
+        stored["overlaid_bytes"] = new Metadata(overlaid);
+        view->StoreMetadata("esp.core_dump", new Metadata(stored), true);
+
+        logger->LogInfo("Attached core dump %s: %zu tasks, %zu snapshots, %llu bytes overlaid on unbacked RAM",
+            path.c_str(), dump.tasks.size(), dump.segments.size(), static_cast<unsigned long long>(overlaid));
+        if (report)
+            view->ShowMarkdownReport("ESP Core Dump", "# Core dump " + path + "\n\n" + markdown, markdown);
+        return true;
+    }
+
+    void ReattachCoreDump(BinaryView* view)
+    {
+        Ref<Metadata> stored = view->QueryMetadata("esp.core_dump");
+        if (!stored || !stored->IsKeyValueStore())
+            return;
+        auto store = stored->GetKeyValueStore();
+        if (!store.count("path"))
+            return;
+
+        string path = store["path"]->GetString();
+        error_code ec;
+        if (!filesystem::exists(path, ec))
+        {
+            Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+            logger->LogWarn("Core dump %s no longer exists and was not attached", path.c_str());
+            return;
+        }
+        AttachCoreDump(view, path, false);
+    }
+
+    void ReleaseCoreDump(size_t sessionId)
+    {
+        lock_guard<mutex> lock(g_coreDumpMutex);
+        g_coreDumps.erase(sessionId);
+    }
+
+    void RegisterCoreDumpCommands()
+    {
+        PluginCommand::Register("ESP\\Attach Core Dump...",
+            "Overlay the RAM of an ESP-IDF core dump and define each task's registers and stack",
+            [](BinaryView* view) {
+                string path;
+                if (GetOpenFileNameInput(path, "ESP-IDF core dump (ELF or coredump partition)"))
+                    AttachCoreDump(view, path);
+            },
+            [](BinaryView* view) { return view->GetTypeName() == "ESP-APP"; });
+    }
+}  // namespace EspApp
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include <string>
+
+namespace EspApp
+{
+    // Synthetic region holding one esp_core_dump_task_t per task of the attached dump. It lies outside the
+    // address map of every supported chip.
+    constexpr uint64_t ESP_CORE_DUMP_TASK_TABLE_ADDR = 0xF0000000;
+
+    // Attach an ESP-IDF core dump (ELF or coredump partition contents) to an ESP-APP view. The RAM snapshots
+    // are overlaid on the parts of the RAM regions that no image segment backs, served straight from a
+    // memory mapping of the dump; task registers and stacks are defined as data. The path is recorded in
+    // "esp.core_dump" so that a reopened database attaches the dump again. `report` shows the task summary.
+    bool AttachCoreDump(BinaryNinja::BinaryView* view, const std::string& path, bool report = true);
+
+    // Attach the dump recorded in the view's metadata, if there is one and it still exists
+    void ReattachCoreDump(BinaryNinja::BinaryView* view);
+
+    // Drop the dump mapping kept for a file session
+    void ReleaseCoreDump(size_t sessionId);
+
+    void RegisterCoreDumpCommands();
+}  // namespace EspApp
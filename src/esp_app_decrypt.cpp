@@ -0,0 +1,193 @@
+#include "esp_app_decrypt.h"
+#include "esp_app_view.h"
+#include "core/esp_mapped_file.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    string GetFlashKeyDirectory()
+    {
+        return (filesystem::path(GetUserDirectory()) / "esp_app" / "keys").string();
+    }
+
+    EspDecryptedView::EspDecryptedView(BinaryView* data, const FlashKeyMatch& match) :
+        BinaryView(ESP_DECRYPTED_VIEW_TYPE, data->GetFile(), data), m_raw(data), m_keyPath(match.key_path)
+    {
+        m_flash = make_unique<DecryptedFlash>(match.decryptor, data->GetLength(), match.flash_addr, ReadRawView,
+            m_raw.GetPtr());
+    }
+
+    bool EspDecryptedView::Init()
+    {
+        return true;
+    }
+
+    size_t EspDecryptedView::PerformRead(void* dest, uint64_t offset, size_t len)
+    {
+        return m_flash->Read(offset, dest, len);
+    }
+
+    uint64_t EspDecryptedView::PerformGetLength() const
+    {
+        return m_flash->GetLength();
+    }
+
+    uint64_t EspDecryptedView::PerformGetStart() const
+    {
+        return 0;
+    }
+
+    bool EspDecryptedView::PerformIsValidOffset(uint64_t offset)
+    {
+        return offset < m_flash->GetLength();
+    }
+
+    bool EspDecryptedView::PerformIsOffsetReadable(uint64_t offset)
+    {
+        return offset < m_flash->GetLength();
+    }
+
+    bool EspDecryptedView::PerformIsOffsetWritable(uint64_t)
+    {
+        return false;
+    }
+
+    bool EspDecryptedView::PerformIsOffsetExecutable(uint64_t)
+    {
+        return false;
+    }
+
+    bool EspDecryptedView::PerformIsOffsetBackedByFile(uint64_t offset)
+    {
+        return offset < m_flash->GetLength();
+    }
+
+    BNEndianness EspDecryptedView::PerformGetDefaultEndianness() const
+    {
+        return LittleEndian;
+    }
+
+    size_t EspDecryptedView::PerformGetAddressSize() const
+    {
+        return 4;
+    }
+
+    FlashKeyRequest GetFlashKeyRequest(BinaryView* data)
+    {
+        FlashKeyRequest request;
+        Ref<Settings> settings = data->GetLoadSettings("ESP-APP");
+        if (settings && settings->Contains("loader.esp.encryptionKey"))
+            request.key_path = settings->Get<string>("loader.esp.encryptionKey", data);
+        if (settings && settings->Contains("loader.esp.encryptionOffset"))
+            request.flash_addr = settings->Get<uint64_t>("loader.esp.encryptionOffset", data);
+        return request;
+    }
+
+    static vector<string> GetKeyCandidates(const FlashKeyRequest& request)
+    {
+        if (!request.key_path.empty())
+            return {request.key_path};
+
+        // Key files are 32 or 64 bytes (espsecure generate_flash_encryption_key), whatever their name
+        vector<string> paths;
+        error_code ec;
+        for (auto it = filesystem::directory_iterator(GetFlashKeyDirectory(), ec);
+             !ec && it != filesystem::directory_iterator(); it.increment(ec))
+        {
+            error_code sizeError;
+            uintmax_t size = it->file_size(sizeError);
+            if (!sizeError && (size == 32 || size == 64))
+                paths.push_back(it->path().string());
+        }
+        sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    bool LooksLikeEncryptedData(BinaryView* data)
+    {
+        uint8_t unit[ESP_FLASH_CRYPT_UNIT];
+        for (uint64_t offset : {uint64_t(0), ESP_PARTITION_TABLE_OFFSET})
+        {
+            if (data->Read(unit, offset, sizeof(unit)) == sizeof(unit) && LooksLikeCiphertext(unit))
+                return true;
+        }
+        return false;
+    }
+
+    bool FindFlashKey(BinaryView* data, const FlashKeyRequest& request, FlashKeyMatch& out)
+    {
+        if (!LooksLikeEncryptedData(data))
+            return false;
+
+        vector<string> paths = GetKeyCandidates(request);
+        uint64_t length = data->GetLength();
+        for (const string& path : paths)
+        {
+            MappedFile keyFile;
+            if (!keyFile.Open(path) || !out.decryptor.SetKey(keyFile.GetSpan()))
+                continue;
+
+            out.flash_addr = request.flash_addr;
+            if (out.flash_addr == ESP_FLASH_CRYPT_NO_MATCH ||
+                !ProbeEncryptedFlash(out.decryptor, out.flash_addr, length, ReadRawView, data))
+                out.flash_addr = FindEncryptedFlashAddress(out.decryptor, length, ReadRawView, data);
+            if (out.flash_addr != ESP_FLASH_CRYPT_NO_MATCH)
+            {
+                out.key_path = path;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool LooksLikeEsp32Ciphertext(BinaryView* data, const FlashKeyRequest& request)
+    {
+        // ESP32 images are encrypted in 32-byte blocks
+        uint64_t length = data->GetLength();
+        if (length < ESP_FLASH_CRYPT_UNIT || length % 32)
+            return false;
+
+        vector<string> paths = GetKeyCandidates(request);
+        error_code ec;
+        if (none_of(paths.begin(), paths.end(),
+                [&](const string& path) { return filesystem::file_size(path, ec) == 32; }))
+            return false;
+
+        uint8_t unit[ESP_FLASH_CRYPT_UNIT];
+        return data->Read(unit, 0, sizeof(unit)) == sizeof(unit) && LooksLikeCiphertext(unit);
+    }
+
+    EspDecryptedViewType::EspDecryptedViewType() : BinaryViewType(ESP_DECRYPTED_VIEW_TYPE, "ESP Decrypted Flash")
+    {
+    }
+
+    Ref<BinaryView> EspDecryptedViewType::Create(BinaryView* data)
+    {
+        FlashKeyMatch match;
+        if (!FindFlashKey(data, GetFlashKeyRequest(data), match))
+            return nullptr;
+        return new EspDecryptedView(data, match);
+    }
+
+    Ref<BinaryView> EspDecryptedViewType::Parse(BinaryView* data)
+    {
+        return Create(data);
+    }
+
+    bool EspDecryptedViewType::IsTypeValidForData(BinaryView*)
+    {
+        return false;
+    }
+
+    void InitEspDecryptedViewType()
+    {
+        static EspDecryptedViewType type;
+        BinaryViewType::Register(&type);
+    }
+}  // namespace EspApp
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include "core/esp_flash_crypt.h"
+
+#include <memory>
+#include <string>
+
+namespace EspApp
+{
+    constexpr const char* ESP_DECRYPTED_VIEW_TYPE = "ESP-Decrypted";
+
+    struct FlashKeyMatch
+    {
+        FlashDecryptor decryptor;
+        uint64_t flash_addr;
+        std::string key_path;
+    };
+
+    // Plaintext of a flash-encrypted raw view, used as the parent of the ESP-APP view. Reads go through a
+    // DecryptedFlash page cache, so only the pages analysis actually reads are ever decrypted.
+    class EspDecryptedView : public BinaryNinja::BinaryView
+    {
+        BinaryNinja::Ref<BinaryNinja::BinaryView> m_raw;
+        std::unique_ptr<DecryptedFlash> m_flash;
+        std::string m_keyPath;
+
+        virtual size_t PerformRead(void* dest, uint64_t offset, size_t len) override;
+        virtual uint64_t PerformGetLength() const override;
+        virtual uint64_t PerformGetStart() const override;
+        virtual bool PerformIsValidOffset(uint64_t offset) override;
+        virtual bool PerformIsOffsetReadable(uint64_t offset) override;
+        virtual bool PerformIsOffsetWritable(uint64_t offset) override;
+        virtual bool PerformIsOffsetExecutable(uint64_t offset) override;
+        virtual bool PerformIsOffsetBackedByFile(uint64_t offset) override;
+        virtual BNEndianness PerformGetDefaultEndianness() const override;
+        virtual size_t PerformGetAddressSize() const override;
+
+    public:
+        EspDecryptedView(BinaryNinja::BinaryView* data, const FlashKeyMatch& match);
+
+        virtual bool Init() override;
+
+        DecryptedFlash& GetDecryptedFlash() { return *m_flash; }
+        const std::string& GetKeyPath() const { return m_keyPath; }
+    };
+
+    // What FindFlashKey tries, from the load settings of the data
+    struct FlashKeyRequest
+    {
+        std::string key_path;                            // loader.esp.encryptionKey; empty for every known key
+        uint64_t flash_addr = ESP_FLASH_CRYPT_NO_MATCH;  // loader.esp.encryptionOffset, if set
+
+        bool operator==(const FlashKeyRequest&) const = default;
+    };
+
+    FlashKeyRequest GetFlashKeyRequest(BinaryNinja::BinaryView* data);
+
+    // True if the first unit of `data`, or the partition table unit of a dump whose bootloader does not start at
+    // 0, is as varied as ciphertext. Two reads; checked before any key is tried.
+    bool LooksLikeEncryptedData(BinaryNinja::BinaryView* data);
+
+    // Find the flash encryption key that turns `data` into an app image or a flash dump: the requested key file,
+    // otherwise each key file in GetFlashKeyDirectory(). The requested flash address is used when the data
+    // decrypts there, otherwise the address is searched for. Data that does not look encrypted is rejected
+    // before the key directory is read. Only a few units of `data` are read.
+    bool FindFlashKey(BinaryNinja::BinaryView* data, const FlashKeyRequest& request, FlashKeyMatch& out);
+
+    // For data FindFlashKey found no key for: true if it looks like ciphertext and a 32-byte key was tried, which
+    // points at the AES-256 flash encryption of the ESP32 (a key tweaked per 32 bytes instead of XTS)
+    bool LooksLikeEsp32Ciphertext(BinaryNinja::BinaryView* data, const FlashKeyRequest& request);
+
+    // Registered so that the parent of an encrypted ESP-APP view has a known type; never offered for data
+    // itself, the ESP-APP view type opens it as needed
+    class EspDecryptedViewType : public BinaryNinja::BinaryViewType
+    {
+    public:
+        EspDecryptedViewType();
+        virtual BinaryNinja::Ref<BinaryNinja::BinaryView> Create(BinaryNinja::BinaryView* data) override;
+        virtual BinaryNinja::Ref<BinaryNinja::BinaryView> Parse(BinaryNinja::BinaryView* data) override;
+        virtual bool IsTypeValidForData(BinaryNinja::BinaryView* data) override;
+    };
+
+    void InitEspDecryptedViewType();
+
+    std::string GetFlashKeyDirectory();
+}  // namespace EspApp
@@ -0,0 +1,230 @@
+#include "esp_app_diff.h"
+#include "esp_app_view.h"
+#include "core/esp_flash.h"
+#include "core/esp_mapped_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static const char* g_diffTagType = "ESP Diff";
+
+    struct DiffBase
+    {
+        string name;
+        uint64_t flash_offset;  // Another app of the same flash dump, or
+        string path;            // an image or flash dump on disk
+    };
+
+    static vector<DiffBase> GetFlashDiffBases(BinaryView* view)
+    {
+        vector<DiffBase> bases;
+        Ref<Metadata> flash = view->QueryMetadata("esp.flash");
+        if (!flash || !flash->IsKeyValueStore())
+            return bases;
+
+        auto store = flash->GetKeyValueStore();
+        if (!store.count("apps") || !store.count("loaded_app"))
+            return bases;
+        string loaded = store["loaded_app"]->GetString();
+        for (const auto& app : store["apps"]->GetArray())
+        {
+            auto entry = app->GetKeyValueStore();
+            if (entry["label"]->GetString() == loaded || entry["status"]->GetString() != "ok" ||
+                entry.count("duplicate_of"))
+                continue;
+            bases.push_back({entry["label"]->GetString(), entry["offset"]->GetUnsignedInteger(), {}});
+        }
+        return bases;
+    }
+
+    static string FormatRange(uint64_t start, uint64_t length)
+    {
+        char text[48];
+        snprintf(text, sizeof(text), "0x%08llx-0x%08llx", static_cast<unsigned long long>(start),
+            static_cast<unsigned long long>(start + length));
+        return text;
+    }
+
+    // Tag `ranges` and the functions they touch, and add a table per region to the report
+    static void ReportRanges(BinaryView* view, const vector<Ref<Function>>& functions,
+        const vector<ChangedRange>& ranges, const string& what, string& markdown, string& text)
+    {
+        const MemoryRegion* currentRegion = nullptr;
+        bool first = true;
+        for (const ChangedRange& range : ranges)
+        {
+            string where = FormatRange(range.start, range.length);
+            string note = what + ": " + where;
+            view->CreateAutoDataTag(range.start, g_diffTagType, note, true);
+
+            // Functions that contain the start of the range or begin inside it
+            vector<Ref<Function>> touched = view->GetAnalysisFunctionsContainingAddress(range.start);
+            auto it = lower_bound(functions.begin(), functions.end(), uint64_t(range.start),
+                [](const Ref<Function>& func, uint64_t addr) { return func->GetStart() < addr; });
+            for (; it != functions.end() && (*it)->GetStart() < uint64_t(range.start) + range.length; ++it)
+                touched.push_back(*it);
+
+            auto byStart = [](const Ref<Function>& a, const Ref<Function>& b) {
+                return a->GetStart() < b->GetStart();
+            };
+            auto sameStart = [](const Ref<Function>& a, const Ref<Function>& b) {
+                return a->GetStart() == b->GetStart();
+            };
+            sort(touched.begin(), touched.end(), byStart);
+            touched.erase(unique(touched.begin(), touched.end(), sameStart), touched.end());
+
+            string names;
+            for (const auto& func : touched)
+            {
+                func->CreateAutoFunctionTag(g_diffTagType, note, true);
+                names += (names.empty() ? "" : ", ") + func->GetSymbol()->GetShortName();
+            }
+
+            if (first || range.region != currentRegion)
+            {
+                string regionName = range.region ? range.region->name : "unmapped";
+                markdown += "\n## " + what + ": " + regionName + "\n\n| Range | Bytes | Functions |\n|---|---|---|\n";
+                text += what + ": " + regionName + "\n";
+                currentRegion = range.region;
+                first = false;
+            }
+            markdown += "| " + where + " | " + to_string(range.length) + " | " + names + " |\n";
+            text += "  " + where + "  " + to_string(range.length) + " bytes  " + names + "\n";
+        }
+    }
+
+    void ApplyImageDiff(BinaryView* view, const ImageDiff& diff, const string& baseName)
+    {
+        if (!view->GetTagType(g_diffTagType))
+            view->AddTagType(new TagType(view, g_diffTagType, "\xc2\xb1"));
+
+        // Function starts in address order, to find the functions that begin inside a changed range
+        vector<Ref<Function>> functions = view->GetAnalysisFunctionList();
+        sort(functions.begin(), functions.end(),
+            [](const Ref<Function>& a, const Ref<Function>& b) { return a->GetStart() < b->GetStart(); });
+
+        string markdown = "# Changes against " + baseName + "\n\n";
+        string text = "Changes against " + baseName + "\n\n";
+        char summary[200];
+        snprintf(summary, sizeof(summary),
+            "%zu changed ranges, %llu bytes changed, %zu moved ranges, %llu bytes moved, %llu bytes unchanged\n\n",
+            diff.changed.size(), static_cast<unsigned long long>(diff.changed_bytes), diff.moved.size(),
+            static_cast<unsigned long long>(diff.moved_bytes), static_cast<unsigned long long>(diff.unchanged_bytes));
+        markdown += summary;
+        text += summary;
+
+        ReportRanges(view, functions, diff.changed, "Changed against " + baseName, markdown, text);
+        ReportRanges(view, functions, diff.moved, "Moved or duplicated against " + baseName, markdown, text);
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        logger->LogInfo("Diff against %s: %zu changed ranges, %llu changed and %llu moved of %llu bytes",
+            baseName.c_str(), diff.changed.size(), static_cast<unsigned long long>(diff.changed_bytes),
+            static_cast<unsigned long long>(diff.moved_bytes),
+            static_cast<unsigned long long>(diff.changed_bytes + diff.moved_bytes + diff.unchanged_bytes));
+        view->ShowMarkdownReport("ESP Diff: " + baseName, markdown, text);
+    }
+
+    static bool DiffAgainst(BinaryView* view, const DiffBase& base)
+    {
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        RawViewBytes raw(view->GetParentView());
+        ParsedImage target;
+        if (!ParseViewImage(view, raw.GetSpan(), target))
+        {
+            logger->LogError("Cannot diff: the loaded app image could not be parsed");
+            return false;
+        }
+        const ChipAttr* attr = GetChipAttrById(target.ChipId());
+        if (!attr)
+            return false;
+
+        // The base is either another app of the same dump or a file, which may itself be a flash dump
+        MappedFile file;
+        span<const uint8_t> baseBytes = raw.GetSpan();
+        ParsedImage baseImage;
+        ImageParseStatus status;
+        if (base.path.empty())
+        {
+            status = ParseImage(baseBytes, baseImage, base.flash_offset);
+        }
+        else
+        {
+            if (!file.Open(base.path))
+            {
+                logger->LogError("Cannot diff: failed to open %s", base.path.c_str());
+                return false;
+            }
+            baseBytes = file.GetSpan();
+            FlashLayout layout;
+            if (LooksLikeFlashDump(baseBytes) && ScanFlashDump(baseBytes, layout) &&
+                layout.GetDefaultAppIndex() != ESP_FLASH_NO_DUPLICATE)
+            {
+                baseImage = layout.apps[layout.GetDefaultAppIndex()].image;
+                status = ImageParseStatus::Ok;
+            }
+            else
+            {
+                status = ParseImage(baseBytes, baseImage);
+            }
+        }
+        if (status != ImageParseStatus::Ok)
+        {
+            logger->LogError("Cannot diff: %s is not an app image (%s)", base.name.c_str(),
+                GetImageParseStatusString(status));
+            return false;
+        }
+
+        // Chunks only line up between builds for the same chip
+        if (baseImage.ChipId() != target.ChipId())
+        {
+            const ChipAttr* baseAttr = GetChipAttrById(baseImage.ChipId());
+            logger->LogError("Cannot diff: %s is an image for %s, the loaded app is for %s", base.name.c_str(),
+                baseAttr ? baseAttr->chip_name : "an unknown chip", attr->chip_name);
+            return false;
+        }
+
+        ChunkIndex baseIndex, targetIndex;
+        BuildChunkIndex(baseBytes, baseImage, baseIndex);
+        BuildChunkIndex(raw.GetSpan(), target, targetIndex);
+        ImageDiff diff;
+        DiffChunkIndexes(baseIndex, targetIndex, RegionIndex(*attr), diff);
+        ApplyImageDiff(view, diff, base.name);
+        return true;
+    }
+
+    void RegisterDiffCommands()
+    {
+        PluginCommand::Register("ESP\\Diff Against Image...",
+            "Tag the address ranges that changed relative to another build (an image file or another app slot)",
+            [](BinaryView* view) {
+                vector<DiffBase> bases = GetFlashDiffBases(view);
+                if (!bases.empty())
+                {
+                    vector<string> choices;
+                    for (const auto& base : bases)
+                        choices.push_back(base.name);
+                    choices.push_back("Other file...");
+
+                    size_t choice;
+                    if (!GetChoiceInput(choice, "Compare with", "Diff Against Image", choices))
+                        return;
+                    if (choice < bases.size())
+                    {
+                        DiffAgainst(view, bases[choice]);
+                        return;
+                    }
+                }
+
+                string path;
+                if (GetOpenFileNameInput(path, "Image or flash dump to compare with"))
+                    DiffAgainst(view, {path, 0, path});
+            },
+            [](BinaryView* view) { return view->GetTypeName() == "ESP-APP"; });
+    }
+}  // namespace EspApp
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include "core/esp_chunk_diff.h"
+#include <string>
+
+namespace EspApp
+{
+    // Tag every changed range of `diff` (and the functions it touches) in `view` and show a report per region.
+    // `baseName` describes what the view was compared against.
+    void ApplyImageDiff(BinaryNinja::BinaryView* view, const ImageDiff& diff, const std::string& baseName);
+
+    void RegisterDiffCommands();
+}  // namespace EspApp
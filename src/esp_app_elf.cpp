@@ -0,0 +1,438 @@
+#include "esp_app_elf.h"
+#include "core/esp_dwarf.h"
+#include "core/esp_elf.h"
+#include "core/esp_elf_index.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static constexpr const char* ELF_TYPE_SOURCE = "esp.elf";
+    static constexpr size_t MAX_TYPE_DEPTH = 64;
+
+    // DWARF encodings of base types (DW_ATE_*)
+    static constexpr uint8_t DW_ATE_boolean = 0x02;
+    static constexpr uint8_t DW_ATE_float = 0x04;
+    static constexpr uint8_t DW_ATE_signed = 0x05;
+    static constexpr uint8_t DW_ATE_signed_char = 0x06;
+
+    // Converts DWARF types to Binary Ninja types. Named structs, unions, enums and typedefs are referenced by
+    // name and defined once, from the first compile unit with a complete definition; an anonymous aggregate
+    // behind a typedef is defined under the typedef's name. Conversions are memoized per DWARF type.
+    class DwarfTypeImporter
+    {
+        const DwarfInfo& m_info;
+        Ref<Architecture> m_arch;
+        Ref<CallingConvention> m_callingConvention;
+        vector<Ref<Type>> m_converted;
+        unordered_map<uint32_t, string_view> m_adoptedNames;
+        unordered_map<string_view, uint32_t> m_definitions;
+        vector<string_view> m_definitionOrder;
+        size_t m_depth = 0;
+
+        bool IsAggregate(const DwarfType& type) const
+        {
+            return type.kind == DwarfTypeKind::Struct || type.kind == DwarfTypeKind::Union ||
+                type.kind == DwarfTypeKind::Enum;
+        }
+
+        string_view GetAggregateName(uint32_t index) const
+        {
+            auto adopted = m_adoptedNames.find(index);
+            return adopted != m_adoptedNames.end() ? adopted->second : m_info.types[index].name;
+        }
+
+        void SelectDefinition(string_view name, uint32_t index)
+        {
+            auto [it, inserted] = m_definitions.try_emplace(name, index);
+            if (inserted)
+                m_definitionOrder.push_back(name);
+            else if (m_info.types[it->second].declaration && !m_info.types[index].declaration)
+                it->second = index;
+        }
+
+        Ref<Type> NamedReference(BNNamedTypeReferenceClass cls, string_view name, uint64_t width)
+        {
+            Ref<NamedTypeReference> ref =
+                NamedTypeReference::GenerateAutoTypeReference(cls, ELF_TYPE_SOURCE, QualifiedName(string(name)));
+            return Type::NamedType(ref, width);
+        }
+
+        Ref<Type> ConvertBase(const DwarfType& type)
+        {
+            if (type.size == 0)
+                return Type::VoidType();
+            string name(type.name);
+            switch (type.encoding)
+            {
+            case DW_ATE_boolean:
+                return type.size == 1 ? Type::BoolType() : Type::IntegerType(type.size, false, name);
+            case DW_ATE_float:
+                return Type::FloatType(type.size, name);
+            case DW_ATE_signed:
+            case DW_ATE_signed_char:
+                return Type::IntegerType(type.size, true, name);
+            default:
+                return Type::IntegerType(type.size, false, name);
+            }
+        }
+
+        Ref<Type> BuildAggregate(const DwarfType& type)
+        {
+            StructureBuilder builder;
+            builder.SetStructureType(type.kind == DwarfTypeKind::Union ? UnionStructureType : StructStructureType);
+            builder.SetWidth(type.size);
+
+            // Bit-fields are kept as their declared type when they start a new storage unit
+            uint64_t coveredEnd = 0;
+            for (const DwarfMember& member : type.members)
+            {
+                Ref<Type> memberType = Convert(member.type);
+                uint64_t width = memberType->GetWidth();
+                if (member.bit_size && (member.offset < coveredEnd || member.offset + width > type.size))
+                    continue;
+
+                string name(member.name);
+                if (name.empty())
+                {
+                    char anonymous[24];
+                    snprintf(anonymous, sizeof(anonymous), "anonymous_%x", member.offset);
+                    name = anonymous;
+                }
+                builder.AddMemberAtOffset(memberType, name, member.offset);
+                coveredEnd = max<uint64_t>(coveredEnd, member.offset + width);
+            }
+            return Type::StructureType(builder.Finalize());
+        }
+
+        Ref<Type> BuildEnum(const DwarfType& type)
+        {
+            EnumerationBuilder builder;
+            bool isSigned = false;
+            for (const DwarfEnumerator& enumerator : type.enumerators)
+            {
+                builder.AddMemberWithValue(string(enumerator.name), static_cast<uint64_t>(enumerator.value));
+                isSigned |= enumerator.value < 0;
+            }
+            return Type::EnumerationType(m_arch, builder.Finalize(), type.size ? type.size : 4, isSigned);
+        }
+
+        Ref<Type> Build(const DwarfType& type, uint32_t index)
+        {
+            switch (type.kind)
+            {
+            case DwarfTypeKind::Base:
+                return ConvertBase(type);
+            case DwarfTypeKind::Pointer:
+                return Type::PointerType(m_arch, Convert(type.target));
+            case DwarfTypeKind::Const:
+            case DwarfTypeKind::Volatile:
+            {
+                TypeBuilder builder(Convert(type.target).GetPtr());
+                if (type.kind == DwarfTypeKind::Const)
+                    builder.SetConst(true);
+                else
+                    builder.SetVolatile(true);
+                return builder.Finalize();
+            }
+            case DwarfTypeKind::Typedef:
+            {
+                // Transparent qualifiers, `typedef struct x x;` and typedefs that name an anonymous aggregate
+                // resolve to their target
+                if (type.name.empty() || type.target == DWARF_NO_TYPE || type.target >= m_info.types.size())
+                    return Convert(type.target);
+                const DwarfType& target = m_info.types[type.target];
+                if (IsAggregate(target) && GetAggregateName(type.target) == type.name)
+                    return Convert(type.target);
+                return NamedReference(TypedefNamedTypeClass, type.name, Convert(type.target)->GetWidth());
+            }
+            case DwarfTypeKind::Struct:
+            case DwarfTypeKind::Union:
+            case DwarfTypeKind::Enum:
+            {
+                string_view name = GetAggregateName(index);
+                if (name.empty())
+                    return type.kind == DwarfTypeKind::Enum ? BuildEnum(type) : BuildAggregate(type);
+                BNNamedTypeReferenceClass cls = type.kind == DwarfTypeKind::Struct ? StructNamedTypeClass :
+                    type.kind == DwarfTypeKind::Union ? UnionNamedTypeClass : EnumNamedTypeClass;
+                return NamedReference(cls, name, type.size);
+            }
+            case DwarfTypeKind::Array:
+            {
+                Ref<Type> element = Convert(type.target);
+                if (type.dimensions.empty())
+                    return Type::ArrayType(element, 0);
+                for (auto it = type.dimensions.rbegin(); it != type.dimensions.rend(); ++it)
+                    element = Type::ArrayType(element, *it);
+                return element;
+            }
+            case DwarfTypeKind::Function:
+            {
+                vector<FunctionParameter> params;
+                for (uint32_t param : type.params)
+                    params.emplace_back("", Convert(param));
+                return Type::FunctionType(Convert(type.target), m_callingConvention, params, type.var_args);
+            }
+            }
+            return Type::VoidType();
+        }
+
+    public:
+        DwarfTypeImporter(const DwarfInfo& info, Ref<Architecture> arch, Ref<CallingConvention> callingConvention) :
+            m_info(info), m_arch(arch), m_callingConvention(callingConvention), m_converted(info.types.size())
+        {
+            for (uint32_t i = 0; i < info.types.size(); i++)
+            {
+                const DwarfType& type = info.types[i];
+                if (type.kind != DwarfTypeKind::Typedef || type.name.empty() || type.target >= info.types.size())
+                    continue;
+                const DwarfType& target = info.types[type.target];
+                if (IsAggregate(target) && target.name.empty())
+                    m_adoptedNames.emplace(type.target, type.name);
+            }
+
+            for (uint32_t i = 0; i < info.types.size(); i++)
+            {
+                const DwarfType& type = info.types[i];
+                if (IsAggregate(type))
+                {
+                    string_view name = GetAggregateName(i);
+                    if (!name.empty())
+                        SelectDefinition(name, i);
+                }
+                else if (type.kind == DwarfTypeKind::Typedef && !type.name.empty() &&
+                    !(type.target < info.types.size() && IsAggregate(info.types[type.target]) &&
+                        GetAggregateName(type.target) == type.name))
+                {
+                    SelectDefinition(type.name, i);
+                }
+            }
+        }
+
+        Ref<Type> Convert(uint32_t index)
+        {
+            if (index >= m_info.types.size() || m_depth >= MAX_TYPE_DEPTH)
+                return Type::VoidType();
+            if (m_converted[index])
+                return m_converted[index];
+
+            m_depth++;
+            Ref<Type> type = Build(m_info.types[index], index);
+            m_depth--;
+            m_converted[index] = type;
+            return type;
+        }
+
+        // Definitions of every named type, for one DefineTypes batch. Declaration-only types are left to
+        // resolve against whatever defines them later.
+        vector<pair<string, QualifiedNameAndType>> GetDefinitions()
+        {
+            vector<pair<string, QualifiedNameAndType>> definitions;
+            definitions.reserve(m_definitionOrder.size());
+            for (string_view name : m_definitionOrder)
+            {
+                uint32_t index = m_definitions[name];
+                const DwarfType& type = m_info.types[index];
+                if (type.declaration)
+                    continue;
+
+                Ref<Type> definition;
+                if (type.kind == DwarfTypeKind::Typedef)
+                    definition = Convert(type.target);
+                else if (type.kind == DwarfTypeKind::Enum)
+                    definition = BuildEnum(type);
+                else
+                    definition = BuildAggregate(type);
+
+                QualifiedNameAndType entry;
+                entry.name = QualifiedName(string(name));
+                entry.type = definition;
+                definitions.emplace_back(Type::GenerateAutoTypeId(ELF_TYPE_SOURCE, entry.name), std::move(entry));
+            }
+            return definitions;
+        }
+    };
+
+    vector<string> GetElfDirectories(BinaryView* view)
+    {
+        vector<string> directories {(filesystem::path(GetUserDirectory()) / "esp_app" / "elf").string()};
+        Ref<Settings> settings = view->GetLoadSettings(view->GetTypeName());
+        if (settings && settings->Contains("loader.esp.elfDirectories"))
+        {
+            for (const string& directory : settings->Get<vector<string>>("loader.esp.elfDirectories", view))
+            {
+                if (!directory.empty())
+                    directories.push_back(directory);
+            }
+        }
+        return directories;
+    }
+
+    bool ApplyElfSidecar(BinaryView* view, const Sha256Digest& appElfSha256)
+    {
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        Ref<Platform> plat = view->GetDefaultPlatform();
+        if (!plat)
+            return false;
+
+        string path = GetElfIndexCache().Find(GetElfDirectories(view), appElfSha256);
+        if (path.empty())
+            return false;
+
+        // Symbol and DWARF names point into the mapping, which stays open until everything is applied
+        MappedFile file;
+        ElfFile elf;
+        if (!file.Open(path) || !elf.Open(file.GetSpan()))
+        {
+            logger->LogWarn("App ELF %s matches the build but cannot be read", path.c_str());
+            return false;
+        }
+
+        vector<ElfSymbol> symbols;
+        elf.GetSymbols(symbols);
+        DwarfInfo dwarf;
+        ParseDwarf(elf, dwarf);
+
+        DwarfTypeImporter importer(dwarf, plat->GetArchitecture(), plat->GetDefaultCallingConvention());
+        vector<pair<string, QualifiedNameAndType>> definitions = importer.GetDefinitions();
+        if (!definitions.empty())
+            view->DefineTypes(definitions);
+
+        unordered_map<uint32_t, uint32_t> prototypes;
+        for (const DwarfFunction& function : dwarf.functions)
+            prototypes.emplace(function.addr, function.type);
+
+        size_t functionCount = 0;
+        size_t dataCount = 0;
+        unordered_set<uint32_t> named;
+        view->BeginBulkModifySymbols();
+        auto defineFunction = [&](string_view name, uint32_t addr, bool global) {
+            auto prototype = prototypes.find(addr);
+            Ref<Type> type = prototype != prototypes.end() ? importer.Convert(prototype->second) : nullptr;
+            view->AddFunctionForAnalysis(plat, addr, false, type);
+            view->DefineAutoSymbol(new Symbol(FunctionSymbol, string(name), addr, global ? GlobalBinding :
+                LocalBinding));
+            named.insert(addr);
+            functionCount++;
+        };
+        for (const ElfSymbol& symbol : symbols)
+        {
+            if (!view->IsValidOffset(symbol.addr))
+                continue;
+            if (symbol.kind == ElfSymbolKind::Function)
+            {
+                defineFunction(symbol.name, symbol.addr, symbol.global);
+            }
+            else
+            {
+                view->DefineAutoSymbol(new Symbol(DataSymbol, string(symbol.name), symbol.addr, symbol.global ?
+                    GlobalBinding : LocalBinding));
+                named.insert(symbol.addr);
+                dataCount++;
+            }
+        }
+
+        // DWARF adds prototypes and variable types, and names whatever the symbol table left out
+        for (const DwarfFunction& function : dwarf.functions)
+        {
+            if (!function.name.empty() && !named.count(function.addr) && view->IsValidOffset(function.addr))
+                defineFunction(function.name, function.addr, true);
+        }
+        size_t variableCount = 0;
+        for (const DwarfVariable& variable : dwarf.variables)
+        {
+            if (!view->IsValidOffset(variable.addr))
+                continue;
+            view->DefineDataVariable(variable.addr, importer.Convert(variable.type));
+            if (named.insert(variable.addr).second)
+                view->DefineAutoSymbol(new Symbol(DataSymbol, string(variable.name), variable.addr, GlobalBinding));
+            variableCount++;
+        }
+        view->EndBulkModifySymbols();
+
+        map<string, Ref<Metadata>> info;
+        info["path"] = new Metadata(path);
+        info["functions"] = new Metadata(static_cast<uint64_t>(functionCount));
+        info["data_symbols"] = new Metadata(static_cast<uint64_t>(dataCount));
+        info["variables"] = new Metadata(static_cast<uint64_t>(variableCount));
+        info["types"] = new Metadata(static_cast<uint64_t>(definitions.size()));
+        info["compile_units"] = new Metadata(static_cast<uint64_t>(dwarf.compile_units));
+        view->StoreMetadata("esp.elf_sidecar", new Metadata(info), true);
+
+        logger->LogInfo("App ELF %s: %zu functions, %zu data symbols, %zu typed variables and %zu types from %zu "
+            "compile units (%zu skipped)", path.c_str(), functionCount, dataCount, variableCount, definitions.size(),
+            dwarf.compile_units, dwarf.skipped_units);
+        return true;
+    }
+
+    bool ApplyElfSidecar(EspAppView* view)
+    {
+        Ref<Settings> settings = view->GetLoadSettings(view->GetTypeName());
+        if (settings && settings->Contains("loader.esp.elfSidecar") &&
+            !settings->Get<bool>("loader.esp.elfSidecar", view))
+            return false;
+
+        const AppDesc* desc = view->GetAppDesc();
+        if (!desc || !desc->HasElfHash())
+            return false;
+        if (ApplyElfSidecar(view, desc->app_elf_sha256))
+            return true;
+
+        // Not in the existing indexes: bring them up to date off the load path, where a new build or a
+        // directory without an index costs a walk and hashing, and apply the ELF if it turns up
+        Ref<BinaryView> viewRef = view;
+        Sha256Digest digest = desc->app_elf_sha256;
+        vector<string> directories = GetElfDirectories(view);
+        WorkerEnqueue([viewRef, digest, directories]() {
+            if (GetElfIndexCache().Update(directories))
+                ApplyElfSidecar(viewRef, digest);
+        }, "ESP app ELF index");
+        return false;
+    }
+
+    static bool GetAppElfHash(BinaryView* view, Sha256Digest& out)
+    {
+        Ref<Metadata> desc = view->QueryMetadata("esp.app_desc");
+        if (!desc || !desc->IsKeyValueStore())
+            return false;
+        auto store = desc->GetKeyValueStore();
+        string hex = store.count("app_elf_sha256") ? store["app_elf_sha256"]->GetString() : "";
+        if (hex.size() != out.size() * 2)
+            return false;
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            unsigned value;
+            if (sscanf(hex.c_str() + i * 2, "%2x", &value) != 1)
+                return false;
+            out[i] = static_cast<uint8_t>(value);
+        }
+        return true;
+    }
+
+    void RegisterElfCommands()
+    {
+        PluginCommand::Register("ESP\\Apply Matching App ELF",
+            "Update the ELF directory indexes and apply the symbols and debug types of the ELF this app was built from",
+            [](BinaryView* view) {
+                Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+                Sha256Digest digest;
+                if (!GetAppElfHash(view, digest))
+                {
+                    logger->LogError("The app description does not record the ELF SHA-256");
+                    return;
+                }
+
+                GetElfIndexCache().Update(GetElfDirectories(view));
+                if (!ApplyElfSidecar(view, digest))
+                    logger->LogWarn("No ELF with SHA-256 %s in the ELF directories", DigestToHex(digest).c_str());
+            },
+            [](BinaryView* view) { return view->GetTypeName() == "ESP-APP"; });
+    }
+}  // namespace EspApp
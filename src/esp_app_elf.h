@@ -0,0 +1,26 @@
+#pragma once
+
+#include "esp_app_view.h"
+#include "core/esp_sha256.h"
+
+#include <string>
+#include <vector>
+
+namespace EspApp
+{
+    // Directories searched for the app ELF: the user directory's esp_app/elf, then the ones listed in the
+    // loader.esp.elfDirectories load setting
+    std::vector<std::string> GetElfDirectories(BinaryNinja::BinaryView* view);
+
+    // Find the ELF the app was built from by its app_elf_sha256 (see core/esp_elf_index.h) and apply its symbol
+    // table and DWARF types, function prototypes and variables in bulk. Returns true if an ELF was applied.
+    // Works on an ESP-APP view or a command's wrapper of one.
+    bool ApplyElfSidecar(BinaryNinja::BinaryView* view, const Sha256Digest& appElfSha256);
+
+    // ApplyElfSidecar at load time, unless the loader.esp.elfSidecar load setting is off or the app
+    // description does not record the ELF hash. Only existing indexes are read; on a miss the indexes are
+    // updated on a worker and the ELF is applied there if it is found. Returns true if it was applied here.
+    bool ApplyElfSidecar(EspAppView* view);
+
+    void RegisterElfCommands();
+}  // namespace EspApp
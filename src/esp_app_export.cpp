@@ -0,0 +1,102 @@
+#include "esp_app_export.h"
+#include "esp_app_view.h"
+#include "core/esp_export.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    // Export state per file session, so repeated exports of a view only rehash what changed in between
+    static mutex g_exportMutex;
+    static map<size_t, unique_ptr<ImageRebuilder>> g_exports;
+
+    static bool LoadExportImage(BinaryView* view, ImageRebuilder& rebuilder)
+    {
+        RawViewBytes raw(view->GetParentView());
+        ParsedImage image;
+        return ParseViewImage(view, raw.GetSpan(), image) && rebuilder.Load(raw.GetSpan(), image);
+    }
+
+    static bool WriteFile(const string& path, span<const uint8_t> data)
+    {
+        // Written next to the target and renamed, so a failed export never leaves a truncated image behind
+        string temp = path + ".tmp";
+        {
+            ofstream out(temp, ios::binary | ios::trunc);
+            if (!out.write(reinterpret_cast<const char*>(data.data()), data.size()))
+                return false;
+        }
+        error_code ec;
+        filesystem::rename(temp, path, ec);
+        if (ec)
+            filesystem::remove(temp, ec);
+        return !ec;
+    }
+
+    bool ExportImage(BinaryView* view, const string& path)
+    {
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        lock_guard<mutex> lock(g_exportMutex);
+
+        unique_ptr<ImageRebuilder>& rebuilder = g_exports[view->GetFile()->GetSessionId()];
+        if (!rebuilder)
+        {
+            rebuilder = make_unique<ImageRebuilder>();
+            if (!LoadExportImage(view, *rebuilder))
+            {
+                logger->LogError("Cannot export: the original app image could not be parsed");
+                rebuilder.reset();
+                return false;
+            }
+        }
+
+        span<const SegmentInfo> segments = rebuilder->GetImage().Segments();
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            DataBuffer contents = view->ReadBuffer(segments[i].load_addr, segments[i].data_len);
+            if (!rebuilder->UpdateSegment(i, {static_cast<const uint8_t*>(contents.GetData()), contents.GetLength()}))
+            {
+                logger->LogError("Cannot export: segment %zu at 0x%08x is not fully readable", i,
+                    segments[i].load_addr);
+                return false;
+            }
+        }
+
+        span<const uint8_t> image = rebuilder->Finish();
+        if (!WriteFile(path, image))
+        {
+            logger->LogError("Failed to write %s", path.c_str());
+            return false;
+        }
+
+        const RebuildStats& stats = rebuilder->GetStats();
+        logger->LogInfo("Exported app image to %s (%zu bytes, %llu bytes changed, %llu bytes rehashed)", path.c_str(),
+            image.size(), stats.bytes_changed, stats.bytes_rehashed);
+        return true;
+    }
+
+    void ReleaseImageExport(size_t sessionId)
+    {
+        lock_guard<mutex> lock(g_exportMutex);
+        g_exports.erase(sessionId);
+    }
+
+    void RegisterExportCommands()
+    {
+        PluginCommand::Register("ESP\\Export Patched Image...",
+            "Write the app image with the current segment contents and a recomputed checksum and SHA-256",
+            [](BinaryView* view) {
+                string path;
+                if (GetSaveFileNameInput(path, "Export ESP app image", "*.bin", "patched.bin"))
+                    ExportImage(view, path);
+            },
+            [](BinaryView* view) { return view->GetTypeName() == "ESP-APP"; });
+    }
+}  // namespace EspApp
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include <string>
+
+namespace EspApp
+{
+    // Write the app image behind an ESP-APP view to `path`, with the segment contents as they currently are
+    // in the view (including patches). The checksum and SHA-256 are recomputed incrementally against the
+    // previous export of the same view.
+    bool ExportImage(BinaryNinja::BinaryView* view, const std::string& path);
+
+    // Drop the export state kept for a file session
+    void ReleaseImageExport(size_t sessionId);
+
+    void RegisterExportCommands();
+}  // namespace EspApp
@@ -0,0 +1,124 @@
+#include "esp_app_log_tags.h"
+#include "core/esp_log_tags.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <map>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static constexpr const char* LOG_TAG_COMPONENT = "ESP Log Tags";
+
+    static Ref<Component> FindOrCreateComponent(BinaryView* view, Component* parent, const string& name)
+    {
+        for (const auto& child : parent->GetContainedComponents())
+        {
+            if (child->GetDisplayName() == name)
+                return child;
+        }
+        return view->CreateComponentWithName(name, parent);
+    }
+
+    // "esp-tls" at 0x42001234 -> esp_tls_sub_42001234
+    static string GetTagFunctionName(const string& tag, uint32_t addr)
+    {
+        string name;
+        for (char c : tag)
+            name += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_sub_%x", addr);
+        return name + suffix;
+    }
+
+    void NameFunctionsFromLogTags(BinaryView* view)
+    {
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        Ref<Platform> plat = view->GetDefaultPlatform();
+        AppImageBytes image(view);
+        const ChipAttr* attr = image.IsValid() ? GetChipAttrById(image.GetImage().ChipId()) : nullptr;
+        PrologueArch arch = attr ? GetPrologueArch(*attr) : PrologueArch::Unknown;
+        if (!plat || arch == PrologueArch::Unknown)
+            return;
+
+        // Format strings and tags live in the read-only data segments (DROM), code in the executable ones
+        vector<CodeRange> codeRanges, dataRanges;
+        for (const auto& segment : view->GetSegments())
+        {
+            if (!segment->GetDataLength())
+                continue;
+            CodeRange range {segment->GetDataOffset(), segment->GetDataLength(),
+                static_cast<uint32_t>(segment->GetStart())};
+            if (segment->GetFlags() & SegmentContainsCode)
+                codeRanges.push_back(range);
+            else
+                dataRanges.push_back(range);
+        }
+
+        image.RebaseRanges(codeRanges);
+        image.RebaseRanges(dataRanges);
+
+        vector<uint32_t> starts;
+        for (const auto& func : view->GetAnalysisFunctionList())
+            starts.push_back(static_cast<uint32_t>(func->GetStart()));
+        sort(starts.begin(), starts.end());
+        starts.erase(unique(starts.begin(), starts.end()), starts.end());
+
+        vector<LogTagProposal> proposals = MineLogTags(image.GetSpan(), codeRanges, dataRanges, arch, starts);
+        if (proposals.empty())
+        {
+            logger->LogInfo("Log tags: no functions with ESP_LOG format strings found");
+            return;
+        }
+
+        Ref<Component> root = FindOrCreateComponent(view, view->GetRootComponent(), LOG_TAG_COMPONENT);
+        map<string, Ref<Component>> components;
+        size_t named = 0;
+        view->BeginBulkModifySymbols();
+        for (const LogTagProposal& proposal : proposals)
+        {
+            Ref<Function> func = view->GetAnalysisFunction(plat, proposal.function);
+            if (!func)
+                continue;
+
+            Ref<Component>& component = components[proposal.tag];
+            if (!component)
+                component = FindOrCreateComponent(view, root, proposal.tag);
+            component->AddFunction(func);
+
+            if (view->GetSymbolByAddress(proposal.function))
+                continue;
+            string name = !proposal.name.empty() ? proposal.name : GetTagFunctionName(proposal.tag, proposal.function);
+            view->DefineAutoSymbol(new Symbol(FunctionSymbol, name, proposal.function, GlobalBinding));
+            named++;
+        }
+        view->EndBulkModifySymbols();
+
+        logger->LogInfo("Log tags: %zu logging functions in %zu components, %zu newly named", proposals.size(),
+            components.size(), named);
+    }
+
+    Ref<AnalysisCompletionEvent> StartLogTagNaming(EspAppView* view)
+    {
+        Ref<Settings> settings = view->GetLoadSettings(view->GetTypeName());
+        if (settings && settings->Contains("loader.esp.logTags") && !settings->Get<bool>("loader.esp.logTags", view))
+            return nullptr;
+
+        // Needs the function list of the first analysis pass; the mining itself walks every function
+        return view->AddAnalysisCompletionEvent([view]() {
+            Ref<BinaryView> ref = view;
+            WorkerEnqueue([ref]() { NameFunctionsFromLogTags(ref); }, "ESP log tag naming");
+        });
+    }
+
+    void RegisterLogTagCommands()
+    {
+        PluginCommand::Register("ESP\\Name Functions From Log Tags",
+            "Name functions and group them into components after the ESP_LOG tags and __func__ strings they use",
+            [](BinaryView* view) { NameFunctionsFromLogTags(view); },
+            [](BinaryView* view) { return view->GetTypeName() == "ESP-APP"; });
+    }
+}  // namespace EspApp
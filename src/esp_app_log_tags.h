@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_app_view.h"
+
+namespace EspApp
+{
+    // Name logging functions after the ESP_LOGx calls they make (see core/esp_log_tags.h): a function whose
+    // format names it through __func__ gets that name, any other unnamed one `<tag>_sub_<address>`, and each
+    // is filed under a component named after its tag. Existing names are kept. Works on an ESP-APP view or a
+    // command's wrapper of one.
+    void NameFunctionsFromLogTags(BinaryNinja::BinaryView* view);
+
+    // Run NameFunctionsFromLogTags on a worker once the initial analysis completes, unless the
+    // loader.esp.logTags load setting is off
+    BinaryNinja::Ref<BinaryNinja::AnalysisCompletionEvent> StartLogTagNaming(EspAppView* view);
+
+    void RegisterLogTagCommands();
+}  // namespace EspApp
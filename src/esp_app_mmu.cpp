@@ -0,0 +1,149 @@
+#include "esp_app_mmu.h"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static mutex g_mmuMutex;
+    static map<size_t, shared_ptr<const FlashMmuModel>> g_mmuModels;
+
+    shared_ptr<const FlashMmuModel> GetFlashMmuModel(BinaryView* view)
+    {
+        lock_guard<mutex> lock(g_mmuMutex);
+        auto it = g_mmuModels.find(view->GetFile()->GetSessionId());
+        return it != g_mmuModels.end() ? it->second : nullptr;
+    }
+
+    void RegisterFlashMmuModel(size_t sessionId, shared_ptr<const FlashMmuModel> model)
+    {
+        lock_guard<mutex> lock(g_mmuMutex);
+        g_mmuModels[sessionId] = std::move(model);
+    }
+
+    void ReleaseFlashMmuModel(size_t sessionId)
+    {
+        lock_guard<mutex> lock(g_mmuMutex);
+        g_mmuModels.erase(sessionId);
+    }
+
+    bool GetFlashOffset(BinaryView* view, uint64_t addr, uint64_t& flashOffset)
+    {
+        shared_ptr<const FlashMmuModel> model = GetFlashMmuModel(view);
+        if (model && addr <= UINT32_MAX && model->mmu.IsFlashWindow(uint32_t(addr)))
+            return model->mmu.VirtualToFlash(uint32_t(addr), flashOffset, model->loaded_app);
+
+        Ref<Segment> segment = view->GetSegmentAt(addr);
+        if (!segment || addr - segment->GetStart() >= segment->GetDataLength())
+            return false;
+        flashOffset = segment->GetDataOffset() + (addr - segment->GetStart());
+        return true;
+    }
+
+    bool GetFlashAddress(BinaryView* view, uint64_t flashOffset, uint64_t& addr)
+    {
+        if (shared_ptr<const FlashMmuModel> model = GetFlashMmuModel(view))
+        {
+            uint32_t mapped;
+            size_t app;
+            for (MmuBus bus : {MmuBus::Instruction, MmuBus::Data})
+            {
+                if (model->mmu.FlashToVirtual(flashOffset, mapped, bus, &app) && app == model->loaded_app)
+                {
+                    addr = mapped;
+                    return true;
+                }
+            }
+        }
+
+        // RAM segments are copied from flash and have no mapping
+        for (const auto& segment : view->GetSegments())
+        {
+            if (flashOffset >= segment->GetDataOffset() &&
+                flashOffset - segment->GetDataOffset() < segment->GetDataLength())
+            {
+                addr = segment->GetStart() + (flashOffset - segment->GetDataOffset());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static string FormatHex(uint64_t value)
+    {
+        char text[24];
+        snprintf(text, sizeof(text), "0x%08llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    static void ShowTranslation(BinaryView* view, uint64_t value)
+    {
+        static const FlashMmuModel empty;
+        shared_ptr<const FlashMmuModel> model = GetFlashMmuModel(view);
+        const FlashMmu& mmu = model ? model->mmu : empty.mmu;
+        const vector<string>& labels = model ? model->labels : empty.labels;
+
+        string markdown = "| Translation | App | Result |\n|---|---|---|\n";
+        string text;
+        auto addRow = [&](const string& kind, const string& app, const string& result) {
+            markdown += "| " + kind + " | " + app + " | " + result + " |\n";
+            text += kind + " (" + app + "): " + result + "\n";
+        };
+
+        // The value as a virtual address: every app maps the flash windows differently
+        uint64_t offset;
+        if (value <= UINT32_MAX && mmu.IsFlashWindow(uint32_t(value)))
+        {
+            for (size_t i = 0; i < mmu.GetAppCount(); i++)
+            {
+                if (mmu.VirtualToFlash(uint32_t(value), offset, i))
+                    addRow("Address to flash offset", labels[i], FormatHex(offset));
+            }
+        }
+        else if (GetFlashOffset(view, value, offset))
+        {
+            addRow("Address to flash offset", "loaded", FormatHex(offset));
+        }
+
+        // The value as a flash offset: a page is mapped on each bus by at most one app
+        uint32_t addr;
+        size_t app;
+        bool mapped = false;
+        if (mmu.FlashToVirtual(value, addr, MmuBus::Instruction, &app))
+        {
+            addRow("Flash offset to instruction address", labels[app], FormatHex(addr));
+            mapped = true;
+        }
+        if (mmu.FlashToVirtual(value, addr, MmuBus::Data, &app))
+        {
+            addRow("Flash offset to data address", labels[app], FormatHex(addr));
+            mapped = true;
+        }
+        uint64_t segmentAddr;
+        if (!mapped && GetFlashAddress(view, value, segmentAddr))
+            addRow("Flash offset to address", "loaded", FormatHex(segmentAddr));
+
+        if (text.empty())
+        {
+            LogWarn("%s is neither a mapped address nor a mapped flash offset", FormatHex(value).c_str());
+            return;
+        }
+        view->ShowMarkdownReport("ESP Address Translation", "# " + FormatHex(value) + "\n\n" + markdown, text);
+    }
+
+    void RegisterMmuCommands()
+    {
+        PluginCommand::Register("ESP\\Translate Address or Flash Offset...",
+            "Show the flash offset of an address and the addresses of a flash offset in every app",
+            [](BinaryView* view) {
+                uint64_t value;
+                if (GetAddressInput(value, "Address or flash offset", "Translate Address or Flash Offset"))
+                    ShowTranslation(view, value);
+            },
+            [](BinaryView* view) { return view->GetTypeName() == "ESP-APP"; });
+    }
+}  // namespace EspApp
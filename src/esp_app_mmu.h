@@ -0,0 +1,35 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include "core/esp_mmu.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace EspApp
+{
+    // Cache MMU page table of every app of the loaded file, built once by the ESP-APP view
+    struct FlashMmuModel
+    {
+        FlashMmu mmu;
+        size_t loaded_app = 0;            // App the view was loaded from
+        std::vector<std::string> labels;  // Partition label of each app
+    };
+
+    // The model of the ESP-APP view of a file session, or null. Works on a command's wrapper of the view.
+    std::shared_ptr<const FlashMmuModel> GetFlashMmuModel(BinaryNinja::BinaryView* view);
+    void RegisterFlashMmuModel(size_t sessionId, std::shared_ptr<const FlashMmuModel> model);
+    void ReleaseFlashMmuModel(size_t sessionId);
+
+    // Flash offset of a virtual address of the loaded app: through the MMU for the flash windows, through the
+    // segment backing the address otherwise (IRAM and DRAM segments are copied from flash at boot). Flash
+    // offsets are offsets within the flash dump, or within the image file for a standalone image.
+    bool GetFlashOffset(BinaryNinja::BinaryView* view, uint64_t addr, uint64_t& flashOffset);
+
+    // Virtual address of a flash offset in the loaded app, preferring the instruction bus
+    bool GetFlashAddress(BinaryNinja::BinaryView* view, uint64_t flashOffset, uint64_t& addr);
+
+    void RegisterMmuCommands();
+}  // namespace EspApp
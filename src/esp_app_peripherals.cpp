@@ -0,0 +1,112 @@
+#include "esp_app_peripherals.h"
+#include "core/esp_layout.h"
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    PeripheralMap::PeripheralMap(BinaryView* view, const ChipAttr& attr) :
+        m_view(view), m_table(GetPeripheralTable(attr.chip_id)), m_appliedCount(0)
+    {
+        // Only blocks that lie inside a mapped region of the chip can carry a data variable
+        RegionIndex index(attr);
+        for (size_t i = 0; i < m_table.GetCount(); i++)
+        {
+            PeripheralBlock block = m_table.GetBlock(i);
+            const MemoryRegion* region = index.Find(block.base);
+            if (!region || uint64_t(block.base) + block.size > region->end_addr)
+                continue;
+
+            // A reopened database already has the blocks that were referenced before
+            DataVariable var;
+            if (m_view->GetDataVariableAtAddress(block.base, var))
+                continue;
+            m_pending.push_back(i);
+        }
+    }
+
+    PeripheralMap::~PeripheralMap()
+    {
+        if (m_event)
+            m_event->Cancel();
+    }
+
+    void PeripheralMap::Start()
+    {
+        if (m_pending.empty())
+            return;
+        m_event = m_view->AddAnalysisCompletionEvent([this]() { OnAnalysisComplete(); });
+    }
+
+    bool PeripheralMap::IsReferenced(const PeripheralBlock& block)
+    {
+        return !m_view->GetCodeReferences(block.base, block.size).empty() ||
+            !m_view->GetDataReferences(block.base, block.size).empty();
+    }
+
+    void PeripheralMap::ApplyBlock(const PeripheralBlock& block)
+    {
+        string typeName(block.type_name);
+        if (m_definedTypes.insert(typeName).second)
+        {
+            vector<PeripheralRegister> registers;
+            if (!m_table.DecodeRegisters(block, registers))
+                registers.clear();
+
+            // Alternate views of the same register overlap; the first one wins
+            StructureBuilder builder;
+            uint64_t end = 0;
+            for (const PeripheralRegister& reg : registers)
+            {
+                if (reg.offset < end)
+                    continue;
+                builder.AddMemberAtOffset(Type::IntegerType(reg.size, false), string(reg.name), reg.offset);
+                end = reg.offset + reg.size;
+            }
+            builder.SetWidth(block.size);
+            m_view->DefineType(Type::GenerateAutoTypeId("esp", QualifiedName(typeName)), QualifiedName(typeName),
+                Type::StructureType(builder.Finalize()));
+        }
+
+        m_view->DefineDataVariable(block.base, Type::NamedType(m_view, QualifiedName(typeName)));
+        m_view->DefineAutoSymbol(new Symbol(DataSymbol, string(block.name), block.base, GlobalBinding));
+    }
+
+    void PeripheralMap::OnAnalysisComplete()
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        // Step 1: Pick out the pending blocks that analysis now references
+        vector<size_t> referenced;
+        vector<size_t> pending;
+        for (size_t index : m_pending)
+        {
+            if (IsReferenced(m_table.GetBlock(index)))
+                referenced.push_back(index);
+            else
+                pending.push_back(index);
+        }
+        m_pending = move(pending);
+
+        // Step 2: Define their types and variables in one batch
+        if (!referenced.empty())
+        {
+            m_view->BeginBulkModifySymbols();
+            for (size_t index : referenced)
+                ApplyBlock(m_table.GetBlock(index));
+            m_view->EndBulkModifySymbols();
+
+            m_appliedCount += referenced.size();
+            Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+            logger->LogDebug("Applied %zu peripheral blocks (%zu total, %zu pending)", referenced.size(),
+                m_appliedCount, m_pending.size());
+        }
+
+        // Step 3: Completion events fire once; keep watching while blocks remain
+        if (!m_pending.empty())
+            m_event = m_view->AddAnalysisCompletionEvent([this]() { OnAnalysisComplete(); });
+        else
+            m_event = nullptr;
+    }
+}  // namespace EspApp
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include "core/esp_chip.h"
+#include "core/esp_peripherals.h"
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace EspApp
+{
+    // Peripheral register blocks of the chip, applied lazily: a block's struct type and data variable are
+    // only defined once analysis references an address inside it. Checked after every analysis pass.
+    class PeripheralMap
+    {
+        BinaryNinja::BinaryView* m_view;
+        PeripheralTable m_table;
+
+        std::mutex m_mutex;
+        std::vector<size_t> m_pending;
+        std::unordered_set<std::string> m_definedTypes;
+        size_t m_appliedCount;
+        BinaryNinja::Ref<BinaryNinja::AnalysisCompletionEvent> m_event;
+
+        void OnAnalysisComplete();
+        bool IsReferenced(const PeripheralBlock& block);
+        void ApplyBlock(const PeripheralBlock& block);
+
+    public:
+        PeripheralMap(BinaryNinja::BinaryView* view, const ChipAttr& attr);
+        ~PeripheralMap();
+
+        PeripheralMap(const PeripheralMap&) = delete;
+        PeripheralMap& operator=(const PeripheralMap&) = delete;
+
+        bool HasPending() const { return !m_pending.empty(); }
+        void Start();
+    };
+}  // namespace EspApp
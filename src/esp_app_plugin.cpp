@@ -1,3 +1,9 @@
+#include "esp_app_core_dump.h"
+#include "esp_app_diff.h"
+#include "esp_app_elf.h"
+#include "esp_app_export.h"
+#include "esp_app_log_tags.h"
+#include "esp_app_mmu.h"
 #include "esp_app_view_type.h"
 #include "esp_app_view.h"
 #include "binaryninjaapi.h"
@@ -14,6 +20,14 @@ extern "C"
         BinaryNinja::LogInfo("ESP-APP View Plugin loaded");
         EspApp::InitializeChips();
         EspApp::InitEspAppViewType();
+        EspApp::RegisterSeedCacheCommands();
+        EspApp::RegisterRegionCommands();
+        EspApp::RegisterExportCommands();
+        EspApp::RegisterDiffCommands();
+        EspApp::RegisterLogTagCommands();
+        EspApp::RegisterCoreDumpCommands();
+        EspApp::RegisterElfCommands();
+        EspApp::RegisterMmuCommands();
         return true;
     }
 }
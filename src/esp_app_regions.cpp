@@ -0,0 +1,174 @@
+#include "esp_app_regions.h"
+#include "core/esp_layout.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <span>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static mutex g_lazyRegionMetadataMutex;
+
+    void MapDeferredRegions(BinaryView* view, span<const MemoryRegion* const> regions)
+    {
+        vector<const MemoryRegion*> unmapped;
+        for (const MemoryRegion* region : regions)
+        {
+            if (!view->GetSegmentAt(region->start_addr))
+                unmapped.push_back(region);
+        }
+        if (unmapped.empty())
+            return;
+
+        view->BeginBulkAddSegments();
+        for (const MemoryRegion* region : unmapped)
+            view->AddAutoSegment(region->start_addr, region->end_addr - region->start_addr, 0, 0, region->flags);
+        view->EndBulkAddSegments();
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        for (const MemoryRegion* region : unmapped)
+        {
+            view->AddAutoSection(region->name, region->start_addr, region->end_addr - region->start_addr,
+                static_cast<BNSectionSemantics>(GetRegionSectionSemantics(*region)));
+            logger->LogInfo("Mapped deferred region %s (0x%08llx-0x%08llx)", region->name, region->start_addr,
+                region->end_addr);
+        }
+
+        lock_guard<mutex> lock(g_lazyRegionMetadataMutex);
+        vector<string> mapped;
+        Ref<Metadata> stored = view->QueryMetadata("esp.lazy_regions");
+        if (stored && stored->IsArray())
+        {
+            for (const auto& name : stored->GetArray())
+                mapped.push_back(name->GetString());
+        }
+        for (const MemoryRegion* region : unmapped)
+            mapped.push_back(region->name);
+        view->StoreMetadata("esp.lazy_regions", new Metadata(mapped), true);
+    }
+
+    static vector<const MemoryRegion*> GetDeferredRegions(BinaryView* view)
+    {
+        vector<const MemoryRegion*> regions;
+        Ref<Metadata> sparse = view->QueryMetadata("esp.sparse");
+        if (!sparse || !sparse->IsKeyValueStore())
+            return regions;
+
+        auto store = sparse->GetKeyValueStore();
+        if (!store.count("chip_id") || !store.count("deferred"))
+            return regions;
+        const ChipAttr* attr = GetChipAttrById(static_cast<EspChipId>(store["chip_id"]->GetUnsignedInteger()));
+        if (!attr)
+            return regions;
+
+        for (const auto& name : store["deferred"]->GetArray())
+        {
+            for (size_t i = 0; i < attr->region_count; i++)
+            {
+                const MemoryRegion& region = attr->regions[i];
+                if (name->GetString() == region.name && !view->GetSegmentAt(region.start_addr))
+                    regions.push_back(&region);
+            }
+        }
+        return regions;
+    }
+
+    LazyRegionMap::LazyRegionMap(BinaryView* view, vector<const MemoryRegion*> pending) :
+        m_view(view), m_pending(std::move(pending)), m_registered(false)
+    {
+    }
+
+    LazyRegionMap::~LazyRegionMap()
+    {
+        if (m_event)
+            m_event->Cancel();
+        if (m_registered)
+            m_view->UnregisterNotification(this);
+    }
+
+    void LazyRegionMap::Start()
+    {
+        if (m_pending.empty())
+            return;
+        m_view->RegisterNotification(this);
+        m_registered = true;
+        m_event = m_view->AddAnalysisCompletionEvent([this]() { OnAnalysisComplete(); });
+    }
+
+    void LazyRegionMap::OnFunctionUpdated(BinaryView*, Function* func)
+    {
+        Ref<LowLevelILFunction> il = func->GetLowLevelILIfAvailable();
+        if (!il)
+            return;
+
+        lock_guard<mutex> lock(m_mutex);
+        if (m_pending.empty())
+            return;
+
+        for (size_t i = 0; i < il->GetInstructionCount(); i++)
+        {
+            il->GetInstruction(i).VisitExprs([&](const LowLevelILInstruction& expr) {
+                if (expr.operation != LLIL_CONST && expr.operation != LLIL_CONST_PTR)
+                    return true;
+
+                uint64_t value = static_cast<uint32_t>(expr.GetConstant());
+                auto it = find_if(m_pending.begin(), m_pending.end(), [&](const MemoryRegion* region) {
+                    return value >= region->start_addr && value < region->end_addr;
+                });
+                if (it != m_pending.end())
+                {
+                    m_referenced.push_back(*it);
+                    m_pending.erase(it);
+                }
+                return !m_pending.empty();
+            });
+        }
+    }
+
+    void LazyRegionMap::OnAnalysisComplete()
+    {
+        vector<const MemoryRegion*> referenced;
+        bool pending;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            referenced.swap(m_referenced);
+            pending = !m_pending.empty();
+        }
+
+        // Segments are added outside the lock; adding them starts another analysis pass
+        if (!referenced.empty())
+            MapDeferredRegions(m_view, referenced);
+
+        // Completion events fire once; keep watching while regions remain
+        if (pending)
+            m_event = m_view->AddAnalysisCompletionEvent([this]() { OnAnalysisComplete(); });
+        else
+            m_event = nullptr;
+    }
+
+    void RegisterRegionCommands()
+    {
+        PluginCommand::Register("ESP\\Map Deferred Region...",
+            "Map a memory region that sparse mapping left out of the view",
+            [](BinaryView* view) {
+                vector<const MemoryRegion*> regions = GetDeferredRegions(view);
+                vector<string> choices;
+                for (const MemoryRegion* region : regions)
+                {
+                    char range[48];
+                    snprintf(range, sizeof(range), " (0x%08llx-0x%08llx)",
+                        static_cast<unsigned long long>(region->start_addr),
+                        static_cast<unsigned long long>(region->end_addr));
+                    choices.push_back(region->name + string(range));
+                }
+
+                size_t choice;
+                if (!choices.empty() && GetChoiceInput(choice, "Region", "Map Deferred Region", choices))
+                    MapDeferredRegions(view, {&regions[choice], 1});
+            },
+            [](BinaryView* view) { return !GetDeferredRegions(view).empty(); });
+    }
+}  // namespace EspApp
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include "core/esp_chip.h"
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace EspApp
+{
+    // Add regions that sparse mapping deferred, each as one unbacked segment and section. They are
+    // recorded in "esp.lazy_regions" so that a reopened database maps them up front.
+    void MapDeferredRegions(BinaryNinja::BinaryView* view, std::span<const MemoryRegion* const> regions);
+
+    // Regions deferred by sparse mapping, mapped once analysis references an address inside them. Every
+    // updated function's lifted IL is checked for constants that point into a pending region; the regions
+    // that were hit are mapped together after the analysis pass.
+    class LazyRegionMap : public BinaryNinja::BinaryDataNotification
+    {
+        BinaryNinja::BinaryView* m_view;
+
+        std::mutex m_mutex;
+        std::vector<const MemoryRegion*> m_pending;
+        std::vector<const MemoryRegion*> m_referenced;
+        BinaryNinja::Ref<BinaryNinja::AnalysisCompletionEvent> m_event;
+        bool m_registered;
+
+        void OnAnalysisComplete();
+
+    public:
+        LazyRegionMap(BinaryNinja::BinaryView* view, std::vector<const MemoryRegion*> pending);
+        virtual ~LazyRegionMap();
+
+        void Start();
+
+        virtual void OnFunctionUpdated(BinaryNinja::BinaryView* view, BinaryNinja::Function* func) override;
+    };
+
+    void RegisterRegionCommands();
+}  // namespace EspApp
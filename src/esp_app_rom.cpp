@@ -0,0 +1,45 @@
+#include "esp_app_rom.h"
+#include "core/esp_layout.h"
+#include "core/esp_rom_symbols.h"
+
+#include <string>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    void ApplyRomSymbols(EspAppView* view)
+    {
+        const ChipAttr* attr = view->GetChipAttr();
+        if (!attr)
+            return;
+
+        RomSymbolTable table = GetRomSymbolTable(attr->chip_id);
+        if (table.GetCount() == 0)
+            return;
+
+        // Both the regions and the symbols are sorted by address, so each region takes a contiguous run
+        RegionIndex index(*attr);
+        size_t defined = 0;
+        view->BeginBulkModifySymbols();
+        for (const MemoryRegion* region : index.GetRegions())
+        {
+            BNSymbolType type = (region->flags & RegionContainsCode) ? FunctionSymbol : DataSymbol;
+            for (size_t i = table.LowerBound(region->start_addr); i < table.GetCount(); i++)
+            {
+                RomSymbol sym = table.Get(i);
+                if (sym.addr >= region->end_addr)
+                    break;
+                if (sym.name.empty())
+                    continue;
+                view->DefineAutoSymbol(new Symbol(type, string(sym.name), sym.addr, GlobalBinding));
+                defined++;
+            }
+        }
+        view->EndBulkModifySymbols();
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        logger->LogInfo("Defined %zu of %zu ROM symbols for %s", defined, table.GetCount(), attr->chip_name);
+    }
+}  // namespace EspApp
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "esp_app_view.h"
+
+namespace EspApp
+{
+    // Define the chip's embedded ROM symbols (see scripts/gen_rom_symbols.py) in one bulk symbol batch.
+    // Symbols that fall outside the chip's memory regions are skipped.
+    void ApplyRomSymbols(EspAppView* view);
+}  // namespace EspApp
@@ -0,0 +1,124 @@
+#include "esp_app_seeds.h"
+#include "esp_app_view.h"
+
+#include <algorithm>
+#include <filesystem>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    string GetSeedCacheDirectory()
+    {
+        return (filesystem::path(GetUserDirectory()) / "esp_app" / "seeds").string();
+    }
+
+    AnalysisSeedCache::AnalysisSeedCache(BinaryView* view, const string& key) :
+        m_view(view), m_path(GetSeedCachePath(GetSeedCacheDirectory(), key))
+    {
+    }
+
+    AnalysisSeedCache::~AnalysisSeedCache()
+    {
+        if (m_event)
+            m_event->Cancel();
+    }
+
+    bool AnalysisSeedCache::Apply(Platform* platform)
+    {
+        SeedCache cache;
+        if (!cache.Open(m_path))
+            return false;
+
+        for (size_t i = 0; i < cache.GetFunctionCount(); i++)
+            m_view->AddFunctionForAnalysis(platform, cache.GetFunctionStart(i));
+
+        size_t dataVars = 0;
+        for (size_t i = 0; i < cache.GetDataVarCount(); i++)
+        {
+            // Types that are not known yet (e.g. lazily defined peripheral structs) are skipped
+            QualifiedNameAndType parsed;
+            string errors;
+            if (!m_view->ParseTypeString(string(cache.GetDataVarType(i)), parsed, errors))
+                continue;
+            m_view->DefineDataVariable(cache.GetDataVarAddress(i), parsed.type);
+            dataVars++;
+        }
+
+        m_view->BeginBulkModifySymbols();
+        for (size_t i = 0; i < cache.GetNameCount(); i++)
+        {
+            BNSymbolType type = cache.GetNameKind(i) == SeedSymbolKind::Function ? FunctionSymbol : DataSymbol;
+            m_view->DefineUserSymbol(new Symbol(type, string(cache.GetName(i)), cache.GetNameAddress(i)));
+        }
+        m_view->EndBulkModifySymbols();
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        logger->LogInfo("Seeded analysis from %s: %zu functions, %zu data variables, %zu names", m_path.c_str(),
+            cache.GetFunctionCount(), dataVars, cache.GetNameCount());
+        return true;
+    }
+
+    static bool StoreSeeds(BinaryView* view, const string& path)
+    {
+        AnalysisSeeds seeds;
+        for (const auto& func : view->GetAnalysisFunctionList())
+            seeds.function_starts.push_back(static_cast<uint32_t>(func->GetStart()));
+        sort(seeds.function_starts.begin(), seeds.function_starts.end());
+
+        for (const auto& [addr, var] : view->GetDataVariables())
+        {
+            Ref<Type> type = var.type.GetValue();
+            if (type)
+                seeds.data_vars.push_back({static_cast<uint32_t>(addr), type->GetString()});
+        }
+
+        for (const auto& sym : view->GetSymbols())
+        {
+            if (sym->IsAutoDefined())
+                continue;
+            if (sym->GetType() == FunctionSymbol)
+                seeds.names.push_back({static_cast<uint32_t>(sym->GetAddress()), SeedSymbolKind::Function,
+                    sym->GetRawName()});
+            else if (sym->GetType() == DataSymbol)
+                seeds.names.push_back({static_cast<uint32_t>(sym->GetAddress()), SeedSymbolKind::Data,
+                    sym->GetRawName()});
+        }
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        if (!StoreSeedCache(path, seeds))
+        {
+            logger->LogError("Failed to write analysis seed cache %s", path.c_str());
+            return false;
+        }
+        logger->LogDebug("Stored analysis seeds in %s: %zu functions, %zu data variables, %zu names",
+            path.c_str(), seeds.function_starts.size(), seeds.data_vars.size(), seeds.names.size());
+        return true;
+    }
+
+    void AnalysisSeedCache::StoreAfterAnalysis()
+    {
+        // Collecting the results walks the whole view, so it runs on a worker rather than the analysis thread
+        m_event = m_view->AddAnalysisCompletionEvent([this]() {
+            Ref<BinaryView> view = m_view;
+            string path = m_path;
+            WorkerEnqueue([view, path]() { StoreSeeds(view, path); }, "ESP analysis seed cache");
+        });
+    }
+
+    void RegisterSeedCacheCommands()
+    {
+        PluginCommand::Register("ESP\\Update Analysis Seed Cache",
+            "Store the current functions, data variables and user names as seeds for later loads of this build",
+            [](BinaryView* view) {
+                Ref<Metadata> key = view->QueryMetadata("esp.seed_key");
+                if (key && key->IsString())
+                    StoreSeeds(view, GetSeedCachePath(GetSeedCacheDirectory(), key->GetString()));
+            },
+            [](BinaryView* view) {
+                Ref<Metadata> key = view->QueryMetadata("esp.seed_key");
+                return key && key->IsString();
+            });
+    }
+}  // namespace EspApp
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "binaryninjaapi.h"
+#include "core/esp_seed_cache.h"
+#include <string>
+
+namespace EspApp
+{
+    // On-disk analysis seeds for one build (see core/esp_seed_cache.h), shared by every database and
+    // machine that loads the same image. Seeds are applied in bulk at load and stored once the first
+    // analysis pass completes; "ESP\Update Analysis Seed Cache" stores them again on demand.
+    class AnalysisSeedCache
+    {
+        BinaryNinja::BinaryView* m_view;
+        std::string m_path;
+        BinaryNinja::Ref<BinaryNinja::AnalysisCompletionEvent> m_event;
+
+    public:
+        AnalysisSeedCache(BinaryNinja::BinaryView* view, const std::string& key);
+        ~AnalysisSeedCache();
+
+        AnalysisSeedCache(const AnalysisSeedCache&) = delete;
+        AnalysisSeedCache& operator=(const AnalysisSeedCache&) = delete;
+
+        // Seed analysis from the cache file, if there is one. Returns false if nothing was applied.
+        bool Apply(BinaryNinja::Platform* platform);
+
+        void StoreAfterAnalysis();
+    };
+
+    std::string GetSeedCacheDirectory();
+    void RegisterSeedCacheCommands();
+}  // namespace EspApp
@@ -0,0 +1,113 @@
+#include "esp_app_signatures.h"
+#include "core/esp_signatures.h"
+
+#include <filesystem>
+#include <vector>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    string GetSignatureDirectory()
+    {
+        return (filesystem::path(GetUserDirectory()) / "esp_app" / "signatures").string();
+    }
+
+    static void ApplySignatures(EspAppView* view, const vector<CodeRange>& ranges, PrologueArch arch,
+        const vector<string>& paths, string_view idfVersion)
+    {
+        Ref<Platform> plat = view->GetDefaultPlatform();
+        AppImageBytes image(view->GetParentView(), view->GetParsedImage());
+        vector<CodeRange> imageRanges = ranges;
+        image.RebaseRanges(imageRanges);
+        SignatureIndex best;
+        vector<SignatureMatch> bestMatches;
+        string bestPath;
+        for (const string& path : paths)
+        {
+            SignatureIndex index;
+            if (!index.Open(path))
+                continue;
+
+            vector<SignatureMatch> matches = MatchSignatures(image.GetSpan(), imageRanges, arch, index);
+            if (bestPath.empty() || matches.size() > bestMatches.size())
+            {
+                best = std::move(index);
+                bestMatches = std::move(matches);
+                bestPath = path;
+            }
+
+            // Databases are ranked; one built for the app's own release is used as is
+            if (IsSameIdfRelease(best.GetIdfVersion(), idfVersion))
+                break;
+        }
+        if (bestPath.empty())
+            return;
+
+        // The ELF lookup may have found the build while the code was matched
+        if (view->QueryMetadata("esp.elf_sidecar"))
+            return;
+
+        view->BeginBulkModifySymbols();
+        for (const SignatureMatch& match : bestMatches)
+        {
+            SignatureEntry entry = best.Get(match.entry);
+            view->AddFunctionForAnalysis(plat, match.addr);
+            view->DefineAutoSymbol(new Symbol(FunctionSymbol, string(entry.name), match.addr, GlobalBinding));
+        }
+        view->EndBulkModifySymbols();
+
+        Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+        logger->LogInfo("Signatures: named %zu functions from %s (%zu signatures, ESP-IDF %.*s)", bestMatches.size(),
+            bestPath.c_str(), best.GetCount(), static_cast<int>(best.GetIdfVersion().size()),
+            best.GetIdfVersion().data());
+    }
+
+    void StartSignatureMatching(EspAppView* view, const LayoutPlan& plan)
+    {
+        Ref<Settings> settings = view->GetLoadSettings(view->GetTypeName());
+        if (settings && settings->Contains("loader.esp.signatures") &&
+            !settings->Get<bool>("loader.esp.signatures", view))
+            return;
+        bool anyRelease = settings && settings->Contains("loader.esp.signaturesAnyRelease") &&
+            settings->Get<bool>("loader.esp.signaturesAnyRelease", view);
+
+        const ChipAttr* attr = view->GetChipAttr();
+        if (!attr || !view->GetDefaultPlatform())
+            return;
+        PrologueArch arch = GetPrologueArch(*attr);
+        if (arch == PrologueArch::Unknown)
+            return;
+
+        const AppDesc* desc = view->GetAppDesc();
+        string idfVersion = desc ? string(desc->idf_ver) : string();
+        vector<string> paths = FindSignatureDatabases(GetSignatureDirectory(), attr->chip_id, idfVersion, anyRelease);
+        if (paths.empty())
+        {
+            if (!anyRelease && !FindSignatureDatabases(GetSignatureDirectory(), attr->chip_id, {}, true).empty())
+            {
+                Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+                logger->LogInfo("Signatures: no database for %s and ESP-IDF %s; turn on the "
+                    "loader.esp.signaturesAnyRelease load setting to try the other releases", attr->chip_name,
+                    idfVersion.empty() ? "(unknown)" : idfVersion.c_str());
+            }
+            return;
+        }
+
+        vector<CodeRange> ranges;
+        for (const auto& segment : plan.segments)
+        {
+            if ((segment.flags & RegionContainsCode) && segment.data_length)
+                ranges.push_back({segment.data_offset, segment.data_length, static_cast<uint32_t>(segment.start)});
+        }
+        if (ranges.empty())
+            return;
+
+        // Matching reads every code byte once per database; the load does not wait for it
+        Ref<EspAppView> viewRef = view;
+        WorkerEnqueue([viewRef, ranges, arch, paths, idfVersion]() {
+            ApplySignatures(viewRef, ranges, arch, paths, idfVersion);
+        }, "ESP signature matching");
+    }
+}  // namespace EspApp
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_app_view.h"
+#include "core/esp_layout.h"
+
+#include <string>
+
+namespace EspApp
+{
+    // Match the code segments against the signature database for the chip and the app's ESP-IDF release (see
+    // core/esp_signatures.h and scripts/gen_signatures.py) on a worker thread, and name the matched functions
+    // in one bulk symbol batch. Without a database for the release nothing is matched, unless the
+    // loader.esp.signaturesAnyRelease load setting asks to try every database for the chip and keep the one
+    // with the most matches. Skipped if an app ELF has been applied by then.
+    void StartSignatureMatching(EspAppView* view, const LayoutPlan& plan);
+
+    std::string GetSignatureDirectory();
+}  // namespace EspApp
@@ -0,0 +1,157 @@
+#include "esp_app_verify.h"
+#include "core/esp_verify.h"
+
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+using namespace BinaryNinja;
+
+namespace EspApp
+{
+    static constexpr size_t VERIFY_CHUNK_SIZE = 1024 * 1024;
+    static constexpr const char* INTEGRITY_TAG_TYPE = "ESP Image Integrity";
+
+    static mutex g_verifyCacheMutex;
+    static unordered_map<uint64_t, ImageVerifyResult> g_verifyCache;
+
+    static string GetVerifyCacheDirectory()
+    {
+        return (filesystem::path(GetUserDirectory()) / "esp_app" / "verify").string();
+    }
+
+    static bool FindCachedResult(uint64_t key, ImageVerifyResult& result)
+    {
+        {
+            lock_guard<mutex> lock(g_verifyCacheMutex);
+            auto it = g_verifyCache.find(key);
+            if (it != g_verifyCache.end())
+            {
+                result = it->second;
+                return true;
+            }
+        }
+
+        if (!LoadCachedVerifyResult(GetVerifyCacheDirectory(), key, result))
+            return false;
+
+        lock_guard<mutex> lock(g_verifyCacheMutex);
+        g_verifyCache[key] = result;
+        return true;
+    }
+
+    static void CacheResult(uint64_t key, const ImageVerifyResult& result)
+    {
+        {
+            lock_guard<mutex> lock(g_verifyCacheMutex);
+            g_verifyCache[key] = result;
+        }
+        StoreCachedVerifyResult(GetVerifyCacheDirectory(), key, result);
+    }
+
+    static void ReportVerifyResult(EspAppView* view, const ImageVerifyResult& result, Logger* logger)
+    {
+        map<string, Ref<Metadata>> verify;
+        verify["checksum_present"] = new Metadata(result.checksum_present);
+        verify["checksum_expected"] = new Metadata(uint64_t(result.checksum_expected));
+        verify["checksum_computed"] = new Metadata(uint64_t(result.checksum_computed));
+        verify["checksum_valid"] = new Metadata(result.ChecksumValid());
+        verify["hash_appended"] = new Metadata(result.hash_appended);
+        verify["sha256_computed"] = new Metadata(DigestToHex(result.hash_computed));
+        if (result.hash_appended)
+        {
+            verify["sha256_present"] = new Metadata(result.hash_present);
+            verify["sha256_expected"] = new Metadata(DigestToHex(result.hash_expected));
+            verify["sha256_valid"] = new Metadata(result.HashValid());
+        }
+        view->StoreMetadata("esp.verify", new Metadata(verify), true);
+
+        if (result.IsValid())
+        {
+            logger->LogInfo("Image checksum%s valid", result.hash_appended ? " and SHA-256" : "");
+            return;
+        }
+
+        Ref<TagType> tagType = view->GetTagType(INTEGRITY_TAG_TYPE);
+        if (!tagType)
+        {
+            tagType = new TagType(view, INTEGRITY_TAG_TYPE, "\xE2\x9A\xA0");
+            view->AddTagType(tagType);
+        }
+
+        char message[160];
+        uint64_t addr = view->GetEntryPoint();
+        if (!result.checksum_present)
+        {
+            snprintf(message, sizeof(message), "Image is truncated before its checksum byte");
+            view->CreateAutoDataTag(addr, INTEGRITY_TAG_TYPE, message, true);
+            logger->LogWarn("%s", message);
+        }
+        else if (!result.ChecksumValid())
+        {
+            snprintf(message, sizeof(message), "Image checksum mismatch: expected 0x%02x, computed 0x%02x",
+                result.checksum_expected, result.checksum_computed);
+            view->CreateAutoDataTag(addr, INTEGRITY_TAG_TYPE, message, true);
+            logger->LogWarn("%s", message);
+        }
+
+        if (!result.HashValid())
+        {
+            string text = result.hash_present ? "Appended SHA-256 mismatch: expected " +
+                    DigestToHex(result.hash_expected) + ", computed " + DigestToHex(result.hash_computed) :
+                                                "Image is truncated inside its appended SHA-256";
+            view->CreateAutoDataTag(addr, INTEGRITY_TAG_TYPE, text, true);
+            logger->LogWarn("%s", text.c_str());
+        }
+    }
+
+    void StartImageVerification(EspAppView* view)
+    {
+        // A database reopened from disk already carries the result
+        if (view->QueryMetadata("esp.verify"))
+            return;
+
+        Ref<EspAppView> viewRef = view;
+        ParsedImage image = view->GetParsedImage();
+        string filename = view->GetFile()->GetOriginalFilename();
+
+        WorkerEnqueue(
+            [viewRef, image, filename]() {
+                Ref<Logger> logger = LogRegistry::GetLogger("BinaryView.EspAppView");
+
+                optional<FileIdentity> identity = GetFileIdentity(filename);
+                uint64_t key = identity ? GetFileIdentityKey(*identity, image.base_offset) : 0;
+
+                ImageVerifyResult result;
+                if (identity && FindCachedResult(key, result))
+                {
+                    ReportVerifyResult(viewRef, result, logger);
+                    return;
+                }
+
+                AppImageBytes bytes(viewRef->GetParentView(), image);
+                ImageVerifier verifier(bytes.GetSpan(), bytes.GetImage());
+
+                Ref<BackgroundTask> task = new BackgroundTask("Verifying ESP image checksum", true);
+                while (!verifier.Step(VERIFY_CHUNK_SIZE))
+                {
+                    if (task->IsCancelled())
+                    {
+                        task->Finish();
+                        return;
+                    }
+                    char progress[64];
+                    snprintf(progress, sizeof(progress), "Verifying ESP image checksum (%d%%)",
+                        static_cast<int>(verifier.GetProgress() * 100));
+                    task->SetProgressText(progress);
+                }
+                task->Finish();
+
+                if (identity)
+                    CacheResult(key, verifier.GetResult());
+                ReportVerifyResult(viewRef, verifier.GetResult(), logger);
+            },
+            "ESP image verification");
+    }
+}  // namespace EspApp
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "esp_app_view.h"
+
+namespace EspApp
+{
+    // Verify the image checksum and appended SHA-256 on a worker thread, off the load path. Results are
+    // cached by file identity and reported as "esp.verify" view metadata plus a tag on mismatch.
+    void StartImageVerification(EspAppView* view);
+}  // namespace EspApp
@@ -1,101 +1,515 @@
 #include "esp_app_view.h"
+#include "esp_app_core_dump.h"
+#include "esp_app_decrypt.h"
+#include "esp_app_elf.h"
+#include "esp_app_export.h"
+#include "esp_app_log_tags.h"
+#include "esp_app_regions.h"
+#include "esp_app_rom.h"
+#include "esp_app_seeds.h"
+#include "esp_app_signatures.h"
+#include "esp_app_verify.h"
 #include "esp32.h"
+#include "core/esp_verify.h"
 
 #include <algorithm>
+#include <cstring>
+#include <optional>
 
 using namespace std;
 using namespace BinaryNinja;
 
 namespace EspApp
 {
-    static const ChipAttr* g_chipAttrList[] = {
-        &g_esp32Attr,
-        // TODO: Add ESP32-S2, ESP32-S3 attributes
+    // Region flags and semantics are handed to the core unchanged
+    static_assert(uint32_t(RegionExecutable) == uint32_t(SegmentExecutable) &&
+            uint32_t(RegionWritable) == uint32_t(SegmentWritable) &&
+            uint32_t(RegionReadable) == uint32_t(SegmentReadable) &&
+            uint32_t(RegionContainsData) == uint32_t(SegmentContainsData) &&
+            uint32_t(RegionContainsCode) == uint32_t(SegmentContainsCode),
+        "Region flags must match BNSegmentFlag");
+    static_assert(uint32_t(RegionDefaultSemantics) == uint32_t(DefaultSectionSemantics) &&
+            uint32_t(RegionReadOnlyCodeSemantics) == uint32_t(ReadOnlyCodeSectionSemantics) &&
+            uint32_t(RegionExternalSemantics) == uint32_t(ExternalSectionSemantics),
+        "Region semantics must match BNSectionSemantics");
+
+    static const ChipHooks* g_chipHooksList[] = {
+        &g_esp32Hooks,
+        &g_esp32s2Hooks,
+        &g_esp32s3Hooks,
     };
 
-    static const size_t g_chipAttrCount = sizeof(g_chipAttrList) / sizeof(g_chipAttrList[0]);
-
     void InitializeChips()
     {
-        for (size_t i = 0; i < g_chipAttrCount; i++)
+        for (const ChipHooks* hooks : g_chipHooksList)
         {
-            if (g_chipAttrList[i]->on_plugin_init)
+            if (hooks->on_plugin_init)
             {
-                g_chipAttrList[i]->on_plugin_init();
+                hooks->on_plugin_init();
             }
         }
     }
 
-    const ChipAttr* GetChipAttrById(EspChipId chipId)
+    const ChipHooks* GetChipHooksById(EspChipId chipId)
     {
-        for (size_t i = 0; i < g_chipAttrCount; i++)
+        for (const ChipHooks* hooks : g_chipHooksList)
         {
-            if (g_chipAttrList[i]->chip_id == chipId)
-                return g_chipAttrList[i];
+            if (hooks->chip_id == chipId)
+                return hooks;
         }
         return nullptr;
     }
 
-    const MemoryRegion* FindRegionForAddress(const ChipAttr* attr, uint64_t addr)
+    bool ReadRawView(void* context, uint64_t offset, void* dest, size_t length)
+    {
+        return static_cast<BinaryView*>(context)->Read(dest, offset, length) == length;
+    }
+
+    RawViewBytes::RawViewBytes(BinaryView* data)
     {
-        if (!attr || !attr->regions)
-            return nullptr;
+        uint64_t length = data->GetLength();
+        string filename = data->GetFile()->GetOriginalFilename();
 
-        for (size_t i = 0; i < attr->region_count; i++)
+        // Only trust the file on disk if it has the same length and the same leading page as the view. The
+        // file behind a decrypted view is ciphertext.
+        if (!filename.empty() && data->GetTypeName() != ESP_DECRYPTED_VIEW_TYPE && m_mapping.Open(filename) &&
+            m_mapping.GetSize() == length)
         {
-            const auto& region = attr->regions[i];
-            if (addr >= region.start_addr && addr < region.end_addr)
-                return &region;
+            size_t probeLength = static_cast<size_t>(min<uint64_t>(length, 0x1000));
+            DataBuffer probe = data->ReadBuffer(0, probeLength);
+            if (probe.GetLength() == probeLength && memcmp(probe.GetData(), m_mapping.GetData(), probeLength) == 0)
+            {
+                m_bytes = m_mapping.GetSpan();
+                return;
+            }
         }
-        return nullptr;
+        m_mapping.Close();
+
+        m_buffer = data->ReadBuffer(0, length);
+        m_bytes = span<const uint8_t>(static_cast<const uint8_t*>(m_buffer.GetData()), m_buffer.GetLength());
+    }
+
+    static bool GetLoadedImageOffset(BinaryView* view, uint64_t& offset)
+    {
+        offset = 0;
+        Ref<Metadata> flash = view->QueryMetadata("esp.flash");
+        if (flash && flash->IsKeyValueStore())
+        {
+            auto store = flash->GetKeyValueStore();
+            if (!store.count("loaded_offset"))
+                return false;
+            offset = store["loaded_offset"]->GetUnsignedInteger();
+        }
+        return true;
+    }
+
+    bool ParseViewImage(BinaryView* view, span<const uint8_t> raw, ParsedImage& out)
+    {
+        uint64_t offset;
+        return GetLoadedImageOffset(view, offset) && ParseImage(raw, out, offset) == ImageParseStatus::Ok;
+    }
+
+    AppImageBytes::AppImageBytes(BinaryView* view)
+    {
+        // The headers are read one at a time, so nothing but the image is touched
+        Ref<BinaryView> parent = view->GetParentView();
+        uint64_t offset;
+        ParsedImage image;
+        if (parent && GetLoadedImageOffset(view, offset) &&
+            ParseImage(parent->GetLength(), ReadRawView, parent.GetPtr(), image, offset) == ImageParseStatus::Ok)
+            Read(parent, image);
+    }
+
+    AppImageBytes::AppImageBytes(BinaryView* parent, const ParsedImage& image)
+    {
+        Read(parent, image);
+    }
+
+    void AppImageBytes::Read(BinaryView* parent, const ParsedImage& image)
+    {
+        uint64_t length = parent->GetLength();
+        uint64_t end = min<uint64_t>(LocateImageTrailer(image).image_end, length);
+        if (image.base_offset >= end)
+            return;
+
+        if (parent->GetTypeName() == ESP_DECRYPTED_VIEW_TYPE)
+        {
+            m_buffer = parent->ReadBuffer(image.base_offset, end - image.base_offset);
+            m_bytes = span<const uint8_t>(static_cast<const uint8_t*>(m_buffer.GetData()), m_buffer.GetLength());
+        }
+        else
+        {
+            m_raw.emplace(parent);
+            if (m_raw->GetSpan().size() < end)
+                return;
+            m_bytes = m_raw->GetSpan().subspan(image.base_offset, end - image.base_offset);
+        }
+        m_base = image.base_offset;
+        m_valid = ParseImage(m_bytes, m_image) == ImageParseStatus::Ok;
+    }
+
+    void AppImageBytes::RebaseRanges(vector<CodeRange>& ranges) const
+    {
+        erase_if(ranges, [this](const CodeRange& range) {
+            return range.file_offset < m_base || range.file_offset - m_base > m_bytes.size() ||
+                range.length > m_bytes.size() - (range.file_offset - m_base);
+        });
+        for (CodeRange& range : ranges)
+            range.file_offset -= m_base;
     }
 
     EspAppView::EspAppView(BinaryView* data, bool parseOnly) :
-        BinaryView("ESP-APP", data->GetFile(), data), m_parseOnly(parseOnly), m_entryPoint(0), m_header {},
-        m_chipAttr(nullptr)
+        BinaryView("ESP-APP", data->GetFile(), data), m_parseOnly(parseOnly), m_entryPoint(0), m_image {},
+        m_hasAppDesc(false), m_appDesc {}, m_encrypted(data->GetTypeName() == ESP_DECRYPTED_VIEW_TYPE),
+        m_flashDump(false), m_flashAppIndex(ESP_FLASH_NO_DUPLICATE), m_chipAttr(nullptr), m_chipHooks(nullptr)
     {
         m_logger = CreateLogger("BinaryView.EspAppView");
+        ScopedPhaseTimer timer(m_loadProfile, LoadPhase::Parse);
+
+        // The header and segment chain are parsed in place over the raw bytes. Encrypted data is only read
+        // through the decrypted view, a header at a time.
+        uint64_t length = data->GetLength();
+        optional<RawViewBytes> raw;
+        if (!m_encrypted)
+            raw.emplace(data);
+        span<const uint8_t> bytes = raw ? raw->GetSpan() : span<const uint8_t>();
+        m_loadProfile.image_bytes = length;
+
+        // Same order of checks as esp_app_triage: a flash dump without a loadable app falls back to an image at 0
+        if (m_encrypted ? LooksLikeFlashDump(length, ReadRawView, data) : LooksLikeFlashDump(bytes))
+        {
+            bool found = m_encrypted ? ScanFlashDump(length, ReadRawView, data, m_flashLayout) :
+                ScanFlashDump(bytes, m_flashLayout);
+            m_flashAppIndex = found ? m_flashLayout.GetDefaultAppIndex() : ESP_FLASH_NO_DUPLICATE;
+            m_flashDump = m_flashAppIndex != ESP_FLASH_NO_DUPLICATE;
+            m_logger->LogInfo("SPI flash dump: %zu partitions, %zu app images%s", m_flashLayout.partitions.size(),
+                m_flashLayout.apps.size(), raw && raw->IsMapped() ? " (memory-mapped)" : "");
+            if (!m_flashDump)
+                m_logger->LogWarn("No valid app image found in flash dump, parsing the data as an app image");
+        }
 
-        BinaryReader reader(data);
-
-        try
-        {
-            reader.Seek(0);
-            m_header.magic = reader.Read8();
-            m_header.segment_count = reader.Read8();
-            m_header.spi_mode = reader.Read8();
-            m_header.spi_speed_size = reader.Read8();
-            m_header.entry_addr = reader.Read32();
-            m_header.wp_pin = reader.Read8();
-            reader.Read(m_header.spi_pin_drv, 3);
-            m_header.chip_id = reader.Read16();
-            m_header.min_chip_rev = reader.Read8();
-            m_header.min_chip_rev_full = reader.Read16();
-            m_header.max_chip_rev_full = reader.Read16();
-            reader.Read(m_header.reserved, 4);
-            m_header.hash_appended = reader.Read8();
-
-            m_entryPoint = m_header.entry_addr;
-            m_chipAttr = GetChipAttrById(static_cast<EspChipId>(m_header.chip_id));
-
-            m_logger->LogDebug("ESP App Image: magic=0x%02x, segments=%d, entry=0x%08x, chip_id=0x%04x (%s)",
-                m_header.magic, m_header.segment_count, m_header.entry_addr, m_header.chip_id, m_chipAttr->chip_name);
-
-            uint64_t offset = sizeof(EspImageHeader);
-            for (uint8_t i = 0; i < m_header.segment_count && i < ESP_IMAGE_MAX_SEGMENTS; i++)
+        if (m_flashDump)
+        {
+            m_image = m_flashLayout.apps[m_flashAppIndex].image;
+            m_hasAppDesc = m_flashLayout.apps[m_flashAppIndex].has_app_desc;
+            m_appDesc = m_flashLayout.apps[m_flashAppIndex].app_desc;
+        }
+        else
+        {
+            ImageParseStatus status = m_encrypted ? ParseImage(length, ReadRawView, data, m_image) :
+                ParseImage(bytes, m_image);
+            if (status != ImageParseStatus::Ok)
             {
-                reader.Seek(offset);
-                SegmentInfo seg;
-                seg.load_addr = reader.Read32();
-                seg.data_len = reader.Read32();
-                seg.file_offset = offset + sizeof(EspSegmentHeader);
-                m_segments.push_back(seg);
-                offset = seg.file_offset + seg.data_len;
+                m_logger->LogError("Failed to parse ESP app image: %s (segment %zu, offset 0x%llx)",
+                    GetImageParseStatusString(status), m_image.failed_segment, m_image.error_offset);
+                m_image.segment_count = 0;
+                return;
             }
+
+            // The descriptor sits at a segment offset the parse above already found
+            m_hasAppDesc = m_encrypted ? ParseAppDesc(length, ReadRawView, data, m_image, m_appDesc) :
+                ParseAppDesc(bytes, m_image, m_appDesc);
         }
-        catch (ReadException& e)
+
+        m_entryPoint = m_image.header.entry_addr;
+        m_chipAttr = GetChipAttrById(m_image.ChipId());
+        m_chipHooks = GetChipHooksById(m_image.ChipId());
+
+        m_logger->LogDebug("ESP App Image: magic=0x%02x, segments=%d, entry=0x%08x, chip_id=0x%04x (%s)",
+            m_image.header.magic, m_image.header.segment_count, m_image.header.entry_addr, m_image.header.chip_id,
+            m_chipAttr ? m_chipAttr->chip_name : "unknown");
+    }
+
+    bool EspAppView::SelectFlashApp()
+    {
+        Ref<Settings> settings = GetLoadSettings(GetTypeName());
+        if (!settings || !settings->Contains("loader.esp.flashApp"))
+            return true;
+
+        string label = settings->Get<string>("loader.esp.flashApp", this);
+        if (label.empty())
+            return true;
+
+        for (size_t i = 0; i < m_flashLayout.apps.size(); i++)
         {
-            m_logger->LogError("Failed to parse ESP app image: %s", e.what());
+            const auto& app = m_flashLayout.apps[i];
+            if (label != app.partition.label)
+                continue;
+
+            if (!app.IsValid())
+            {
+                m_logger->LogError("Partition %s does not contain a valid app image: %s", app.partition.label,
+                    GetImageParseStatusString(app.status));
+                return false;
+            }
+
+            // Identical OTA slots are loaded once, through the first copy
+            m_flashAppIndex = app.IsDuplicate() ? app.duplicate_of : i;
+            m_image = m_flashLayout.apps[m_flashAppIndex].image;
+            m_hasAppDesc = m_flashLayout.apps[m_flashAppIndex].has_app_desc;
+            m_appDesc = m_flashLayout.apps[m_flashAppIndex].app_desc;
+            m_entryPoint = m_image.header.entry_addr;
+            m_chipAttr = GetChipAttrById(m_image.ChipId());
+            m_chipHooks = GetChipHooksById(m_image.ChipId());
+            return true;
+        }
+
+        m_logger->LogError("Partition %s not found in flash dump", label.c_str());
+        return false;
+    }
+
+    void EspAppView::StoreFlashLayoutMetadata()
+    {
+        vector<Ref<Metadata>> partitions;
+        for (const auto& partition : m_flashLayout.partitions)
+        {
+            map<string, Ref<Metadata>> entry;
+            entry["label"] = new Metadata(string(partition.label));
+            entry["type"] = new Metadata(string(GetPartitionTypeName(partition.type)));
+            entry["subtype"] = new Metadata(string(GetPartitionSubtypeName(partition.type, partition.subtype)));
+            entry["offset"] = new Metadata(uint64_t(partition.offset));
+            entry["size"] = new Metadata(uint64_t(partition.size));
+            entry["encrypted"] = new Metadata(partition.IsEncrypted());
+            partitions.push_back(new Metadata(entry));
+        }
+
+        vector<Ref<Metadata>> apps;
+        for (const auto& app : m_flashLayout.apps)
+        {
+            map<string, Ref<Metadata>> entry;
+            entry["label"] = new Metadata(string(app.partition.label));
+            entry["offset"] = new Metadata(uint64_t(app.partition.offset));
+            entry["status"] = new Metadata(string(GetImageParseStatusString(app.status)));
+            if (app.IsValid())
+            {
+                entry["size"] = new Metadata(app.GetImageSize());
+                entry["content_hash"] = new Metadata(app.content_hash);
+            }
+            if (app.IsDuplicate())
+                entry["duplicate_of"] = new Metadata(string(m_flashLayout.apps[app.duplicate_of].partition.label));
+            apps.push_back(new Metadata(entry));
+        }
+
+        map<string, Ref<Metadata>> flash;
+        flash["partition_table_offset"] = new Metadata(m_flashLayout.partition_table_offset);
+        flash["partitions"] = new Metadata(partitions);
+        flash["apps"] = new Metadata(apps);
+        flash["loaded_app"] = new Metadata(string(m_flashLayout.apps[m_flashAppIndex].partition.label));
+        flash["loaded_offset"] = new Metadata(m_image.base_offset);
+        if (m_flashLayout.has_bootloader)
+            flash["bootloader_offset"] = new Metadata(m_flashLayout.bootloader.base_offset);
+        StoreMetadata("esp.flash", new Metadata(flash), true);
+    }
+
+    void EspAppView::StoreAppDescMetadata()
+    {
+        map<string, Ref<Metadata>> desc;
+        desc["project_name"] = new Metadata(string(m_appDesc.project_name));
+        desc["version"] = new Metadata(string(m_appDesc.version));
+        desc["idf_ver"] = new Metadata(string(m_appDesc.idf_ver));
+        desc["date"] = new Metadata(string(m_appDesc.date));
+        desc["time"] = new Metadata(string(m_appDesc.time));
+        desc["secure_version"] = new Metadata(uint64_t(m_appDesc.secure_version));
+        desc["app_elf_sha256"] = new Metadata(DigestToHex(m_appDesc.app_elf_sha256));
+        desc["address"] = new Metadata(uint64_t(m_appDesc.load_addr));
+        desc["identity"] = new Metadata(GetAppIdentityKey(m_appDesc));
+        StoreMetadata("esp.app_desc", new Metadata(desc), true);
+    }
+
+    // The cache MMU mapping of every app, kept for the translation helpers and stored as page runs for scripts
+    void EspAppView::StoreFlashMmuMetadata()
+    {
+        auto model = make_shared<FlashMmuModel>();
+        FlashMmu& mmu = model->mmu;
+        if (!mmu.Init(m_image.ChipId()))
+            return;
+
+        vector<Ref<Metadata>> apps;
+        auto addApp = [&](const ParsedImage& image, const string& label) {
+            vector<MmuRun> runs;
+            mmu.GetRuns(mmu.AddImage(image), runs);
+            model->labels.push_back(label);
+            vector<Ref<Metadata>> runEntries;
+            for (const MmuRun& run : runs)
+            {
+                map<string, Ref<Metadata>> entry;
+                entry["address"] = new Metadata(uint64_t(run.addr));
+                entry["flash_offset"] = new Metadata(run.flash_offset);
+                entry["size"] = new Metadata(uint64_t(run.size));
+                runEntries.push_back(new Metadata(entry));
+            }
+            map<string, Ref<Metadata>> app;
+            app["label"] = new Metadata(label);
+            app["offset"] = new Metadata(image.base_offset);
+            app["runs"] = new Metadata(runEntries);
+            apps.push_back(new Metadata(app));
+        };
+
+        if (m_flashDump)
+        {
+            for (size_t i = 0; i < m_flashLayout.apps.size(); i++)
+            {
+                const auto& app = m_flashLayout.apps[i];
+                if (!app.IsValid() || app.image.ChipId() != m_image.ChipId())
+                    continue;
+                if (i == m_flashAppIndex)
+                    model->loaded_app = apps.size();
+                addApp(app.image, string(app.partition.label));
+            }
+        }
+        else
+        {
+            addApp(m_image, "app");
+        }
+
+        map<string, Ref<Metadata>> info;
+        info["chip_id"] = new Metadata(uint64_t(m_image.header.chip_id));
+        info["page_size"] = new Metadata(uint64_t(mmu.GetPageSize()));
+        info["loaded_app"] = new Metadata(uint64_t(model->loaded_app));
+        info["apps"] = new Metadata(apps);
+        StoreMetadata("esp.mmu", new Metadata(info), true);
+
+        m_mmu = model;
+        if (!m_parseOnly)
+            RegisterFlashMmuModel(GetFile()->GetSessionId(), model);
+    }
+
+    void EspAppView::DefineAppDescType()
+    {
+        Ref<Type> u8 = Type::IntegerType(1, false);
+        Ref<Type> u16 = Type::IntegerType(2, false);
+        Ref<Type> u32 = Type::IntegerType(4, false);
+        Ref<Type> ch = Type::IntegerType(1, true);
+
+        StructureBuilder builder;
+        builder.AddMember(u32, "magic_word");
+        builder.AddMember(u32, "secure_version");
+        builder.AddMember(Type::ArrayType(u32, 2), "reserv1");
+        builder.AddMember(Type::ArrayType(ch, 32), "version");
+        builder.AddMember(Type::ArrayType(ch, 32), "project_name");
+        builder.AddMember(Type::ArrayType(ch, 16), "time");
+        builder.AddMember(Type::ArrayType(ch, 16), "date");
+        builder.AddMember(Type::ArrayType(ch, 32), "idf_ver");
+        builder.AddMember(Type::ArrayType(u8, 32), "app_elf_sha256");
+        builder.AddMember(u16, "min_efuse_blk_rev_full");
+        builder.AddMember(u16, "max_efuse_blk_rev_full");
+        builder.AddMember(u8, "mmu_page_size");
+        builder.AddMember(Type::ArrayType(u8, 3), "reserv3");
+        builder.AddMember(Type::ArrayType(u32, 18), "reserv2");
+
+        QualifiedName name("esp_app_desc_t");
+        DefineType(Type::GenerateAutoTypeId("esp", name), name, Type::StructureType(builder.Finalize()));
+        DefineDataVariable(m_appDesc.load_addr, Type::NamedType(this, name));
+        DefineAutoSymbol(new Symbol(DataSymbol, "esp_app_desc", m_appDesc.load_addr, GlobalBinding));
+    }
+
+    void EspAppView::AddPrologueFunctions(const LayoutPlan& plan)
+    {
+        Ref<Settings> settings = GetLoadSettings(GetTypeName());
+        if (settings && settings->Contains("loader.esp.prologueScan") &&
+            !settings->Get<bool>("loader.esp.prologueScan", this))
+            return;
+
+        PrologueArch arch = GetPrologueArch(*m_chipAttr);
+        Ref<Platform> plat = GetDefaultPlatform();
+        if (arch == PrologueArch::Unknown || !plat)
+            return;
+
+        vector<CodeRange> ranges;
+        for (const auto& segment : plan.segments)
+        {
+            if ((segment.flags & RegionContainsCode) && segment.data_length)
+                ranges.push_back({segment.data_offset, segment.data_length, static_cast<uint32_t>(segment.start)});
+        }
+
+        AppImageBytes image(GetParentView(), m_image);
+        image.RebaseRanges(ranges);
+        vector<uint32_t> starts = ScanCodeRanges(image.GetSpan(), ranges, arch);
+        for (uint32_t start : starts)
+            AddFunctionForAnalysis(plat, start, true);
+        m_loadProfile.function_starts = starts.size();
+        m_logger->LogInfo("Prologue scan: %zu function starts in %zu code segments", starts.size(), ranges.size());
+
+        // Xtensa code loads its constants through L32R; decode them from the same starts while the bytes are at
+        // hand, the chip hooks define the literal pools
+        if (arch == PrologueArch::Xtensa)
+        {
+            if (!binary_search(starts.begin(), starts.end(), m_entryPoint))
+                starts.insert(upper_bound(starts.begin(), starts.end(), m_entryPoint), uint32_t(m_entryPoint));
+            m_literals = ResolveXtensaLiterals(image.GetSpan(), ranges, starts);
+        }
+    }
+
+    void EspAppView::StartAnalysisSeedCache()
+    {
+        Ref<Settings> settings = GetLoadSettings(GetTypeName());
+        if (settings && settings->Contains("loader.esp.seedCache") &&
+            !settings->Get<bool>("loader.esp.seedCache", this))
+            return;
+
+        string key;
+        Ref<Metadata> stored = QueryMetadata("esp.seed_key");
+        if (stored && stored->IsString())
+        {
+            key = stored->GetString();
+        }
+        else
+        {
+            // The build's ELF hash identifies it without reading the image; only without one is the image
+            // hashed, which for an encrypted image would mean decrypting all of it
+            const AppDesc* desc = GetAppDesc();
+            if (desc && desc->HasElfHash())
+            {
+                key = GetSeedCacheKey({}, m_image, desc);
+            }
+            else if (m_encrypted)
+            {
+                m_logger->LogInfo("Seed cache: encrypted image has no ELF hash, not cached");
+                return;
+            }
+            else
+            {
+                AppImageBytes image(GetParentView(), m_image);
+                key = GetSeedCacheKey(image.GetSpan(), image.GetImage(), nullptr);
+            }
+            StoreMetadata("esp.seed_key", new Metadata(key), true);
+        }
+
+        m_seedCache = make_unique<AnalysisSeedCache>(this, key);
+        m_seedCache->Apply(GetDefaultPlatform());
+        m_seedCache->StoreAfterAnalysis();
+    }
+
+    void EspAppView::StoreLoadProfile()
+    {
+        map<string, Ref<Metadata>> profile;
+        for (size_t i = 0; i < m_loadProfile.phase_ns.size(); i++)
+        {
+            profile[string(GetLoadPhaseName(static_cast<LoadPhase>(i))) + "_ns"] =
+                new Metadata(m_loadProfile.phase_ns[i]);
+        }
+        profile["total_ns"] = new Metadata(m_loadProfile.GetTotalNanoseconds());
+        profile["image_bytes"] = new Metadata(m_loadProfile.image_bytes);
+        profile["segments_created"] = new Metadata(m_loadProfile.segments_created);
+        profile["sections_created"] = new Metadata(m_loadProfile.sections_created);
+        profile["bytes_mapped"] = new Metadata(m_loadProfile.bytes_mapped);
+        profile["file_backed_bytes"] = new Metadata(m_loadProfile.file_backed_bytes);
+        profile["function_starts"] = new Metadata(m_loadProfile.function_starts);
+        StoreMetadata("esp.load_profile", new Metadata(profile), true);
+
+        m_logger->LogInfo("Load profile: %s", m_loadProfile.ToJson().c_str());
+    }
+
+    EspAppView::~EspAppView()
+    {
+        if (m_logTagEvent)
+            m_logTagEvent->Cancel();
+        ReleaseImageExport(GetFile()->GetSessionId());
+        // A parse-only view shares the session with the full view, whose memory map still reads these
+        if (!m_parseOnly)
+        {
+            ReleaseCoreDump(GetFile()->GetSessionId());
+            ReleaseFlashMmuModel(GetFile()->GetSessionId());
         }
     }
 
@@ -119,9 +533,74 @@ namespace EspApp
         return 4;
     }
 
+    void EspAppView::ApplyLayoutPlan(const LayoutPlan& plan)
+    {
+        // One batch for the whole memory map, so the core updates its segment map once
+        BeginBulkAddSegments();
+        for (const auto& segment : plan.segments)
+            AddAutoSegment(segment.start, segment.length, segment.data_offset, segment.data_length, segment.flags);
+        EndBulkAddSegments();
+
+        for (const auto& section : plan.sections)
+        {
+            AddAutoSection(section.name, section.start, section.length,
+                static_cast<BNSectionSemantics>(section.semantics));
+        }
+
+        m_logger->LogDebug("Mapped %zu segments (0x%llx bytes, 0x%llx file-backed)", plan.segments.size(),
+            plan.mapped_bytes, plan.file_backed_bytes);
+    }
+
+    bool EspAppView::IsSparseMappingEnabled()
+    {
+        Ref<Settings> settings = GetLoadSettings(GetTypeName());
+        return settings && settings->Contains("loader.esp.sparseRegions") &&
+            settings->Get<bool>("loader.esp.sparseRegions", this);
+    }
+
+    void EspAppView::DeferRegions(const vector<const MemoryRegion*>& deferred)
+    {
+        map<string, Ref<Metadata>> sparse;
+        vector<string> names;
+        for (const MemoryRegion* region : deferred)
+            names.push_back(region->name);
+        sparse["chip_id"] = new Metadata(uint64_t(m_chipAttr->chip_id));
+        sparse["deferred"] = new Metadata(names);
+        StoreMetadata("esp.sparse", new Metadata(sparse), true);
+
+        // Regions that an earlier session had to map are mapped again right away
+        vector<string> mapped;
+        Ref<Metadata> stored = QueryMetadata("esp.lazy_regions");
+        if (stored && stored->IsArray())
+        {
+            for (const auto& name : stored->GetArray())
+                mapped.push_back(name->GetString());
+        }
+
+        vector<const MemoryRegion*> remap, pending;
+        for (const MemoryRegion* region : deferred)
+        {
+            if (find(mapped.begin(), mapped.end(), region->name) != mapped.end())
+                remap.push_back(region);
+            else
+                pending.push_back(region);
+        }
+        if (!remap.empty())
+            MapDeferredRegions(this, remap);
+
+        m_logger->LogInfo("Sparse mapping: %zu regions deferred", pending.size());
+        if (pending.empty() || m_parseOnly)
+            return;
+        m_lazyRegions = make_unique<LazyRegionMap>(this, std::move(pending));
+        m_lazyRegions->Start();
+    }
+
     bool EspAppView::Init()
     {
-        if (m_segments.empty())
+        if (m_flashDump && !SelectFlashApp())
+            return false;
+
+        if (m_image.segment_count == 0)
         {
             m_logger->LogError("No segments found in ESP app image");
             return false;
@@ -129,141 +608,81 @@ namespace EspApp
 
         if (!m_chipAttr || !m_chipAttr->regions)
         {
-            m_logger->LogError("No attribute available for chip");
+            m_logger->LogError("No attribute available for chip: %s 0x%04x",
+                GetImageParseStatusString(ImageParseStatus::UnknownChip), m_image.header.chip_id);
             return false;
         }
 
         // Step 1: Validate all app segments and map them to regions
         // Each app segment must be fully contained within exactly one region
-        struct AppSegmentMapping
+        // Step 2: Fragment each region around its app segments
+        // Both steps only build a plan; the view is not touched until the whole layout is known
+        span<const SegmentInfo> segments = m_image.Segments();
+        RegionIndex regionIndex(*m_chipAttr);
+        SegmentRegionMap regionMap;
+        LayoutPlan plan;
+        LayoutMode mode = IsSparseMappingEnabled() ? LayoutMode::Sparse : LayoutMode::Full;
+        SegmentMapStatus mapStatus;
         {
-            size_t segmentIndex;
-            const SegmentInfo* segment;
-            const MemoryRegion* region;
-        };
-        vector<AppSegmentMapping> appSegmentMappings;
-
-        for (size_t i = 0; i < m_segments.size(); i++)
+            ScopedPhaseTimer timer(m_loadProfile, LoadPhase::Plan);
+            mapStatus = PlanMemoryLayout(regionIndex, segments, regionMap, plan, mode);
+        }
+        if (mapStatus != SegmentMapStatus::Ok)
         {
-            const auto& seg = m_segments[i];
-            uint64_t seg_start = seg.load_addr;
-            uint64_t seg_end = seg.load_addr + seg.data_len;
-
-            const MemoryRegion* region = FindRegionForAddress(m_chipAttr, seg_start);
-
-            if (!region)
+            size_t i = regionMap.failed_segment;
+            const auto& seg = segments[i];
+            uint64_t seg_end = static_cast<uint64_t>(seg.load_addr) + seg.data_len;
+            const MemoryRegion* region = regionMap.regions[i];
+            switch (mapStatus)
             {
+            case SegmentMapStatus::NoRegion:
                 m_logger->LogError("Segment %zu at 0x%08x is not in any known memory region", i, seg.load_addr);
-                return false;
+                break;
+            case SegmentMapStatus::SpansRegions:
+                m_logger->LogError("Segment %zu at 0x%08x-0x%08llx spans multiple regions (%s and %s)", i,
+                    seg.load_addr, seg_end, region->name, regionMap.end_region->name);
+                break;
+            default:
+                m_logger->LogError("Segment %zu at 0x%08x-0x%08llx exceeds region %s boundary (0x%08llx-0x%08llx)",
+                    i, seg.load_addr, seg_end, region->name, region->start_addr, region->end_addr);
+                break;
             }
-
-            // Check if segment end is within the same region
-            if (seg_end > region->end_addr)
-            {
-                // Check if segment spans multiple regions
-                const MemoryRegion* endRegion = FindRegionForAddress(m_chipAttr, seg_end - 1);
-                if (endRegion && endRegion != region)
-                {
-                    m_logger->LogError("Segment %zu at 0x%08x-0x%08llx spans multiple regions (%s and %s)", i,
-                        seg.load_addr, seg_end, region->name, endRegion->name);
-                }
-                else
-                {
-                    m_logger->LogError("Segment %zu at 0x%08x-0x%08llx exceeds region %s boundary (0x%08llx-0x%08llx)",
-                        i, seg.load_addr, seg_end, region->name, region->start_addr, region->end_addr);
-                }
-                return false;
-            }
-
-            m_logger->LogDebug("Segment %zu: region=%s addr=0x%08x, len=0x%x, offset=0x%llx", i, region->name,
-                seg.load_addr, seg.data_len, seg.file_offset);
-
-            appSegmentMappings.push_back({i, &seg, region});
+            return false;
         }
 
-        // Step 2: Process each region - add file-backed segments and fragment remainders
-        for (size_t regionIdx = 0; regionIdx < m_chipAttr->region_count; regionIdx++)
+        for (size_t i = 0; i < segments.size(); i++)
         {
-            const auto& region = m_chipAttr->regions[regionIdx];
+            const auto& seg = segments[i];
+            m_logger->LogDebug("Segment %zu: region=%s addr=0x%08x, len=0x%x, offset=0x%llx", i,
+                regionMap.regions[i]->name, seg.load_addr, seg.data_len, seg.file_offset);
+        }
 
-            // Collect all app segments that belong to this region, sorted by address
-            vector<const AppSegmentMapping*> regionAppSegments;
-            for (const auto& mapping : appSegmentMappings)
-            {
-                if (mapping.region == &region)
-                {
-                    regionAppSegments.push_back(&mapping);
-                }
-            }
+        {
+            ScopedPhaseTimer timer(m_loadProfile, LoadPhase::Map);
+            ApplyLayoutPlan(plan);
+            m_loadProfile.AddLayout(plan);
+            if (mode == LayoutMode::Sparse)
+                DeferRegions(plan.deferred_regions);
+        }
 
-            // Sort by load address
-            sort(regionAppSegments.begin(), regionAppSegments.end(),
-                [](const AppSegmentMapping* a, const AppSegmentMapping* b) {
-                    return a->segment->load_addr < b->segment->load_addr;
-                });
+        if (m_flashDump)
+        {
+            StoreFlashLayoutMetadata();
+            m_logger->LogInfo("Loaded app image from partition %s at flash offset 0x%llx",
+                m_flashLayout.apps[m_flashAppIndex].partition.label, m_image.base_offset);
+        }
 
-            BNSectionSemantics semantics =
-                (region.flags & SegmentContainsCode) ? ReadOnlyCodeSectionSemantics : DefaultSectionSemantics;
+        StoreFlashMmuMetadata();
 
-            if (regionAppSegments.empty())
-            {
-                // No app segments in this region - add entire region as non-file-backed
-                uint64_t regionSize = region.end_addr - region.start_addr;
-                AddAutoSegment(region.start_addr, regionSize, 0, 0, region.flags);
-                AddAutoSection(region.name, region.start_addr, regionSize, semantics);
-                m_logger->LogDebug("Region %s: added as non-file-backed (0x%08llx-0x%08llx)", region.name,
-                    region.start_addr, region.end_addr);
-            }
-            else
-            {
-                // Region has app segments - fragment the region
-                uint64_t currentAddr = region.start_addr;
-                size_t fragmentIndex = 0;
-
-                for (const auto* mapping : regionAppSegments)
-                {
-                    const auto& seg = *mapping->segment;
-                    uint64_t seg_start = seg.load_addr;
-                    uint64_t seg_end = seg.load_addr + seg.data_len;
-
-                    // Add non-file-backed fragment before this app segment (if any gap)
-                    if (currentAddr < seg_start)
-                    {
-                        uint64_t gapSize = seg_start - currentAddr;
-                        AddAutoSegment(currentAddr, gapSize, 0, 0, region.flags);
-
-                        string sectionName = string(region.name) + ".frag." + to_string(fragmentIndex++);
-                        AddAutoSection(sectionName, currentAddr, gapSize, semantics);
-                        m_logger->LogDebug("Region %s: added fragment at 0x%08llx-0x%08llx (non-file-backed)",
-                            region.name, currentAddr, seg_start);
-                    }
-
-                    // Add the file-backed app segment
-                    AddAutoSegment(seg.load_addr, seg.data_len, seg.file_offset, seg.data_len, region.flags);
-
-                    string sectionName = string(region.name) + ".app." + to_string(mapping->segmentIndex);
-                    AddAutoSection(sectionName, seg.load_addr, seg.data_len, semantics);
-                    m_logger->LogDebug("Region %s: added app segment %zu at 0x%08x-0x%08llx (file-backed)", region.name,
-                        mapping->segmentIndex, seg.load_addr, seg_end);
-
-                    currentAddr = seg_end;
-                }
-
-                // Add non-file-backed fragment after the last app segment (if any remainder)
-                if (currentAddr < region.end_addr)
-                {
-                    uint64_t remainderSize = region.end_addr - currentAddr;
-                    AddAutoSegment(currentAddr, remainderSize, 0, 0, region.flags);
-
-                    string sectionName = string(region.name) + ".frag." + to_string(fragmentIndex);
-                    AddAutoSection(sectionName, currentAddr, remainderSize, semantics);
-                    m_logger->LogDebug("Region %s: added fragment at 0x%08llx-0x%08llx (non-file-backed)", region.name,
-                        currentAddr, region.end_addr);
-                }
-            }
+        if (m_hasAppDesc)
+        {
+            StoreAppDescMetadata();
+            m_logger->LogInfo("App: %s %s (ESP-IDF %s, built %s %s)", m_appDesc.project_name, m_appDesc.version,
+                m_appDesc.idf_ver, m_appDesc.date, m_appDesc.time);
         }
 
         // Step 3: Set up architecture and platform
+        optional<ScopedPhaseTimer> timer(in_place, m_loadProfile, LoadPhase::Platform);
         Ref<Architecture> arch = Architecture::GetByName(m_chipAttr->arch_name);
         if (!arch)
         {
@@ -287,9 +706,12 @@ namespace EspApp
 
         if (m_parseOnly)
         {
+            timer.reset();
+            StoreLoadProfile();
             return true;
         }
 
+        timer.emplace(m_loadProfile, LoadPhase::Functions);
         if (arch)
         {
             Ref<Platform> plat = GetDefaultPlatform();
@@ -298,12 +720,41 @@ namespace EspApp
                 AddEntryPointForAnalysis(plat, m_entryPoint);
             }
             DefineAutoSymbol(new Symbol(FunctionSymbol, "_entry", m_entryPoint, GlobalBinding));
+            AddPrologueFunctions(plan);
         }
 
-        if (m_chipAttr && m_chipAttr->post_init)
+        timer.emplace(m_loadProfile, LoadPhase::Symbols);
+        if (m_hasAppDesc)
+            DefineAppDescType();
+
+        ApplyRomSymbols(this);
+        bool elfApplied = arch && ApplyElfSidecar(this);
+        if (arch && !elfApplied)
+            StartSignatureMatching(this, plan);
+
+        m_peripherals = make_unique<PeripheralMap>(this, *m_chipAttr);
+        if (m_peripherals->HasPending())
+            m_peripherals->Start();
+        else
+            m_peripherals.reset();
+
+        timer.emplace(m_loadProfile, LoadPhase::PostInit);
+        if (m_chipHooks && m_chipHooks->post_init)
         {
-            m_chipAttr->post_init(this);
+            m_chipHooks->post_init(this);
         }
+        ReattachCoreDump(this);
+
+        // Step 4: Seed analysis with what earlier loads of the same build discovered
+        timer.emplace(m_loadProfile, LoadPhase::Seeds);
+        if (arch)
+            StartAnalysisSeedCache();
+        timer.reset();
+
+        if (arch)
+            m_logTagEvent = StartLogTagNaming(this);
+        StartImageVerification(this);
+        StoreLoadProfile();
 
         return true;
     }
@@ -1,104 +1,122 @@
 #pragma once
 
 #include "binaryninjaapi.h"
-#include <vector>
+#include "esp_app_mmu.h"
+#include "esp_app_peripherals.h"
+#include "esp_app_regions.h"
+#include "esp_app_seeds.h"
+#include "core/esp_app_desc.h"
+#include "core/esp_chip.h"
+#include "core/esp_flash.h"
+#include "core/esp_image.h"
+#include "core/esp_layout.h"
+#include "core/esp_literals.h"
+#include "core/esp_load_profile.h"
+#include "core/esp_mapped_file.h"
+#include "core/esp_prologue.h"
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
 
 namespace EspApp
 {
-    constexpr uint8_t ESP_IMAGE_HEADER_MAGIC = 0xE9;
-    constexpr uint8_t ESP_IMAGE_MAX_SEGMENTS = 16;
-
-    enum class EspChipId : uint16_t
-    {
-        ESP32 = 0x0000,
-        ESP32_S2 = 0x0002,
-        ESP32_C3 = 0x0005,
-        ESP32_S3 = 0x0009,
-        ESP32_C2 = 0x000C,
-        ESP32_C6 = 0x000D,
-        ESP32_H2 = 0x0010,
-        ESP32_P4 = 0x0012,
-        Invalid = 0xFFFF
-    };
-
-    struct MemoryRegion
-    {
-        const char* name;
-        uint64_t start_addr;
-        uint64_t end_addr;
-        uint32_t flags;
-        uint32_t section_semantics;
-    };
-
     class EspAppView;
 
     using PostInitCallback = void (*)(EspAppView* view);
     using PluginInitCallback = void (*)();
 
-    struct ChipAttr
+    // Binary Ninja specific behaviour attached to a chip from the core registry
+    struct ChipHooks
     {
         EspChipId chip_id;
-        const char* chip_name;
-        const char* arch_name;
-        const MemoryRegion* regions;
-        size_t region_count;
         PostInitCallback post_init;
         PluginInitCallback on_plugin_init;
     };
 
-// ESP32 Image Header (24 bytes)
-#pragma pack(push, 1)
-    struct EspImageHeader
-    {
-        uint8_t magic;               // 0xE9
-        uint8_t segment_count;       // Number of segments (max 16)
-        uint8_t spi_mode;            // Flash read mode
-        uint8_t spi_speed_size;      // spi_speed: 4, spi_size: 4
-        uint32_t entry_addr;         // Entry point address
-        uint8_t wp_pin;              // Write protect pin
-        uint8_t spi_pin_drv[3];      // SPI pin drive settings
-        uint16_t chip_id;            // Chip ID
-        uint8_t min_chip_rev;        // Minimum chip revision
-        uint16_t min_chip_rev_full;  // Minimum chip revision (full)
-        uint16_t max_chip_rev_full;  // Maximum chip revision (full)
-        uint8_t reserved[4];         // Reserved
-        uint8_t hash_appended;       // SHA256 hash appended flag
-    };
-#pragma pack(pop)
+    void InitializeChips();
+    const ChipHooks* GetChipHooksById(EspChipId chipId);
 
-    static_assert(sizeof(EspImageHeader) == 24, "EspImageHeader must be 24 bytes");
+    // ImageProbeReader over a BinaryView* `context`
+    bool ReadRawView(void* context, uint64_t offset, void* dest, size_t length);
 
-// ESP32 Segment Header (8 bytes)
-#pragma pack(push, 1)
-    struct EspSegmentHeader
+    // Bytes of a raw parent view. The original file is memory-mapped when it still matches the view;
+    // otherwise (e.g. a database whose source file moved) the view is read once in bulk.
+    class RawViewBytes
     {
-        uint32_t load_addr;  // Memory address to load segment
-        uint32_t data_len;   // Length of segment data
+        MappedFile m_mapping;
+        BinaryNinja::DataBuffer m_buffer;
+        std::span<const uint8_t> m_bytes;
+
+    public:
+        explicit RawViewBytes(BinaryNinja::BinaryView* data);
+        std::span<const uint8_t> GetSpan() const { return m_bytes; }
+        bool IsMapped() const { return m_mapping.IsOpen(); }
     };
-#pragma pack(pop)
 
-    static_assert(sizeof(EspSegmentHeader) == 8, "EspSegmentHeader must be 8 bytes");
+    // Parse the app image an ESP-APP view (or a command's wrapper of one) was loaded from out of the raw
+    // bytes of its parent. For flash dumps this is the loaded app, found through the "esp.flash" metadata.
+    bool ParseViewImage(BinaryNinja::BinaryView* view, std::span<const uint8_t> raw, ParsedImage& out);
 
-    // Internal segment info with file offset
-    struct SegmentInfo
+    // The loaded app image of an ESP-APP view (or a command's wrapper of one), read from its parent. A plain
+    // file is memory-mapped as RawViewBytes does; from a decrypted view only the image itself is read, so no
+    // page outside it is decrypted and the rest of the dump is never copied. Offsets into the span, and those
+    // of GetImage(), are relative to the image; GetBase() is where it starts in the parent.
+    class AppImageBytes
     {
-        uint32_t load_addr;
-        uint32_t data_len;
-        uint64_t file_offset;  // Offset in raw file where data starts
-    };
+        std::optional<RawViewBytes> m_raw;
+        BinaryNinja::DataBuffer m_buffer;
+        std::span<const uint8_t> m_bytes;
+        uint64_t m_base = 0;
+        ParsedImage m_image {};
+        bool m_valid = false;
 
-    void InitializeChips();
-    const ChipAttr* GetChipAttrById(EspChipId chipId);
-    const MemoryRegion* FindRegionForAddress(const ChipAttr* attr, uint64_t addr);
+        void Read(BinaryNinja::BinaryView* parent, const ParsedImage& image);
+
+    public:
+        explicit AppImageBytes(BinaryNinja::BinaryView* view);
+        AppImageBytes(BinaryNinja::BinaryView* parent, const ParsedImage& image);
+
+        bool IsValid() const { return m_valid; }
+        std::span<const uint8_t> GetSpan() const { return m_bytes; }
+        uint64_t GetBase() const { return m_base; }
+        const ParsedImage& GetImage() const { return m_image; }
+
+        // Move file-backed ranges of the parent into the image's offsets, dropping any outside it
+        void RebaseRanges(std::vector<CodeRange>& ranges) const;
+    };
 
     class EspAppView : public BinaryNinja::BinaryView
     {
         bool m_parseOnly;
         uint64_t m_entryPoint;
-        EspImageHeader m_header;
-        std::vector<SegmentInfo> m_segments;
+        ParsedImage m_image;
+
+        // esp_app_desc_t from the first DROM segment, if the image has one
+        bool m_hasAppDesc;
+        AppDesc m_appDesc;
+
+        // Parsed through an EspDecryptedView: the headers are read through it a unit at a time, so that a parse
+        // decrypts only what it looks at. Analysis passes read the app image alone through AppImageBytes.
+        bool m_encrypted;
+
+        // Raw SPI flash dump mode: every app found in the dump, and the one this view maps
+        bool m_flashDump;
+        FlashLayout m_flashLayout;
+        size_t m_flashAppIndex;
+
         const ChipAttr* m_chipAttr;
+        const ChipHooks* m_chipHooks;
+        LoadProfile m_loadProfile;
+        std::unique_ptr<PeripheralMap> m_peripherals;
+        std::unique_ptr<AnalysisSeedCache> m_seedCache;
+        std::unique_ptr<LazyRegionMap> m_lazyRegions;
+        std::shared_ptr<FlashMmuModel> m_mmu;
+        BinaryNinja::Ref<BinaryNinja::AnalysisCompletionEvent> m_logTagEvent;
+
+        // L32R loads found by the prologue sweep of Xtensa code, until the chip hooks take them
+        LiteralScanResult m_literals;
         BinaryNinja::Ref<BinaryNinja::Logger> m_logger;
 
         virtual uint64_t PerformGetEntryPoint() const override;
@@ -106,11 +124,34 @@ namespace EspApp
         virtual BNEndianness PerformGetDefaultEndianness() const override;
         virtual size_t PerformGetAddressSize() const override;
 
+        void ApplyLayoutPlan(const LayoutPlan& plan);
+        bool IsSparseMappingEnabled();
+        void DeferRegions(const std::vector<const MemoryRegion*>& deferred);
+        bool SelectFlashApp();
+        void StoreFlashLayoutMetadata();
+        void StoreAppDescMetadata();
+        void StoreFlashMmuMetadata();
+        void DefineAppDescType();
+        void AddPrologueFunctions(const LayoutPlan& plan);
+        void StartAnalysisSeedCache();
+        void StoreLoadProfile();
+
     public:
         EspAppView(BinaryNinja::BinaryView* data, bool parseOnly = false);
-        virtual ~EspAppView() = default;
+        virtual ~EspAppView();
 
         virtual bool Init() override;
+
+        const ParsedImage& GetParsedImage() const { return m_image; }
+        const EspImageHeader& GetImageHeader() const { return m_image.header; }
+        std::span<const SegmentInfo> GetImageSegments() const { return m_image.Segments(); }
+        const ChipAttr* GetChipAttr() const { return m_chipAttr; }
+        bool IsFlashDump() const { return m_flashDump; }
+        bool IsEncrypted() const { return m_encrypted; }
+        const AppDesc* GetAppDesc() const { return m_hasAppDesc ? &m_appDesc : nullptr; }
+        const LoadProfile& GetLoadProfile() const { return m_loadProfile; }
+        const FlashMmuModel* GetFlashMmu() const { return m_mmu.get(); }
+        LiteralScanResult TakeLiteralScan() { return std::move(m_literals); }
     };
 
 }  // namespace EspApp
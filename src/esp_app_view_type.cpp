@@ -1,5 +1,7 @@
 #include "esp_app_view_type.h"
+#include "esp_app_decrypt.h"
 #include "esp_app_view.h"
+#include "core/esp_json.h"
 
 using namespace std;
 using namespace BinaryNinja;
@@ -8,16 +10,87 @@ namespace EspApp
 {
     static EspAppViewType* g_espAppViewType = nullptr;
 
+    static string ToHexString(uint64_t value)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%llx", static_cast<unsigned long long>(value));
+        return buf;
+    }
+
     EspAppViewType::EspAppViewType() : BinaryViewType("ESP-APP", "ESP App Image")
     {
         m_logger = LogRegistry::CreateLogger("BinaryViewType.EspApp");
     }
 
+    // Plaintext app image or raw SPI flash dump
+    static bool ProbePlainData(BinaryView* data, ImageParseStatus* status = nullptr)
+    {
+        // Raw SPI flash dump: partition table at its fixed offset
+        if (LooksLikeFlashDump(data->GetLength(), ReadRawView, data))
+            return true;
+
+        ImageParseStatus result = ProbeImage(data->GetLength(), ReadRawView, data);
+        if (status)
+            *status = result;
+        return result == ImageParseStatus::Ok;
+    }
+
+    bool EspAppViewType::FindFlashKey(BinaryView* data, FlashKeyMatch& out)
+    {
+        static constexpr size_t maxKeySearches = 16;
+        if (!LooksLikeEncryptedData(data))
+            return false;
+
+        size_t sessionId = data->GetFile()->GetSessionId();
+        uint64_t length = data->GetLength();
+        FlashKeyRequest request = GetFlashKeyRequest(data);
+
+        lock_guard<mutex> lock(m_keyMutex);
+        for (auto it = m_keySearches.begin(); it != m_keySearches.end(); ++it)
+        {
+            if (it->session_id == sessionId && it->length == length && it->request == request)
+            {
+                m_keySearches.splice(m_keySearches.begin(), m_keySearches, it);
+                out = it->match;
+                return it->found;
+            }
+        }
+
+        KeySearch search {sessionId, length, request, false, {}};
+        search.found = EspApp::FindFlashKey(data, request, search.match);
+        if (!search.found && LooksLikeEsp32Ciphertext(data, request))
+        {
+            m_logger->LogWarn("The data looks flash-encrypted, but no key decrypts it with XTS-AES. The AES-256 "
+                "flash encryption of the ESP32 is not supported; decrypt the image with espsecure.py "
+                "decrypt_flash_data first.");
+        }
+        if (m_keySearches.size() >= maxKeySearches)
+            m_keySearches.pop_back();
+        m_keySearches.push_front(std::move(search));
+        out = m_keySearches.front().match;
+        return m_keySearches.front().found;
+    }
+
+    Ref<BinaryView> EspAppViewType::GetSourceView(BinaryView* data)
+    {
+        if (ProbePlainData(data))
+            return data;
+
+        // Flash-encrypted data is parsed through a view that decrypts what is read
+        FlashKeyMatch match;
+        if (!FindFlashKey(data, match))
+            return data;
+        m_logger->LogInfo("Flash-encrypted data: XTS-AES-%zu with %s at flash address 0x%llx (%s AES)",
+            match.decryptor.GetKeyBits(), match.key_path.c_str(), static_cast<unsigned long long>(match.flash_addr),
+            match.decryptor.UsesHardwareAes() ? "hardware" : "software");
+        return new EspDecryptedView(data, match);
+    }
+
     Ref<BinaryView> EspAppViewType::Create(BinaryView* data)
     {
         try
         {
-            return new EspAppView(data, false);
+            return new EspAppView(GetSourceView(data), false);
         }
         catch (exception& e)
         {
@@ -30,7 +103,7 @@ namespace EspApp
     {
         try
         {
-            return new EspAppView(data, true);
+            return new EspAppView(GetSourceView(data), true);
         }
         catch (exception& e)
         {
@@ -41,37 +114,176 @@ namespace EspApp
 
     bool EspAppViewType::IsTypeValidForData(BinaryView* data)
     {
-        if (data->GetLength() < sizeof(EspImageHeader))
-            return false;
-
-        DataBuffer magic = data->ReadBuffer(0, 1);
-        if (magic.GetLength() < 1)
-            return false;
+        ImageParseStatus status;
+        if (ProbePlainData(data, &status))
+            return true;
 
-        uint8_t magicByte = ((uint8_t*)magic.GetData())[0];
-        if (magicByte != ESP_IMAGE_HEADER_MAGIC)
-            return false;
-
-        DataBuffer segCountBuf = data->ReadBuffer(1, 1);
-        if (segCountBuf.GetLength() < 1)
-            return false;
+        // Ciphertext is only recognized with a key that decrypts it
+        FlashKeyMatch match;
+        if (FindFlashKey(data, match))
+            return true;
 
-        uint8_t segCount = ((uint8_t*)segCountBuf.GetData())[0];
-        if (segCount == 0 || segCount > ESP_IMAGE_MAX_SEGMENTS)
-            return false;
-
-        return true;
+        // Only worth a note when the file does look like an image at first glance
+        if (status != ImageParseStatus::TooShort && status != ImageParseStatus::BadMagic)
+            m_logger->LogDebug("Not an ESP app image: %s", GetImageParseStatusString(status));
+        return false;
     }
 
     Ref<Settings> EspAppViewType::GetLoadSettingsForData(BinaryView* data)
     {
         Ref<Settings> settings = GetDefaultLoadSettingsForData(data);
+        settings->RegisterSetting("loader.esp.seedCache",
+            R"({
+                "title" : "Analysis Seed Cache",
+                "type" : "boolean",
+                "default" : true,
+                "description" : "Seed analysis with the functions, data variables and user names found by earlier loads of the same build, and store them for later loads.",
+                "readOnly" : false
+            })");
+
+        settings->RegisterSetting("loader.esp.sparseRegions",
+            R"({
+                "title" : "Sparse Region Mapping",
+                "type" : "boolean",
+                "default" : false,
+                "description" : "Only map the memory regions that contain app segments. Other regions are mapped once analysis references an address in them, or with ESP > Map Deferred Region.",
+                "readOnly" : false
+            })");
+        settings->RegisterSetting("loader.esp.prologueScan",
+            R"({
+                "title" : "Function Prologue Scan",
+                "type" : "boolean",
+                "default" : true,
+                "description" : "Scan code segments for function prologues (Xtensa entry, RISC-V stack adjustment) and add them for analysis up front. On Xtensa the same pass resolves the L32R literal pools.",
+                "readOnly" : false
+            })");
+        settings->RegisterSetting("loader.esp.logTags",
+            R"({
+                "title" : "Log Tag Naming",
+                "type" : "boolean",
+                "default" : true,
+                "description" : "After the initial analysis, name functions and group them into components after the ESP_LOG tags and __func__ strings they reference.",
+                "readOnly" : false
+            })");
+        settings->RegisterSetting("loader.esp.signatures",
+            R"({
+                "title" : "Function Signatures",
+                "type" : "boolean",
+                "default" : true,
+                "description" : "Name ESP-IDF library functions by matching code segments against the signature database in <user folder>/esp_app/signatures built for the chip and the app's ESP-IDF release. Runs in the background.",
+                "readOnly" : false
+            })");
+        settings->RegisterSetting("loader.esp.signaturesAnyRelease",
+            R"({
+                "title" : "Signatures of Other Releases",
+                "type" : "boolean",
+                "default" : false,
+                "description" : "When there is no signature database for the app's ESP-IDF release, match against every database for the chip and use the one with the most matches. Scans the code once per database.",
+                "readOnly" : false
+            })");
+        settings->RegisterSetting("loader.esp.elfSidecar",
+            R"({
+                "title" : "Matching App ELF",
+                "type" : "boolean",
+                "default" : true,
+                "description" : "Find the ELF the app was built from by the app description's ELF SHA-256 in <user folder>/esp_app/elf and the ELF directories, and apply its symbols and debug types. Function signatures are skipped when an ELF is found.",
+                "readOnly" : false
+            })");
+        settings->RegisterSetting("loader.esp.elfDirectories",
+            R"({
+                "title" : "App ELF Directories",
+                "type" : "array",
+                "elementType" : "string",
+                "default" : [],
+                "description" : "Additional directories searched for the app ELF. Each is indexed by SHA-256 in esp_elf_index.bin (updated in the background when the ELF is not found, or with the esp_elf_index tool).",
+                "readOnly" : false
+            })");
+
+        FlashLayout layout;
+        FlashKeyMatch match;
+        if (!ProbePlainData(data) && FindFlashKey(data, match))
+        {
+            string keyPath;
+            AppendJsonString(keyPath, match.key_path);
+            settings->RegisterSetting("loader.esp.encryptionKey",
+                R"({
+                    "title" : "Flash Encryption Key",
+                    "type" : "string",
+                    "default" : )" + keyPath + R"(,
+                    "description" : "Flash encryption key file (32 bytes for XTS-AES-128, 64 bytes for XTS-AES-256) used to decrypt the image as it is read. By default every key in <user folder>/esp_app/keys is tried.",
+                    "readOnly" : false
+                })");
+            settings->RegisterSetting("loader.esp.encryptionOffset",
+                R"({
+                    "title" : "Flash Encryption Address",
+                    "type" : "number",
+                    "default" : )" + to_string(match.flash_addr) + R"(,
+                    "minValue" : 0,
+                    "maxValue" : 4294967295,
+                    "description" : "Flash address the first byte of the file was read from, which the encryption tweak depends on: 0 for a whole flash dump, the partition offset for an app image.",
+                    "readOnly" : false
+                })");
+
+            DecryptedFlash flash(match.decryptor, data->GetLength(), match.flash_addr, ReadRawView, data);
+            if (!LooksLikeFlashDump(flash.GetLength(), DecryptedFlash::ReadExact, &flash))
+                return settings;
+            ScanFlashDump(flash.GetLength(), DecryptedFlash::ReadExact, &flash, layout);
+        }
+        else
+        {
+            RawViewBytes raw(data);
+            if (!LooksLikeFlashDump(raw.GetSpan()))
+                return settings;
+            ScanFlashDump(raw.GetSpan(), layout);
+        }
+
+        size_t defaultIndex = layout.GetDefaultAppIndex();
+        if (defaultIndex == ESP_FLASH_NO_DUPLICATE)
+            return settings;
+
+        // Offer one entry per distinct app image; identical OTA slots collapse onto the first copy
+        string labels, descriptions;
+        for (const auto& app : layout.apps)
+        {
+            if (!app.IsValid() || app.IsDuplicate())
+                continue;
+
+            string description = string(GetPartitionSubtypeName(app.partition.type, app.partition.subtype)) +
+                " at 0x" + ToHexString(app.partition.offset);
+            for (const auto& other : layout.apps)
+            {
+                if (other.IsDuplicate() && &layout.apps[other.duplicate_of] == &app)
+                    description += string(", identical to ") + other.partition.label;
+            }
+
+            if (!labels.empty())
+            {
+                labels += ",";
+                descriptions += ",";
+            }
+            AppendJsonString(labels, app.partition.label);
+            AppendJsonString(descriptions, description);
+        }
+
+        string defaultLabel;
+        AppendJsonString(defaultLabel, layout.apps[defaultIndex].partition.label);
+        settings->RegisterSetting("loader.esp.flashApp",
+            R"({
+                "title" : "Flash Dump App Partition",
+                "type" : "string",
+                "default" : )" + defaultLabel + R"(,
+                "enum" : [)" + labels + R"(],
+                "enumDescriptions" : [)" + descriptions + R"(],
+                "description" : "App image to load from a raw SPI flash dump.",
+                "readOnly" : false
+            })");
 
         return settings;
     }
 
     void InitEspAppViewType()
     {
+        InitEspDecryptedViewType();
         static EspAppViewType type;
         BinaryViewType::Register(&type);
         g_espAppViewType = &type;
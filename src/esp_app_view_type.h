@@ -1,6 +1,10 @@
 #pragma once
 
 #include "binaryninjaapi.h"
+#include "esp_app_decrypt.h"
+
+#include <list>
+#include <mutex>
 
 namespace EspApp
 {
@@ -8,6 +12,24 @@ namespace EspApp
     {
         BinaryNinja::Ref<BinaryNinja::Logger> m_logger;
 
+        // FindFlashKey results of the raw views seen last: probing, load settings and creating the view each
+        // need the key, and finding it (or finding there is none) tries every key at up to 256 addresses
+        struct KeySearch
+        {
+            size_t session_id;
+            uint64_t length;
+            FlashKeyRequest request;
+            bool found;
+            FlashKeyMatch match;
+        };
+        std::mutex m_keyMutex;
+        std::list<KeySearch> m_keySearches;  // Most recent first
+
+        bool FindFlashKey(BinaryNinja::BinaryView* data, FlashKeyMatch& out);
+
+        // `data` itself, or the decrypted view over it for flash-encrypted data
+        BinaryNinja::Ref<BinaryNinja::BinaryView> GetSourceView(BinaryNinja::BinaryView* data);
+
     public:
         EspAppViewType();
         virtual BinaryNinja::Ref<BinaryNinja::BinaryView> Create(BinaryNinja::BinaryView* data) override;
@@ -0,0 +1,200 @@
+// Tests for XXH64 (reference vectors) and the content-defined chunk diff: chunk boundaries, resynchronization
+// after an insertion, and changed, moved and unchanged content between two builds. Exits with status 1 if any
+// check fails.
+
+#include "esp_chip.h"
+#include "esp_chunk_diff.h"
+#include "esp_endian.h"
+#include "esp_hash.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+// Reference values from the xxHash implementation over bytes i * 7 + 3
+static void TestXxHash64()
+{
+    const char* test = "xxh64";
+    const struct
+    {
+        size_t length;
+        uint64_t hash;
+        uint64_t seeded;
+    } vectors[] = {
+        {0, 0xef46db3751d8e999, 0x6ec6d05f61c7e7a7},
+        {1, 0x1f25c8d0bc1f4bb6, 0xc9605b95df42dc9b},
+        {3, 0x31d2363f52e564c9, 0x01e45ca3ec3eb0cc},
+        {4, 0x9bb64b7d66ee9fda, 0x37da6d964719cae7},
+        {8, 0xdab99d95c6f90092, 0x9468866ad01ed76f},
+        {15, 0x1b47cb8243cc8e32, 0x55bff360c339f7a5},
+        {31, 0xa2aa5f33cc4a6119, 0xe8cbf0e00f190c6e},
+        {32, 0x23c3c17ef790fd97, 0x7ce1c68e13aae778},
+        {33, 0x50a7cfc7ba588784, 0x89d57d87d9f50a9d},
+        {100, 0xa61f8d4c170fe531, 0x9869d9ef85051be9},
+        {1000, 0x5f235fa033f1a3fb, 0x7e8472e0ae8f34a5},
+    };
+    vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i * 7 + 3);
+    for (const auto& kat : vectors)
+    {
+        span<const uint8_t> input = span(data).first(kat.length);
+        Check(XxHash64(input) == kat.hash, test, "unseeded hash");
+        Check(XxHash64(input, 0x9E3779B185EBCA87) == kat.seeded, test, "seeded hash");
+    }
+}
+
+static vector<uint8_t> GetRandomBytes(size_t length, uint64_t seed)
+{
+    vector<uint8_t> data(length);
+    uint64_t state = seed | 1;
+    for (uint8_t& byte : data)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        byte = static_cast<uint8_t>(state >> 32);
+    }
+    return data;
+}
+
+static void TestChunking()
+{
+    const char* test = "chunking";
+    vector<uint8_t> data = GetRandomBytes(0x10000, 1);
+    vector<ContentChunk> chunks;
+    ChunkContent(data, 0x42000000, chunks);
+    Check(chunks.size() > 32 && chunks.size() < 0x10000 / ESP_CHUNK_MIN_SIZE, test, "chunk count");
+
+    uint32_t addr = 0x42000000;
+    bool contiguous = true, sized = true, hashed = true;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        const ContentChunk& chunk = chunks[i];
+        contiguous &= chunk.addr == addr;
+        sized &= chunk.length <= ESP_CHUNK_MAX_SIZE && (chunk.length > ESP_CHUNK_MIN_SIZE || i + 1 == chunks.size());
+        hashed &= chunk.hash == XxHash64(span(data).subspan(chunk.addr - 0x42000000, chunk.length), chunk.length);
+        addr += chunk.length;
+    }
+    Check(contiguous && addr == 0x42000000 + data.size(), test, "chunks cover the data in order");
+    Check(sized, test, "chunk sizes are bounded");
+    Check(hashed, test, "chunk hash is XXH64 seeded with the length");
+
+    // Constant data never finds a boundary and is cut at the maximum size
+    vector<uint8_t> zeros(3 * ESP_CHUNK_MAX_SIZE + 5);
+    chunks.clear();
+    ChunkContent(zeros, 0, chunks);
+    Check(chunks.size() == 4 && chunks[0].length == ESP_CHUNK_MAX_SIZE && chunks[3].length == 5, test,
+        "constant data");
+
+    // Boundaries depend only on nearby bytes, so an insertion only changes the chunks around it
+    vector<uint8_t> inserted = data;
+    inserted.insert(inserted.begin() + 0x5000, 17, 0xA5);
+    vector<ContentChunk> before, after;
+    ChunkContent(data, 0, before);
+    ChunkContent(inserted, 0, after);
+    multiset<uint64_t> hashes;
+    for (const ContentChunk& chunk : before)
+        hashes.insert(chunk.hash);
+    size_t shared = count_if(after.begin(), after.end(), [&](const ContentChunk& c) { return hashes.count(c.hash); });
+    Check(shared + 3 >= after.size(), test, "chunking resynchronizes after an insertion");
+    Check(before.back().hash == after.back().hash, test, "the last chunk is unaffected");
+}
+
+// An app image with one segment per entry of `segments`, all loaded into `region` back to back
+static vector<uint8_t> BuildImage(const MemoryRegion& region, const vector<vector<uint8_t>>& segments)
+{
+    vector<uint8_t> image(sizeof(EspImageHeader));
+    image[0] = ESP_IMAGE_HEADER_MAGIC;
+    image[1] = static_cast<uint8_t>(segments.size());
+    StoreLE16(image.data() + 12, static_cast<uint16_t>(EspChipId::ESP32_C3));
+    uint32_t addr = static_cast<uint32_t>(region.start_addr);
+    for (const vector<uint8_t>& contents : segments)
+    {
+        size_t at = image.size();
+        image.resize(at + sizeof(EspSegmentHeader));
+        StoreLE32(image.data() + at, addr);
+        StoreLE32(image.data() + at + 4, static_cast<uint32_t>(contents.size()));
+        image.insert(image.end(), contents.begin(), contents.end());
+        addr += static_cast<uint32_t>(contents.size());
+    }
+    return image;
+}
+
+static void Diff(const RegionIndex& regions, const vector<uint8_t>& base, const vector<uint8_t>& target,
+    ImageDiff& out)
+{
+    ParsedImage baseImage, targetImage;
+    ChunkIndex baseIndex, targetIndex;
+    ParseImage(base, baseImage);
+    ParseImage(target, targetImage);
+    BuildChunkIndex(base, baseImage, baseIndex, 2);
+    BuildChunkIndex(target, targetImage, targetIndex, 2);
+    Check(targetIndex.bytes == targetImage.Segments()[0].data_len + (targetImage.segment_count > 1 ?
+        targetImage.Segments()[1].data_len : 0), "diff", "the index covers every segment");
+    DiffChunkIndexes(baseIndex, targetIndex, regions, out);
+    Check(out.changed_bytes + out.moved_bytes + out.unchanged_bytes == targetIndex.bytes, "diff",
+        "every target byte is classified");
+}
+
+static void TestDiff()
+{
+    const char* test = "diff";
+    const ChipAttr& attr = *GetChipAttrById(EspChipId::ESP32_C3);
+    RegionIndex regions(attr);
+    const MemoryRegion* region = &attr.regions[0];
+    for (size_t i = 0; i < attr.region_count; i++)
+    {
+        if (attr.regions[i].end_addr - attr.regions[i].start_addr > region->end_addr - region->start_addr)
+            region = &attr.regions[i];
+    }
+
+    vector<uint8_t> code = GetRandomBytes(0x18000, 2);
+    vector<uint8_t> rodata = GetRandomBytes(0x4000, 3);
+    vector<uint8_t> base = BuildImage(*region, {code, rodata});
+
+    ImageDiff diff;
+    Diff(regions, base, base, diff);
+    Check(diff.changed.empty() && diff.moved.empty() && diff.unchanged_bytes == code.size() + rodata.size(), test,
+        "identical images");
+
+    // A patched function shows up as one changed range around it
+    vector<uint8_t> patched = code;
+    for (size_t i = 0x9000; i < 0x9040; i++)
+        patched[i] ^= 0xFF;
+    Diff(regions, base, BuildImage(*region, {patched, rodata}), diff);
+    uint32_t patchAddr = static_cast<uint32_t>(region->start_addr) + 0x9000;
+    Check(diff.changed.size() == 1 && diff.moved.empty(), test, "one changed range");
+    Check(diff.changed.size() == 1 && diff.changed[0].start <= patchAddr &&
+        diff.changed[0].start + diff.changed[0].length >= patchAddr + 0x40, test, "the range covers the patch");
+    Check(diff.changed.size() == 1 && diff.changed[0].region == region, test, "the range knows its region");
+    Check(diff.changed_bytes < 3 * ESP_CHUNK_MAX_SIZE, test, "only the chunks around the patch changed");
+
+    // Swapped blocks: one of them stays in place, the other moved
+    vector<uint8_t> swapped(code.begin() + 0xC000, code.end());
+    swapped.insert(swapped.end(), code.begin(), code.begin() + 0xC000);
+    Diff(regions, base, BuildImage(*region, {swapped, rodata}), diff);
+    Check(!diff.moved.empty() && diff.moved_bytes > 0x8000, test, "a swapped block is moved");
+    Check(diff.changed_bytes < 4 * ESP_CHUNK_MAX_SIZE, test, "only the seams changed");
+    Check(diff.unchanged_bytes > 0x8000, test, "the longest ordered run is unchanged");
+
+    // A duplicated block: the second copy is moved, not unchanged
+    vector<uint8_t> doubled = code;
+    doubled.insert(doubled.end(), code.begin(), code.begin() + 0x4000);
+    Diff(regions, base, BuildImage(*region, {doubled, rodata}), diff);
+    Check(diff.moved_bytes > 0x2000 && diff.unchanged_bytes >= code.size() - ESP_CHUNK_MAX_SIZE, test,
+        "a second copy is moved");
+}
+
+int main()
+{
+    TestXxHash64();
+    TestChunking();
+    TestDiff();
+    return Finish("esp_chunk_diff_test");
+}
@@ -0,0 +1,467 @@
+// Tests for the ELF reader, the DWARF type and symbol model and the ELF directory index: a small ELF32 with a
+// hand-assembled DWARF 4 unit is read back, and a directory of such files is indexed, looked up and rebuilt
+// incrementally as files are added, changed and removed. Exits with status 1 if any check fails.
+
+#include "esp_dwarf.h"
+#include "esp_elf.h"
+#include "esp_elf_index.h"
+#include "esp_endian.h"
+#include "test_util.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+static constexpr uint16_t EM_RISCV = 0xF3;
+static constexpr uint32_t SHT_PROGBITS = 1;
+static constexpr uint32_t SHT_SYMTAB = 2;
+static constexpr uint32_t SHT_STRTAB = 3;
+
+// Little-endian byte sink for hand-assembled ELF and DWARF data
+struct ByteWriter
+{
+    vector<uint8_t> bytes;
+
+    size_t Size() const { return bytes.size(); }
+    void U8(uint8_t value) { bytes.push_back(value); }
+    void U16(uint16_t value)
+    {
+        bytes.resize(bytes.size() + 2);
+        StoreLE16(bytes.data() + bytes.size() - 2, value);
+    }
+    void U32(uint32_t value)
+    {
+        bytes.resize(bytes.size() + 4);
+        StoreLE32(bytes.data() + bytes.size() - 4, value);
+    }
+    void Uleb(uint64_t value)
+    {
+        do
+        {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            bytes.push_back(static_cast<uint8_t>(byte | (value ? 0x80 : 0)));
+        } while (value);
+    }
+    void String(const string& value)
+    {
+        bytes.insert(bytes.end(), value.begin(), value.end());
+        bytes.push_back(0);
+    }
+};
+
+struct ElfSectionSpec
+{
+    string name;
+    uint32_t type;
+    uint32_t addr;
+    vector<uint8_t> data;
+    uint32_t link;
+};
+
+// ELF32 file with the given sections after the null section and a trailing .shstrtab
+static vector<uint8_t> BuildElf(const vector<ElfSectionSpec>& sections)
+{
+    ByteWriter names;
+    names.U8(0);
+    vector<uint32_t> nameOffsets;
+    for (const ElfSectionSpec& section : sections)
+    {
+        nameOffsets.push_back(static_cast<uint32_t>(names.Size()));
+        names.String(section.name);
+    }
+    uint32_t shstrtabName = static_cast<uint32_t>(names.Size());
+    names.String(".shstrtab");
+
+    ByteWriter file;
+    file.bytes.resize(52);
+    vector<uint32_t> offsets;
+    for (const ElfSectionSpec& section : sections)
+    {
+        offsets.push_back(static_cast<uint32_t>(file.Size()));
+        file.bytes.insert(file.bytes.end(), section.data.begin(), section.data.end());
+    }
+    uint32_t shstrtabOffset = static_cast<uint32_t>(file.Size());
+    file.bytes.insert(file.bytes.end(), names.bytes.begin(), names.bytes.end());
+    while (file.Size() % 4)
+        file.U8(0);
+
+    uint32_t shOffset = static_cast<uint32_t>(file.Size());
+    auto sectionHeader = [&](uint32_t name, uint32_t type, uint32_t addr, uint32_t offset, uint32_t size,
+        uint32_t link) {
+        file.U32(name);
+        file.U32(type);
+        file.U32(0);
+        file.U32(addr);
+        file.U32(offset);
+        file.U32(size);
+        file.U32(link);
+        file.U32(0);
+        file.U32(1);
+        file.U32(type == SHT_SYMTAB ? 16 : 0);
+    };
+    sectionHeader(0, 0, 0, 0, 0, 0);
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        const ElfSectionSpec& section = sections[i];
+        sectionHeader(nameOffsets[i], section.type, section.addr, offsets[i],
+            static_cast<uint32_t>(section.data.size()), section.link);
+    }
+    sectionHeader(shstrtabName, SHT_STRTAB, 0, shstrtabOffset, static_cast<uint32_t>(names.Size()), 0);
+
+    uint8_t* header = file.bytes.data();
+    const uint8_t ident[] = {0x7F, 'E', 'L', 'F', 1, 1, 1};
+    copy(begin(ident), end(ident), header);
+    StoreLE16(header + 16, 2);
+    StoreLE16(header + 18, EM_RISCV);
+    StoreLE32(header + 20, 1);
+    StoreLE32(header + 24, 0x42000010);
+    StoreLE32(header + 32, shOffset);
+    StoreLE16(header + 40, 52);
+    StoreLE16(header + 46, 40);
+    StoreLE16(header + 48, static_cast<uint16_t>(sections.size() + 2));
+    StoreLE16(header + 50, static_cast<uint16_t>(sections.size() + 1));
+    return file.bytes;
+}
+
+enum : uint8_t
+{
+    AbbrevUnit = 1,
+    AbbrevBase,
+    AbbrevPointer,
+    AbbrevStruct,
+    AbbrevMember,
+    AbbrevVariable,
+    AbbrevSubprogram,
+    AbbrevParameter,
+    AbbrevArray,
+    AbbrevSubrange,
+    AbbrevEnum,
+    AbbrevEnumerator,
+    AbbrevTypedef,
+};
+
+static vector<uint8_t> BuildAbbrevs()
+{
+    // Abbreviation code, tag, children, then (attribute, form) pairs
+    const vector<vector<uint16_t>> abbrevs = {
+        {AbbrevUnit, 0x11, 1, 0x03, 0x0e},
+        {AbbrevBase, 0x24, 0, 0x03, 0x08, 0x0b, 0x0b, 0x3e, 0x0b},
+        {AbbrevPointer, 0x0f, 0, 0x49, 0x13},
+        {AbbrevStruct, 0x13, 1, 0x03, 0x08, 0x0b, 0x0b},
+        {AbbrevMember, 0x0d, 0, 0x03, 0x08, 0x49, 0x13, 0x38, 0x0b},
+        {AbbrevVariable, 0x34, 0, 0x03, 0x08, 0x49, 0x13, 0x02, 0x18},
+        {AbbrevSubprogram, 0x2e, 1, 0x03, 0x0e, 0x49, 0x13, 0x11, 0x01},
+        {AbbrevParameter, 0x05, 0, 0x03, 0x08, 0x49, 0x13},
+        {AbbrevArray, 0x01, 1, 0x49, 0x13},
+        {AbbrevSubrange, 0x21, 0, 0x2f, 0x0b},
+        {AbbrevEnum, 0x04, 1, 0x03, 0x08, 0x0b, 0x0b},
+        {AbbrevEnumerator, 0x28, 0, 0x03, 0x08, 0x1c, 0x0d},
+        {AbbrevTypedef, 0x16, 0, 0x03, 0x08, 0x49, 0x13},
+    };
+    ByteWriter out;
+    for (const vector<uint16_t>& abbrev : abbrevs)
+    {
+        out.Uleb(abbrev[0]);
+        out.Uleb(abbrev[1]);
+        out.U8(static_cast<uint8_t>(abbrev[2]));
+        for (size_t i = 3; i < abbrev.size(); i++)
+            out.Uleb(abbrev[i]);
+        out.Uleb(0);
+        out.Uleb(0);
+    }
+    out.Uleb(0);
+    return out.bytes;
+}
+
+// One DWARF 4 unit: int, struct point { int x, y; }, struct point*, int[8], enum color, typedef point_t, a
+// variable g_points and a function int app_main(struct point* p); then a unit of an unknown version
+static vector<uint8_t> BuildDebugInfo(uint32_t unitNameOffset, uint32_t functionNameOffset)
+{
+    ByteWriter info;
+    info.U32(0);
+    info.U16(4);
+    info.U32(0);
+    info.U8(4);
+
+    info.U8(AbbrevUnit);
+    info.U32(unitNameOffset);
+
+    uint32_t intType = static_cast<uint32_t>(info.Size());
+    info.U8(AbbrevBase);
+    info.String("int");
+    info.U8(4);
+    info.U8(0x05);  // DW_ATE_signed
+
+    uint32_t pointType = static_cast<uint32_t>(info.Size());
+    info.U8(AbbrevStruct);
+    info.String("point");
+    info.U8(8);
+    info.U8(AbbrevMember);
+    info.String("x");
+    info.U32(intType);
+    info.U8(0);
+    info.U8(AbbrevMember);
+    info.String("y");
+    info.U32(intType);
+    info.U8(4);
+    info.U8(0);
+
+    uint32_t pointerType = static_cast<uint32_t>(info.Size());
+    info.U8(AbbrevPointer);
+    info.U32(pointType);
+
+    uint32_t arrayType = static_cast<uint32_t>(info.Size());
+    info.U8(AbbrevArray);
+    info.U32(intType);
+    info.U8(AbbrevSubrange);
+    info.U8(7);
+    info.U8(0);
+
+    info.U8(AbbrevEnum);
+    info.String("color");
+    info.U8(4);
+    info.U8(AbbrevEnumerator);
+    info.String("red");
+    info.U8(0);
+    info.U8(AbbrevEnumerator);
+    info.String("blue");
+    info.U8(0x7F);  // -1
+    info.U8(0);
+
+    info.U8(AbbrevTypedef);
+    info.String("point_t");
+    info.U32(pointType);
+
+    info.U8(AbbrevVariable);
+    info.String("g_points");
+    info.U32(arrayType);
+    info.Uleb(5);
+    info.U8(0x03);  // DW_OP_addr
+    info.U32(0x3FC80010);
+
+    info.U8(AbbrevSubprogram);
+    info.U32(functionNameOffset);
+    info.U32(intType);
+    info.U32(0x42000010);
+    info.U8(AbbrevParameter);
+    info.String("p");
+    info.U32(pointerType);
+    info.U8(0);
+
+    info.U8(0);
+    StoreLE32(info.bytes.data(), static_cast<uint32_t>(info.Size() - 4));
+
+    // DWARF 6 does not exist; the unit is skipped
+    info.U32(3);
+    info.U16(6);
+    info.U8(0);
+    return info.bytes;
+}
+
+static vector<uint8_t> BuildTestElf(const string& functionName = "app_main")
+{
+    ByteWriter str;
+    uint32_t unitName = static_cast<uint32_t>(str.Size());
+    str.String("main.c");
+    uint32_t functionNameOffset = static_cast<uint32_t>(str.Size());
+    str.String(functionName);
+
+    ByteWriter strtab;
+    strtab.U8(0);
+    ByteWriter symtab;
+    auto symbol = [&](const string& name, uint32_t value, uint32_t size, uint8_t info, uint16_t section) {
+        uint32_t nameOffset = 0;
+        if (!name.empty())
+        {
+            nameOffset = static_cast<uint32_t>(strtab.Size());
+            strtab.String(name);
+        }
+        symtab.U32(nameOffset);
+        symtab.U32(value);
+        symtab.U32(size);
+        symtab.U8(info);
+        symtab.U8(0);
+        symtab.U16(section);
+    };
+    symbol("", 0, 0, 0, 0);
+    symbol(functionName, 0x42000010, 0x20, 0x12, 1);  // Global function
+    symbol("counter", 0x3FC80000, 4, 0x01, 1);        // Local object
+    symbol("printf", 0, 0, 0x12, 0);                  // Undefined
+    symbol("", 0x42000000, 0, 0x03, 1);               // Section symbol
+
+    return BuildElf({
+        {".text", SHT_PROGBITS, 0x42000000, vector<uint8_t>(0x40, 0x13), 0},
+        {".symtab", SHT_SYMTAB, 0, symtab.bytes, 3},
+        {".strtab", SHT_STRTAB, 0, strtab.bytes, 0},
+        {".debug_abbrev", SHT_PROGBITS, 0, BuildAbbrevs(), 0},
+        {".debug_info", SHT_PROGBITS, 0, BuildDebugInfo(unitName, functionNameOffset), 0},
+        {".debug_str", SHT_PROGBITS, 0, str.bytes, 0},
+    });
+}
+
+static void TestElf()
+{
+    const char* test = "elf";
+    vector<uint8_t> data = BuildTestElf();
+    ElfFile elf;
+    Check(LooksLikeElf32(data) && elf.Open(data), test, "ELF opens");
+    Check(elf.GetMachine() == EM_RISCV && elf.GetSections().size() == 8, test, "header fields");
+    const ElfSection* text = elf.FindSection(".text");
+    Check(text && text->addr == 0x42000000 && elf.GetSectionData(text).size() == 0x40, test, ".text section");
+    Check(!elf.FindSection(".data") && elf.GetSectionData(".data").empty(), test, "missing section");
+
+    vector<ElfSymbol> symbols;
+    elf.GetSymbols(symbols);
+    Check(symbols.size() == 2, test, "only named, defined functions and objects");
+    Check(symbols.size() == 2 && symbols[0].name == "app_main" && symbols[0].addr == 0x42000010 &&
+        symbols[0].size == 0x20 && symbols[0].kind == ElfSymbolKind::Function && symbols[0].global, test,
+        "function symbol");
+    Check(symbols.size() == 2 && symbols[1].name == "counter" && symbols[1].kind == ElfSymbolKind::Object &&
+        !symbols[1].global, test, "object symbol");
+
+    vector<uint8_t> truncated(data.begin(), data.end() - 8);
+    Check(!ElfFile().Open(truncated), test, "truncated section headers");
+    data[4] = 2;
+    Check(!LooksLikeElf32(data), test, "ELF64 is not ELF32");
+}
+
+static void TestDwarf()
+{
+    const char* test = "dwarf";
+    vector<uint8_t> data = BuildTestElf();
+    ElfFile elf;
+    elf.Open(data);
+    DwarfInfo info;
+    Check(ParseDwarf(elf, info), test, "DWARF parses");
+    Check(info.compile_units == 1 && info.skipped_units == 1, test, "unknown versions are skipped");
+    Check(info.types.size() == 7, test, "six types and one prototype");
+    if (info.types.size() != 7)
+        return;
+
+    const DwarfType& intType = info.types[0];
+    Check(intType.kind == DwarfTypeKind::Base && intType.name == "int" && intType.size == 4 &&
+        intType.encoding == 5, test, "base type");
+    const DwarfType& point = info.types[1];
+    Check(point.kind == DwarfTypeKind::Struct && point.size == 8 && point.members.size() == 2, test, "struct");
+    Check(point.members.size() == 2 && point.members[1].name == "y" && point.members[1].type == 0 &&
+        point.members[1].offset == 4, test, "struct member");
+    Check(info.types[2].kind == DwarfTypeKind::Pointer && info.types[2].target == 1 && info.types[2].size == 4,
+        test, "pointer takes the address size");
+    Check(info.types[3].kind == DwarfTypeKind::Array && info.types[3].target == 0 &&
+        info.types[3].dimensions == vector<uint64_t> {8}, test, "array bound");
+    const DwarfType& color = info.types[4];
+    Check(color.kind == DwarfTypeKind::Enum && color.enumerators.size() == 2 && color.enumerators[1].name == "blue" &&
+        color.enumerators[1].value == -1, test, "enumerators");
+    Check(info.types[5].kind == DwarfTypeKind::Typedef && info.types[5].name == "point_t" &&
+        info.types[5].target == 1, test, "typedef");
+
+    Check(info.variables.size() == 1 && info.variables[0].name == "g_points" &&
+        info.variables[0].addr == 0x3FC80010 && info.variables[0].type == 3, test, "variable");
+    Check(info.functions.size() == 1 && info.functions[0].name == "app_main" &&
+        info.functions[0].addr == 0x42000010, test, "function");
+    const DwarfType& prototype = info.types[6];
+    Check(prototype.kind == DwarfTypeKind::Function && prototype.target == 0 &&
+        prototype.params == vector<uint32_t> {2}, test, "prototype");
+
+    vector<uint8_t> stripped = BuildElf({{".text", SHT_PROGBITS, 0x42000000, vector<uint8_t>(4), 0}});
+    ElfFile plain;
+    Check(plain.Open(stripped) && !ParseDwarf(plain, info), test, "no .debug_info");
+}
+
+static void WriteFile(const filesystem::path& path, const vector<uint8_t>& data)
+{
+    filesystem::create_directories(path.parent_path());
+    ofstream(path, ios::binary | ios::trunc).write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+static void TestIndex()
+{
+    const char* test = "index";
+    TempDirectory directory("esp_elf_index_test");
+    const filesystem::path& root = directory.GetPath();
+    vector<uint8_t> app = BuildTestElf();
+    vector<uint8_t> other = BuildTestElf("other_main");
+    WriteFile(root / "app.elf", app);
+    WriteFile(root / "build" / "other.elf", other);
+    WriteFile(root / "build" / "app_copy.elf", app);
+    WriteFile(root / "notes.txt", vector<uint8_t>(100, 'x'));
+    Sha256Digest appHash = Sha256::Hash(app);
+    Sha256Digest otherHash = Sha256::Hash(other);
+
+    ElfIndexStats stats;
+    Check(BuildElfIndex(root.string(), &stats, 2), test, "index is built");
+    Check(stats.files == 3 && stats.hashed == 3 && stats.removed == 0, test, "ELF files are hashed");
+
+    ElfIndex index;
+    Check(index.Open(root.string()) && index.GetCount() == 3, test, "index opens from disk");
+    Check(index.GetStamp() == GetElfDirectoryStamp(root.string()), test, "index is current");
+    Check(filesystem::equivalent(index.Find(otherHash), root / "build" / "other.elf"), test, "lookup");
+    string found = index.Find(appHash);
+    Check(!found.empty() && filesystem::exists(found), test, "lookup of a build with two copies");
+    Check(index.Find(Sha256::Hash(vector<uint8_t>(100, 'x'))).empty(), test, "other files are not indexed");
+
+    Check(BuildElfIndex(root.string(), &stats, 2) && stats.hashed == 0, test, "unchanged files are not hashed");
+
+    // A rewritten file is hashed again, and its old entry does not match in the meantime
+    other.push_back(0);
+    WriteFile(root / "build" / "other.elf", other);
+    Check(index.Find(otherHash).empty(), test, "a changed file does not match its old hash");
+    Check(BuildElfIndex(root.string(), &stats, 2) && stats.hashed == 1, test, "the changed file is hashed");
+    ElfIndex rebuilt;
+    rebuilt.Open(root.string());
+    Check(!rebuilt.Find(Sha256::Hash(other)).empty(), test, "the new build is found");
+
+    // The remaining copy still matches after one is removed
+    filesystem::remove(root / "app.elf");
+    Check(BuildElfIndex(root.string(), &stats, 2) && stats.removed == 1 && stats.files == 2, test,
+        "removed file is dropped");
+    rebuilt.Open(root.string());
+    Check(filesystem::equivalent(rebuilt.Find(appHash), root / "build" / "app_copy.elf"), test,
+        "the remaining copy is found");
+}
+
+static void TestCache()
+{
+    const char* test = "cache";
+    TempDirectory directory("esp_elf_index_test");
+    const filesystem::path& root = directory.GetPath();
+    vector<string> directories = {root.string(), (root / "missing").string()};
+    vector<uint8_t> app = BuildTestElf();
+
+    ElfIndexCache cache;
+    Check(cache.Find(directories, Sha256::Hash(app)).empty(), test, "no index yet");
+    Check(cache.Update(directories, 2), test, "an empty directory gets an empty index");
+    Check(!cache.Update(directories, 2), test, "an unchanged directory is not indexed again");
+
+    WriteFile(root / "fw" / "app.elf", app);
+    Check(cache.Update(directories, 2), test, "a new file updates the index");
+    Check(!cache.Find(directories, Sha256::Hash(app)).empty(), test, "the new build is found");
+    Check(!cache.Update(directories, 2), test, "an unchanged tree is not indexed again");
+
+    // Writing a file in place changes no directory, and the same size is not enough to hide it
+    vector<uint8_t> patched = app;
+    patched[0x40] ^= 1;
+    filesystem::path path = root / "fw" / "app.elf";
+    auto written = filesystem::last_write_time(path);
+    WriteFile(path, patched);
+    filesystem::last_write_time(path, written + chrono::seconds(1));
+    Check(cache.Update(directories, 2), test, "a file written in place updates the index");
+    Check(!cache.Find(directories, Sha256::Hash(patched)).empty(), test, "the rewritten build is found");
+    Check(cache.Find(directories, Sha256::Hash(app)).empty(), test, "the old build is gone");
+}
+
+int main()
+{
+    TestElf();
+    TestDwarf();
+    TestIndex();
+    TestCache();
+    return Finish("esp_elf_index_test");
+}
@@ -0,0 +1,120 @@
+// Tests for rebuilding a patched app image: the rewritten checksum and digest must verify, and only the chunks
+// from the first change onwards are hashed again. Exits with status 1 if any check fails.
+
+#include "bench_util.h"
+#include "esp_export.h"
+#include "esp_verify.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+static vector<uint8_t> GetSegment(const vector<uint8_t>& data, const SegmentInfo& seg)
+{
+    return vector<uint8_t>(data.begin() + seg.file_offset, data.begin() + seg.file_offset + seg.data_len);
+}
+
+static bool Verifies(span<const uint8_t> data)
+{
+    ParsedImage image;
+    return ParseImage(data, image) == ImageParseStatus::Ok && VerifyImage(data, image).IsValid();
+}
+
+static void TestRebuild()
+{
+    const char* test = "rebuild";
+    vector<uint8_t> original = EspAppBench::BuildSyntheticImage(*GetChipAttrById(EspChipId::ESP32_S3), 6, 0x12000);
+    EspAppBench::AppendImageTrailer(original);
+    ParsedImage image;
+    Check(ParseImage(original, image) == ImageParseStatus::Ok, test, "image parses");
+    Check(original.size() > 4 * ESP_REBUILD_CHUNK_SIZE, test, "image spans several chunks");
+
+    ImageRebuilder rebuilder;
+    Check(!rebuilder.IsLoaded(), test, "nothing loaded yet");
+    Check(rebuilder.Load(original, image) && rebuilder.IsLoaded(), test, "image loads");
+
+    // Unchanged contents reproduce the original bytes; the first Finish hashes everything
+    span<const uint8_t> rebuilt = rebuilder.Finish();
+    Check(equal(rebuilt.begin(), rebuilt.end(), original.begin(), original.end()), test,
+        "unchanged image is reproduced");
+    Check(rebuilder.GetStats().bytes_changed == 0, test, "nothing changed");
+
+    // Patch a few bytes of the last segment: the digest is resumed from the chunk holding them
+    size_t last = image.segment_count - 1;
+    const SegmentInfo& seg = image.Segments()[last];
+    vector<uint8_t> contents = GetSegment(original, seg);
+    contents[0x100] ^= 0x5A;
+    contents[0x101] ^= 0xA5;
+    Check(rebuilder.UpdateSegment(last, contents), test, "segment is updated");
+    span<const uint8_t> patched = rebuilder.Finish();
+    Check(Verifies(patched), test, "patched image verifies");
+    Check(rebuilder.GetStats().bytes_changed == 2, test, "changed bytes are counted");
+    uint64_t firstDirty = (seg.file_offset + 0x100) / ESP_REBUILD_CHUNK_SIZE * ESP_REBUILD_CHUNK_SIZE;
+    uint64_t hashEnd = LocateImageTrailer(image).checksum_offset + 1;
+    Check(rebuilder.GetStats().bytes_rehashed == hashEnd - firstDirty, test, "only the tail is rehashed");
+    Check(patched[seg.file_offset + 0x100] == contents[0x100], test, "patched bytes are written");
+
+    // A second Finish with nothing new rehashes only the partial last chunk
+    rebuilder.Finish();
+    Check(rebuilder.GetStats().bytes_changed == 0 &&
+        rebuilder.GetStats().bytes_rehashed == hashEnd % ESP_REBUILD_CHUNK_SIZE, test, "idle Finish");
+
+    // Writing the original contents back restores the original image
+    Check(rebuilder.UpdateSegment(last, GetSegment(original, seg)), test, "segment is restored");
+    rebuilt = rebuilder.Finish();
+    Check(equal(rebuilt.begin(), rebuilt.end(), original.begin(), original.end()), test,
+        "restored image matches the original");
+
+    // Changing the first segment means hashing from the start
+    vector<uint8_t> first = GetSegment(original, image.Segments()[0]);
+    first[0] ^= 1;
+    rebuilder.UpdateSegment(0, first);
+    Check(Verifies(rebuilder.Finish()) && rebuilder.GetStats().bytes_rehashed == hashEnd, test,
+        "change in the first chunk");
+
+    Check(!rebuilder.UpdateSegment(image.segment_count, first), test, "segment index is checked");
+    first.pop_back();
+    Check(!rebuilder.UpdateSegment(0, first), test, "segment size is checked");
+}
+
+static void TestOffsetAndChecksumOnly()
+{
+    const char* test = "offset";
+    vector<uint8_t> image = EspAppBench::BuildSyntheticImage(*GetChipAttrById(EspChipId::ESP32), 3, 0x800);
+    EspAppBench::AppendImageTrailer(image);
+    image[23] = 0;
+    ParsedImage parsed;
+    ParseImage(image, parsed);
+    image.resize(LocateImageTrailer(parsed).hash_offset);
+
+    // An image inside a flash dump is copied out and rebased
+    vector<uint8_t> flash(0x10000 + image.size(), 0xFF);
+    copy(image.begin(), image.end(), flash.begin() + 0x10000);
+    Check(ParseImage(flash, parsed, 0x10000) == ImageParseStatus::Ok, test, "image parses at its offset");
+
+    ImageRebuilder rebuilder;
+    Check(rebuilder.Load(flash, parsed), test, "image loads from the dump");
+    Check(rebuilder.GetImage().base_offset == 0 && rebuilder.GetImage().Segments()[0].file_offset ==
+        parsed.Segments()[0].file_offset - 0x10000, test, "offsets are rebased");
+
+    vector<uint8_t> contents = GetSegment(flash, parsed.Segments()[1]);
+    contents[7] ^= 0x80;
+    rebuilder.UpdateSegment(1, contents);
+    span<const uint8_t> patched = rebuilder.Finish();
+    Check(patched.size() == image.size() && Verifies(patched), test, "checksum-only image is rebuilt");
+    Check(rebuilder.GetStats().bytes_rehashed == 0, test, "no digest to rehash");
+
+    flash.resize(flash.size() - 1);
+    Check(!ImageRebuilder().Load(flash, parsed), test, "truncated image does not load");
+}
+
+int main()
+{
+    TestRebuild();
+    TestOffsetAndChecksumOnly();
+    return Finish("esp_export_test");
+}
@@ -0,0 +1,145 @@
+// Known-answer tests for the XTS-AES flash decryption. The vectors are laid out as espsecure.py
+// encrypt_flash_data writes them, computed with OpenSSL's XTS-AES: each 128-byte unit is reversed, encrypted with
+// its flash address as the tweak and reversed back. The all-zero vector ties that layout to IEEE 1619 vector 1.
+// Every vector is decrypted by the portable code and, where the CPU has AES instructions, by the hardware path.
+
+#include "esp_flash_crypt.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+struct CryptVector
+{
+    const char* name;
+    vector<uint8_t> key;
+    uint64_t flash_addr;
+    vector<uint8_t> plaintext;
+    vector<uint8_t> ciphertext;
+};
+
+static vector<uint8_t> GetPatternKey(size_t length)
+{
+    vector<uint8_t> key(length);
+    for (size_t i = 0; i < length; i++)
+        key[i] = static_cast<uint8_t>(i * 7 + 3);
+    return key;
+}
+
+static vector<uint8_t> GetCountingBytes(size_t length)
+{
+    vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; i++)
+        data[i] = static_cast<uint8_t>(i);
+    return data;
+}
+
+static vector<CryptVector> GetVectors()
+{
+    return {
+        {"xts-aes-128/zero", vector<uint8_t>(32), 0, vector<uint8_t>(128), FromHex(
+            "5a9f1171e9e373eb6247f47967db743043dd289bfa7baff9e853a5a1c6a5e845ffe994eac7248dbf22ace6132def8ee3"
+            "57f4e7bcdff180869ecbba7502bc8e4db12f1052b4439a4e19ce3f7c655a525329778ec113974b096a519b27fd674873"
+            "2e92bf2f65c2028c85ed9895f5d243cd92a6ddeaa3e99f9becb268bd9ef67c91")},
+        {"xts-aes-128/0x10080", GetPatternKey(32), 0x10080, GetCountingBytes(256), FromHex(
+            "aa05925406a0eaf3fcc63f30c44ae084f90edbe682b886e5b35bc70e8df9dff1d8f2a9daeb4b0e5290b1207410a202aa"
+            "c21cbc3dc8945c94b94ef05267dc6d2ce92ec03544568e6b0520aa0048233a84594c9c73e2d12121ded7e562a3307959"
+            "d3ac146094a0fd45b39d0acf58a785a07778f68cdc9ff6b42bba8a7942e88bade252f16854aca056cf43d77d33e86f4f"
+            "3020858534507aa0bd4cc92c1ba3dd356d1e95930758dedfedb76a8f17818789126f65db076c50ed1ff0c289b232bcd5"
+            "4ecad3b71be2d353764bb90f05c7d4a1175a03d0dad15ea1d4638552dc6ee1044dc2235de44fddf4f4fd622ce2b04a9b"
+            "5cc629f2e611679cbafeb56e89b87fe6")},
+        {"xts-aes-256/0x10080", GetPatternKey(64), 0x10080, GetCountingBytes(256), FromHex(
+            "44fafa50ee32c1f08bbbe5ade9a6dd3b69cec98ec3e846c423a6bda2e0ad63069894b5e77e9cce7d251deac0dda5e1e0"
+            "21f0a177de6bdd3bc82bed502485635d49664aaee1042761973a8108f1e9f6c79dc11d8897cbaeed06e4aed2bc022073"
+            "60b22004b8305e7fa1a533f18893860832de900701de8a28690ccc65e6630b4e50673e6f5fc7a3bb1b178e455becf834"
+            "5f5bd5c7a7c7147f516063bcfca1db86d7c1297e2da8dcc71d206a9d8f212b91edd2b5506a538c6b441edb1c2994a40b"
+            "0790b65de694d6c4b731d42c2bc356bfd5ff9a186f96f5acf8214fb21e1346fd43b047bbe72660a84d2126a118146a8d"
+            "28aa0df08d94f75026301b2ef09a1992")},
+    };
+}
+
+static bool ReadVector(void* context, uint64_t offset, void* dest, size_t length)
+{
+    auto data = static_cast<const vector<uint8_t>*>(context);
+    if (offset > data->size() || data->size() - offset < length)
+        return false;
+    memcpy(dest, data->data() + offset, length);
+    return true;
+}
+
+static void TestIeee1619Layout()
+{
+    // The first two XTS blocks of the reversed unit are IEEE 1619 vector 1 (zero keys, tweak 0, zero data)
+    const char* test = "ieee1619";
+    vector<uint8_t> unit = GetVectors()[0].ciphertext;
+    reverse(unit.begin(), unit.end());
+    vector<uint8_t> expected = FromHex("917cf69ebd68b2ec9b9fe9a3eadda692cd43d2f59598ed858c02c2652fbf922e");
+    Check(equal(expected.begin(), expected.end(), unit.begin()), test, "reversed unit starts with vector 1");
+}
+
+static void TestDecrypt(const CryptVector& crypt, bool useHardware)
+{
+    string test = string(crypt.name) + (useHardware ? "/hardware" : "/software");
+    FlashDecryptor decryptor;
+    Check(decryptor.SetKey(crypt.key, useHardware), test.c_str(), "key is accepted");
+    Check(decryptor.GetKeyBits() == (crypt.key.size() == 64 ? 256u : 128u), test.c_str(), "key size");
+    Check(decryptor.UsesHardwareAes() == (useHardware && FlashDecryptor::HasHardwareAes()), test.c_str(),
+        "AES implementation");
+
+    vector<uint8_t> data = crypt.ciphertext;
+    decryptor.Decrypt(crypt.flash_addr, data.data(), data.size());
+    Check(data == crypt.plaintext, test.c_str(), "whole vector decrypts");
+
+    // Units are independent: the second one alone, at its own address
+    if (crypt.ciphertext.size() >= 2 * ESP_FLASH_CRYPT_UNIT)
+    {
+        vector<uint8_t> unit(crypt.ciphertext.begin() + ESP_FLASH_CRYPT_UNIT,
+            crypt.ciphertext.begin() + 2 * ESP_FLASH_CRYPT_UNIT);
+        decryptor.Decrypt(crypt.flash_addr + ESP_FLASH_CRYPT_UNIT, unit.data(), unit.size());
+        Check(equal(unit.begin(), unit.end(), crypt.plaintext.begin() + ESP_FLASH_CRYPT_UNIT), test.c_str(),
+            "second unit decrypts on its own");
+    }
+
+    // The wrong address is a different tweak
+    data = crypt.ciphertext;
+    decryptor.Decrypt(crypt.flash_addr + 0x1000, data.data(), data.size());
+    Check(data != crypt.plaintext, test.c_str(), "address is part of the tweak");
+}
+
+static void TestDecryptedFlash(const CryptVector& crypt)
+{
+    const char* test = crypt.name;
+    FlashDecryptor decryptor;
+    decryptor.SetKey(crypt.key);
+    DecryptedFlash flash(decryptor, crypt.ciphertext.size(), crypt.flash_addr, ReadVector,
+        const_cast<vector<uint8_t>*>(&crypt.ciphertext));
+
+    uint8_t bytes[16];
+    Check(flash.Read(3, bytes, sizeof(bytes)) == sizeof(bytes) &&
+        memcmp(bytes, crypt.plaintext.data() + 3, sizeof(bytes)) == 0, test, "unaligned read");
+    Check(flash.Read(crypt.ciphertext.size() - 4, bytes, sizeof(bytes)) == 4, test, "read is short at the end");
+    Check(flash.GetDecryptedPages() == 1, test, "the page is decrypted once");
+
+    Check(LooksLikeCiphertext(crypt.ciphertext), test, "ciphertext looks like ciphertext");
+}
+
+int main()
+{
+    TestIeee1619Layout();
+    for (const CryptVector& crypt : GetVectors())
+    {
+        TestDecrypt(crypt, false);
+        TestDecrypt(crypt, true);
+        TestDecryptedFlash(crypt);
+    }
+    FlashDecryptor decryptor;
+    Check(!decryptor.SetKey(vector<uint8_t>(48)), "key", "48-byte key is rejected");
+    Check(!LooksLikeCiphertext(vector<uint8_t>(ESP_FLASH_CRYPT_UNIT, 0xFF)), "ciphertext", "erased flash is not");
+    return Finish("esp_flash_crypt_test");
+}
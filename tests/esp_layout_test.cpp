@@ -0,0 +1,270 @@
+// Tests for the memory layout planner: merging app segments into the chip's regions, overlapping and invalid
+// segments, and the regions deferred by a sparse layout. Covers the ESP32 map (separate code and data buses)
+// and the ESP32-C6 map (unified regions). Exits with status 1 if any check fails.
+
+#include "esp_chip.h"
+#include "esp_image.h"
+#include "esp_layout.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <span>
+#include <string>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+static const PlannedSection* FindSection(const LayoutPlan& plan, const string& name)
+{
+    for (const PlannedSection& section : plan.sections)
+    {
+        if (section.name == name)
+            return &section;
+    }
+    return nullptr;
+}
+
+static bool HasSection(const LayoutPlan& plan, const string& name, uint64_t start, uint64_t length,
+    uint32_t semantics)
+{
+    const PlannedSection* section = FindSection(plan, name);
+    return section && section->start == start && section->length == length && section->semantics == semantics;
+}
+
+static const PlannedSegment* FindSegment(const LayoutPlan& plan, uint64_t start)
+{
+    for (const PlannedSegment& segment : plan.segments)
+    {
+        if (segment.start == start)
+            return &segment;
+    }
+    return nullptr;
+}
+
+static uint64_t GetRegionSize(const MemoryRegion& region)
+{
+    return region.end_addr - region.start_addr;
+}
+
+// Invariants of every successful plan: one section per segment, ascending addresses and consistent totals
+static void CheckPlanShape(const char* test, const LayoutPlan& plan)
+{
+    Check(plan.segments.size() == plan.sections.size(), test, "one section per segment");
+    uint64_t mapped = 0, fileBacked = 0;
+    for (size_t i = 0; i < plan.segments.size(); i++)
+    {
+        const PlannedSegment& segment = plan.segments[i];
+        Check(plan.sections[i].start == segment.start && plan.sections[i].length == segment.length, test,
+            "section matches its segment");
+        Check(i == 0 || plan.segments[i - 1].start <= segment.start, test, "segments are in address order");
+        Check(segment.data_length == 0 || segment.data_length == segment.length, test,
+            "file-backed segments are fully backed");
+        mapped += segment.length;
+        fileBacked += segment.data_length;
+    }
+    Check(plan.mapped_bytes == mapped, test, "mapped_bytes is the sum of the segments");
+    Check(plan.file_backed_bytes == fileBacked, test, "file_backed_bytes is the sum of the backed segments");
+}
+
+static void TestEsp32Merge()
+{
+    const char* test = "esp32/merge";
+    const ChipAttr& attr = *GetChipAttrById(EspChipId::ESP32);
+    RegionIndex index(attr);
+
+    // File order differs from address order; segments 0 and 4 are contiguous in DROM
+    const SegmentInfo segments[] = {
+        {0x3F400020, 0x100, 0x20},   // external.data.1
+        {0x400D0020, 0x200, 0x128},  // external.code.0
+        {0x40080000, 0x400, 0x330},  // embedded.code.ram.0.2, at the region start
+        {0x400C3000, 0x100, 0x738},  // external.code.0, below segment 1
+        {0x3F400120, 0x80, 0x840},   // external.data.1, right after segment 0
+    };
+    SegmentRegionMap map;
+    LayoutPlan plan;
+    Check(PlanMemoryLayout(index, segments, map, plan) == SegmentMapStatus::Ok, test, "plan succeeds");
+    Check(map.segment_count == 5, test, "every segment is mapped");
+    CheckPlanShape(test, plan);
+
+    // 14 untouched regions plus 4, 5 and 2 pieces of the regions with segments
+    Check(plan.segments.size() == 25, test, "regions are split around the app segments");
+    Check(plan.deferred_regions.empty(), test, "a full layout defers nothing");
+
+    uint64_t regionBytes = 0;
+    for (size_t i = 0; i < attr.region_count; i++)
+        regionBytes += GetRegionSize(attr.regions[i]);
+    Check(plan.mapped_bytes == regionBytes, test, "the whole address map is covered");
+    Check(plan.file_backed_bytes == 0x100 + 0x200 + 0x400 + 0x100 + 0x80, test, "every app byte is file-backed");
+
+    const uint32_t data = RegionDefaultSemantics, code = RegionReadOnlyCodeSemantics;
+    Check(HasSection(plan, "external.data.1.frag.0", 0x3F400000, 0x20, data), test, "gap before DROM segment");
+    Check(HasSection(plan, "external.data.1.app.0", 0x3F400020, 0x100, data), test, "DROM segment 0");
+    Check(HasSection(plan, "external.data.1.app.4", 0x3F400120, 0x80, data), test, "DROM segment 4");
+    Check(!FindSection(plan, "external.data.1.frag.2"), test, "no fragment between contiguous segments");
+    Check(HasSection(plan, "external.data.1.frag.1", 0x3F4001A0, 0x3F800000 - 0x3F4001A0, data), test,
+        "DROM tail");
+
+    Check(HasSection(plan, "external.code.0.frag.0", 0x400C2000, 0x1000, code), test, "gap before IROM");
+    Check(HasSection(plan, "external.code.0.app.3", 0x400C3000, 0x100, code), test, "IROM segment 3");
+    Check(HasSection(plan, "external.code.0.frag.1", 0x400C3100, 0x400D0020 - 0x400C3100, code), test,
+        "gap between IROM segments");
+    Check(HasSection(plan, "external.code.0.app.1", 0x400D0020, 0x200, code), test, "IROM segment 1");
+    Check(HasSection(plan, "external.code.0.frag.2", 0x400D0220, 0x40C00000 - 0x400D0220, code), test,
+        "IROM tail");
+
+    Check(!FindSection(plan, "embedded.code.ram.0.2.frag.1"), test, "no gap before a segment at a region start");
+    Check(HasSection(plan, "embedded.code.ram.0.2.app.2", 0x40080000, 0x400, code), test, "IRAM segment");
+    Check(HasSection(plan, "embedded.code.ram.0.2.frag.0", 0x40080400, 0x400A0000 - 0x40080400, code), test,
+        "IRAM tail");
+    Check(HasSection(plan, "peripheral", 0x3FF00000, 0x80000, data), test, "untouched region is kept whole");
+
+    const PlannedSegment* segment = FindSegment(plan, 0x400D0020);
+    Check(segment && segment->data_offset == 0x128 && segment->data_length == 0x200 &&
+        segment->flags == (RegionExecutable | RegionReadable | RegionContainsCode), test,
+        "app segment keeps its file offset and the region flags");
+    segment = FindSegment(plan, 0x400C2000);
+    Check(segment && segment->data_length == 0, test, "fragments are not file-backed");
+}
+
+static void TestEsp32Overlap()
+{
+    const char* test = "esp32/overlap";
+    const ChipAttr& attr = *GetChipAttrById(EspChipId::ESP32);
+    RegionIndex index(attr);
+
+    // Segment 1 overlaps segment 0 and segment 2 lies inside it
+    const SegmentInfo overlapping[] = {
+        {0x40080000, 0x200, 0x20},
+        {0x40080100, 0x200, 0x228},
+        {0x40080040, 0x40, 0x430},
+    };
+    SegmentRegionMap map;
+    LayoutPlan plan;
+    Check(PlanMemoryLayout(index, overlapping, map, plan) == SegmentMapStatus::Ok, test, "plan succeeds");
+    CheckPlanShape(test, plan);
+    Check(!FindSection(plan, "embedded.code.ram.0.2.frag.1"), test, "no fragment inside overlapping segments");
+    Check(HasSection(plan, "embedded.code.ram.0.2.frag.0", 0x40080300, 0x400A0000 - 0x40080300,
+        RegionReadOnlyCodeSemantics), test, "tail starts after the furthest segment end");
+
+    size_t first = 0;
+    while (first < plan.sections.size() && plan.sections[first].start != 0x40080000)
+        first++;
+    Check(first + 3 < plan.sections.size() && plan.sections[first].name == "embedded.code.ram.0.2.app.0" &&
+        plan.sections[first + 1].name == "embedded.code.ram.0.2.app.2" &&
+        plan.sections[first + 2].name == "embedded.code.ram.0.2.app.1", test,
+        "overlapping segments are kept in address order");
+
+    // Invalid segments fail the plan and leave it empty, even if it held an earlier plan
+    const SegmentInfo spans[] = {{0x3F400020, 0x100, 0x20}, {0x3FFFFF00, 0x200, 0x128}};
+    Check(PlanMemoryLayout(index, spans, map, plan) == SegmentMapStatus::SpansRegions, test,
+        "segment running into the next region");
+    Check(map.failed_segment == 1 && map.end_region && strcmp(map.end_region->name, "embedded.code.rom.0.1") == 0,
+        test, "spanning segment and its end region are reported");
+    Check(plan.segments.empty() && plan.sections.empty() && plan.mapped_bytes == 0, test,
+        "failed plan is empty");
+
+    const SegmentInfo exceeds[] = {{0x3FF81F00, 0x200, 0x20}};
+    Check(PlanMemoryLayout(index, exceeds, map, plan) == SegmentMapStatus::ExceedsRegion, test,
+        "segment running into unmapped space");
+    Check(map.failed_segment == 0 && !map.end_region, test, "exceeding segment has no end region");
+
+    const SegmentInfo unmapped[] = {{0x3F400020, 0x100, 0x20}, {0x400D0020, 0x100, 0x128}, {0x3FF88000, 0x10, 0x230}};
+    Check(PlanMemoryLayout(index, unmapped, map, plan) == SegmentMapStatus::NoRegion, test,
+        "segment outside every region");
+    Check(map.failed_segment == 2 && map.segment_count == 2, test, "unmapped segment is reported");
+}
+
+static void TestEsp32Deferred()
+{
+    const char* test = "esp32/deferred";
+    const ChipAttr& attr = *GetChipAttrById(EspChipId::ESP32);
+    RegionIndex index(attr);
+
+    const SegmentInfo segments[] = {{0x3F400020, 0x100, 0x20}, {0x400D0020, 0x200, 0x128}};
+    SegmentRegionMap map;
+    LayoutPlan plan;
+    Check(PlanMemoryLayout(index, segments, map, plan, LayoutMode::Sparse) == SegmentMapStatus::Ok, test,
+        "plan succeeds");
+    CheckPlanShape(test, plan);
+    Check(plan.segments.size() == 6, test, "only the regions with segments are mapped");
+    Check(plan.mapped_bytes == 0x400000 + (0x40C00000 - 0x400C2000), test, "mapped bytes of the two regions");
+    Check(plan.deferred_regions.size() == attr.region_count - 2, test, "every other region is deferred");
+
+    bool ordered = true, excluded = true;
+    for (size_t i = 0; i < plan.deferred_regions.size(); i++)
+    {
+        const MemoryRegion* region = plan.deferred_regions[i];
+        ordered &= i == 0 || plan.deferred_regions[i - 1]->start_addr < region->start_addr;
+        excluded &= strcmp(region->name, "external.data.1") != 0 && strcmp(region->name, "external.code.0") != 0;
+    }
+    Check(ordered, test, "deferred regions are in address order");
+    Check(excluded, test, "mapped regions are not deferred");
+    Check(!FindSection(plan, "peripheral"), test, "deferred regions get no section");
+
+    // A deferred region mapped later keeps the semantics the full plan gives it
+    for (const MemoryRegion* region : plan.deferred_regions)
+    {
+        if (strcmp(region->name, "embedded.code.ram.0.2") == 0)
+            Check(GetRegionSectionSemantics(*region) == RegionReadOnlyCodeSemantics, test, "deferred IRAM is code");
+        if (strcmp(region->name, "embedded.data.ram.1") == 0)
+            Check(GetRegionSectionSemantics(*region) == RegionDefaultSemantics, test, "deferred DRAM is data");
+    }
+}
+
+static void TestEsp32c6()
+{
+    const char* test = "esp32-c6";
+    const ChipAttr& attr = *GetChipAttrById(EspChipId::ESP32_C6);
+    RegionIndex index(attr);
+
+    // Code and rodata share the unified flash region; segment 2 is in HP SRAM
+    const SegmentInfo segments[] = {
+        {0x42000020, 0x1000, 0x20},
+        {0x42010020, 0x800, 0x1028},
+        {0x40800000, 0x300, 0x1830},
+    };
+    SegmentRegionMap map;
+    LayoutPlan plan;
+    Check(PlanMemoryLayout(index, segments, map, plan) == SegmentMapStatus::Ok, test, "full plan succeeds");
+    CheckPlanShape(test, plan);
+    Check(plan.segments.size() == 10, test, "regions are split around the app segments");
+
+    // Unified regions keep default semantics so rodata is not swept as code; the ROM is code only
+    const uint32_t unified = RegionDefaultSemantics;
+    Check(HasSection(plan, "external.flash.0.frag.0", 0x42000000, 0x20, unified), test, "gap before flash code");
+    Check(HasSection(plan, "external.flash.0.app.0", 0x42000020, 0x1000, unified), test, "flash code");
+    Check(HasSection(plan, "external.flash.0.frag.1", 0x42001020, 0xF000, unified), test, "gap in flash");
+    Check(HasSection(plan, "external.flash.0.app.1", 0x42010020, 0x800, unified), test, "flash rodata");
+    Check(HasSection(plan, "external.flash.0.frag.2", 0x42010820, 0x43000000 - 0x42010820, unified), test,
+        "flash tail");
+    Check(HasSection(plan, "embedded.ram.0.app.2", 0x40800000, 0x300, unified), test, "SRAM segment");
+    Check(HasSection(plan, "embedded.code.rom.0", 0x40000000, 0x50000, RegionReadOnlyCodeSemantics), test,
+        "ROM is code only");
+
+    const PlannedSegment* segment = FindSegment(plan, 0x42000020);
+    Check(segment && (segment->flags & RegionContainsCode) && (segment->flags & RegionContainsData), test,
+        "unified region flags are kept");
+
+    Check(PlanMemoryLayout(index, segments, map, plan, LayoutMode::Sparse) == SegmentMapStatus::Ok, test,
+        "sparse plan succeeds");
+    CheckPlanShape(test, plan);
+    Check(plan.segments.size() == 7, test, "only flash and SRAM are mapped");
+    Check(plan.deferred_regions.size() == 3 && strcmp(plan.deferred_regions[0]->name, "embedded.code.rom.0") == 0 &&
+        strcmp(plan.deferred_regions[1]->name, "embedded.rtc") == 0 &&
+        strcmp(plan.deferred_regions[2]->name, "peripheral") == 0, test, "ROM, RTC and peripherals are deferred");
+
+    const SegmentInfo spans[] = {{0x4087FF00, 0x200, 0x20}};
+    Check(PlanMemoryLayout(index, spans, map, plan, LayoutMode::Sparse) == SegmentMapStatus::ExceedsRegion, test,
+        "segment past the end of SRAM");
+    Check(plan.segments.empty() && plan.deferred_regions.empty(), test, "failed sparse plan is empty");
+}
+
+int main()
+{
+    TestEsp32Merge();
+    TestEsp32Overlap();
+    TestEsp32Deferred();
+    TestEsp32c6();
+    return Finish("esp_layout_test");
+}
@@ -0,0 +1,148 @@
+// Tests for the flash cache MMU model: page-granular mappings as the bootloader programs them, translation in
+// both directions, several apps sharing the virtual windows, unified windows and smaller pages. Exits with
+// status 1 if any check fails.
+
+#include "bench_util.h"
+#include "esp_mmu.h"
+#include "test_util.h"
+
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+static bool Translates(const FlashMmu& mmu, uint32_t addr, uint64_t flashOffset, size_t app = 0)
+{
+    uint64_t result;
+    return mmu.VirtualToFlash(addr, result, app) && result == flashOffset;
+}
+
+static bool ReverseTranslates(const FlashMmu& mmu, uint64_t flashOffset, MmuBus bus, uint32_t addr)
+{
+    uint32_t result;
+    return mmu.FlashToVirtual(flashOffset, result, bus) && result == addr;
+}
+
+static void TestInit()
+{
+    const char* test = "init";
+    FlashMmu mmu;
+    Check(mmu.Init(EspChipId::ESP32_S3), test, "S3 has a model");
+    Check(mmu.GetPageSize() == FLASH_MMU_PAGE_SIZE && mmu.GetAppCount() == 0, test, "defaults");
+    Check(mmu.IsFlashWindow(0x3C000000) && mmu.IsFlashWindow(0x43FFFFFF), test, "window bounds");
+    Check(!mmu.IsFlashWindow(0x3FC88000) && !mmu.IsFlashWindow(0x44000000), test, "internal RAM is not flash");
+    Check(!mmu.Init(EspChipId::ESP32_S3, 0x3000), test, "page size must be a power of two");
+
+    bool covered = true;
+    for (const ChipAttr* attr : GetChipAttrList())
+        covered &= !GetFlashMmuWindows(attr->chip_id).empty();
+    Check(covered, test, "every supported chip has flash windows");
+}
+
+static void TestMapping()
+{
+    const char* test = "mapping";
+    FlashMmu mmu;
+    mmu.Init(EspChipId::ESP32_S3);
+    size_t factory = mmu.AddApp();
+
+    // DROM at 0x3C000020 from flash 0x10020, IROM at 0x42000020 from flash 0x30020, as in an app at 0x10000
+    Check(mmu.Map(factory, 0x3C000020, 0x10020, 0x18000), test, "DROM maps");
+    Check(mmu.Map(factory, 0x42000020, 0x30020, 0x30000), test, "IROM maps");
+    Check(!mmu.Map(factory, 0x3FC88000, 0x50000, 0x1000), test, "RAM does not map");
+    Check(!mmu.Map(factory, 0x3C100020, 0x10, 0x100), test, "flash offset below the page offset");
+
+    Check(Translates(mmu, 0x3C000020, 0x10020) && Translates(mmu, 0x3C012345, 0x22345), test, "DROM pages");
+    Check(Translates(mmu, 0x3C000000, 0x10000), test, "the whole first page is mapped");
+    uint64_t flashOffset;
+    Check(!mmu.VirtualToFlash(0x3C020000, flashOffset), test, "past the last page");
+    Check(Translates(mmu, 0x4202FFFF, 0x5FFFF), test, "IROM pages");
+
+    Check(ReverseTranslates(mmu, 0x30020, MmuBus::Both, 0x42000020), test, "flash to IROM");
+    Check(ReverseTranslates(mmu, 0x10020, MmuBus::Data, 0x3C000020), test, "flash to DROM");
+    uint32_t addr;
+    Check(!mmu.FlashToVirtual(0x10020, addr, MmuBus::Instruction), test, "DROM pages are not on the I bus");
+    Check(!mmu.FlashToVirtual(0x700000, addr), test, "unmapped flash");
+
+    vector<MmuRun> runs;
+    mmu.GetRuns(factory, runs);
+    Check(runs.size() == 2, test, "one run per window");
+    Check(runs.size() == 2 && runs[0].addr == 0x3C000000 && runs[0].flash_offset == 0x10000 &&
+        runs[0].size == 0x20000, test, "DROM run");
+    Check(runs.size() == 2 && runs[1].addr == 0x42000000 && runs[1].flash_offset == 0x30000 &&
+        runs[1].size == 0x40000, test, "IROM run, one page more for the offset of its first byte");
+
+    // An OTA app reuses the windows with its own flash pages
+    size_t ota = mmu.AddApp();
+    mmu.Map(ota, 0x42000020, 0x130020, 0x8000);
+    Check(Translates(mmu, 0x42000020, 0x130020, ota) && Translates(mmu, 0x42000020, 0x30020, factory), test,
+        "apps translate independently");
+    size_t owner = FLASH_MMU_NO_APP;
+    Check(mmu.FlashToVirtual(0x130020, addr, MmuBus::Both, &owner) && addr == 0x42000020 && owner == ota, test,
+        "flash page knows its app");
+
+    // A mapping is cut at the end of its window
+    Check(mmu.Map(ota, 0x3DFF0000, 0x200000, 0x40000), test, "mapping at the window end");
+    mmu.GetRuns(ota, runs);
+    Check(!runs.empty() && runs[0].addr == 0x3DFF0000 && runs[0].size == FLASH_MMU_PAGE_SIZE, test,
+        "mapping is limited to the window");
+}
+
+static void TestUnifiedWindow()
+{
+    const char* test = "unified";
+    FlashMmu mmu;
+    Check(mmu.Init(EspChipId::ESP32_C6), test, "C6 has a model");
+    size_t app = mmu.AddApp();
+    mmu.Map(app, 0x42000020, 0x10020, 0x100);
+    Check(ReverseTranslates(mmu, 0x10020, MmuBus::Data, 0x42000020) &&
+        ReverseTranslates(mmu, 0x10020, MmuBus::Instruction, 0x42000020), test, "one window serves both buses");
+
+    // 32 KB pages for small flash chips
+    Check(mmu.Init(EspChipId::ESP32_C2, 0x8000) && mmu.GetPageSize() == 0x8000, test, "32 KB pages");
+    app = mmu.AddApp();
+    mmu.Map(app, 0x42009000, 0x19000, 0x9000);
+    Check(Translates(mmu, 0x42008000, 0x18000) && Translates(mmu, 0x42017FFF, 0x27FFF), test,
+        "mapping follows the smaller pages");
+    uint64_t flashOffset;
+    Check(!mmu.VirtualToFlash(0x42018000, flashOffset) && !mmu.VirtualToFlash(0x42007FFF, flashOffset), test,
+        "neighbouring pages stay unmapped");
+}
+
+static void TestImage()
+{
+    const char* test = "image";
+    vector<uint8_t> data = EspAppBench::BuildSyntheticImage(*GetChipAttrById(EspChipId::ESP32_C3), 8, 0x2000);
+    ParsedImage image;
+    Check(ParseImage(data, image) == ImageParseStatus::Ok, test, "image parses");
+
+    FlashMmu mmu;
+    mmu.Init(EspChipId::ESP32_C3);
+    size_t app = mmu.AddImage(image, 0x20000);
+    // esptool pads flash segments so that load address and file offset agree modulo the page size; the
+    // synthetic image is not padded, so the expected offset is the one of the page the bootloader maps
+    size_t flashSegments = 0;
+    bool translated = true;
+    for (const SegmentInfo& seg : image.Segments())
+    {
+        if (!mmu.IsFlashWindow(seg.load_addr))
+            continue;
+        flashSegments++;
+        uint32_t pageOffset = seg.load_addr & (FLASH_MMU_PAGE_SIZE - 1);
+        uint64_t page = (0x20000 + seg.file_offset - pageOffset) & ~uint64_t(FLASH_MMU_PAGE_SIZE - 1);
+        translated &= Translates(mmu, seg.load_addr, page + pageOffset, app) &&
+            Translates(mmu, seg.load_addr + seg.data_len - 1, page + pageOffset + seg.data_len - 1, app);
+    }
+    Check(flashSegments >= 2, test, "image has flash segments");
+    Check(translated, test, "segments translate through the pages mapped for them");
+}
+
+int main()
+{
+    TestInit();
+    TestMapping();
+    TestUnifiedWindow();
+    TestImage();
+    return Finish("esp_mmu_test");
+}
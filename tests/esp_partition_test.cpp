@@ -0,0 +1,203 @@
+// Tests for partition table parsing, the stricter table check used for format detection, and the flash dump
+// scan built on them: app partitions, byte-identical OTA slots and the default app. Exits with status 1 if any
+// check fails.
+
+#include "bench_util.h"
+#include "esp_flash.h"
+#include "esp_partition.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+struct TableEntry
+{
+    uint8_t type;
+    uint8_t subtype;
+    uint32_t offset;
+    uint32_t size;
+    const char* label;
+    uint32_t flags;
+};
+
+static constexpr uint8_t APP = static_cast<uint8_t>(EspPartitionType::App);
+static constexpr uint8_t DATA = static_cast<uint8_t>(EspPartitionType::Data);
+
+// A partition table sector as gen_esp32part writes it: the entries, optionally an MD5 row, then erased flash
+static vector<uint8_t> BuildTable(const vector<TableEntry>& entries, bool md5Row)
+{
+    vector<uint8_t> table(ESP_PARTITION_TABLE_MAX_LEN, 0xFF);
+    size_t at = 0;
+    for (const TableEntry& entry : entries)
+    {
+        uint8_t* p = table.data() + at;
+        memset(p, 0, sizeof(EspPartitionEntry));
+        StoreLE16(p, ESP_PARTITION_MAGIC);
+        p[2] = entry.type;
+        p[3] = entry.subtype;
+        StoreLE32(p + 4, entry.offset);
+        StoreLE32(p + 8, entry.size);
+        memcpy(p + 12, entry.label, min<size_t>(strlen(entry.label), 16));
+        StoreLE32(p + 28, entry.flags);
+        at += sizeof(EspPartitionEntry);
+    }
+    if (md5Row)
+    {
+        memset(table.data() + at, 0xFF, sizeof(EspPartitionEntry));
+        StoreLE16(table.data() + at, ESP_PARTITION_MAGIC_MD5);
+    }
+    return table;
+}
+
+static vector<TableEntry> GetDefaultEntries()
+{
+    return {
+        {DATA, DataNvs, 0x9000, 0x6000, "nvs", 0},
+        {DATA, DataPhy, 0xF000, 0x1000, "phy_init", 0},
+        {APP, AppFactory, 0x10000, 0x100000, "factory", 0},
+        {APP, AppOtaMin, 0x110000, 0x100000, "ota_0", 1},
+        {DATA, 0x82, 0x210000, 0x10000, "a_sixteen_char_l", 0},
+    };
+}
+
+static void TestParse()
+{
+    const char* test = "parse";
+    vector<uint8_t> table = BuildTable(GetDefaultEntries(), true);
+    vector<PartitionInfo> partitions;
+    Check(ParsePartitionTable(table, partitions, 0), test, "table parses");
+    Check(partitions.size() == 5, test, "the MD5 row ends the table");
+    if (partitions.size() != 5)
+        return;
+
+    Check(!partitions[0].IsApp() && partitions[0].offset == 0x9000 && partitions[0].size == 0x6000, test,
+        "nvs entry");
+    Check(strcmp(partitions[0].label, "nvs") == 0, test, "label");
+    Check(partitions[2].IsApp() && partitions[2].subtype == AppFactory && !partitions[2].IsEncrypted(), test,
+        "factory entry");
+    Check(partitions[3].IsEncrypted(), test, "encrypted flag");
+    Check(strcmp(partitions[4].label, "a_sixteen_char_l") == 0, test, "a 16-character label is terminated");
+
+    Check(strcmp(GetPartitionTypeName(APP), "app") == 0, test, "app type name");
+    Check(strcmp(GetPartitionSubtypeName(APP, AppOtaMin + 1), "ota_1") == 0, test, "OTA subtype name");
+    Check(strcmp(GetPartitionSubtypeName(DATA, DataCoreDump), "coredump") == 0, test, "data subtype name");
+    Check(strcmp(GetPartitionTypeName(0x40), "custom") == 0, test, "custom type name");
+    Check(strcmp(GetPartitionSubtypeName(DATA, 0x82), "unknown") == 0, test, "custom data subtype name");
+
+    // Entries past the end of the data are kept, a short read only ends the table
+    vector<uint8_t> dump(0x100, 0xFF);
+    dump.insert(dump.end(), table.begin(), table.begin() + 2 * sizeof(EspPartitionEntry) + 8);
+    Check(ParsePartitionTable(dump, partitions, 0x100) && partitions.size() == 2, test,
+        "a truncated entry ends the table");
+
+    vector<uint8_t> erased(ESP_PARTITION_TABLE_MAX_LEN, 0xFF);
+    Check(!ParsePartitionTable(erased, partitions, 0) && partitions.empty(), test, "erased flash has no table");
+}
+
+static void TestValidate()
+{
+    const char* test = "validate";
+    Check(IsValidPartitionTable(BuildTable(GetDefaultEntries(), true)), test, "table with an MD5 row");
+    Check(IsValidPartitionTable(BuildTable(GetDefaultEntries(), false)), test, "table ended by erased flash");
+
+    struct
+    {
+        const char* what;
+        TableEntry entry;
+        bool valid;
+    } cases[] = {
+        {"custom data subtype", {DATA, 0x40, 0x300000, 0x1000, "custom", 0}, true},
+        {"custom type", {0x40, 0x00, 0x300000, 0x1000, "custom", 0}, true},
+        {"reserved type", {0x02, 0x00, 0x300000, 0x1000, "reserved", 0}, false},
+        {"unknown app subtype", {APP, 0x30, 0x300000, 0x10000, "app", 0}, false},
+        {"test app subtype", {APP, AppTest, 0x300000, 0x10000, "test", 0}, true},
+        {"app not on a 64 KB boundary", {APP, AppOtaMin + 1, 0x301000, 0x10000, "ota_1", 0}, false},
+        {"data not on a 4 KB boundary", {DATA, DataNvs, 0x300800, 0x1000, "nvs2", 0}, false},
+        {"empty partition", {DATA, DataNvs, 0x300000, 0, "nvs2", 0}, false},
+        {"partition over the table", {DATA, DataNvs, 0x8000, 0x1000, "nvs2", 0}, false},
+    };
+    for (const auto& c : cases)
+    {
+        vector<TableEntry> entries = GetDefaultEntries();
+        entries.push_back(c.entry);
+        Check(IsValidPartitionTable(BuildTable(entries, true)) == c.valid, test, c.what);
+    }
+
+    vector<TableEntry> dataOnly = {{DATA, DataNvs, 0x9000, 0x6000, "nvs", 0}};
+    Check(!IsValidPartitionTable(BuildTable(dataOnly, true)), test, "a table needs an app");
+
+    vector<uint8_t> garbage = BuildTable(GetDefaultEntries(), false);
+    garbage[5 * sizeof(EspPartitionEntry)] = 0x12;
+    Check(!IsValidPartitionTable(garbage), test, "garbage after the last entry");
+
+    // The terminator has to fit in ESP_PARTITION_TABLE_MAX_LEN
+    vector<TableEntry> full;
+    for (uint32_t i = 0; i < ESP_PARTITION_TABLE_MAX_LEN / sizeof(EspPartitionEntry); i++)
+        full.push_back({APP, AppFactory, 0x10000 * (i + 1), 0x10000, "app", 0});
+    Check(!IsValidPartitionTable(BuildTable(full, false)), test, "table without a terminator");
+}
+
+static bool ReadBytes(void* context, uint64_t offset, void* dest, size_t length)
+{
+    auto data = static_cast<const vector<uint8_t>*>(context);
+    if (offset > data->size() || data->size() - offset < length)
+        return false;
+    memcpy(dest, data->data() + offset, length);
+    return true;
+}
+
+static void TestFlashScan()
+{
+    const char* test = "flash";
+    const ChipAttr& attr = *GetChipAttrById(EspChipId::ESP32);
+    vector<uint8_t> flash = EspAppBench::BuildSyntheticFlashDump(attr, 0x100000, 0x1000);
+    Check(LooksLikeFlashDump(flash), test, "dump is recognized");
+    Check(LooksLikeFlashDump(flash.size(), ReadBytes, &flash), test, "dump is recognized through a reader");
+
+    FlashLayout layout;
+    Check(ScanFlashDump(flash, layout, 2), test, "scan finds the apps");
+    Check(layout.partition_table_offset == ESP_PARTITION_TABLE_OFFSET, test, "table offset");
+    Check(!layout.has_bootloader, test, "no bootloader in the synthetic dump");
+    Check(layout.apps.size() == 3, test, "one app per app partition");
+    if (layout.apps.size() != 3)
+        return;
+    for (const FlashAppImage& app : layout.apps)
+        Check(app.IsValid() && app.image.base_offset == app.partition.offset, test, "app parses at its partition");
+    Check(!layout.apps[0].IsDuplicate() && !layout.apps[1].IsDuplicate(), test, "distinct apps are not linked");
+    Check(layout.apps[2].duplicate_of == 1, test, "ota_1 is a copy of ota_0");
+    Check(layout.apps[1].content_hash == layout.apps[2].content_hash, test, "copies hash alike");
+    Check(layout.GetDefaultAppIndex() == 0, test, "factory is the default app");
+
+    // The reader scan reads headers only
+    FlashLayout headers;
+    Check(ScanFlashDump(flash.size(), ReadBytes, &flash, headers, 2) && headers.apps.size() == 3, test,
+        "reader scan finds the apps");
+    Check(headers.apps.size() == 3 && headers.apps[2].content_hash == 0 && !headers.apps[2].IsDuplicate(), test,
+        "reader scan does not hash");
+
+    // Without a parsable factory image the lowest OTA slot is loaded
+    flash[0x10000] = 0;
+    Check(ScanFlashDump(flash, layout, 2) && !layout.apps[0].IsValid(), test, "broken factory image");
+    Check(layout.GetDefaultAppIndex() == 1, test, "ota_0 is the fallback");
+
+    // A partition past the end of the dump is listed but does not parse
+    flash.resize(0x60000);
+    Check(ScanFlashDump(flash, layout, 2) && layout.apps.size() == 3, test, "truncated dump keeps the table");
+    Check(layout.apps.size() == 3 && layout.apps[2].status == ImageParseStatus::TooShort, test,
+        "app past the end");
+
+    flash[ESP_PARTITION_TABLE_OFFSET + 3] = 0x30;
+    Check(!LooksLikeFlashDump(flash), test, "malformed table is rejected");
+}
+
+int main()
+{
+    TestParse();
+    TestValidate();
+    TestFlashScan();
+    return Finish("esp_partition_test");
+}
@@ -0,0 +1,117 @@
+// Tests for the analysis seed cache: which hash identifies a build, and the flat file that carries function
+// starts, data variables and names over to the next load. Exits with status 1 if any check fails.
+
+#include "bench_util.h"
+#include "esp_seed_cache.h"
+#include "test_util.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+static void TestKey()
+{
+    const char* test = "key";
+    vector<uint8_t> data = EspAppBench::BuildSyntheticImage(*GetChipAttrById(EspChipId::ESP32_C3), 3, 0x200);
+    EspAppBench::AppendImageTrailer(data);
+    ParsedImage image;
+    Check(ParseImage(data, image) == ImageParseStatus::Ok, test, "image parses");
+
+    // The ELF hash wins and needs no image bytes at all
+    AppDesc desc {};
+    for (size_t i = 0; i < desc.app_elf_sha256.size(); i++)
+        desc.app_elf_sha256[i] = static_cast<uint8_t>(i);
+    string elfKey = GetSeedCacheKey({}, image, &desc);
+    Check(elfKey == "elf-" + DigestToHex(desc.app_elf_sha256), test, "ELF hash key");
+
+    // Then the digest esptool appended, then a hash of the image
+    ImageTrailer trailer = LocateImageTrailer(image);
+    string appendedKey = GetSeedCacheKey(data, image, nullptr);
+    Check(appendedKey == "img-" + DigestToHex(span(data).subspan(trailer.hash_offset, 32)), test,
+        "appended digest key");
+    desc.app_elf_sha256 = {};
+    Check(GetSeedCacheKey(data, image, &desc) == appendedKey, test, "an all-zero ELF hash is absent");
+
+    vector<uint8_t> plain(data.begin(), data.begin() + trailer.hash_offset);
+    plain[23] = 0;
+    ParsedImage plainImage;
+    ParseImage(plain, plainImage);
+    string hashedKey = GetSeedCacheKey(plain, plainImage, nullptr);
+    Check(hashedKey == "img-" + DigestToHex(Sha256::Hash(plain)), test, "image hash key");
+
+    // The key depends on the image, not on where it lies in the file
+    vector<uint8_t> padded(0x1000, 0xFF);
+    padded.insert(padded.end(), plain.begin(), plain.end());
+    ParsedImage paddedImage;
+    ParseImage(padded, paddedImage, 0x1000);
+    Check(GetSeedCacheKey(padded, paddedImage, nullptr) == hashedKey, test, "key of an image at an offset");
+
+    Check(GetSeedCachePath("cache", elfKey) == (filesystem::path("cache") / (elfKey + ".seeds")).string(), test,
+        "path is named after the key");
+}
+
+static void TestStore()
+{
+    const char* test = "store";
+    TempDirectory directory("esp_seed_cache_test");
+    string path = GetSeedCachePath((directory.GetPath() / "seeds").string(), "elf-0011");
+
+    AnalysisSeeds seeds;
+    seeds.function_starts = {0x42000020, 0x42000100, 0x420001F0};
+    seeds.data_vars = {{0x3C000040, "char const[0x10]"}, {0x3FC80000, "struct task_ctx*"}};
+    seeds.names = {{0x42000100, SeedSymbolKind::Function, "app_main"}, {0x3FC80000, SeedSymbolKind::Data, ""}};
+    Check(StoreSeedCache(path, seeds), test, "seeds are stored in a new directory");
+
+    SeedCache cache;
+    Check(cache.Open(path), test, "cache opens");
+    Check(cache.GetFunctionCount() == 3 && cache.GetFunctionStart(2) == 0x420001F0, test, "function starts");
+    Check(cache.GetDataVarCount() == 2 && cache.GetDataVarAddress(1) == 0x3FC80000 &&
+        cache.GetDataVarType(0) == "char const[0x10]", test, "data variables");
+    Check(cache.GetNameCount() == 2 && cache.GetNameAddress(0) == 0x42000100 &&
+        cache.GetNameKind(0) == SeedSymbolKind::Function && cache.GetName(0) == "app_main", test, "names");
+    Check(cache.GetNameKind(1) == SeedSymbolKind::Data && cache.GetName(1).empty(), test, "empty name");
+
+    // Replacing the file leaves the mapped copy intact and nothing else in the directory
+    AnalysisSeeds empty;
+    Check(StoreSeedCache(path, empty), test, "empty seeds are stored");
+    Check(cache.GetFunctionStart(0) == 0x42000020, test, "open cache survives the replacement");
+    SeedCache replaced;
+    Check(replaced.Open(path) && replaced.GetFunctionCount() == 0 && replaced.GetNameCount() == 0, test,
+        "replacement is read");
+    size_t files = 0;
+    for ([[maybe_unused]] const auto& entry : filesystem::directory_iterator(filesystem::path(path).parent_path()))
+        files++;
+    Check(files == 1, test, "no temporary file is left behind");
+
+    // A failed replacement cleans up after itself as well
+    string blocked = GetSeedCachePath((directory.GetPath() / "blocked").string(), "elf-0022");
+    filesystem::create_directories(filesystem::path(blocked) / "entry");
+    Check(!StoreSeedCache(blocked, seeds), test, "a directory in the way fails the store");
+    files = 0;
+    for ([[maybe_unused]] const auto& entry : filesystem::directory_iterator(filesystem::path(blocked).parent_path()))
+        files++;
+    Check(files == 1, test, "no temporary file is left behind after a failure");
+
+    // A truncated or foreign file does not open
+    Check(StoreSeedCache(path, seeds), test, "seeds are stored again");
+    filesystem::resize_file(path, filesystem::file_size(path) - 1);
+    SeedCache truncated;
+    Check(!truncated.Open(path), test, "truncated file is rejected");
+    ofstream(path, ios::binary | ios::trunc) << "ESPSEED2 and then some more bytes to pass the size check";
+    SeedCache foreign;
+    Check(!foreign.Open(path), test, "wrong magic is rejected");
+    SeedCache missing;
+    Check(!missing.Open(directory.GetFile("missing.seeds")), test, "missing file");
+}
+
+int main()
+{
+    TestKey();
+    TestStore();
+    return Finish("esp_seed_cache_test");
+}
@@ -0,0 +1,160 @@
+// Tests for SHA-256 (FIPS 180-2 example vectors, one-shot and streamed) and for image verification: the
+// checksum byte and appended digest esptool writes, incremental verification, truncated and corrupted images
+// and the on-disk result cache. Exits with status 1 if any check fails.
+
+#include "bench_util.h"
+#include "esp_sha256.h"
+#include "esp_verify.h"
+#include "test_util.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+using namespace EspAppTest;
+
+static span<const uint8_t> AsBytes(const string& text)
+{
+    return {reinterpret_cast<const uint8_t*>(text.data()), text.size()};
+}
+
+static void TestSha256()
+{
+    const char* test = "sha256";
+    const struct
+    {
+        string message;
+        const char* digest;
+    } vectors[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+    for (const auto& kat : vectors)
+    {
+        Check(DigestToHex(Sha256::Hash(AsBytes(kat.message))) == kat.digest, test, "one-shot digest");
+
+        // Odd chunk sizes cross the block boundary at every offset
+        Sha256 sha;
+        span<const uint8_t> message = AsBytes(kat.message);
+        for (size_t at = 0, step = 1; at < message.size(); at += step, step = step % 97 + 13)
+            sha.Update(message.subspan(at, min(step, message.size() - at)));
+        Check(DigestToHex(sha.Final()) == kat.digest, test, "streamed digest");
+    }
+
+    Sha256 sha;
+    sha.Update(AsBytes("abc"));
+    sha.Reset();
+    Check(DigestToHex(sha.Final()) == vectors[0].digest, test, "Reset starts over");
+}
+
+static vector<uint8_t> BuildImage()
+{
+    vector<uint8_t> image = EspAppBench::BuildSyntheticImage(*GetChipAttrById(EspChipId::ESP32), 4, 0x301);
+    EspAppBench::AppendImageTrailer(image);
+    return image;
+}
+
+static void TestVerify()
+{
+    const char* test = "verify";
+    vector<uint8_t> data = BuildImage();
+    ParsedImage image;
+    Check(ParseImage(data, image) == ImageParseStatus::Ok, test, "image parses");
+
+    ImageTrailer trailer = LocateImageTrailer(image);
+    Check(trailer.checksum_offset % 16 == 15, test, "checksum ends the 16-byte padding");
+    Check(trailer.hash_offset == trailer.checksum_offset + 1 && trailer.image_end == data.size(), test,
+        "digest follows the checksum");
+
+    ImageVerifyResult result = VerifyImage(data, image);
+    Check(result.IsValid() && result.hash_appended && result.hash_present, test, "esptool trailer verifies");
+    Check(result.hash_computed == Sha256::Hash(span(data).first(trailer.hash_offset)), test,
+        "digest covers everything before it");
+
+    // Small steps reach the same result
+    ImageVerifier verifier(data, image);
+    size_t steps = 0;
+    double progress = 0;
+    bool monotonic = true;
+    while (!verifier.Step(61))
+    {
+        monotonic &= verifier.GetProgress() >= progress;
+        progress = verifier.GetProgress();
+        steps++;
+    }
+    Check(steps > 10 && monotonic && verifier.GetProgress() == 1.0, test, "progress advances to completion");
+    Check(verifier.GetResult().IsValid() && verifier.GetResult().hash_computed == result.hash_computed, test,
+        "incremental verification");
+
+    // A changed data byte breaks both, a changed digest only the hash
+    vector<uint8_t> corrupt = data;
+    corrupt[image.Segments()[2].file_offset + 5] ^= 0x40;
+    result = VerifyImage(corrupt, image);
+    Check(!result.ChecksumValid() && !result.HashValid(), test, "segment data is covered");
+
+    corrupt = data;
+    corrupt[trailer.hash_offset + 31] ^= 1;
+    result = VerifyImage(corrupt, image);
+    Check(result.ChecksumValid() && !result.HashValid(), test, "stored digest is compared");
+
+    // Truncation is reported as missing, not as a mismatch
+    result = VerifyImage(span(data).first(trailer.hash_offset + 16), image);
+    Check(result.ChecksumValid() && result.hash_appended && !result.hash_present && !result.IsValid(), test,
+        "truncated digest");
+    result = VerifyImage(span(data).first(trailer.checksum_offset), image);
+    Check(!result.checksum_present && !result.IsValid(), test, "truncated checksum");
+
+    // Without hash_appended only the checksum counts
+    vector<uint8_t> plain = data;
+    plain[23] = 0;
+    plain.resize(trailer.hash_offset);
+    ParsedImage plainImage;
+    ParseImage(plain, plainImage);
+    result = VerifyImage(plain, plainImage);
+    Check(result.IsValid() && !result.hash_appended, test, "checksum-only image");
+}
+
+static void TestCache()
+{
+    const char* test = "cache";
+    TempDirectory directory("esp_verify_test");
+    string path = directory.GetFile("app.bin");
+    vector<uint8_t> data = BuildImage();
+    ofstream(path, ios::binary).write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    optional<FileIdentity> identity = GetFileIdentity(path);
+    Check(identity && identity->size == data.size(), test, "identity of the file");
+    Check(!GetFileIdentity(directory.GetFile("missing.bin")), test, "no identity for a missing file");
+    if (!identity)
+        return;
+    uint64_t key = GetFileIdentityKey(*identity, 0);
+    Check(key != GetFileIdentityKey(*identity, 0x10000), test, "image offset is part of the key");
+
+    ParsedImage image;
+    ParseImage(data, image);
+    ImageVerifyResult stored = VerifyImage(data, image);
+    stored.checksum_expected ^= 1;
+    string cache = (directory.GetPath() / "cache").string();
+    ImageVerifyResult loaded {};
+    Check(!LoadCachedVerifyResult(cache, key, loaded), test, "empty cache misses");
+    Check(StoreCachedVerifyResult(cache, key, stored), test, "result is stored");
+    Check(LoadCachedVerifyResult(cache, key, loaded), test, "result is loaded");
+    Check(loaded.checksum_present == stored.checksum_present && loaded.checksum_expected == stored.checksum_expected &&
+        loaded.checksum_computed == stored.checksum_computed && loaded.hash_appended == stored.hash_appended &&
+        loaded.hash_present == stored.hash_present && loaded.hash_expected == stored.hash_expected &&
+        loaded.hash_computed == stored.hash_computed, test, "every field round-trips");
+    Check(!LoadCachedVerifyResult(cache, key + 1, loaded), test, "other keys miss");
+}
+
+int main()
+{
+    TestSha256();
+    TestVerify();
+    TestCache();
+    return Finish("esp_verify_test");
+}
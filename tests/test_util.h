@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Shared by the core tests: checks that report and count failures instead of stopping at the first one
+namespace EspAppTest
+{
+    inline size_t g_failures = 0;
+
+    inline void Check(bool ok, const char* test, const char* what)
+    {
+        if (!ok)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            g_failures++;
+        }
+    }
+
+    // Exit status of a test program, with a summary line
+    inline int Finish(const char* name)
+    {
+        if (g_failures)
+        {
+            fprintf(stderr, "%s: %zu checks failed\n", name, g_failures);
+            return 1;
+        }
+        printf("%s: all checks passed\n", name);
+        return 0;
+    }
+
+    // Bytes of a hex string; whitespace is skipped so vectors can be wrapped
+    inline std::vector<uint8_t> FromHex(std::string_view hex)
+    {
+        auto nibble = [](char c) {
+            return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+        };
+        std::vector<uint8_t> out;
+        int high = -1;
+        for (char c : hex)
+        {
+            if (c == ' ' || c == '\n')
+                continue;
+            if (high < 0)
+            {
+                high = nibble(c);
+                continue;
+            }
+            out.push_back(static_cast<uint8_t>(high << 4 | nibble(c)));
+            high = -1;
+        }
+        return out;
+    }
+
+    // Fresh directory below the system temporary directory, removed with everything in it on destruction
+    class TempDirectory
+    {
+        std::filesystem::path m_path;
+
+    public:
+        explicit TempDirectory(const char* name)
+        {
+            std::random_device random;
+            m_path = std::filesystem::temp_directory_path() / (std::string(name) + "-" + std::to_string(random()));
+            std::filesystem::create_directories(m_path);
+        }
+        ~TempDirectory()
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(m_path, ec);
+        }
+        TempDirectory(const TempDirectory&) = delete;
+        TempDirectory& operator=(const TempDirectory&) = delete;
+
+        const std::filesystem::path& GetPath() const { return m_path; }
+        std::string GetFile(const char* name) const { return (m_path / name).string(); }
+    };
+}  // namespace EspAppTest
@@ -0,0 +1,359 @@
+// Headless batch triage of ESP app images and raw flash dumps.
+//
+// Usage: esp_app_triage [-j threads] [--no-verify] [--paths-from <file|->] [path ...]
+// Directories are walked recursively. Every file is memory-mapped and parsed in place with the same core
+// the view uses, and one JSON object per file is written to stdout as a single line. Lines appear in
+// completion order; use the "path" key to match them up. Files that are neither an app image nor a flash
+// dump are reported with "kind": "unknown".
+
+#include "esp_app_desc.h"
+#include "esp_chip.h"
+#include "esp_flash.h"
+#include "esp_image.h"
+#include "esp_json.h"
+#include "esp_layout.h"
+#include "esp_mapped_file.h"
+#include "esp_parallel.h"
+#include "esp_partition.h"
+#include "esp_verify.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+
+namespace
+{
+    struct TriageOptions
+    {
+        size_t threads = 0;
+        bool verify = true;
+    };
+
+    void AppendKey(string& out, const char* key)
+    {
+        if (out.back() != '{')
+            out += ',';
+        AppendJsonString(out, key);
+        out += ':';
+    }
+
+    void AppendField(string& out, const char* key, string_view value)
+    {
+        AppendKey(out, key);
+        AppendJsonString(out, value);
+    }
+
+    void AppendField(string& out, const char* key, const char* value)
+    {
+        AppendField(out, key, string_view(value));
+    }
+
+    void AppendField(string& out, const char* key, uint64_t value)
+    {
+        AppendKey(out, key);
+        out += to_string(value);
+    }
+
+    void AppendField(string& out, const char* key, bool value)
+    {
+        AppendKey(out, key);
+        out += value ? "true" : "false";
+    }
+
+    void AppendAppDesc(string& out, const AppDesc& desc)
+    {
+        AppendKey(out, "app_desc");
+        out += '{';
+        AppendField(out, "project_name", desc.project_name);
+        AppendField(out, "version", desc.version);
+        AppendField(out, "idf_ver", desc.idf_ver);
+        AppendField(out, "date", desc.date);
+        AppendField(out, "time", desc.time);
+        AppendField(out, "secure_version", uint64_t(desc.secure_version));
+        AppendField(out, "app_elf_sha256", DigestToHex(desc.app_elf_sha256));
+        AppendField(out, "address", uint64_t(desc.load_addr));
+        AppendField(out, "identity", GetAppIdentityKey(desc));
+        out += '}';
+    }
+
+    // Header, segments with their regions, layout status, verification and app description of one image
+    void AppendImage(string& out, span<const uint8_t> data, const ParsedImage& image, const TriageOptions& options)
+    {
+        const EspImageHeader& header = image.header;
+        const ChipAttr* attr = GetChipAttrById(image.ChipId());
+        AppendField(out, "offset", image.base_offset);
+        AppendField(out, "size", image.end_offset - image.base_offset);
+        AppendField(out, "chip", attr ? attr->chip_name : "unknown");
+        AppendField(out, "chip_id", uint64_t(header.chip_id));
+        AppendField(out, "entry", uint64_t(header.entry_addr));
+        AppendField(out, "spi_mode", uint64_t(header.spi_mode));
+        AppendField(out, "spi_speed", uint64_t(header.spi_speed_size & 0xF));
+        AppendField(out, "spi_size", uint64_t(header.spi_speed_size >> 4));
+        AppendField(out, "min_chip_rev_full", uint64_t(header.min_chip_rev_full));
+        AppendField(out, "max_chip_rev_full", uint64_t(header.max_chip_rev_full));
+        AppendField(out, "hash_appended", header.hash_appended == 1);
+
+        // Region assignment exactly as the view plans it
+        SegmentRegionMap map {};
+        SegmentMapStatus mapStatus = SegmentMapStatus::NoRegion;
+        if (attr)
+        {
+            RegionIndex index(*attr);
+            mapStatus = MapSegmentsToRegions(index, image.Segments(), map);
+        }
+        AppendField(out, "layout", attr ? GetSegmentMapStatusString(mapStatus) : "unknown chip");
+
+        AppendKey(out, "segments");
+        out += '[';
+        span<const SegmentInfo> segments = image.Segments();
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            if (i)
+                out += ',';
+            out += '{';
+            AppendField(out, "addr", uint64_t(segments[i].load_addr));
+            AppendField(out, "len", uint64_t(segments[i].data_len));
+            AppendField(out, "offset", segments[i].file_offset);
+            bool mapped = mapStatus == SegmentMapStatus::Ok || i < map.failed_segment;
+            if (attr && mapped)
+                AppendField(out, "region", map.regions[i]->name);
+            out += '}';
+        }
+        out += ']';
+
+        if (options.verify)
+        {
+            ImageVerifyResult result = VerifyImage(data, image);
+            AppendField(out, "checksum",
+                !result.checksum_present ? "missing" : result.ChecksumValid() ? "valid" : "invalid");
+            AppendField(out, "sha256",
+                !result.hash_appended ? "absent" :
+                !result.hash_present  ? "missing" :
+                result.HashValid()    ? "valid" :
+                                        "invalid");
+            if (result.hash_appended)
+                AppendField(out, "sha256_computed", DigestToHex(result.hash_computed));
+        }
+
+        AppDesc desc;
+        if (ParseAppDesc(data, image, desc))
+            AppendAppDesc(out, desc);
+    }
+
+    void AppendPartition(string& out, const PartitionInfo& partition)
+    {
+        AppendField(out, "label", partition.label);
+        AppendField(out, "type", GetPartitionTypeName(partition.type));
+        AppendField(out, "subtype", GetPartitionSubtypeName(partition.type, partition.subtype));
+        AppendField(out, "partition_offset", uint64_t(partition.offset));
+        AppendField(out, "partition_size", uint64_t(partition.size));
+        AppendField(out, "encrypted", partition.IsEncrypted());
+    }
+
+    void AppendFlashDump(string& out, span<const uint8_t> data, const FlashLayout& layout, const TriageOptions& options)
+    {
+        AppendField(out, "kind", "flash");
+        AppendField(out, "partition_table_offset", layout.partition_table_offset);
+
+        AppendKey(out, "partitions");
+        out += '[';
+        for (size_t i = 0; i < layout.partitions.size(); i++)
+        {
+            if (i)
+                out += ',';
+            out += '{';
+            AppendPartition(out, layout.partitions[i]);
+            out += '}';
+        }
+        out += ']';
+
+        if (layout.has_bootloader)
+        {
+            AppendKey(out, "bootloader");
+            out += '{';
+            AppendImage(out, data, layout.bootloader, options);
+            out += '}';
+        }
+
+        AppendKey(out, "apps");
+        out += '[';
+        for (size_t i = 0; i < layout.apps.size(); i++)
+        {
+            const FlashAppImage& app = layout.apps[i];
+            if (i)
+                out += ',';
+            out += '{';
+            AppendPartition(out, app.partition);
+            AppendField(out, "status", GetImageParseStatusString(app.status));
+            if (app.IsDuplicate())
+                AppendField(out, "duplicate_of", uint64_t(app.duplicate_of));
+            else if (app.IsValid())
+                AppendImage(out, data, app.image, options);
+            out += '}';
+        }
+        out += ']';
+        AppendField(out, "default_app", uint64_t(layout.GetDefaultAppIndex()));
+    }
+
+    string TriageFile(const string& path, const TriageOptions& options)
+    {
+        string out = "{";
+        AppendField(out, "path", path);
+
+        MappedFile file;
+        if (!file.Open(path))
+        {
+            AppendField(out, "kind", "error");
+            AppendField(out, "error", strerror(errno));
+            out += '}';
+            return out;
+        }
+
+        span<const uint8_t> data = file.GetSpan();
+        AppendField(out, "file_size", uint64_t(data.size()));
+
+        // Same order of checks as EspAppViewType::IsTypeValidForData
+        FlashLayout layout;
+        ParsedImage image;
+        if (LooksLikeFlashDump(data) && ScanFlashDump(data, layout, 1) &&
+            layout.GetDefaultAppIndex() != ESP_FLASH_NO_DUPLICATE)
+        {
+            AppendFlashDump(out, data, layout, options);
+        }
+        else if (ImageParseStatus status = ParseImage(data, image); status == ImageParseStatus::Ok)
+        {
+            AppendField(out, "kind", "app");
+            AppendImage(out, data, image, options);
+        }
+        else
+        {
+            AppendField(out, "kind", "unknown");
+            AppendField(out, "status", GetImageParseStatusString(status));
+            if (status == ImageParseStatus::TruncatedSegmentHeader || status == ImageParseStatus::TruncatedSegmentData)
+            {
+                AppendField(out, "failed_segment", uint64_t(image.failed_segment));
+                AppendField(out, "error_offset", image.error_offset);
+            }
+        }
+        out += '}';
+        return out;
+    }
+
+    void AddPath(const string& path, vector<string>& files)
+    {
+        error_code ec;
+        if (!filesystem::is_directory(path, ec))
+        {
+            files.push_back(path);
+            return;
+        }
+
+        for (auto it = filesystem::recursive_directory_iterator(path, ec);
+             !ec && it != filesystem::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (it->is_regular_file(ec))
+                files.push_back(it->path().string());
+        }
+        if (ec)
+            fprintf(stderr, "warning: %s: %s\n", path.c_str(), ec.message().c_str());
+    }
+
+    // One path per line from `list`, or from stdin for "-"
+    bool AddPathsFrom(const string& list, vector<string>& files)
+    {
+        ifstream stream;
+        if (list != "-")
+        {
+            stream.open(list);
+            if (!stream)
+                return false;
+        }
+        istream& in = list == "-" ? cin : stream;
+
+        string line;
+        while (getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                AddPath(line, files);
+        }
+        return true;
+    }
+
+    void PrintUsage()
+    {
+        fprintf(stderr,
+            "Usage: esp_app_triage [-j threads] [--no-verify] [--paths-from <file|->] [path ...]\n"
+            "Writes one JSON object per file to stdout. Directories are walked recursively.\n");
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    TriageOptions options;
+    vector<string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+        {
+            options.threads = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--no-verify")
+        {
+            options.verify = false;
+        }
+        else if (arg == "--paths-from" && i + 1 < argc)
+        {
+            if (!AddPathsFrom(argv[++i], files))
+            {
+                fprintf(stderr, "error: cannot read path list %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            AddPath(arg, files);
+        }
+    }
+
+    if (files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Files are handed out one at a time, so a few large flash dumps do not hold up thousands of small images.
+    // Each result is written as soon as it is ready; the lock only covers the write of one finished line.
+    mutex outputMutex;
+    ParallelFor(files.size(), [&](size_t i) {
+        string line = TriageFile(files[i], options);
+        line += '\n';
+        lock_guard<mutex> lock(outputMutex);
+        fwrite(line.data(), 1, line.size(), stdout);
+    }, options.threads);
+    fflush(stdout);
+    return 0;
+}
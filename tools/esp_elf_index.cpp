@@ -0,0 +1,78 @@
+// Build or update the app ELF index of one or more directories.
+//
+// Usage: esp_elf_index [-j threads] <directory ...>
+// Every ELF32 file below a directory is indexed by its SHA-256 (the app description's app_elf_sha256) in
+// esp_elf_index.bin at the top of the directory. Files that did not change since the previous run are not
+// hashed again, so updating the index of a large build archive after adding a few builds is quick.
+
+#include "esp_elf_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace EspApp;
+
+namespace
+{
+    void PrintUsage()
+    {
+        fprintf(stderr,
+            "Usage: esp_elf_index [-j threads] <directory ...>\n"
+            "Indexes the ELF files below each directory by SHA-256 for the ESP-APP view's ELF sidecar lookup.\n");
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    size_t threads = 0;
+    vector<string> directories;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+        {
+            threads = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            directories.push_back(arg);
+        }
+    }
+
+    if (directories.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    int status = 0;
+    for (const string& directory : directories)
+    {
+        auto start = chrono::steady_clock::now();
+        ElfIndexStats stats;
+        if (!BuildElfIndex(directory, &stats, threads))
+        {
+            fprintf(stderr, "error: cannot index %s\n", directory.c_str());
+            status = 1;
+            continue;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("%s: %zu ELF files, %zu hashed, %zu removed (%.2f s)\n", directory.c_str(), stats.files, stats.hashed,
+            stats.removed, seconds);
+    }
+    return status;
+}